@@ -5,6 +5,7 @@
 #include "input_ctrl.h"
 #include "mqtt_link.h"
 #include "cJSON.h"
+#include "json_wr.h"
 #include "esp_log.h"
 #include <string.h>
 #include <stdio.h>
@@ -15,6 +16,8 @@
 #include "router.h"
 
 #define LENOF(a) ((int)(sizeof(a)/sizeof((a)[0])))
+#define CFG_STR_(x) #x
+#define CFG_STR(x)  CFG_STR_(x)
 
 static const char *TAG = "cfg_mqtt";
 
@@ -99,13 +102,15 @@ static void publish_cfg_state(const char *local_dev, const char *corr_id,
     snprintf(topic, sizeof(topic), "Devices/%s/State", local_dev);
 
     char body[256];
-    int n = snprintf(body, sizeof(body),
-        "{ \"corr_id\":\"%s\",\"dev\":\"%s\",\"type\":\"CONFIG\",\"status\":\"%s\"",
-        corr_id ? corr_id : "", local_dev, status);
-    if (detail && *detail) n += snprintf(body+n, sizeof(body)-n, ",\"detail\":\"%s\"", detail);
-    snprintf(body+n, sizeof(body)-n, " }");
-
-    mqtt_link_publish_cb(topic, body, /*qos=*/1, /*retain=*/false);
+    jw_t w; jw_init(&w, body, sizeof body);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", corr_id ? corr_id : "");
+    jw_str(&w, "dev",     local_dev);
+    jw_str(&w, "type",    "CONFIG");
+    jw_str(&w, "status",  status);
+    if (detail && *detail) jw_str(&w, "detail", detail);
+    jw_obj_end(&w);
+    if (jw_done(&w)) mqtt_link_publish_cb(topic, body, /*qos=*/1, /*retain=*/false);
 }
 
 static const char* read_opt_str(cJSON *obj, const char *key, char *out, size_t outsz){
@@ -203,12 +208,39 @@ static void cfg_emit_hello_now(const cfg_t *cfg){
     cJSON_AddItemToObject(in, "debounce_ms", in_db);
     cJSON_AddItemToObject(h, "inputs", in);
 
+    // positie in de mesh → vlootregister op de root (laag, RSSI naar de parent)
+    mesh_link_info_t li;
+    if (mesh_get_link_info(&li) == MESH_OK) {
+        cJSON *m = cJSON_CreateObject();
+        cJSON_AddNumberToObject(m, "layer", li.layer);
+        cJSON_AddNumberToObject(m, "rssi",  li.rssi);
+        cJSON_AddItemToObject(h, "mesh", m);
+    }
+
+    // groepen → root leert hieruit het lidmaatschap
+    cJSON *grp = cJSON_CreateArray();
+    for (int i=0;i<cfg->group_count;i++) cJSON_AddItemToArray(grp, cJSON_CreateString(cfg->groups[i]));
+    cJSON_AddItemToObject(h, "groups", grp);
+
     // via mesh naar root → root publiceert retained Info
     router_emit_event(ML_KIND_DIAG, /*corr_id*/0, /*origin*/NULL, h);
     cJSON_Delete(h);
 }
 
 
+// groepen uit de config → mesh (group-IDs, ontvangen van groepsframes) + router (root als lid)
+static void cfg_apply_groups(const cfg_t *cfg){
+    const char *names[CFG_GROUPS_MAX];
+    for (int i=0;i<cfg->group_count;i++) names[i] = cfg->groups[i];
+    (void)mesh_set_groups(names, cfg->group_count);
+    router_set_groups(cfg->dev_name, names, cfg->group_count);
+}
+
+void cfg_groups_apply(void){
+    const cfg_t *cfg = config_get_cached();
+    if (cfg) cfg_apply_groups(cfg);
+}
+
 void cfg_publish_hello_now(void){
     const cfg_t *cfg = config_get_cached();
     if (cfg) cfg_emit_hello_now(cfg);
@@ -342,6 +374,27 @@ void cfg_mqtt_handle(const char *json, const char *local_dev)
         }
     }
 
+    // ===== groups =====
+    cJSON *grp = cJSON_GetObjectItemCaseSensitive(root, "groups");
+    if (grp) {
+        if (!cJSON_IsArray(grp) || cJSON_GetArraySize(grp) > CFG_GROUPS_MAX) {
+            cJSON_Delete(root); publish_cfg_state(local_dev, corr_id, "ERROR", "groups invalid (max " CFG_STR(CFG_GROUPS_MAX) ")"); return;
+        }
+        int n = 0;
+        cJSON *it;
+        cJSON_ArrayForEach(it, grp) {
+            // naam komt in een topic (Groups/<naam>/State)
+            if (!cJSON_IsString(it) || !it->valuestring[0] || strlen(it->valuestring) >= CFG_GROUP_NAME ||
+                strpbrk(it->valuestring, "/+#")) {
+                cJSON_Delete(root); publish_cfg_state(local_dev, corr_id, "ERROR", "groups: name 1..15 chars, no '/', '+', '#'"); return;
+            }
+            snprintf(tmp.groups[n++], CFG_GROUP_NAME, "%s", it->valuestring);
+        }
+        for (int i=n;i<CFG_GROUPS_MAX;i++) tmp.groups[i][0] = '\0';
+        tmp.group_count = n;
+        any_change = true;
+    }
+
     if (!any_change) { cJSON_Delete(root); publish_cfg_state(local_dev, corr_id, "ERROR", "NO_EFFECT"); return; }
 
     // ===== Drivers herstarten (re-init met nieuwe mapping) =====
@@ -398,6 +451,7 @@ void cfg_mqtt_handle(const char *json, const char *local_dev)
     ESP_LOGI(TAG, "full config applied: relays=%d pwm=%d inputs=%d",
             tmp.relay_count, tmp.pwm_count, tmp.input_count);
     
+    cfg_apply_groups(&tmp);
     cfg_emit_hello_now(&tmp);
 
     if (name_changed) {
@@ -13,6 +13,10 @@ void cfg_mqtt_handle(const char *json, const char *local_dev);
 
 void cfg_publish_hello_now(void);
 
+// Groepen uit de config toepassen: mesh-groepsadressen + root-lidmaatschap in de router.
+// Eén keer na router_init(); Config/Set met "groups" doet het zelf.
+void cfg_groups_apply(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -60,6 +60,9 @@ esp_err_t config_reset_defaults(cfg_t *out){
     out->input_pulldown_mask = 0;
     out->input_inverted_mask = 0;
 
+    // GROEPEN
+    out->group_count = 0;
+
     return ESP_OK;
 }
 
@@ -69,6 +72,7 @@ bool config_validate(const cfg_t *c){
     if(c->relay_count<0 || c->relay_count>RELAY_CH_MAX) return false;
     if(c->pwm_count  <0 || c->pwm_count  >PWM_CH_MAX)   return false;
     if(c->input_count<0 || c->input_count>INPUT_CH_MAX) return false;
+    if(c->group_count<0 || c->group_count>CFG_GROUPS_MAX) return false;
 
     // gpio range/unique check (lichte)
     // (optioneel uitbreiden: geen -1 dubbel controleren)
@@ -131,6 +135,10 @@ esp_err_t config_load(cfg_t *out){
     nvs_read_u32("in_inv", &tmp.input_inverted_mask);
     nvs_read_blob("in_db", tmp.input_debounce_ms, sizeof(tmp.input_debounce_ms));
 
+    // groepen (ontbreken bij oudere config → geen)
+    nvs_read_u32("gr_n", (uint32_t*)&tmp.group_count);
+    nvs_read_blob("gr", tmp.groups, sizeof(tmp.groups));
+
     if(!config_validate(&tmp)) return ESP_ERR_INVALID_STATE;
     *out = tmp;
     return ESP_OK;
@@ -164,6 +172,10 @@ static esp_err_t save_to_nvs_atomic(const cfg_t *c){
     ESP_ERROR_CHECK(nvs_write_u32("in_inv", c->input_inverted_mask));
     ESP_ERROR_CHECK(nvs_write_blob("in_db", c->input_debounce_ms, sizeof(c->input_debounce_ms)));
 
+    // groepen
+    ESP_ERROR_CHECK(nvs_write_u32("gr_n", c->group_count));
+    ESP_ERROR_CHECK(nvs_write_blob("gr", c->groups, sizeof(c->groups)));
+
     // als alles ok: versie schrijven
     ESP_ERROR_CHECK(nvs_write_u32("v", VER_CUR));
 
@@ -273,6 +285,18 @@ esp_err_t config_set_input_debounce(int ch, uint32_t ms){
     return ESP_OK;
 }
 
+/* groepen */
+esp_err_t config_set_groups(const char *const *names, int count){
+    if((count && !names) || count<0 || count>CFG_GROUPS_MAX) return ESP_ERR_INVALID_ARG;
+    for(int i=0;i<count;i++) if(!names[i] || !names[i][0] || strlen(names[i])>=CFG_GROUP_NAME) return ESP_ERR_INVALID_ARG;
+    lock();
+    s_cfg.group_count = count;
+    memset(s_cfg.groups, 0, sizeof(s_cfg.groups));
+    for(int i=0;i<count;i++) strlcpy(s_cfg.groups[i], names[i], CFG_GROUP_NAME);
+    unlock();
+    return ESP_OK;
+}
+
 /* commit */
 esp_err_t config_commit(void){
     lock(); esp_err_t r = save_to_nvs_atomic(&s_cfg); unlock();
@@ -16,6 +16,10 @@ extern "C" {
 #ifndef INPUT_CH_MAX
 #define INPUT_CH_MAX 16
 #endif
+#ifndef CFG_GROUPS_MAX
+#define CFG_GROUPS_MAX 4
+#endif
+#define CFG_GROUP_NAME 16   // incl. '\0'
 
 typedef struct {
     char     dev_name[32];
@@ -41,6 +45,10 @@ typedef struct {
     uint32_t input_inverted_mask;
     uint32_t input_debounce_ms[INPUT_CH_MAX];
 
+    // GROEPEN (fan-out: Cmd/Set met "group")
+    int      group_count;
+    char     groups[CFG_GROUPS_MAX][CFG_GROUP_NAME];
+
     // versie
     uint32_t version;  // =1
 } cfg_t;
@@ -71,6 +79,9 @@ esp_err_t   config_set_inputs(const int *gpio, int count);
 esp_err_t   config_set_input_masks(uint32_t pullup, uint32_t pulldown, uint32_t inverted);
 esp_err_t   config_set_input_debounce(int ch, uint32_t ms);
 
+/* Groepen */
+esp_err_t   config_set_groups(const char *const *names, int count);
+
 /* Commit RAM->NVS (atomic) */
 esp_err_t   config_commit(void);
 
@@ -0,0 +1,71 @@
+// json_wr.h
+#pragma once
+// Streaming JSON-writer voor State/Status/Info: schrijft rechtstreeks in een buffer
+// van de caller (stack/static) of uit een kleine vaste pool. Geen heap, geen DOM.
+// Overflow is sticky: jw_done() geeft dan NULL en er wordt niets gepubliceerd.
+//
+//   char body[192]; jw_t w; jw_init(&w, body, sizeof body);
+//   jw_obj(&w, NULL);
+//   jw_str(&w, "dev", dev); jw_int(&w, "io_id", 3);
+//   jw_obj_end(&w);
+//   if (jw_done(&w)) mqtt_link_publish(topic, body, 1, false);
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef JW_DEPTH_MAX
+#define JW_DEPTH_MAX   16     // nesting (objecten + arrays)
+#endif
+#ifndef JW_POOL_SLOTS
+#define JW_POOL_SLOTS  3      // grote payloads (batch-State, Info, doorgestuurde EVENTs)
+#endif
+#ifndef JW_POOL_BUF
+#define JW_POOL_BUF    1536
+#endif
+
+typedef struct {
+    char     *buf;
+    size_t    cap;
+    size_t    len;        // zonder afsluitende '\0'
+    uint32_t  more;       // bit d: diepte d heeft al een element (→ komma)
+    uint8_t   depth;
+    bool      overflow;
+    int8_t    slot;       // pool-slot of -1 (buffer van de caller)
+} jw_t;
+
+// Buffer van de caller
+void jw_init(jw_t *w, char *buf, size_t cap);
+// Buffer uit de pool (thread-safe); false = pool leeg → caller valt terug of laat vallen
+bool jw_init_pooled(jw_t *w);
+void jw_release(jw_t *w);              // pool-buffer teruggeven (no-op voor caller-buffers)
+
+// key = NULL binnen een array of voor de root-waarde
+void jw_obj(jw_t *w, const char *key);
+void jw_obj_end(jw_t *w);
+void jw_arr(jw_t *w, const char *key);
+void jw_arr_end(jw_t *w);
+
+void jw_str(jw_t *w, const char *key, const char *v);   // v == NULL → null
+void jw_int(jw_t *w, const char *key, int64_t v);
+void jw_uint(jw_t *w, const char *key, uint64_t v);
+void jw_bool(jw_t *w, const char *key, bool v);
+void jw_null(jw_t *w, const char *key);
+
+// Bestaande cJSON-boom serialiseren (zelfde uitvoer als cJSON_PrintUnformatted)
+void jw_cjson(jw_t *w, const char *key, const cJSON *item);
+// Enkel de velden van een object, in het open object van w (velden bijvoegen zonder kopie)
+void jw_cjson_fields(jw_t *w, const cJSON *obj);
+
+// '\0'-afgesloten resultaat, of NULL bij overflow/onafgesloten nesting
+const char *jw_done(jw_t *w);
+static inline size_t jw_len(const jw_t *w) { return w->len; }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,188 @@
+// json_wr.c
+#include "json_wr.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdatomic.h>
+
+// ------------ pool ------------
+static char        s_pool[JW_POOL_SLOTS][JW_POOL_BUF];
+static atomic_uint s_pool_used;   // bit i = slot i in gebruik
+
+void jw_init(jw_t *w, char *buf, size_t cap){
+    w->buf = buf; w->cap = cap; w->len = 0;
+    w->more = 0; w->depth = 0; w->slot = -1;
+    w->overflow = (!buf || cap == 0);
+    if (!w->overflow) buf[0] = '\0';
+}
+
+bool jw_init_pooled(jw_t *w){
+    unsigned used = atomic_load(&s_pool_used);
+    for (int i = 0; i < JW_POOL_SLOTS; ++i) {
+        unsigned bit = 1u << i;
+        while (!(used & bit)) {
+            if (atomic_compare_exchange_weak(&s_pool_used, &used, used | bit)) {
+                jw_init(w, s_pool[i], JW_POOL_BUF);
+                w->slot = (int8_t)i;
+                return true;
+            }
+        }
+    }
+    jw_init(w, NULL, 0);   // overflow: schrijven is veilig, jw_done() geeft NULL
+    return false;
+}
+
+void jw_release(jw_t *w){
+    if (!w || w->slot < 0) return;
+    atomic_fetch_and(&s_pool_used, ~(1u << w->slot));
+    w->slot = -1;
+    w->buf = NULL; w->cap = 0; w->overflow = true;
+}
+
+// ------------ intern ------------
+static void put(jw_t *w, const char *s, size_t n){
+    if (w->overflow) return;
+    if (w->len + n + 1 > w->cap) { w->overflow = true; return; }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+    w->buf[w->len] = '\0';
+}
+
+static void putc_(jw_t *w, char c){ put(w, &c, 1); }
+
+static void put_escaped(jw_t *w, const char *s){
+    static const char hex[] = "0123456789abcdef";
+    putc_(w, '"');
+    const char *run = s;   // stuk zonder escapes in één memcpy
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 32 && c != '"' && c != '\\') continue;
+        put(w, run, (size_t)(s - run));
+        char e[6] = { '\\', 0 };
+        size_t n = 2;
+        switch (c) {
+            case '"':  e[1] = '"';  break;
+            case '\\': e[1] = '\\'; break;
+            case '\b': e[1] = 'b';  break;
+            case '\f': e[1] = 'f';  break;
+            case '\n': e[1] = 'n';  break;
+            case '\r': e[1] = 'r';  break;
+            case '\t': e[1] = 't';  break;
+            default:   // zoals cJSON: \u00XX
+                e[1] = 'u'; e[2] = '0'; e[3] = '0'; e[4] = hex[c >> 4]; e[5] = hex[c & 15]; n = 6;
+                break;
+        }
+        put(w, e, n);
+        run = s + 1;
+    }
+    put(w, run, (size_t)(s - run));
+    putc_(w, '"');
+}
+
+// komma + key vóór elke waarde
+static void prefix(jw_t *w, const char *key){
+    if (w->depth) {
+        uint32_t bit = 1u << (w->depth - 1);
+        if (w->more & bit) putc_(w, ',');
+        w->more |= bit;
+    }
+    if (key) { put_escaped(w, key); putc_(w, ':'); }
+}
+
+static void open_(jw_t *w, const char *key, char c){
+    prefix(w, key);
+    if (w->depth >= JW_DEPTH_MAX) { w->overflow = true; return; }
+    putc_(w, c);
+    w->depth++;
+    w->more &= ~(1u << (w->depth - 1));
+}
+
+static void close_(jw_t *w, char c){
+    if (!w->depth) { w->overflow = true; return; }
+    w->depth--;
+    putc_(w, c);
+}
+
+// ------------ API ------------
+void jw_obj(jw_t *w, const char *key)  { open_(w, key, '{'); }
+void jw_obj_end(jw_t *w)               { close_(w, '}'); }
+void jw_arr(jw_t *w, const char *key)  { open_(w, key, '['); }
+void jw_arr_end(jw_t *w)               { close_(w, ']'); }
+
+void jw_str(jw_t *w, const char *key, const char *v){
+    prefix(w, key);
+    if (v) put_escaped(w, v); else put(w, "null", 4);
+}
+
+void jw_int(jw_t *w, const char *key, int64_t v){
+    char tmp[24];
+    int n = snprintf(tmp, sizeof tmp, "%" PRId64, v);
+    prefix(w, key);
+    put(w, tmp, (size_t)n);
+}
+
+void jw_uint(jw_t *w, const char *key, uint64_t v){
+    char tmp[24];
+    int n = snprintf(tmp, sizeof tmp, "%" PRIu64, v);
+    prefix(w, key);
+    put(w, tmp, (size_t)n);
+}
+
+void jw_bool(jw_t *w, const char *key, bool v){
+    prefix(w, key);
+    if (v) put(w, "true", 4); else put(w, "false", 5);
+}
+
+void jw_null(jw_t *w, const char *key){
+    prefix(w, key);
+    put(w, "null", 4);
+}
+
+// getal zoals cJSON print_number(): int als exact, anders %1.15g (of %1.17g voor round-trip)
+static void put_number(jw_t *w, const cJSON *it){
+    char tmp[32];
+    double d = it->valuedouble;
+    int n;
+    if (isnan(d) || isinf(d))              n = snprintf(tmp, sizeof tmp, "null");
+    else if (d == (double)it->valueint)    n = snprintf(tmp, sizeof tmp, "%d", it->valueint);
+    else {
+        n = snprintf(tmp, sizeof tmp, "%1.15g", d);
+        if (strtod(tmp, NULL) != d) n = snprintf(tmp, sizeof tmp, "%1.17g", d);
+    }
+    put(w, tmp, (size_t)n);
+}
+
+void jw_cjson_fields(jw_t *w, const cJSON *obj){
+    if (!obj) return;
+    for (const cJSON *c = obj->child; c; c = c->next) jw_cjson(w, c->string, c);
+}
+
+void jw_cjson(jw_t *w, const char *key, const cJSON *it){
+    if (!it) { jw_null(w, key); return; }
+    switch (it->type & 0xFF) {
+        case cJSON_False:  jw_bool(w, key, false); break;
+        case cJSON_True:   jw_bool(w, key, true);  break;
+        case cJSON_NULL:   jw_null(w, key);        break;
+        case cJSON_Number: prefix(w, key); put_number(w, it); break;
+        case cJSON_String: jw_str(w, key, it->valuestring ? it->valuestring : ""); break;
+        case cJSON_Raw:    prefix(w, key); if (it->valuestring) put(w, it->valuestring, strlen(it->valuestring)); break;
+        case cJSON_Array:
+            jw_arr(w, key);
+            for (const cJSON *c = it->child; c; c = c->next) jw_cjson(w, NULL, c);
+            jw_arr_end(w);
+            break;
+        case cJSON_Object:
+            jw_obj(w, key);
+            jw_cjson_fields(w, it);
+            jw_obj_end(w);
+            break;
+        default: jw_null(w, key); break;
+    }
+}
+
+const char *jw_done(jw_t *w){
+    if (w->overflow || w->depth) return NULL;
+    return w->buf;
+}
@@ -0,0 +1,75 @@
+// lat_trace.h
+#pragma once
+// Latency per pijplijn-stap voor een steekproef van de commando's (1 op LAT_SAMPLE_EVERY).
+// Een trace start in MQTT_EVENT_DATA (MQTT-taak), volgt vanaf router_handle de corr_id
+// en eindigt wanneer de State gepubliceerd is. Elke mark telt de tijd sinds de vorige
+// mark bij één stap op, in een log2-histogram per io_kind. Geen heap; niet-gesampelde
+// commando's kosten één vergelijking per hook.
+//
+//   MQTT_EVENT_DATA ─COPY─ parse ─PARSE─ router_handle ─ROUTE─ lane ─QUEUE─
+//   uitgevoerd/verstuurd ─DISPATCH─ [mesh heen+terug ─MESH─ / child ─CHILD_EXEC─]
+//   State gepubliceerd ─PUBLISH─            TOTAL = MQTT_EVENT_DATA → State
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LAT_SAMPLE_EVERY
+#define LAT_SAMPLE_EVERY  8       // 1 op N commando's; 0 = uit
+#endif
+#ifndef LAT_SLOTS
+#define LAT_SLOTS         8       // traces tegelijk onderweg (na router_handle)
+#endif
+#ifndef LAT_TRACE_MAX_MS
+#define LAT_TRACE_MAX_MS  5000    // ouder = verloren (geen antwoord, coalesced, shadow, ...)
+#endif
+
+#define LAT_KINDS    3            // IO_RELAY, IO_PWM, IO_INPUT (parser.h)
+#define LAT_BUCKETS  16
+#define LAT_EDGE0_US 64           // bucket 0: < 64 µs; bucket b: < 64·2^b µs; laatste: >= ~1 s
+
+typedef enum {
+    LAT_COPY = 0,     // MQTT_EVENT_DATA → topic/payload gekopieerd
+    LAT_PARSE,        // → parser klaar
+    LAT_ROUTE,        // → router_handle aanvaard (dedup, shadow, lane)
+    LAT_QUEUE,        // → lane-taak neemt het commando op
+    LAT_DISPATCH,     // → lokaal uitgevoerd, of mesh-frame verstuurd/in het coalescing-venster
+    LAT_CHILD_EXEC,   // child: REQUEST → EVENT (uit de envelop)
+    LAT_MESH,         // verstuurd → EVENT op de root, zonder CHILD_EXEC
+    LAT_PUBLISH,      // → State opgebouwd en gepubliceerd
+    LAT_TOTAL,
+    LAT_STAGES
+} lat_stage_t;
+
+typedef struct {
+    uint32_t n;
+    uint32_t max_us;
+    uint32_t hist[LAT_BUCKETS];
+} lat_hist_t;
+
+typedef struct {
+    lat_hist_t st[LAT_STAGES];
+} lat_stats_t;
+
+const char *lat_stage_name(lat_stage_t st);   // "copy", "parse", ...
+uint32_t    lat_bucket_edge_us(int b);        // bovengrens van bucket b (exclusief)
+
+// MQTT-taak (één "huidige" trace, nog zonder corr)
+void lat_rx_begin(void);                      // sample-beslissing, t0
+void lat_rx_mark(lat_stage_t st);             // LAT_COPY / LAT_PARSE
+// router_handle: huidige trace volgt voortaan corr (+ LAT_ROUTE). No-op als niet gesampeld.
+void lat_bind(uint64_t corr, uint8_t kind);
+// Willekeurige taak; no-op als corr geen trace heeft
+void lat_mark(uint64_t corr, lat_stage_t st);
+void lat_event(uint64_t corr, uint32_t child_exec_us);   // EVENT op de root: CHILD_EXEC + MESH
+void lat_done(uint64_t corr);                 // State gepubliceerd: PUBLISH + TOTAL, trace klaar
+void lat_drop(uint64_t corr);                 // trace weggooien (bv. lane vol)
+
+void lat_stats_get(lat_stats_t out[LAT_KINDS], uint32_t *lost, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,160 @@
+// lat_trace.c
+#include "lat_trace.h"
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    uint64_t corr;       // 0 = vrij
+    uint8_t  kind;
+    int64_t  t0_us;      // MQTT_EVENT_DATA
+    int64_t  last_us;    // vorige mark
+} lat_slot_t;
+
+static const char *const s_names[LAT_STAGES] = {
+    "copy", "parse", "route", "queue", "dispatch", "child_exec", "mesh", "publish", "total"
+};
+
+static portMUX_TYPE  s_mux = portMUX_INITIALIZER_UNLOCKED;
+static lat_slot_t    s_slot[LAT_SLOTS];
+static volatile int  s_live;                  // bezette slots (snelle no-op zonder traces)
+static lat_stats_t   s_stats[LAT_KINDS];
+static uint32_t      s_lost;
+
+// huidige trace van de MQTT-taak (vóór de corr gekend is)
+static struct {
+    bool     on;
+    int64_t  t0_us, last_us;
+    uint32_t d[LAT_ROUTE];                    // COPY, PARSE
+} s_cur;
+static uint32_t s_seq;
+
+const char *lat_stage_name(lat_stage_t st) {
+    return (st >= 0 && st < LAT_STAGES) ? s_names[st] : "?";
+}
+
+uint32_t lat_bucket_edge_us(int b) {
+    return (uint32_t)LAT_EDGE0_US << b;
+}
+
+static int bucket(uint32_t us) {
+    int b = 0;
+    for (uint32_t v = us / LAT_EDGE0_US; v && b < LAT_BUCKETS - 1; v >>= 1) b++;
+    return b;
+}
+
+static uint32_t clamp_us(int64_t d) {
+    return d <= 0 ? 0 : d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+}
+
+static void record_unsafe(uint8_t kind, lat_stage_t st, uint32_t us) {
+    lat_hist_t *h = &s_stats[kind].st[st];
+    h->n++;
+    if (us > h->max_us) h->max_us = us;
+    h->hist[bucket(us)]++;
+}
+
+static lat_slot_t *find_unsafe(uint64_t corr) {
+    for (int i = 0; i < LAT_SLOTS; ++i) if (s_slot[i].corr == corr) return &s_slot[i];
+    return NULL;
+}
+
+static void free_unsafe(lat_slot_t *s) {
+    s->corr = 0;
+    s_live--;
+}
+
+// ---------- MQTT-taak ----------
+void lat_rx_begin(void) {
+    s_cur.on = LAT_SAMPLE_EVERY && (++s_seq % LAT_SAMPLE_EVERY) == 0;
+    if (!s_cur.on) return;
+    s_cur.t0_us = s_cur.last_us = esp_timer_get_time();
+    memset(s_cur.d, 0, sizeof s_cur.d);
+}
+
+void lat_rx_mark(lat_stage_t st) {
+    if (!s_cur.on || st >= LAT_ROUTE) return;
+    int64_t now = esp_timer_get_time();
+    s_cur.d[st] = clamp_us(now - s_cur.last_us);
+    s_cur.last_us = now;
+}
+
+void lat_bind(uint64_t corr, uint8_t kind) {
+    if (!s_cur.on) return;
+    s_cur.on = false;                         // één bind per trace (batch/herhaling: niet)
+    if (!corr || kind >= LAT_KINDS) return;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_mux);
+    lat_slot_t *s = NULL, *oldest = NULL;
+    for (int i = 0; i < LAT_SLOTS; ++i) {
+        lat_slot_t *c = &s_slot[i];
+        if (c->corr && now - c->t0_us > (int64_t)LAT_TRACE_MAX_MS * 1000) { free_unsafe(c); s_lost++; }
+        if (!c->corr) { if (!s) s = c; }
+        else if (!oldest || c->t0_us < oldest->t0_us) oldest = c;
+    }
+    if (!s) { s = oldest; free_unsafe(s); s_lost++; }   // vol: oudste trace opgeven
+    record_unsafe(kind, LAT_COPY,  s_cur.d[LAT_COPY]);
+    record_unsafe(kind, LAT_PARSE, s_cur.d[LAT_PARSE]);
+    record_unsafe(kind, LAT_ROUTE, clamp_us(now - s_cur.last_us));
+    s->corr = corr; s->kind = kind;
+    s->t0_us = s_cur.t0_us; s->last_us = now;
+    s_live++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// ---------- alle taken ----------
+void lat_mark(uint64_t corr, lat_stage_t st) {
+    if (!s_live || !corr || st >= LAT_STAGES) return;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    lat_slot_t *s = find_unsafe(corr);
+    if (s) {
+        record_unsafe(s->kind, st, clamp_us(now - s->last_us));
+        s->last_us = now;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void lat_event(uint64_t corr, uint32_t child_exec_us) {
+    if (!s_live || !corr) return;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    lat_slot_t *s = find_unsafe(corr);
+    if (s) {
+        uint32_t rtt = clamp_us(now - s->last_us);
+        if (child_exec_us) record_unsafe(s->kind, LAT_CHILD_EXEC, child_exec_us);
+        record_unsafe(s->kind, LAT_MESH, rtt > child_exec_us ? rtt - child_exec_us : 0);
+        s->last_us = now;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void lat_done(uint64_t corr) {
+    if (!s_live || !corr) return;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    lat_slot_t *s = find_unsafe(corr);
+    if (s) {
+        record_unsafe(s->kind, LAT_PUBLISH, clamp_us(now - s->last_us));
+        record_unsafe(s->kind, LAT_TOTAL,   clamp_us(now - s->t0_us));
+        free_unsafe(s);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void lat_drop(uint64_t corr) {
+    if (!s_live || !corr) return;
+    portENTER_CRITICAL(&s_mux);
+    lat_slot_t *s = find_unsafe(corr);
+    if (s) free_unsafe(s);
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void lat_stats_get(lat_stats_t out[LAT_KINDS], uint32_t *lost, bool reset) {
+    portENTER_CRITICAL(&s_mux);
+    if (out) memcpy(out, s_stats, sizeof s_stats);
+    if (lost) *lost = s_lost;
+    if (reset) { memset(s_stats, 0, sizeof s_stats); s_lost = 0; }
+    portEXIT_CRITICAL(&s_mux);
+}
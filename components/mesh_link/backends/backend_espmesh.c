@@ -2,9 +2,13 @@
 // ESP-WIFI-MESH backend: request/response + event + route diag with MQTT publishing
 
 #include "mesh_link.h"
+#include "mesh_wire.h"
+#include "mesh_fleet.h"
+#include "mesh_time.h"
 #include "mqtt_link.h"
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
@@ -47,14 +51,70 @@
 
 #define LOG_TAG "backend_espmesh"
 #define MESH_PAYLOAD_MAX   1024
-#define MAX_PEERS          16
 #define MAX_PENDING        16
+#define MESH_PEND_TICK_MS  100   // resolutie van async timeouts en retransmits
+#define MESH_TIME_TICK_MS  250   // root: vervallen tijd-probes versturen (hoogstens 4 per tick)
+#ifndef MESH_RTO_INIT_MS
+#define MESH_RTO_INIT_MS    300   // eerste RTO naar een peer zonder RTT-meting
+#endif
+#ifndef MESH_RTO_MIN_MS
+#define MESH_RTO_MIN_MS     MESH_PEND_TICK_MS
+#endif
+#ifndef MESH_RTO_MAX_MS
+#define MESH_RTO_MAX_MS     2000
+#endif
+#ifndef MESH_RETX_MAX
+#define MESH_RETX_MAX       3     // herhalingen van een REQUEST zonder RESPONSE-ACK
+#endif
+#ifndef MESH_RETX_FRAME_MAX
+#define MESH_RETX_FRAME_MAX 384   // bewaard frame per pending REQUEST; groter → geen retransmit
+#endif
 #define MAX_RT_SNAPSHOT    128
+#ifndef MESH_RT_FULL_EVERY
+#define MESH_RT_FULL_EVERY 16    // na zoveel RouteDiffs opnieuw de volledige RouteTable
+#endif
+#ifndef MESH_WIRE_JSON
+#define MESH_WIRE_JSON     0     // 1 = frames als JSON versturen (debug/sniffen); ontvangen kan altijd beide
+#endif
+#ifndef MESH_TXQ_PEERS
+#define MESH_TXQ_PEERS     24    // bestemmingen met een eigen TX-queue (lege worden hergebruikt)
+#endif
+#ifndef MESH_TXQ_DEPTH
+#define MESH_TXQ_DEPTH     8     // frames per bestemming
+#endif
+#ifndef MESH_TXQ_POOL
+#define MESH_TXQ_POOL      24    // gedeelde framebuffers van MESH_TXQ_FRAME bytes; groter → heap
+#endif
+#ifndef MESH_TXQ_FRAME
+#define MESH_TXQ_FRAME     384
+#endif
+#ifndef MESH_TXQ_MAX_AGE_MS
+#define MESH_TXQ_MAX_AGE_MS 3000 // langer in de queue → weg (de REQUEST-timeout loopt intussen)
+#endif
+#ifndef MESH_TX_WINDOW
+#define MESH_TX_WINDOW     2     // REQUESTs zonder RESPONSE-ACK per bestemming
+#endif
+#define MESH_TX_BACKOFF_MIN_MS  10
+#define MESH_TX_BACKOFF_MAX_MS  320
+#ifndef CONFIG_MESH_RX_POOL
+#define CONFIG_MESH_RX_POOL     8     // ontvangstbuffers van MESH_PAYLOAD_MAX (Kconfig)
+#endif
+#ifndef CONFIG_MESH_RX_WORKERS
+#define CONFIG_MESH_RX_WORKERS  1     // dispatch-taken; per bron steeds dezelfde → volgorde blijft
+#endif
+#ifndef CONFIG_MESH_RX_CORE
+#define CONFIG_MESH_RX_CORE     -1    // core van de dispatch-taken, -1 = vrij
+#endif
 
 static QueueHandle_t s_workq = NULL;
 
-typedef struct { char name[32]; mesh_addr_t mac; bool valid; uint64_t last_ms; } peer_t;
-typedef struct { uint32_t corr_id; SemaphoreHandle_t sem; mesh_status_t st; bool used; } pend_t;
+// pending REQUEST: sync (sem) of async (cb + deadline, afgehandeld door de worker).
+// Het verzonden frame blijft bewaard: zonder RESPONSE-ACK binnen de RTO volgt een
+// retransmit (RTO verdubbelt), tot MESH_RETX_MAX herhalingen of de deadline.
+typedef struct { corr_id_t corr_id; SemaphoreHandle_t sem; mesh_status_t st; bool used, acked;
+                 char dst[32]; mesh_done_cb_t cb; void *user; uint64_t deadline_ms;
+                 mesh_addr_t to; uint8_t tries, cls; uint32_t rto_ms; uint64_t sent_ms, next_ms;
+                 uint16_t frame_n; uint8_t frame[MESH_RETX_FRAME_MAX]; } pend_t;
 
 typedef struct {
     mesh_opts_t O;
@@ -76,25 +136,48 @@ typedef struct {
     uint32_t root_epoch;
     uint32_t last_topo_crc;
 
-    peer_t peers[MAX_PEERS];
     pend_t pend [MAX_PENDING];
 
-    // previous RT snapshot for diffs
+    // baseline voor RouteDiff (gesorteerd, hash = last_topo_crc)
     mesh_addr_t rt_prev[MAX_RT_SNAPSHOT];
     int         rt_prev_n;
+    uint32_t    rt_seq;          // per gepubliceerde wijziging
+    uint32_t    rt_full_topo;    // hash in de retained RouteTable
+    int         rt_deltas;       // RouteDiffs sinds de laatste RouteTable
 
     // Heartbeat
     TimerHandle_t hb_timer;
     int           hb_interval_ms;
+    TimerHandle_t time_timer;    // tijd-probes (root)
+
+    // async pendings: timeout-sweep via timer → worker
+    TimerHandle_t pend_timer;
+    volatile int  n_async;
 } ctx_t;
 
 static ctx_t C;
 
-typedef enum { W_RT_ADD, W_RT_REMOVE, W_CHILD_ADD, W_CHILD_REMOVE, W_ROOT_CHANGE, W_HEARTBEAT } work_t;
+// eigen groepen (vóór init bewaard, na esp_mesh_start toegepast)
+static mesh_addr_t s_gid[MESH_GROUP_MAX];
+static int         s_gid_n;
+static bool        s_mesh_up;
+static TaskHandle_t s_tx_task;      // mesh_tx
+
+typedef enum { W_RT_ADD, W_RT_REMOVE, W_CHILD_ADD, W_CHILD_REMOVE, W_ROOT_CHANGE, W_HEARTBEAT, W_PEND_SWEEP, W_TIME_TICK } work_t;
 typedef struct { uint8_t type; bool now_root; } work_msg_t;
 
+// TX-frame: eerste verzending van een REQUEST telt in het window, een retransmit niet
+enum { TXF_DATA = 0, TXF_REQ, TXF_RETX };
+
 // forward
-static void publish_route_event(const char *ev_name);
+static bool pend_complete(corr_id_t corr_id, const char *src, mesh_status_t st);
+static void pend_sweep(void);
+static esp_err_t send_env(const mesh_addr_t *to, mesh_wire_type_t type, const mesh_envelope_t *e, int flag);
+static void groups_apply(void);
+static size_t frame_env(uint8_t *buf, size_t cap, mesh_wire_type_t type, const mesh_envelope_t *e);
+static esp_err_t tx_push_raw(const mesh_addr_t *to, const uint8_t *data, size_t n, int flag, uint8_t cls, uint8_t what);
+static void tx_ack(const mesh_addr_t *from);
+static void tx_task(void *arg);
 static void subscribe_root_current_stream(void);
 static void on_mqtt_root_current(const char *topic, const char *payload);
 
@@ -120,6 +203,10 @@ static int cmp_mac(const void *aa, const void *bb){
 static int rt_snapshot(mesh_addr_t *buf, int max){
     int cap = esp_mesh_get_routing_table_size();
     int got = 0;
+    if (cap <= max){   // gewone geval: rechtstreeks in buf
+        if (cap > 0) esp_mesh_get_routing_table(buf, max*sizeof(mesh_addr_t), &got);
+        return got < max ? got : max;
+    }
     mesh_addr_t *tmp = (cap>0) ? (mesh_addr_t*)calloc(cap, sizeof(mesh_addr_t)) : NULL;
     if (tmp) esp_mesh_get_routing_table(tmp, cap*sizeof(mesh_addr_t), &got);
     int n = (got < max) ? got : max;
@@ -128,35 +215,49 @@ static int rt_snapshot(mesh_addr_t *buf, int max){
     return n;
 }
 
-// peer cache
 static bool mac_equal(const mesh_addr_t *a, const mesh_addr_t *b){ return memcmp(a->addr, b->addr, 6)==0; }
-static int  peer_find_by_name_unsafe(const char *name){ for(int i=0;i<MAX_PEERS;i++) if(C.peers[i].valid && strcmp(C.peers[i].name,name)==0) return i; return -1; }
-static int  peer_find_by_mac_unsafe(const mesh_addr_t *mac){ for(int i=0;i<MAX_PEERS;i++) if(C.peers[i].valid && mac_equal(&C.peers[i].mac,mac)) return i; return -1; }
-static int  peer_free_slot_unsafe(void){ for(int i=0;i<MAX_PEERS;i++) if(!C.peers[i].valid) return i; int o=0; for(int i=1;i<MAX_PEERS;i++) if(C.peers[i].last_ms<C.peers[o].last_ms) o=i; return o; }
-static void peer_upsert(const char *name, const mesh_addr_t *mac){ if(!name||!*name||!mac) return; xSemaphoreTake(C.lock,portMAX_DELAY); int idx=peer_find_by_name_unsafe(name); if(idx<0) idx=peer_free_slot_unsafe(); strlcpy(C.peers[idx].name,name,sizeof(C.peers[idx].name)); C.peers[idx].mac=*mac; C.peers[idx].valid=true; C.peers[idx].last_ms=now_ms(); xSemaphoreGive(C.lock); }
-static bool peer_resolve(const char *name, mesh_addr_t *out){ if(!name||!*name) return false; bool ok=false; xSemaphoreTake(C.lock,portMAX_DELAY); int idx=peer_find_by_name_unsafe(name); if(idx>=0){ *out=C.peers[idx].mac; ok=true; C.peers[idx].last_ms=now_ms(); } xSemaphoreGive(C.lock); return ok; }
+
+// RTO per peer uit de RTT in het vlootregister (mesh_fleet): srtt + 4·rttvar, begrensd
+static uint32_t rto_clamp(uint32_t ms){ return ms<MESH_RTO_MIN_MS ? MESH_RTO_MIN_MS : ms>MESH_RTO_MAX_MS ? MESH_RTO_MAX_MS : ms; }
+
+static uint32_t peer_rto(const char *name){
+    mesh_node_info_t n;
+    uint32_t rto = MESH_RTO_INIT_MS;
+    if (mesh_fleet_get(name, &n) && n.srtt_ms) rto = n.srtt_ms + 4*n.rttvar_ms;
+    return rto_clamp(rto);
+}
 
 // mqtt helpers
 static inline void mqtt_retained_clear(const char *topic){ mqtt_link_publish_cb(topic, "", 1, true); }
 
-// topology fingerprint
-static uint32_t compute_topology_crc(void){
-    mesh_addr_t *snap = (mesh_addr_t*)calloc(MAX_RT_SNAPSHOT, sizeof(mesh_addr_t));
-    if (!snap) return 0;
-    int n = rt_snapshot(snap, MAX_RT_SNAPSHOT);
-    qsort(snap, n, sizeof(mesh_addr_t), cmp_mac);
+// topology fingerprint (snap gesorteerd)
+static uint32_t compute_topology_crc(const mesh_addr_t *snap, int n){
     uint8_t header[1+6+4+6];
     header[0] = C.is_root ? 1 : 0;
     memcpy(&header[1], C.root_mac.addr, 6);
     memcpy(&header[7], &C.root_epoch, 4);
     memcpy(&header[11], C.mesh_id, 6);
     uint32_t crc = esp_rom_crc32_le(0, header, sizeof(header));
-    crc = esp_rom_crc32_le(crc, (const uint8_t*)snap, n*sizeof(mesh_addr_t));
-    free(snap);
-    return crc;
+    return esp_rom_crc32_le(crc, (const uint8_t*)snap, n*sizeof(mesh_addr_t));
 }
 
-// publish per-root Current
+// één snapshot per topologie-event, gedeeld door diff, publish, janitor, TTL-sweep en vloot
+typedef struct { mesh_addr_t mac[MAX_RT_SNAPSHOT]; int n; uint32_t topo; } rt_snap_t;
+static rt_snap_t s_rt;   // enkel de worker
+
+static const rt_snap_t *rt_take(void){
+    s_rt.n = rt_snapshot(s_rt.mac, MAX_RT_SNAPSHOT);
+    qsort(s_rt.mac, s_rt.n, sizeof(mesh_addr_t), cmp_mac);
+    s_rt.topo = compute_topology_crc(s_rt.mac, s_rt.n);
+    mesh_fleet_sync((const uint8_t*)s_rt.mac, s_rt.n, sizeof(mesh_addr_t));   // online-status
+    return &s_rt;
+}
+
+static bool rt_contains(const rt_snap_t *s, const mesh_addr_t *mac){
+    return bsearch(mac, s->mac, s->n, sizeof(mesh_addr_t), cmp_mac) != NULL;
+}
+
+// publish per-root Current: heartbeat (enkel hash + aantal) en na elke wijziging
 static void publish_root_current(int node_count, uint32_t topo_hash){
     cJSON *o = cJSON_CreateObject();
     cJSON_AddStringToObject(o, "mesh_id", C.mesh_id_hex);
@@ -168,64 +269,103 @@ static void publish_root_current(int node_count, uint32_t topo_hash){
     cJSON_AddNumberToObject(o, "published_ms", now_ms());
     cJSON_AddNumberToObject(o, "node_count", node_count);
     cJSON_AddNumberToObject(o, "topology_hash", topo_hash);
+    cJSON_AddNumberToObject(o, "seq", C.rt_seq);
     char topic[128]; snprintf(topic, sizeof topic, "Mesh/%s/Root/Current/%s", C.mesh_id_hex, root_mac_s);
     char *payload = cJSON_PrintUnformatted(o);
     if (payload){ mqtt_link_publish_cb(topic, payload, 1, true); free(payload); }
     cJSON_Delete(o);
 }
 
-// janitor: only clear topics for nodes in our current tree (former roots), never our own root
-static void janitor_cleanup_nodes(const mesh_addr_t *snap, int n){
+// janitor: retained topics van een node die nieuw in onze boom zit (vroegere root) wissen,
+// nooit onze eigen root
+static void janitor_cleanup_node(const mesh_addr_t *mac){
+    if (mac_equal(mac, &C.root_mac)) return;
     char mac_s[18], topic[160];
-    for (int i=0;i<n;i++){
-        if (mac_equal(&snap[i], &C.root_mac)) continue;
-        mac_str(snap[i].addr, mac_s, sizeof mac_s);
-        snprintf(topic, sizeof topic, "Mesh/%s/Root/%s/RouteTable", C.mesh_id_hex, mac_s);
-        mqtt_retained_clear(topic);
-        snprintf(topic, sizeof topic, "Mesh/%s/Root/Current/%s", C.mesh_id_hex, mac_s);
-        mqtt_retained_clear(topic);
-    }
+    mac_str(mac->addr, mac_s, sizeof mac_s);
+    snprintf(topic, sizeof topic, "Mesh/%s/Root/%s/RouteTable", C.mesh_id_hex, mac_s);
+    mqtt_retained_clear(topic);
+    snprintf(topic, sizeof topic, "Mesh/%s/Root/Current/%s", C.mesh_id_hex, mac_s);
+    mqtt_retained_clear(topic);
 }
 
-// routing diff baseline
-static void rt_diff_and_update_baseline(bool publish_offline){
-    (void)publish_offline; // not implemented in this trimmed backend
-    if (!C.is_root) return;
-    mesh_addr_t *now = (mesh_addr_t*)calloc(MAX_RT_SNAPSHOT, sizeof(mesh_addr_t));
-    int now_n = now ? rt_snapshot(now, MAX_RT_SNAPSHOT) : 0;
-    uint32_t topo = compute_topology_crc();
-    if (topo != C.last_topo_crc){ publish_route_event("ROUTE_DIFF"); C.last_topo_crc = topo; }
-    C.rt_prev_n = (now_n <= MAX_RT_SNAPSHOT) ? now_n : MAX_RT_SNAPSHOT;
-    if (C.rt_prev_n>0 && now) memcpy(C.rt_prev, now, C.rt_prev_n*sizeof(mesh_addr_t));
-    free(now);
-}
-
-// publish route event + pointer + janitor
-static void publish_route_event(const char *ev_name){
-    mesh_addr_t *snap = (mesh_addr_t*)calloc(MAX_RT_SNAPSHOT, sizeof(mesh_addr_t));
-    int n = snap ? rt_snapshot(snap, MAX_RT_SNAPSHOT) : 0;
-
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "event", ev_name);
-    cJSON_AddStringToObject(root, "mesh_id", C.mesh_id_hex);
+static void rt_publish(const char *leaf, cJSON *o){
+    char root_mac_s[18]; mac_str(C.root_mac.addr, root_mac_s, sizeof root_mac_s);
+    char topic[160]; snprintf(topic, sizeof topic, "Mesh/%s/Root/%s/%s", C.mesh_id_hex, root_mac_s, leaf);
+    char *payload = cJSON_PrintUnformatted(o);
+    // RouteTable retained (baseline voor late subscribers), RouteDiff niet
+    if (payload){ mqtt_link_publish_cb(topic, payload, 1, strcmp(leaf, "RouteTable")==0); free(payload); }
+    cJSON_Delete(o);
+}
+
+static cJSON *rt_msg(const char *ev_name, const rt_snap_t *s){
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "event", ev_name);
+    cJSON_AddStringToObject(o, "mesh_id", C.mesh_id_hex);
     char root_mac_s[18]; mac_str(C.root_mac.addr, root_mac_s, sizeof root_mac_s);
-    cJSON_AddStringToObject(root, "root_mac", root_mac_s);
-    cJSON_AddStringToObject(root, "root_dev", C.O.local_dev ? C.O.local_dev : "?");
-    cJSON_AddBoolToObject(root,   "is_root", C.is_root);
-    cJSON_AddNumberToObject(root, "root_epoch", C.root_epoch);
-    uint32_t topo = compute_topology_crc();
-    cJSON_AddNumberToObject(root, "topology_hash", topo);
-    cJSON_AddNumberToObject(root, "published_ms", now_ms());
+    cJSON_AddStringToObject(o, "root_mac", root_mac_s);
+    cJSON_AddStringToObject(o, "root_dev", C.O.local_dev ? C.O.local_dev : "?");
+    cJSON_AddBoolToObject(o,   "is_root", C.is_root);
+    cJSON_AddNumberToObject(o, "root_epoch", C.root_epoch);
+    cJSON_AddNumberToObject(o, "seq", C.rt_seq);
+    cJSON_AddNumberToObject(o, "topology_hash", s->topo);
+    cJSON_AddNumberToObject(o, "node_count", s->n);
+    cJSON_AddNumberToObject(o, "published_ms", now_ms());
+    return o;
+}
+
+static void mac_array_add(cJSON *arr, const mesh_addr_t *mac){
+    char m[18]; mac_str(mac->addr, m, sizeof m);
+    cJSON_AddItemToArray(arr, cJSON_CreateString(m));
+}
+
+// volledige tabel (retained): bij een nieuwe root, na MESH_RT_FULL_EVERY deltas, bij een
+// delta groter dan de halve tabel, en op de heartbeat als er sinds de vorige deltas waren
+static void rt_publish_full(const char *ev_name, const rt_snap_t *s){
+    cJSON *o = rt_msg(ev_name, s);
     cJSON *nodes = cJSON_CreateArray();
-    for (int i=0;i<n;i++){ char mac[18]; mac_str(snap[i].addr, mac, sizeof mac); cJSON_AddItemToArray(nodes, cJSON_CreateString(mac)); }
-    cJSON_AddItemToObject(root, "nodes", nodes);
-    char topic[160]; snprintf(topic, sizeof topic, "Mesh/%s/Root/%s/RouteTable", C.mesh_id_hex, root_mac_s);
-    char *payload = cJSON_PrintUnformatted(root);
-    if (payload){ mqtt_link_publish_cb(topic, payload, 1, true); free(payload); }
-    cJSON_Delete(root);
-    publish_root_current(n, topo);
-    if (ev_name && strcmp(ev_name, "HEARTBEAT") != 0 && snap) janitor_cleanup_nodes(snap, n);
-    if (snap) free(snap);
+    for (int i=0;i<s->n;i++) mac_array_add(nodes, &s->mac[i]);
+    cJSON_AddItemToObject(o, "nodes", nodes);
+    rt_publish("RouteTable", o);
+    C.rt_full_topo = s->topo;
+    C.rt_deltas = 0;
+}
+
+// baseline (rt_prev) → s: enkel toegevoegde/verdwenen nodes op RouteDiff, janitor enkel
+// voor de nieuwe. Beide lijsten gesorteerd → één merge-pass.
+static void rt_publish_changes(const char *ev_name, const rt_snap_t *s){
+    cJSON *add = cJSON_CreateArray(), *rem = cJSON_CreateArray();
+    int i = 0, j = 0, changed = 0;
+    while (i < C.rt_prev_n || j < s->n){
+        int c = (i >= C.rt_prev_n) ? 1 : (j >= s->n) ? -1 : cmp_mac(&C.rt_prev[i], &s->mac[j]);
+        if (c == 0){ i++; j++; continue; }
+        if (c < 0) mac_array_add(rem, &C.rt_prev[i++]);
+        else { janitor_cleanup_node(&s->mac[j]); mac_array_add(add, &s->mac[j++]); }
+        changed++;
+    }
+    uint32_t base = C.last_topo_crc;
+    C.rt_seq++;
+    if (!C.rt_prev_n || changed*2 > s->n || ++C.rt_deltas >= MESH_RT_FULL_EVERY){
+        cJSON_Delete(add); cJSON_Delete(rem);
+        rt_publish_full(ev_name, s);
+    } else {
+        cJSON *o = rt_msg(ev_name, s);
+        cJSON_AddNumberToObject(o, "base_hash", base);
+        cJSON_AddItemToObject(o, "add", add);
+        cJSON_AddItemToObject(o, "remove", rem);
+        rt_publish("RouteDiff", o);
+    }
+    C.last_topo_crc = s->topo;
+    C.rt_prev_n = s->n;
+    memcpy(C.rt_prev, s->mac, s->n*sizeof(mesh_addr_t));
+    publish_root_current(s->n, s->topo);
+}
+
+// topologie-event (worker): één snapshot; niets gewijzigd → niets publiceren
+static void rt_update(const char *ev_name){
+    if (!C.is_root) return;
+    const rt_snap_t *s = rt_take();
+    if (s->topo == C.last_topo_crc && C.rt_prev_n) return;
+    rt_publish_changes(ev_name, s);
 }
 
 // ---- TTL sweep for stale roots ----
@@ -242,22 +382,22 @@ static void seen_root_touch(const char *mac){
     for (int i=0;i<MAX_SEEN_ROOTS;i++) if (!SEEN[i].mac[0]){ strlcpy(SEEN[i].mac, mac, sizeof(SEEN[i].mac)); SEEN[i].last_ms=now_ms(); return; }
 }
 
-static bool mac_in_snapshot(const mesh_addr_t *snap, int n, const char *mac_s){
-    char buf[18];
-    for (int i=0;i<n;i++){ mac_str(snap[i].addr, buf, sizeof buf); if (strcmp(buf, mac_s)==0) return true; }
-    return false;
+static bool mac_parse(const char *s, mesh_addr_t *out){
+    unsigned b[6];
+    if (sscanf(s, "%2x:%2x:%2x:%2x:%2x:%2x", &b[0],&b[1],&b[2],&b[3],&b[4],&b[5]) != 6) return false;
+    for (int i=0;i<6;i++) out->addr[i] = (uint8_t)b[i];
+    return true;
 }
 
-static void sweep_stale_roots(void){
+static void sweep_stale_roots(const rt_snap_t *s){
     if (!C.is_root) return;
-    mesh_addr_t *snap = (mesh_addr_t*)calloc(MAX_RT_SNAPSHOT, sizeof(mesh_addr_t));
-    int n = snap ? rt_snapshot(snap, MAX_RT_SNAPSHOT) : 0;
     char my_mac[18]; mac_str(C.root_mac.addr, my_mac, sizeof my_mac);
     uint64_t now = now_ms();
     for (int i=0;i<MAX_SEEN_ROOTS;i++){
         if (!SEEN[i].mac[0]) continue;
         if (strcmp(SEEN[i].mac, my_mac)==0) continue; // never self
-        if (mac_in_snapshot(snap, n, SEEN[i].mac)) continue; // merged under us -> janitor already handles
+        mesh_addr_t m;
+        if (mac_parse(SEEN[i].mac, &m) && rt_contains(s, &m)) continue; // merged under us -> janitor already handles
         if (now - SEEN[i].last_ms > ROOT_TTL_MS){
             char topic[160];
             snprintf(topic, sizeof topic, "Mesh/%s/Root/Current/%s", C.mesh_id_hex, SEEN[i].mac); mqtt_retained_clear(topic);
@@ -265,58 +405,226 @@ static void sweep_stale_roots(void){
             SEEN[i].mac[0] = '\0';
         }
     }
-    if (snap) free(snap);
 }
 
-// RX handling (lightweight): forwards decoded envelopes
-static void handle_packet(const mesh_addr_t *from, const char *json, size_t len){
-    (void)len;
+// heartbeat: ongewijzigd → enkel Root/Current (hash); gemiste events worden hier ingehaald,
+// en de retained tabel volgt de deltas van het voorbije interval
+static void rt_heartbeat(void){
+    if (!C.is_root) return;
+    const rt_snap_t *s = rt_take();
+    if (s->topo != C.last_topo_crc) rt_publish_changes("HEARTBEAT", s);
+    else publish_root_current(s->n, s->topo);
+    if (C.rt_full_topo != C.last_topo_crc) rt_publish_full("HEARTBEAT", s);
+    sweep_stale_roots(s);
+}
+
+// corr_id op de draad: 64-bit past niet in een JSON-number (double) → 16 hex-tekens
+static void corr_to_json(cJSON *o, corr_id_t c){
+    char hex[17];
+    snprintf(hex, sizeof hex, "%016" PRIx64, c);
+    cJSON_AddStringToObject(o, "corr_id", hex);
+}
+static corr_id_t corr_from_json(const cJSON *j){
+    const char *s = cJSON_GetStringValue(j);
+    return s ? (corr_id_t)strtoull(s, NULL, 16) : 0;
+}
+
+static const char *kind_str(mesh_kind_t k){
+    switch (k){
+        case ML_KIND_RELAY:  return "relay";
+        case ML_KIND_PWM:    return "pwm";
+        case ML_KIND_CONFIG: return "config";
+        case ML_KIND_INPUT:  return "input";
+        default:             return "diag";
+    }
+}
+static mesh_kind_t kind_from_str(const char *s){
+    if (!s) return ML_KIND_DIAG;
+    for (int k = ML_KIND_RELAY; k < ML_KIND_DIAG; ++k) if (!strcmp(s, kind_str((mesh_kind_t)k))) return (mesh_kind_t)k;
+    return ML_KIND_DIAG;
+}
+
+static bool is_hello(const mesh_envelope_t *e){
+    const cJSON *t = cJSON_GetObjectItemCaseSensitive(e->payload, "type");
+    return e->kind==ML_KIND_DIAG && cJSON_IsString(t) && strcasecmp(t->valuestring, "HELLO")==0;
+}
+
+// RX: gedecodeerde envelop (binair of JSON) → vlootregister, ACK/callbacks
+static void dispatch_frame(const mesh_addr_t *from, mesh_wire_type_t type, const mesh_envelope_t *e){
+    if (e->src_dev && !mesh_fleet_touch(e->src_dev, from->addr, (uint32_t)now_ms()))
+        ESP_LOGW(LOG_TAG, "vlootregister vol: %s niet opgenomen", e->src_dev);
+    switch (type){
+        case MW_RESPONSE:
+            // leverings-ACK; dubbele ACK (na een retransmit) geeft het window niet nog eens vrij
+            if (pend_complete(e->corr_id, e->src_dev, MESH_OK)) tx_ack(from);
+            break;
+        case MW_REQUEST: {
+            mesh_envelope_t ack = { .corr_id = e->corr_id, .kind = e->kind, .src_dev = C.O.local_dev, .dst_dev = e->src_dev };
+            (void)send_env(from, MW_RESPONSE, &ack, MESH_DATA_P2P);
+            if (C.on_req) C.on_req(e);
+            break;
+        }
+        case MW_GROUP:
+            // fan-out: geen ACK per lid (het EVENT volgt); de root voerde zijn deel al lokaal uit
+            if (!C.is_root && C.on_req) C.on_req(e);
+            break;
+        case MW_EVENT:
+            if (is_hello(e)) mesh_fleet_hello(e->src_dev, e->payload);
+            if (C.on_evt) C.on_evt(e);
+            break;
+    }
+}
+
+// JSON-frame (MESH_WIRE_JSON of terugval van de zender)
+static void handle_json(const mesh_addr_t *from, const char *json){
     cJSON *o = cJSON_Parse(json); if (!o) return;
-    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(o,"type"));
-    const char *src  = cJSON_GetStringValue(cJSON_GetObjectItem(o,"src_dev"));
-    const char *dst  = cJSON_GetStringValue(cJSON_GetObjectItem(o,"dst_dev"));
-    uint32_t corr_id = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"corr_id"));
-    cJSON *payload   = cJSON_GetObjectItem(o,"payload");
-    if (src) peer_upsert(src, from);
+    mesh_wire_type_t type = mesh_wire_type_from_str(cJSON_GetStringValue(cJSON_GetObjectItem(o,"type")));
+    const cJSON *jprio = cJSON_GetObjectItem(o,"prio");
+    const cJSON *jexec = cJSON_GetObjectItem(o,"exec_us");
+    const cJSON *jttl  = cJSON_GetObjectItem(o,"ttl");
+    const cJSON *jhop  = cJSON_GetObjectItem(o,"hop");
     mesh_envelope_t e = {
         .schema = cJSON_GetStringValue(cJSON_GetObjectItem(o,"schema")),
-        .corr_id = corr_id,
+        .corr_id = corr_from_json(cJSON_GetObjectItem(o,"corr_id")),
         .ts_ms = (uint64_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"ts_ms")),
-        .src_dev = src,
-        .dst_dev = dst,
-        .kind = ML_KIND_DIAG,
-        .ttl = (int8_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"ttl")),
-        .hop = (uint8_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"hop")),
+        .src_dev = cJSON_GetStringValue(cJSON_GetObjectItem(o,"src_dev")),
+        .dst_dev = cJSON_GetStringValue(cJSON_GetObjectItem(o,"dst_dev")),
+        .kind = kind_from_str(cJSON_GetStringValue(cJSON_GetObjectItem(o,"kind"))),
+        .prio = cJSON_IsNumber(jprio) ? (mesh_prio_t)jprio->valueint : ML_PRIO_NONE,
+        .ttl = cJSON_IsNumber(jttl) ? (int8_t)jttl->valueint : 0,
+        .hop = cJSON_IsNumber(jhop) ? (uint8_t)jhop->valueint : 0,
         .origin_set_topic = cJSON_GetStringValue(cJSON_GetObjectItem(o,"origin_set_topic")),
-        .payload = payload
+        .payload = cJSON_GetObjectItem(o,"payload"),
+        .exec_us = cJSON_IsNumber(jexec) ? (uint32_t)jexec->valuedouble : 0
     };
-    if      (type && strcmp(type,"RESPONSE")==0){
-        // no special handling
-    } else if (type && strcmp(type,"REQUEST")==0){ if (C.on_req) C.on_req(&e); }
-      else if (type && strcmp(type,"EVENT")==0){ if (C.on_evt) C.on_evt(&e); }
+    if (type) dispatch_frame(from, type, &e);
     cJSON_Delete(o);
 }
 
+// ---- RX: mesh_rx kopieert enkel, dispatch-taken decoderen en roepen de callbacks ----
+// mesh_rx haalt frames uit esp-mesh in een vrije poolbuffer en zet de index in de queue
+// van een dispatch-taak (gekozen op bron-MAC: frames van één bron blijven in volgorde).
+// Trage callbacks (router → MQTT) houden esp_mesh_recv dus niet meer op. Pool leeg →
+// het frame wordt gelezen en weggegooid (geteld); een REQUEST komt terug als retransmit.
+typedef struct {
+    mesh_addr_t from;
+    uint16_t    n;
+    uint64_t    t_us;      // ontvangen
+    uint8_t     buf[MESH_PAYLOAD_MAX + 1];   // + '\0' achter een JSON-frame
+} rx_frame_t;
+
+typedef struct {
+    QueueHandle_t    q;      // indexen in s_rx_frames
+    mesh_wire_pool_t pool;   // payload-boom van het lopende frame
+} rx_worker_t;
+
+static rx_frame_t   s_rx_frames[CONFIG_MESH_RX_POOL];
+static QueueHandle_t s_rx_free;
+static rx_worker_t  s_rx_w[CONFIG_MESH_RX_WORKERS];
+static portMUX_TYPE s_rx_mux = portMUX_INITIALIZER_UNLOCKED;
+static struct {
+    uint32_t frames, dropped, min_free;
+    uint32_t lag_max_us, run_max_us;
+    uint64_t lag_sum_us;
+} s_rx_st = { .min_free = CONFIG_MESH_RX_POOL };
+
+static void handle_packet(mesh_wire_pool_t *pool, const mesh_addr_t *from, const uint8_t *data, size_t len, uint64_t t_us){
+    if (mesh_time_is_frame(data, len)) {
+        // tijd-probe (child) → antwoord meteen in de queue; t2 = kopieertijd, t3 stempelt mesh_tx
+        uint8_t out[MESH_TIME_FRAME];
+        size_t n = mesh_time_rx(from->addr, data, len, (int64_t)t_us, out, sizeof out);
+        if (n) (void)tx_push_raw(from, out, n, MESH_DATA_P2P, ML_PRIO_READ, TXF_DATA);
+        return;
+    }
+    if (!mesh_wire_is_bin(data, len)) { handle_json(from, (const char*)data); return; }
+    mesh_wire_type_t type;
+    mesh_envelope_t e;
+    if (!mesh_wire_decode(data, len, &type, &e, pool)) { ESP_LOGW(LOG_TAG, "ongeldig frame (%u bytes, v%u)", (unsigned)len, data[1]); return; }
+    dispatch_frame(from, type, &e);
+}
+
+static void rx_dispatch_task(void *arg){
+    rx_worker_t *w = arg;
+    uint8_t i;
+    for(;;){
+        if (xQueueReceive(w->q, &i, portMAX_DELAY) != pdTRUE) continue;
+        rx_frame_t *f = &s_rx_frames[i];
+        uint64_t t0 = esp_timer_get_time();
+        handle_packet(&w->pool, &f->from, f->buf, f->n, f->t_us);
+        uint32_t lag = (uint32_t)(t0 - f->t_us), run = (uint32_t)(esp_timer_get_time() - t0);
+        xQueueSend(s_rx_free, &i, 0);
+        portENTER_CRITICAL(&s_rx_mux);
+        s_rx_st.lag_sum_us += lag;
+        if (lag > s_rx_st.lag_max_us) s_rx_st.lag_max_us = lag;
+        if (run > s_rx_st.run_max_us) s_rx_st.run_max_us = run;
+        portEXIT_CRITICAL(&s_rx_mux);
+    }
+}
+
 static void rx_loop(void *arg){
     (void)arg;
-    uint8_t *buf = malloc(MESH_PAYLOAD_MAX);
-    if (!buf) { vTaskDelete(NULL); return; }
+    static uint8_t scratch[MESH_PAYLOAD_MAX];   // pool leeg: lezen en weggooien
     for(;;){
+        uint8_t i;
+        bool have = xQueueReceive(s_rx_free, &i, 0) == pdTRUE;
+        rx_frame_t *f = have ? &s_rx_frames[i] : NULL;
         mesh_addr_t from = {0};
-        mesh_data_t data = { .data = buf, .size = MESH_PAYLOAD_MAX, .proto = 0, .tos = 0 };
+        mesh_data_t data = { .data = have ? f->buf : scratch, .size = MESH_PAYLOAD_MAX, .proto = 0, .tos = 0 };
         int flag = 0;
         esp_err_t err = esp_mesh_recv(&from, &data, portMAX_DELAY, &flag, NULL, 0);
-        if (err == ESP_OK && data.data && data.size>0){
-            size_t n = data.size; if (n >= MESH_PAYLOAD_MAX) n = MESH_PAYLOAD_MAX-1; ((char*)data.data)[n]='\0';
-            handle_packet(&from, (const char*)data.data, n);
-        }
+        bool ok = err == ESP_OK && data.data && data.size>0;
+        uint32_t nfree = (uint32_t)uxQueueMessagesWaiting(s_rx_free);
+        portENTER_CRITICAL(&s_rx_mux);
+        if (ok){ s_rx_st.frames++; if (!have) s_rx_st.dropped++; }
+        if (nfree < s_rx_st.min_free) s_rx_st.min_free = nfree;
+        portEXIT_CRITICAL(&s_rx_mux);
+        if (!have) continue;
+        if (!ok){ xQueueSend(s_rx_free, &i, 0); continue; }
+        size_t n = data.size > MESH_PAYLOAD_MAX ? MESH_PAYLOAD_MAX : data.size;   // volledig: binaire frames tot MESH_PAYLOAD_MAX
+        f->buf[n]='\0';
+        f->from = from; f->n = (uint16_t)n; f->t_us = esp_timer_get_time();
+        uint32_t h = 0;
+        for (int k=0;k<6;k++) h = h*31 + from.addr[k];
+        xQueueSend(s_rx_w[h % CONFIG_MESH_RX_WORKERS].q, &i, portMAX_DELAY);   // nooit vol: diepte = pool
     }
 }
 
+static void rx_stats(mesh_rx_stats_t *out, bool reset){
+    portENTER_CRITICAL(&s_rx_mux);
+    out->pool = CONFIG_MESH_RX_POOL; out->workers = CONFIG_MESH_RX_WORKERS;
+    out->frames = s_rx_st.frames; out->dropped = s_rx_st.dropped; out->min_free = s_rx_st.min_free;
+    uint32_t done = s_rx_st.frames - s_rx_st.dropped;
+    out->lag_avg_us = done ? (uint32_t)(s_rx_st.lag_sum_us / done) : 0;
+    out->lag_max_us = s_rx_st.lag_max_us; out->run_max_us = s_rx_st.run_max_us;
+    if (reset){ memset(&s_rx_st, 0, sizeof s_rx_st); s_rx_st.min_free = CONFIG_MESH_RX_POOL; }
+    portEXIT_CRITICAL(&s_rx_mux);
+}
+
 // worker + events
 static void root_hb_timer_cb(TimerHandle_t xTimer){ (void)xTimer; if (!C.is_root) return; work_msg_t w={.type=W_HEARTBEAT}; xQueueSend(s_workq,&w,0); }
-static void root_hb_start(void){ if (!C.hb_interval_ms) C.hb_interval_ms = 20000; if (!C.hb_timer) C.hb_timer = xTimerCreate("mesh_hb", pdMS_TO_TICKS(C.hb_interval_ms), pdTRUE, NULL, root_hb_timer_cb); if (C.hb_timer) xTimerStart(C.hb_timer,0); }
-static void root_hb_stop(void){ if (C.hb_timer) xTimerStop(C.hb_timer,0); }
+static void time_timer_cb(TimerHandle_t xTimer){ (void)xTimer; if (!C.is_root) return; work_msg_t w={.type=W_TIME_TICK}; xQueueSend(s_workq,&w,0); }
+static void root_hb_start(void){
+    if (!C.hb_interval_ms) C.hb_interval_ms = 20000;
+    if (!C.hb_timer) C.hb_timer = xTimerCreate("mesh_hb", pdMS_TO_TICKS(C.hb_interval_ms), pdTRUE, NULL, root_hb_timer_cb);
+    if (C.hb_timer) xTimerStart(C.hb_timer,0);
+    if (!C.time_timer) C.time_timer = xTimerCreate("mesh_time", pdMS_TO_TICKS(MESH_TIME_TICK_MS), pdTRUE, NULL, time_timer_cb);
+    if (C.time_timer) xTimerStart(C.time_timer,0);
+}
+static void root_hb_stop(void){ if (C.hb_timer) xTimerStop(C.hb_timer,0); if (C.time_timer) xTimerStop(C.time_timer,0); }
+
+// root: probes naar children waarvan de vorige MESH_TIME_PERIOD_MS oud is (laagste klasse:
+// de wachttijd in de queue telt niet, t1 wordt pas bij verzenden gezet)
+static void time_tick(void){
+    uint8_t mac[4][6];
+    int n = mesh_time_due((uint32_t)now_ms(), C.local_mac.addr, mac, 4);
+    for (int i=0;i<n;i++){
+        uint8_t buf[MESH_TIME_FRAME];
+        mesh_addr_t to; memcpy(to.addr, mac[i], 6);
+        size_t k = mesh_time_probe(mac[i], buf, sizeof buf);
+        if (k) (void)tx_push_raw(&to, buf, k, MESH_DATA_P2P, ML_PRIO_READ, TXF_DATA);
+    }
+}
+static void pend_timer_cb(TimerHandle_t xTimer){ (void)xTimer; if (!C.n_async) return; work_msg_t w={.type=W_PEND_SWEEP}; xQueueSend(s_workq,&w,0); }
 
 static void backend_worker(void *arg){
     (void)arg;
@@ -325,15 +633,17 @@ static void backend_worker(void *arg){
         if (xQueueReceive(s_workq, &m, portMAX_DELAY) != pdTRUE) continue;
         switch(m.type){
             case W_ROOT_CHANGE:
-                C.is_root = m.now_root; if (C.on_root) C.on_root(m.now_root);
-                if (C.is_root){ C.rt_prev_n=0; C.last_topo_crc=0; C.root_epoch++; publish_route_event("ROOT_ELECTED"); rt_diff_and_update_baseline(false); root_hb_start(); }
+                C.is_root = m.now_root; mesh_time_role(m.now_root); if (C.on_root) C.on_root(m.now_root);
+                if (C.is_root){ C.rt_prev_n=0; C.last_topo_crc=0; C.root_epoch++; rt_update("ROOT_ELECTED"); root_hb_start(); }
                 else { C.rt_prev_n=0; root_hb_stop(); }
                 break;
-            case W_RT_ADD:    publish_route_event("ADD");    rt_diff_and_update_baseline(false); break;
-            case W_RT_REMOVE: publish_route_event("REMOVE"); rt_diff_and_update_baseline(true);  break;
-            case W_CHILD_ADD: rt_diff_and_update_baseline(false); break;
-            case W_CHILD_REMOVE: rt_diff_and_update_baseline(true); break;
-            case W_HEARTBEAT: publish_route_event("HEARTBEAT"); sweep_stale_roots(); break;
+            case W_RT_ADD:       rt_update("ADD");    break;
+            case W_RT_REMOVE:    rt_update("REMOVE"); break;
+            case W_CHILD_ADD:    rt_update("CHILD_ADD");    break;
+            case W_CHILD_REMOVE: rt_update("CHILD_REMOVE"); break;
+            case W_HEARTBEAT:    rt_heartbeat(); break;
+            case W_PEND_SWEEP: pend_sweep(); break;
+            case W_TIME_TICK:  time_tick(); break;
         }
     }
 }
@@ -368,7 +678,20 @@ static void apply_mesh_cfg(void){
     ESP_ERROR_CHECK(esp_mesh_set_config(&cfg));
 }
 
-static void start_rx_task_once(void){ if (!C.rx_task) xTaskCreate(rx_loop, "mesh_rx", 4096, NULL, 5, &C.rx_task); }
+static void start_rx_task_once(void){
+    if (C.rx_task) return;
+    if (!s_rx_free){
+        s_rx_free = xQueueCreate(CONFIG_MESH_RX_POOL, sizeof(uint8_t));
+        for (uint8_t i=0;i<CONFIG_MESH_RX_POOL;i++) xQueueSend(s_rx_free, &i, 0);
+        for (int k=0;k<CONFIG_MESH_RX_WORKERS;k++){
+            char name[16]; snprintf(name, sizeof name, "mesh_disp%d", k);
+            s_rx_w[k].q = xQueueCreate(CONFIG_MESH_RX_POOL, sizeof(uint8_t));
+            xTaskCreatePinnedToCore(rx_dispatch_task, name, 6144, &s_rx_w[k], 5, NULL,
+                                    CONFIG_MESH_RX_CORE < 0 ? tskNO_AFFINITY : CONFIG_MESH_RX_CORE);
+        }
+    }
+    xTaskCreate(rx_loop, "mesh_rx", 3072, NULL, 6, &C.rx_task);
+}
 
 static void init_mesh_stack(const mesh_opts_t *opts){
     (void)opts;
@@ -380,8 +703,10 @@ static void init_mesh_stack(const mesh_opts_t *opts){
     esp_mesh_set_max_layer(6);
     ESP_ERROR_CHECK(esp_event_handler_instance_register(MESH_EVENT, ESP_EVENT_ANY_ID, espmesh_event_handler, NULL, NULL));
     ESP_ERROR_CHECK(esp_mesh_start());
+    s_mesh_up = true;
+    groups_apply();
     esp_wifi_get_mac(WIFI_IF_STA, C.local_mac.addr);
-    C.root_epoch = 0; C.last_topo_crc = 0; C.is_root = esp_mesh_is_root(); if (C.on_root) C.on_root(C.is_root);
+    C.root_epoch = 0; C.last_topo_crc = 0; C.is_root = esp_mesh_is_root(); mesh_time_role(C.is_root); if (C.on_root) C.on_root(C.is_root);
     // subscribe to per-root Current stream for TTL tracking
     subscribe_root_current_stream();
 }
@@ -395,8 +720,12 @@ static void init(const mesh_opts_t *opts){
     C.O = *opts;
     C.on_req  = saved_req; C.on_evt = saved_evt; C.on_root = saved_root;
     C.lock = xSemaphoreCreateMutex();
+    mesh_time_clock(esp_timer_get_time);
     s_workq = xQueueCreate(8, sizeof(work_msg_t));
     xTaskCreate(backend_worker, "mesh_bkw", 6144, NULL, 5, NULL);
+    if (!s_tx_task) xTaskCreate(tx_task, "mesh_tx", 3072, NULL, 5, &s_tx_task);
+    C.pend_timer = xTimerCreate("mesh_pend", pdMS_TO_TICKS(MESH_PEND_TICK_MS), pdTRUE, NULL, pend_timer_cb);
+    if (C.pend_timer) xTimerStart(C.pend_timer, 0);
     C.is_root=false; C.root_mac_known=false;
     init_mesh_stack(opts);
     start_rx_task_once();
@@ -407,25 +736,480 @@ static void register_root(mesh_root_cb_t cb){ C.on_root=cb; }
 
 static bool resolve_dst(const char *dst_dev, mesh_addr_t *out){
     if (!dst_dev || !*dst_dev || strcmp(dst_dev,"*ROOT*")==0){ if (C.root_mac_known){ *out=C.root_mac; return true; } return false; }
-    return peer_resolve(dst_dev, out);
+    return mesh_fleet_resolve(dst_dev, out->addr);
+}
+
+static int pend_alloc(corr_id_t corr_id){ xSemaphoreTake(C.lock,portMAX_DELAY); int idx=-1; for(int i=0;i<MAX_PENDING;i++) if(!C.pend[i].used){ idx=i; break; } if(idx>=0){ memset(&C.pend[idx],0,sizeof C.pend[idx]); C.pend[idx].corr_id=corr_id; C.pend[idx].sem=xSemaphoreCreateBinary(); C.pend[idx].st=MESH_TIMEOUT; C.pend[idx].used=true; } xSemaphoreGive(C.lock); return idx; }
+static void pend_free(int idx){ vSemaphoreDelete(C.pend[idx].sem); xSemaphoreTake(C.lock,portMAX_DELAY); C.pend[idx].used=false; xSemaphoreGive(C.lock); }
+
+// async: slot zonder semaphore; vrijgegeven door pend_complete/pend_sweep (of bij verzendfout)
+static int pend_alloc_async(const mesh_envelope_t *req, uint32_t timeout_ms, mesh_done_cb_t cb, void *user){
+    xSemaphoreTake(C.lock,portMAX_DELAY);
+    int idx=-1;
+    for (int i=0;i<MAX_PENDING;i++) if (!C.pend[i].used){ idx=i; break; }
+    if (idx>=0){
+        pend_t *p=&C.pend[idx];
+        memset(p,0,sizeof *p);
+        p->corr_id=req->corr_id; p->cb=cb; p->user=user; p->used=true;
+        p->deadline_ms=now_ms()+timeout_ms;
+        p->next_ms=UINT64_MAX;            // sweep slaat het slot over tot het verstuurd is
+        strlcpy(p->dst, req->dst_dev ? req->dst_dev : "", sizeof p->dst);
+        C.n_async++;
+    }
+    xSemaphoreGive(C.lock);
+    return idx;
 }
+static void pend_free_async_unsafe(pend_t *p){ p->used=false; p->cb=NULL; C.n_async--; }
 
-static int pend_alloc(uint32_t corr_id){ xSemaphoreTake(C.lock,portMAX_DELAY); int idx=-1; for(int i=0;i<MAX_PENDING;i++) if(!C.pend[i].used){ idx=i; break; } if(idx>=0){ C.pend[idx].corr_id=corr_id; C.pend[idx].sem=xSemaphoreCreateBinary(); C.pend[idx].st=MESH_TIMEOUT; C.pend[idx].used=true; } xSemaphoreGive(C.lock); return idx; }
-static mesh_status_t pend_wait_and_free(int idx, uint32_t timeout_ms){ if(idx<0) return MESH_ERR; mesh_status_t st=MESH_TIMEOUT; if(xSemaphoreTake(C.pend[idx].sem,pdMS_TO_TICKS(timeout_ms))==pdTRUE){ st=C.pend[idx].st; } vSemaphoreDelete(C.pend[idx].sem); xSemaphoreTake(C.lock,portMAX_DELAY); C.pend[idx].used=false; xSemaphoreGive(C.lock); return st; }
+// RESPONSE van src: zelfde corr mag bij meerdere children openstaan (batch) → ook op dst matchen.
+// true = eerste antwoord op een open REQUEST (niet voor een reeds afgehandelde of onbekende corr)
+static bool pend_complete(corr_id_t corr_id, const char *src, mesh_status_t st){
+    mesh_done_cb_t cb=NULL; void *user=NULL; char dst[32]=""; uint32_t rtt=0; bool sample=false, hit=false;
+    xSemaphoreTake(C.lock,portMAX_DELAY);
+    for (int i=0;i<MAX_PENDING;i++){
+        pend_t *p=&C.pend[i];
+        if (!p->used || p->corr_id!=corr_id) continue;
+        if (p->dst[0] && src && strcmp(p->dst, src)!=0) continue;
+        if (p->sem){                                   // sync: meet zelf; slot blijft tot pend_free
+            if (!p->acked){ p->acked=true; p->st=st; xSemaphoreGive(p->sem); hit=true; }
+            break;
+        }
+        hit=true;
+        cb=p->cb; user=p->user; strlcpy(dst, p->dst, sizeof dst);
+        if (p->tries==1){ rtt=(uint32_t)(now_ms()-p->sent_ms); sample=true; }   // Karn: na een retransmit dubbelzinnig
+        pend_free_async_unsafe(p);
+        break;
+    }
+    xSemaphoreGive(C.lock);
+    if (sample && st==MESH_OK) mesh_fleet_rtt_sample(dst, rtt);
+    if (cb) cb(corr_id, dst, st, user);   // buiten de lock
+    return hit;
+}
 
-static char* build_json(const char *type, const mesh_envelope_t *e){ cJSON *o=cJSON_CreateObject(); cJSON_AddStringToObject(o,"schema","v1"); cJSON_AddStringToObject(o,"type",type); cJSON_AddNumberToObject(o,"corr_id", e?e->corr_id:0); cJSON_AddNumberToObject(o,"ts_ms", e?e->ts_ms:now_ms()); cJSON_AddStringToObject(o,"src_dev", e?e->src_dev:C.O.local_dev); if(e&&e->dst_dev) cJSON_AddStringToObject(o,"dst_dev", e->dst_dev); if(e&&e->payload) cJSON_AddItemToObject(o,"payload", cJSON_Duplicate(e->payload,1)); char *js=cJSON_PrintUnformatted(o); cJSON_Delete(o); return js; }
+// worker: RTO verlopen → retransmit, of (herhalingen op / deadline) TIMEOUT.
+// Callbacks en verzenden één voor één, buiten de lock.
+static uint8_t s_retx_buf[MESH_RETX_FRAME_MAX];   // enkel de worker
 
-static esp_err_t mesh_send_json(const mesh_addr_t *to, const char *js){ mesh_data_t md={0}; md.data=(uint8_t*)js; md.size=strlen(js)+1; md.proto=MESH_PROTO_BIN; md.tos=MESH_TOS_P2P; return esp_mesh_send((mesh_addr_t*)to,&md,MESH_DATA_P2P,NULL,0); }
+static void pend_sweep(void){
+    for (;;){
+        mesh_done_cb_t cb=NULL; void *user=NULL; corr_id_t corr=0; char dst[32]="";
+        size_t retx_n=0; mesh_addr_t to; uint8_t cls=0;
+        uint64_t now=now_ms();
+        xSemaphoreTake(C.lock,portMAX_DELAY);
+        for (int i=0;i<MAX_PENDING;i++){
+            pend_t *p=&C.pend[i];
+            if (!p->used || p->sem || now < p->next_ms) continue;
+            if (p->frame_n && p->tries <= MESH_RETX_MAX && now < p->deadline_ms){
+                memcpy(s_retx_buf, p->frame, p->frame_n); retx_n=p->frame_n; to=p->to; cls=p->cls;
+                p->tries++;
+                p->rto_ms = rto_clamp(p->rto_ms*2);
+                p->next_ms = now + p->rto_ms;
+                if (p->next_ms > p->deadline_ms) p->next_ms = p->deadline_ms;
+                break;
+            }
+            cb=p->cb; user=p->user; corr=p->corr_id; strlcpy(dst, p->dst, sizeof dst);
+            pend_free_async_unsafe(p);
+            break;
+        }
+        xSemaphoreGive(C.lock);
+        if (retx_n){
+            ESP_LOGD(LOG_TAG, "retransmit REQUEST");
+            (void)tx_push_raw(&to, s_retx_buf, retx_n, MESH_DATA_P2P, cls, TXF_RETX);
+            continue;
+        }
+        if (!cb) return;
+        cb(corr, dst, MESH_TIMEOUT, user);
+    }
+}
+
+static char* build_json(const char *type, const mesh_envelope_t *e){
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o,"schema","v1");
+    cJSON_AddStringToObject(o,"type",type);
+    corr_to_json(o, e->corr_id);
+    cJSON_AddNumberToObject(o,"ts_ms", e->ts_ms);
+    cJSON_AddStringToObject(o,"src_dev", e->src_dev ? e->src_dev : C.O.local_dev);
+    if (e->dst_dev) cJSON_AddStringToObject(o,"dst_dev", e->dst_dev);
+    cJSON_AddStringToObject(o,"kind", kind_str(e->kind));
+    if (e->ttl) cJSON_AddNumberToObject(o,"ttl", e->ttl);
+    if (e->hop) cJSON_AddNumberToObject(o,"hop", e->hop);
+    if (e->prio) cJSON_AddNumberToObject(o,"prio", e->prio);
+    if (e->exec_us) cJSON_AddNumberToObject(o,"exec_us", e->exec_us);
+    if (e->origin_set_topic) cJSON_AddStringToObject(o,"origin_set_topic", e->origin_set_topic);
+    if (e->payload) cJSON_AddItemReferenceToObject(o,"payload", e->payload);   // geen kopie
+    char *js = cJSON_PrintUnformatted(o);
+    cJSON_Delete(o);
+    return js;
+}
+
+// ---- TX: per bestemming een begrensde queue, geleegd door de mesh_tx-taak ----
+// Callers (router, RX-taak voor ACKs, worker voor retransmits) wachten nooit op de radio:
+// het frame gaat in de queue van zijn bestemming en mesh_tx verstuurt met NONBLOCK, om
+// beurten per bestemming. Lukt een send niet (mesh-queue vol, geen route), dan wacht
+// enkel die bestemming (backoff ×2); de andere lopen door. Per bestemming hoogstens
+// MESH_TX_WINDOW REQUESTs zonder RESPONSE-ACK onderweg. Binnen een queue gaat de hoogste
+// klasse eerst (ACK = SAFETY). Vol → het oudste frame van de laagste klasse valt weg,
+// nooit voor een nieuw frame van een lagere klasse (dan valt het nieuwe weg).
+typedef struct {
+    uint8_t  *buf;          // NULL = vrij
+    uint16_t  n;
+    uint8_t   cls, what;    // mesh_prio_t, TXF_*
+    int8_t    pool;         // pool-index, -1 = heap
+    int       flag;
+    uint32_t  seq, t_ms;    // volgorde, in de queue gezet
+} txf_t;
+
+typedef struct {
+    mesh_addr_t to;
+    bool        used;
+    int8_t      busy_i;                        // frame dat mesh_tx nu verstuurt
+    uint8_t     len, max_len;
+    uint8_t     inflight;
+    uint16_t    backoff_ms;
+    uint32_t    retry_ms, last_ms;
+    uint32_t    inflight_ms[MESH_TX_WINDOW];   // verzendtijd open REQUESTs, oudste eerst
+    uint32_t    sent, dropped, expired, busy;
+    txf_t       f[MESH_TXQ_DEPTH];
+} txq_t;
+
+_Static_assert(MESH_TXQ_POOL <= 32, "MESH_TXQ_POOL: bitmap van 32");
+
+static txq_t        s_txq[MESH_TXQ_PEERS];
+static uint8_t      s_txpool[MESH_TXQ_POOL][MESH_TXQ_FRAME];
+static uint32_t     s_txpool_used;
+static uint32_t     s_tx_seq;
+static portMUX_TYPE s_tx_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t mesh_send_raw(const mesh_addr_t *to, const uint8_t *data, size_t n, int flag){ mesh_data_t md={0}; md.data=(uint8_t*)data; md.size=n; md.proto=MESH_PROTO_BIN; md.tos=MESH_TOS_P2P; return esp_mesh_send((mesh_addr_t*)to,&md,flag,NULL,0); }
+
+static uint8_t *txbuf_pool(int8_t *pool){
+    uint8_t *b = NULL;
+    *pool = -1;
+    portENTER_CRITICAL(&s_tx_mux);
+    for (int i=0;i<MESH_TXQ_POOL;i++) if (!(s_txpool_used & (1u<<i))){ s_txpool_used |= 1u<<i; *pool=i; b=s_txpool[i]; break; }
+    portEXIT_CRITICAL(&s_tx_mux);
+    return b;
+}
+// buiten s_tx_mux
+static void txbuf_release(uint8_t *buf, int8_t pool){
+    if (!buf) return;
+    if (pool < 0){ free(buf); return; }
+    portENTER_CRITICAL(&s_tx_mux); s_txpool_used &= ~(1u<<pool); portEXIT_CRITICAL(&s_tx_mux);
+}
+
+static uint8_t tx_class(mesh_wire_type_t type, mesh_prio_t prio){
+    if (type == MW_RESPONSE) return ML_PRIO_SAFETY;   // ACK: klein, voorkomt een retransmit
+    return prio ? prio : ML_PRIO_SETPOINT;
+}
+
+// open REQUESTs ouder dan MESH_RTO_MAX_MS: ACK verloren → window niet blijvend dicht
+static void window_expire_unsafe(txq_t *q, uint32_t now){
+    int k = 0;
+    while (k < q->inflight && now - q->inflight_ms[k] > MESH_RTO_MAX_MS) k++;
+    if (!k) return;
+    memmove(q->inflight_ms, q->inflight_ms+k, (q->inflight-k)*sizeof q->inflight_ms[0]);
+    q->inflight -= k;
+}
+
+// queue van to; anders een vrije, of de langst ongebruikte lege (tellers beginnen opnieuw)
+static txq_t *txq_get_unsafe(const mesh_addr_t *to, uint32_t now){
+    txq_t *idle = NULL;
+    for (int i=0;i<MESH_TXQ_PEERS;i++){
+        txq_t *q = &s_txq[i];
+        if (q->used && mac_equal(&q->to, to)) return q;
+        if (!q->used){ if (!idle || idle->used) idle = q; continue; }
+        window_expire_unsafe(q, now);
+        if (q->len || q->inflight || (idle && !idle->used)) continue;
+        if (!idle || now - q->last_ms > now - idle->last_ms) idle = q;
+    }
+    if (idle){ memset(idle, 0, sizeof *idle); idle->used = true; idle->to = *to; idle->busy_i = -1; idle->last_ms = now; }
+    return idle;
+}
+
+// neemt buf over (ook bij een fout)
+static esp_err_t tx_push(const mesh_addr_t *to, uint8_t *buf, int8_t pool, size_t n, int flag, uint8_t cls, uint8_t what){
+    txf_t victim = { .buf = NULL };
+    esp_err_t er = ESP_OK;
+    uint32_t now = (uint32_t)now_ms();
+    portENTER_CRITICAL(&s_tx_mux);
+    txq_t *q = txq_get_unsafe(to, now);
+    int slot = -1;
+    if (!q) er = ESP_ERR_NO_MEM;
+    else if (q->len < MESH_TXQ_DEPTH){
+        for (int i=0;i<MESH_TXQ_DEPTH;i++) if (!q->f[i].buf){ slot=i; break; }
+    } else {
+        for (int i=0;i<MESH_TXQ_DEPTH;i++){
+            const txf_t *f = &q->f[i];
+            if (i == q->busy_i || f->cls < cls) continue;
+            if (slot < 0 || f->cls > q->f[slot].cls || (f->cls == q->f[slot].cls && (int32_t)(f->seq - q->f[slot].seq) < 0)) slot = i;
+        }
+        q->dropped++;
+        if (slot >= 0){ victim = q->f[slot]; q->f[slot].buf = NULL; q->len--; }
+        else er = ESP_FAIL;
+    }
+    if (slot >= 0){
+        q->f[slot] = (txf_t){ .buf=buf, .n=(uint16_t)n, .cls=cls, .what=what, .pool=pool, .flag=flag, .seq=s_tx_seq++, .t_ms=now };
+        if (++q->len > q->max_len) q->max_len = q->len;
+        q->last_ms = now;
+    }
+    portEXIT_CRITICAL(&s_tx_mux);
+    txbuf_release(victim.buf, victim.pool);
+    if (er != ESP_OK){ txbuf_release(buf, pool); return er; }
+    if (s_tx_task) xTaskNotifyGive(s_tx_task);
+    return ESP_OK;
+}
+
+static esp_err_t tx_push_raw(const mesh_addr_t *to, const uint8_t *data, size_t n, int flag, uint8_t cls, uint8_t what){
+    int8_t pool = -1;
+    uint8_t *buf = n <= MESH_TXQ_FRAME ? txbuf_pool(&pool) : NULL;
+    if (!buf && !(buf = malloc(n))) return ESP_ERR_NO_MEM;
+    memcpy(buf, data, n);
+    return tx_push(to, buf, pool, n, flag, cls, what);
+}
 
-static mesh_status_t request(const mesh_envelope_t *req, uint32_t timeout_ms){ mesh_addr_t dst; if(!resolve_dst(req->dst_dev,&dst)) return MESH_NO_ROUTE; int p=pend_alloc(req->corr_id); if(p<0) return MESH_ERR; char *js=build_json("REQUEST",req); esp_err_t er=mesh_send_json(&dst, js); free(js); if(er!=ESP_OK){ (void)pend_wait_and_free(p,0); return MESH_NO_ROUTE; } return pend_wait_and_free(p, timeout_ms); }
-static mesh_status_t send_event(const mesh_envelope_t *evt){ mesh_addr_t dst; if(!resolve_dst(evt->dst_dev,&dst)) return MESH_NO_ROUTE; char *js=build_json("EVENT",evt); esp_err_t er=mesh_send_json(&dst, js); free(js); return (er==ESP_OK)?MESH_OK:MESH_ERR; }
+// RESPONSE-ACK van from (enkel de eerste per REQUEST, zie pend_complete): oudste open REQUEST sluit
+static void tx_ack(const mesh_addr_t *from){
+    bool opened = false;
+    portENTER_CRITICAL(&s_tx_mux);
+    for (int i=0;i<MESH_TXQ_PEERS;i++){
+        txq_t *q = &s_txq[i];
+        if (!q->used || !mac_equal(&q->to, from)) continue;
+        if (q->inflight){
+            memmove(q->inflight_ms, q->inflight_ms+1, (q->inflight-1)*sizeof q->inflight_ms[0]);
+            opened = q->inflight-- == MESH_TX_WINDOW && q->len;
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&s_tx_mux);
+    if (opened && s_tx_task) xTaskNotifyGive(s_tx_task);
+}
+
+// volgend frame van q: hoogste klasse, oudste; REQUESTs enkel met ruimte in het window.
+// Eén verlopen frame per oproep gaat naar *dead (vrijgeven buiten de lock).
+static int txq_pick_unsafe(txq_t *q, uint32_t now, txf_t *dead){
+    bool win = q->inflight < MESH_TX_WINDOW;
+    int best = -1;
+    for (int i=0;i<MESH_TXQ_DEPTH;i++){
+        txf_t *f = &q->f[i];
+        if (!f->buf) continue;
+        if (!dead->buf && now - f->t_ms > MESH_TXQ_MAX_AGE_MS){ *dead = *f; f->buf = NULL; q->len--; q->expired++; continue; }
+        if (f->what == TXF_REQ && !win) continue;
+        if (best < 0 || f->cls < q->f[best].cls || (f->cls == q->f[best].cls && (int32_t)(f->seq - q->f[best].seq) < 0)) best = i;
+    }
+    if ((int32_t)(q->retry_ms - now) > 0) return -1;   // backoff loopt
+    return best;
+}
+
+static void tx_task(void *arg){
+    (void)arg;
+    uint32_t rr = 0;
+    for(;;){
+        bool sent = false, waiting = false;
+        // één frame per bestemming per ronde: een trage bestemming houdt de rest niet op
+        for (int k=0;k<MESH_TXQ_PEERS;k++){
+            txq_t *q = &s_txq[(rr+k) % MESH_TXQ_PEERS];
+            txf_t f = { .buf = NULL }, dead = { .buf = NULL };
+            mesh_addr_t to;
+            uint32_t now = (uint32_t)now_ms();
+            int i = -1;
+            portENTER_CRITICAL(&s_tx_mux);
+            if (q->used && q->len){
+                window_expire_unsafe(q, now);
+                i = txq_pick_unsafe(q, now, &dead);
+                if (i >= 0){ q->busy_i = (int8_t)i; f = q->f[i]; to = q->to; }
+                else if (q->len) waiting = true;
+            }
+            portEXIT_CRITICAL(&s_tx_mux);
+            txbuf_release(dead.buf, dead.pool);
+            if (i < 0) continue;
+
+            mesh_time_stamp_tx(f.buf, f.n);   // tijd-probe: t1/t3 zo dicht mogelijk bij de radio
+            esp_err_t er = mesh_send_raw(&to, f.buf, f.n, f.flag | MESH_DATA_NONBLOCK);
+            portENTER_CRITICAL(&s_tx_mux);
+            q->busy_i = -1;
+            if (er == ESP_OK){
+                q->f[i].buf = NULL; q->len--; q->sent++; q->backoff_ms = 0;
+                if (f.what == TXF_REQ && q->inflight < MESH_TX_WINDOW) q->inflight_ms[q->inflight++] = now;
+            } else {
+                q->busy++;
+                q->backoff_ms = !q->backoff_ms ? MESH_TX_BACKOFF_MIN_MS
+                              : q->backoff_ms*2 > MESH_TX_BACKOFF_MAX_MS ? MESH_TX_BACKOFF_MAX_MS : q->backoff_ms*2;
+                q->retry_ms = now + q->backoff_ms;
+                waiting = true;
+            }
+            portEXIT_CRITICAL(&s_tx_mux);
+            if (er == ESP_OK){ txbuf_release(f.buf, f.pool); sent = true; }
+        }
+        rr++;
+        if (sent) continue;
+        ulTaskNotifyTake(pdTRUE, waiting ? pdMS_TO_TICKS(MESH_TX_BACKOFF_MIN_MS) : portMAX_DELAY);
+    }
+}
+
+static int txq_list(int *pos, mesh_txq_info_t *out, int max, bool reset){
+    int n = 0, i = pos ? *pos : 0;
+    for (; i<MESH_TXQ_PEERS && n<max; i++){
+        txq_t *q = &s_txq[i];
+        mesh_txq_info_t *o = &out[n];
+        portENTER_CRITICAL(&s_tx_mux);
+        bool use = q->used;
+        if (use){
+            memcpy(o->mac, q->to.addr, 6);
+            o->depth = q->len; o->max_depth = q->max_len; o->inflight = q->inflight;
+            o->sent = q->sent; o->dropped = q->dropped; o->expired = q->expired; o->busy = q->busy;
+            if (reset){ q->sent = q->dropped = q->expired = q->busy = 0; q->max_len = q->len; }
+        }
+        portEXIT_CRITICAL(&s_tx_mux);
+        if (!use) continue;
+        mesh_node_info_t ni;
+        if (mesh_fleet_find_mac(o->mac, &ni)) strlcpy(o->dev, ni.dev, sizeof o->dev);
+        else o->dev[0] = '\0';
+        n++;
+    }
+    if (pos) *pos = i;
+    return n;
+}
+
+// envelop → frame in buf (bewaard voor retransmits): binair, of JSON bij MESH_WIRE_JSON /
+// een te grote boom; 0 = past niet
+static size_t frame_env(uint8_t *buf, size_t cap, mesh_wire_type_t type, const mesh_envelope_t *e){
+    size_t n = 0;
+#if !MESH_WIRE_JSON
+    n = mesh_wire_encode(buf, cap, type, e);
+    if (n) return n;
+#endif
+    char *js = build_json(mesh_wire_type_str(type), e);
+    if (js && (n = strlen(js)+1) <= cap) memcpy(buf, js, n); else n = 0;
+    free(js);
+    return n;
+}
+
+// envelop in de TX-queue van to: binair in een poolbuffer; anders (MESH_WIRE_JSON, groot
+// frame, pool leeg) frame_env in een heapbuffer
+static esp_err_t send_env(const mesh_addr_t *to, mesh_wire_type_t type, const mesh_envelope_t *e, int flag){
+    uint8_t cls = tx_class(type, e->prio), what = type == MW_REQUEST ? TXF_REQ : TXF_DATA;
+    int8_t pool = -1;
+    size_t n = 0;
+    uint8_t *buf = NULL;
+#if !MESH_WIRE_JSON
+    if ((buf = txbuf_pool(&pool)) && !(n = mesh_wire_encode(buf, MESH_TXQ_FRAME, type, e))){ txbuf_release(buf, pool); buf = NULL; pool = -1; }
+#endif
+    if (!buf){
+        if (!(buf = malloc(MESH_PAYLOAD_MAX))) return ESP_ERR_NO_MEM;
+        if (!(n = frame_env(buf, MESH_PAYLOAD_MAX, type, e))){ free(buf); return ESP_FAIL; }
+    }
+    return tx_push(to, buf, pool, n, flag, cls, what);
+}
+
+// blokkerend: wacht per poging één RTO op de RESPONSE-ACK, dan retransmit (RTO ×2)
+static mesh_status_t request(const mesh_envelope_t *req, uint32_t timeout_ms){
+    mesh_addr_t dst;
+    if (!resolve_dst(req->dst_dev,&dst)) return MESH_NO_ROUTE;
+    int p = pend_alloc(req->corr_id);
+    if (p<0) return MESH_ERR;
+    pend_t *pp = &C.pend[p];
+    pp->cls = tx_class(MW_REQUEST, req->prio);
+    size_t n = frame_env(pp->frame, sizeof pp->frame, MW_REQUEST, req);
+    uint64_t end = now_ms() + timeout_ms;
+    uint32_t rto = n ? peer_rto(req->dst_dev) : timeout_ms;   // geen bewaard frame → één poging
+    mesh_status_t st = MESH_TIMEOUT;
+    for (int tries=0;; tries++){
+        uint64_t t0 = now_ms();
+        esp_err_t er = n ? tx_push_raw(&dst, pp->frame, n, MESH_DATA_P2P, pp->cls, tries ? TXF_RETX : TXF_REQ)
+                         : send_env(&dst, MW_REQUEST, req, MESH_DATA_P2P);
+        if (er != ESP_OK){ st = tries ? MESH_TIMEOUT : MESH_NO_ROUTE; break; }
+        uint64_t left = end > t0 ? end - t0 : 0;
+        if (xSemaphoreTake(pp->sem, pdMS_TO_TICKS(rto < left ? rto : left)) == pdTRUE){
+            st = pp->st;
+            if (!tries) mesh_fleet_rtt_sample(req->dst_dev, (uint32_t)(now_ms()-t0));
+            break;
+        }
+        if (!n || tries >= MESH_RETX_MAX || now_ms() >= end) break;
+        rto = rto_clamp(rto*2);
+    }
+    pend_free(p);
+    return st;
+}
+
+// niet-blokkerend: enkel in de TX-queue zetten (volle queue → fout i.p.v. wachten);
+// retransmits door de worker (pend_sweep)
+static mesh_status_t request_async(const mesh_envelope_t *req, uint32_t timeout_ms, mesh_done_cb_t cb, void *user){
+    mesh_addr_t dst;
+    if (!resolve_dst(req->dst_dev,&dst)) return MESH_NO_ROUTE;
+    int p = pend_alloc_async(req, timeout_ms, cb, user);
+    if (p<0) return MESH_ERR;
+    pend_t *pp = &C.pend[p];
+    pp->cls = tx_class(MW_REQUEST, req->prio);
+    size_t n = frame_env(pp->frame, sizeof pp->frame, MW_REQUEST, req);
+    uint32_t rto = peer_rto(req->dst_dev);
+    // alles klaarzetten vóór het verzenden: de ACK kan het slot meteen vrijgeven
+    xSemaphoreTake(C.lock,portMAX_DELAY);
+    pp->to = dst; pp->frame_n = (uint16_t)n; pp->rto_ms = rto; pp->tries = 1;
+    pp->sent_ms = now_ms();
+    pp->next_ms = n ? pp->sent_ms + rto : pp->deadline_ms;
+    if (pp->next_ms > pp->deadline_ms) pp->next_ms = pp->deadline_ms;
+    xSemaphoreGive(C.lock);
+    esp_err_t er = n ? tx_push_raw(&dst, pp->frame, n, MESH_DATA_P2P, pp->cls, TXF_REQ)
+                     : send_env(&dst, MW_REQUEST, req, MESH_DATA_P2P);
+    if (er != ESP_OK){
+        xSemaphoreTake(C.lock,portMAX_DELAY); pend_free_async_unsafe(&C.pend[p]); xSemaphoreGive(C.lock);
+        return MESH_NO_ROUTE;
+    }
+    return MESH_OK;
+}
+static mesh_status_t send_event(const mesh_envelope_t *evt){ mesh_addr_t dst; if(!resolve_dst(evt->dst_dev,&dst)) return MESH_NO_ROUTE; esp_err_t er=send_env(&dst, MW_EVENT, evt, MESH_DATA_P2P); return (er==ESP_OK)?MESH_OK:MESH_ERR; }
+
+// groepen: naam → 6-byte group-ID (multicast-bit gezet, nooit een station-MAC)
+static void group_id(const char *name, mesh_addr_t *out){
+    uint32_t h = esp_rom_crc32_le(0, (const uint8_t*)name, strlen(name));
+    out->addr[0] = 0x01; out->addr[1] = 0x00;
+    memcpy(&out->addr[2], &h, 4);
+}
+
+static void groups_apply(void){
+    int n = esp_mesh_get_group_num();
+    if (n > 0) {
+        mesh_addr_t old[MESH_GROUP_MAX * 2];
+        if (n > (int)(sizeof old / sizeof old[0])) n = sizeof old / sizeof old[0];
+        if (esp_mesh_get_group_list(old, n) == ESP_OK) esp_mesh_delete_group_id(old, n);
+    }
+    if (s_gid_n) esp_mesh_set_group_id(s_gid, s_gid_n);
+}
+
+// vóór init bewaard; na esp_mesh_start() meteen toegepast
+static mesh_status_t set_groups(const char *const *names, int n){
+    if (n < 0 || (n && !names)) return MESH_ERR;
+    if (n > MESH_GROUP_MAX) n = MESH_GROUP_MAX;
+    for (int i = 0; i < n; ++i) group_id(names[i], &s_gid[i]);
+    s_gid_n = n;
+    if (s_mesh_up) groups_apply();
+    return MESH_OK;
+}
+
+static mesh_status_t send_group(const mesh_envelope_t *req){
+    if (!req || !req->dst_dev || !*req->dst_dev) return MESH_ERR;
+    mesh_addr_t gid; group_id(req->dst_dev, &gid);
+    esp_err_t er = send_env(&gid, MW_GROUP, req, MESH_DATA_GROUP);
+    return (er==ESP_OK)?MESH_OK:MESH_NO_ROUTE;
+}
+
+// eigen laag + RSSI naar de parent (STA-link); root: geen parent
+static mesh_status_t link_info(mesh_link_info_t *out){
+    if (!s_mesh_up) return MESH_ERR;
+    int layer = esp_mesh_get_layer();
+    out->layer = layer > 0 ? (uint8_t)layer : 0;
+    out->rssi = 0;
+    wifi_ap_record_t ap;
+    if (!C.is_root && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) out->rssi = ap.rssi;
+    return MESH_OK;
+}
 
 static cJSON* snapshot(void){ int cap=esp_mesh_get_routing_table_size(); int got=0; mesh_addr_t *tbl=(cap>0)?(mesh_addr_t*)calloc(cap,sizeof(mesh_addr_t)):NULL; if(tbl) esp_mesh_get_routing_table(tbl,cap*sizeof(mesh_addr_t),&got); cJSON *arr=cJSON_CreateArray(); for(int i=0;i<got;i++){ char mac[18]; snprintf(mac,sizeof mac,"%02x:%02x:%02x:%02x:%02x:%02x", tbl[i].addr[0],tbl[i].addr[1],tbl[i].addr[2],tbl[i].addr[3],tbl[i].addr[4],tbl[i].addr[5]); cJSON_AddItemToArray(arr, cJSON_CreateString(mac)); } free(tbl); return arr; }
 
 // vtable export
-typedef struct { const char* (*name)(void); void (*init)(const mesh_opts_t*); void (*register_rx)(mesh_request_cb_t, mesh_event_cb_t); void (*register_root)(mesh_root_cb_t); mesh_status_t (*request)(const mesh_envelope_t*, uint32_t); mesh_status_t (*send_event)(const mesh_envelope_t*); cJSON* (*snapshot)(void); } ml_backend_t;
+typedef struct { const char* (*name)(void); void (*init)(const mesh_opts_t*); void (*register_rx)(mesh_request_cb_t, mesh_event_cb_t); void (*register_root)(mesh_root_cb_t); mesh_status_t (*request)(const mesh_envelope_t*, uint32_t); mesh_status_t (*send_event)(const mesh_envelope_t*); cJSON* (*snapshot)(void); mesh_status_t (*request_async)(const mesh_envelope_t*, uint32_t, mesh_done_cb_t, void*); mesh_status_t (*set_groups)(const char *const*, int); mesh_status_t (*send_group)(const mesh_envelope_t*); mesh_status_t (*link_info)(mesh_link_info_t*); int (*txq)(int*, mesh_txq_info_t*, int, bool); void (*rx_stats)(mesh_rx_stats_t*, bool); int (*paths)(mesh_path_info_t*, int, bool); } ml_backend_t;
 
-const ml_backend_t* ml_backend_espmesh(void){ static const ml_backend_t V={ name_backend, init, register_rx, register_root, request, send_event, snapshot }; return &V; }
+const ml_backend_t* ml_backend_espmesh(void){ static const ml_backend_t V={ name_backend, init, register_rx, register_root, request, send_event, snapshot, request_async, set_groups, send_group, link_info, txq_list, rx_stats, NULL }; return &V; }
 
 // ----- MQTT extra subscribe (Root/Current/#) -----
 static void on_mqtt_root_current(const char *topic, const char *payload){
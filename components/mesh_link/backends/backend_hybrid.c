@@ -0,0 +1,301 @@
+// components/mesh_link/backends/backend_hybrid.c
+// Hybride backend: ESP-WIFI-MESH voor toestellen in de eigen mesh, de MQTT-mailbox
+// (backend_mailbox.c) voor al de rest — toestellen met een eigen broker-sessie: de root
+// van een andere mesh (ander verdiep) of een standalone toestel.
+//
+// Pad per bestemming (REQUEST en EVENT):
+//   - "*ROOT*" / leeg / eigen naam  → mesh
+//   - online in het vlootregister   → mesh, tenzij de mailbox er aantoonbaar sneller is
+//   - anders, MQTT verbonden        → mailbox
+// "Aantoonbaar": de bestemming stuurde recent iets via de mailbox (heeft dus een eigen
+// sessie) en haar gladgestreken ACK-tijd over de mailbox ligt HYB_HYST_PCT % onder die
+// over de mesh. Elke HYB_PROBE_EVERY-de REQUEST naar zo'n bestemming neemt het andere pad
+// zodat beide metingen vers blijven. Weigert een pad meteen (geen route, vol), dan het andere.
+//
+// Beide backends blijven ongewijzigd eigenaar van hun pending-tabel en retransmits; deze
+// laag meet enkel REQUEST → afloop per pad en kiest.
+#include "mesh_link.h"
+#include "mesh_fleet.h"
+#include "mqtt_link.h"
+#include <string.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#define LOG_TAG "backend_hybrid"
+
+#ifndef HYB_PEERS
+#define HYB_PEERS          32    // bestemmingen met een eigen meting per pad (LRU)
+#endif
+#ifndef HYB_PENDING
+#define HYB_PENDING        32    // async REQUESTs onderweg (≥ MAX_PENDING van beide backends)
+#endif
+#ifndef HYB_PROBE_EVERY
+#define HYB_PROBE_EVERY    16
+#endif
+#ifndef HYB_HYST_PCT
+#define HYB_HYST_PCT       20    // mailbox pas verkiezen als ze zoveel % sneller is
+#endif
+#ifndef HYB_REMOTE_TTL_MS
+#define HYB_REMOTE_TTL_MS  (10*60*1000)   // zolang geldt "heeft een eigen broker-sessie"
+#endif
+
+/* Zelfde vtable-struct als in mesh_link.c */
+typedef struct {
+    const char* (*name)(void);
+    void (*init)(const mesh_opts_t*);
+    void (*register_rx)(mesh_request_cb_t, mesh_event_cb_t);
+    void (*register_root)(mesh_root_cb_t);
+    mesh_status_t (*request)(const mesh_envelope_t*, uint32_t);
+    mesh_status_t (*send_event)(const mesh_envelope_t*);
+    cJSON* (*snapshot)(void);
+    mesh_status_t (*request_async)(const mesh_envelope_t*, uint32_t, mesh_done_cb_t, void*);
+    mesh_status_t (*set_groups)(const char *const*, int);
+    mesh_status_t (*send_group)(const mesh_envelope_t*);
+    mesh_status_t (*link_info)(mesh_link_info_t*);
+    int (*txq)(int*, mesh_txq_info_t*, int, bool);
+    void (*rx_stats)(mesh_rx_stats_t*, bool);
+    int (*paths)(mesh_path_info_t*, int, bool);
+} ml_backend_t;
+
+const ml_backend_t* ml_backend_espmesh(void);
+const ml_backend_t* ml_backend_mailbox(void);
+
+enum { P_MESH = 0, P_MBOX, P_N };
+static const char *const s_path_name[P_N] = { "mesh", "mailbox" };
+
+typedef struct {
+    char     dev[32];            // "" = vrij
+    uint32_t srtt[P_N];          // ms, 0 = geen meting
+    uint32_t mbox_seen_ms;       // laatste frame van dev via de mailbox, 0 = nooit
+    uint32_t used_ms;            // LRU
+    uint16_t n;                  // REQUESTs (probe-teller)
+} peer_t;
+
+typedef struct {
+    bool           used;
+    uint8_t        path;
+    uint32_t       timeout_ms;
+    int64_t        t0_us;
+    mesh_done_cb_t cb;
+    void          *user;
+} hreq_t;
+
+static const ml_backend_t *E, *M;
+static const char      *s_local;
+static mesh_request_cb_t s_on_req;
+static mesh_event_cb_t   s_on_evt;
+static peer_t           s_peer[HYB_PEERS];
+static hreq_t           s_req[HYB_PENDING];
+static mesh_path_info_t s_path[P_N];
+static portMUX_TYPE     s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t now_ms(void){ return (uint32_t)(esp_timer_get_time() / 1000); }
+
+/* ---------- metingen ---------- */
+static peer_t *peer_find_unsafe(const char *dev){
+    for (int i=0;i<HYB_PEERS;i++) if (s_peer[i].dev[0] && !strcmp(s_peer[i].dev, dev)) return &s_peer[i];
+    return NULL;
+}
+
+// bestaand slot, anders het vrije of minst recent gebruikte
+static peer_t *peer_get_unsafe(const char *dev, uint32_t now){
+    peer_t *p = peer_find_unsafe(dev);
+    if (!p){
+        p = &s_peer[0];
+        for (int i=0;i<HYB_PEERS;i++){
+            if (!s_peer[i].dev[0]){ p = &s_peer[i]; break; }
+            if ((int32_t)(s_peer[i].used_ms - p->used_ms) < 0) p = &s_peer[i];
+        }
+        memset(p, 0, sizeof *p);
+        snprintf(p->dev, sizeof p->dev, "%s", dev);
+    }
+    p->used_ms = now;
+    return p;
+}
+
+static inline void ewma(uint32_t *srtt, uint32_t sample){
+    *srtt = *srtt ? (*srtt * 7 + sample) / 8 : (sample ? sample : 1);
+}
+
+// afloop van één REQUEST; een timeout telt mee als meting van timeout_ms (trager pad verliest)
+static void path_done(const char *dev, int path, mesh_status_t st, uint32_t ms, uint32_t timeout_ms){
+    uint32_t now = now_ms();
+    portENTER_CRITICAL(&s_mux);
+    mesh_path_info_t *pi = &s_path[path];
+    if (st == MESH_OK){
+        pi->ok++;
+        ewma(&pi->srtt_ms, ms);
+        if (ms > pi->max_ms) pi->max_ms = ms;
+    }
+    else if (st == MESH_TIMEOUT) pi->timeout++;
+    else if (st == MESH_NO_ROUTE) pi->no_route++;
+    if (dev && *dev && (st == MESH_OK || st == MESH_TIMEOUT)){
+        peer_t *p = peer_get_unsafe(dev, now);
+        ewma(&p->srtt[path], st == MESH_OK ? ms : timeout_ms);
+        if (path == P_MBOX && st == MESH_OK) p->mbox_seen_ms = now;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void mbox_seen(const char *dev){
+    if (!dev || !*dev) return;
+    uint32_t now = now_ms();
+    portENTER_CRITICAL(&s_mux);
+    peer_get_unsafe(dev, now)->mbox_seen_ms = now;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+/* ---------- padkeuze ---------- */
+static bool is_self_or_root(const char *dst){
+    return !dst || !*dst || !strcmp(dst, "*ROOT*") || (s_local && !strcmp(dst, s_local));
+}
+
+// -1 = geen pad; *alt = het andere pad (terugval) of -1
+static int choose(const char *dst, bool count, int *alt){
+    *alt = -1;
+    if (is_self_or_root(dst)) return P_MESH;
+    mesh_node_info_t ni;
+    bool mesh_ok = mesh_fleet_get(dst, &ni) && ni.online;
+    bool mbox_ok = mqtt_link_connected();
+    if (!mesh_ok) return mbox_ok ? P_MBOX : -1;
+    if (!mbox_ok) return P_MESH;
+
+    int pick = P_MESH;
+    uint32_t now = now_ms();
+    portENTER_CRITICAL(&s_mux);
+    peer_t *p = peer_find_unsafe(dst);
+    bool remote = p && p->mbox_seen_ms && now - p->mbox_seen_ms < HYB_REMOTE_TTL_MS;
+    if (remote){
+        uint32_t sm = p->srtt[P_MESH] ? p->srtt[P_MESH] : ni.srtt_ms;
+        uint32_t sb = p->srtt[P_MBOX];
+        if (sm && sb && (uint64_t)sb * 100 < (uint64_t)sm * (100 - HYB_HYST_PCT)) pick = P_MBOX;
+        if (count && ++p->n % HYB_PROBE_EVERY == 0){ pick = !pick; s_path[pick].probes++; }
+        *alt = !pick;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return pick;
+}
+
+static const ml_backend_t *be(int path){ return path == P_MBOX ? M : E; }
+
+static void count_sent(int path, bool fallback){
+    portENTER_CRITICAL(&s_mux);
+    s_path[path].sent++;
+    if (fallback) s_path[path].fallback++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+/* ---------- RX ---------- */
+// mailbox-verkeer: afzender heeft een eigen broker-sessie → mailbox-pad geldig
+static void on_mbox_req(const mesh_envelope_t *req){ mbox_seen(req->src_dev); if (s_on_req) s_on_req(req); }
+static void on_mbox_evt(const mesh_envelope_t *evt){ mbox_seen(evt->src_dev); if (s_on_evt) s_on_evt(evt); }
+
+/* ---------- backend vtable ---------- */
+static const char* name_backend(void){ return "hybrid(espmesh+mailbox)"; }
+
+static void init(const mesh_opts_t *opts){
+    E = ml_backend_espmesh();
+    M = ml_backend_mailbox();
+    s_local = opts->local_dev;
+    for (int p=0;p<P_N;p++) snprintf(s_path[p].name, sizeof s_path[p].name, "%s", s_path_name[p]);
+    E->init(opts);
+    M->init(opts);   // subscribe op de eigen mailbox gebeurt bij (elke) MQTT-connect
+    E->register_rx(s_on_req, s_on_evt);
+    M->register_rx(on_mbox_req, on_mbox_evt);
+    ESP_LOGI(LOG_TAG, "mesh + mailbox, probe 1/%d, mailbox vanaf %d%% sneller", HYB_PROBE_EVERY, HYB_HYST_PCT);
+}
+
+// mag vóór init (main.c registreert eerst)
+static void register_rx(mesh_request_cb_t on_request, mesh_event_cb_t on_event){
+    s_on_req = on_request; s_on_evt = on_event;
+    if (E) E->register_rx(on_request, on_event);
+}
+
+static void register_root(mesh_root_cb_t cb){ ml_backend_espmesh()->register_root(cb); }
+
+static mesh_status_t request(const mesh_envelope_t *req, uint32_t timeout_ms){
+    int alt, path = choose(req->dst_dev, true, &alt);
+    if (path < 0) return MESH_NO_ROUTE;
+    for (bool fb = false;; fb = true){
+        count_sent(path, fb);
+        int64_t t0 = esp_timer_get_time();
+        mesh_status_t st = be(path)->request(req, timeout_ms);
+        path_done(req->dst_dev, path, st, (uint32_t)((esp_timer_get_time() - t0) / 1000), timeout_ms);
+        if (st == MESH_OK || st == MESH_TIMEOUT || fb || alt < 0) return st;
+        path = alt;
+    }
+}
+
+static void on_done(corr_id_t corr_id, const char *dst_dev, mesh_status_t st, void *user){
+    hreq_t *h = (hreq_t*)user;
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - h->t0_us) / 1000);
+    path_done(dst_dev, h->path, st, ms, h->timeout_ms);
+    mesh_done_cb_t cb = h->cb; void *u = h->user;
+    portENTER_CRITICAL(&s_mux); h->used = false; portEXIT_CRITICAL(&s_mux);
+    if (cb) cb(corr_id, dst_dev, st, u);
+}
+
+static mesh_status_t request_async(const mesh_envelope_t *req, uint32_t timeout_ms, mesh_done_cb_t cb, void *user){
+    int alt, path = choose(req->dst_dev, true, &alt);
+    if (path < 0) return MESH_NO_ROUTE;
+    hreq_t *h = NULL;
+    portENTER_CRITICAL(&s_mux);
+    for (int i=0;i<HYB_PENDING;i++) if (!s_req[i].used){ h = &s_req[i]; h->used = true; break; }
+    portEXIT_CRITICAL(&s_mux);
+    if (!h) return MESH_ERR;
+    h->cb = cb; h->user = user; h->timeout_ms = timeout_ms;
+
+    mesh_status_t st = MESH_NO_ROUTE;
+    for (bool fb = false;; fb = true){
+        // alles klaar vóór het verzenden: de ACK kan on_done meteen oproepen
+        h->path = (uint8_t)path; h->t0_us = esp_timer_get_time();
+        count_sent(path, fb);
+        st = be(path)->request_async(req, timeout_ms, on_done, h);
+        if (st == MESH_OK) return MESH_OK;
+        path_done(req->dst_dev, path, st, 0, timeout_ms);
+        if (fb || alt < 0) break;
+        path = alt;
+    }
+    portENTER_CRITICAL(&s_mux); h->used = false; portEXIT_CRITICAL(&s_mux);
+    return st;
+}
+
+static mesh_status_t send_event(const mesh_envelope_t *evt){
+    int alt, path = choose(evt->dst_dev, false, &alt);
+    if (path < 0) return MESH_NO_ROUTE;
+    mesh_status_t st = be(path)->send_event(evt);
+    if (st != MESH_OK && alt >= 0) st = be(alt)->send_event(evt);
+    return st;
+}
+
+static cJSON* snapshot(void){ return ml_backend_espmesh()->snapshot(); }
+static mesh_status_t set_groups(const char *const *names, int n){ return ml_backend_espmesh()->set_groups(names, n); }
+static mesh_status_t send_group(const mesh_envelope_t *req){ return ml_backend_espmesh()->send_group(req); }
+static mesh_status_t link_info(mesh_link_info_t *out){ return ml_backend_espmesh()->link_info(out); }
+static int txq(int *pos, mesh_txq_info_t *out, int max, bool reset){ return ml_backend_espmesh()->txq(pos, out, max, reset); }
+static void rx_stats(mesh_rx_stats_t *out, bool reset){ ml_backend_espmesh()->rx_stats(out, reset); }
+
+static int paths(mesh_path_info_t *out, int max, bool reset){
+    int n = max < P_N ? max : P_N;
+    portENTER_CRITICAL(&s_mux);
+    for (int p=0;p<n;p++){
+        out[p] = s_path[p];
+        if (reset){
+            // srtt blijft (gladgestreken over de perioden heen)
+            uint32_t srtt = s_path[p].srtt_ms;
+            memset(&s_path[p], 0, sizeof s_path[p]);
+            memcpy(s_path[p].name, out[p].name, sizeof s_path[p].name);
+            s_path[p].srtt_ms = srtt;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+const ml_backend_t* ml_backend_hybrid(void){
+    static const ml_backend_t V = { name_backend, init, register_rx, register_root, request, send_event, snapshot,
+                                    request_async, set_groups, send_group, link_info, txq, rx_stats, paths };
+    return &V;
+}
@@ -1,16 +1,20 @@
 // components/mesh_link/backends/backend_mailbox.c
 // Mailbox-MQTT backend: REQUEST/RESPONSE-ACK + EVENT via broker
+// Alleen bruikbaar met een eigen MQTT-sessie (root of standalone); ook het tweede pad
+// van de hybride backend (backend_hybrid.c).
 #include "mesh_link.h"
+#include "mqtt_link.h"
+#include "mesh_time.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
-
-/* Vereist door jouw project (implementeer in mqtt_link.c of gelijkaardig) */
-typedef void (*mqtt_rx_cb_t)(const char* topic, const char* payload, void* user);
-extern int mqtt_link_publish(const char* topic, const char* payload, int qos, bool retain);
-extern int mqtt_link_subscribe(const char* topic, mqtt_rx_cb_t cb, void *user);
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
 
 /* Instelbaar: topicvorm voor ‘mailbox’ per device */
 #ifndef ML_MAILBOX_FMT
@@ -18,6 +22,7 @@ extern int mqtt_link_subscribe(const char* topic, mqtt_rx_cb_t cb, void *user);
 #endif
 
 #define MAX_PENDING   16
+#define PEND_TICK_MS  100   // async: deadlines nakijken
 #define STRLCPY(dst,src) do{ (dst)[sizeof(dst)-1]='\0'; strncpy((dst),(src),sizeof(dst)-1);}while(0)
 
 typedef struct {
@@ -26,44 +31,113 @@ typedef struct {
     mesh_event_cb_t   on_evt;
     char local_box[128];
     SemaphoreHandle_t lock;
+    TimerHandle_t pend_timer;
+    volatile int  n_async;          // open async-slots; 0 → timer stuurt geen sweep
     struct {
-        uint32_t corr_id;
-        SemaphoreHandle_t sem;
+        corr_id_t corr_id;
+        SemaphoreHandle_t sem;      // NULL = async
         mesh_status_t st;
         int used;
+        mesh_done_cb_t cb;          // async
+        void *user;
+        uint64_t deadline_ms;
+        char dst[32];
     } pend[MAX_PENDING];
 } ctx_t;
 
 static ctx_t C;
+static QueueHandle_t s_workq = NULL;
+
+typedef enum { W_PEND_SWEEP } work_t;
 
 /* ---------- helpers ---------- */
 static void mailbox_topic(char *buf, size_t sz, const char *dev){
     snprintf(buf, sz, ML_MAILBOX_FMT, dev);
 }
 
-static int pend_alloc(uint32_t corr_id){
+static uint64_t now_ms(void){ return (uint64_t)(esp_timer_get_time() / 1000); }
+
+static bool publish_box(const char *dev, const char *type, const mesh_envelope_t *e);
+
+static int pend_alloc(const mesh_envelope_t *req){
     xSemaphoreTake(C.lock, portMAX_DELAY);
     int idx=-1;
     for (int i=0;i<MAX_PENDING;i++) if (!C.pend[i].used){ idx=i; break; }
     if (idx>=0){
+        memset(&C.pend[idx], 0, sizeof C.pend[idx]);
         C.pend[idx].used=1;
-        C.pend[idx].corr_id=corr_id;
+        C.pend[idx].corr_id=req->corr_id;
         C.pend[idx].st=MESH_TIMEOUT;
         C.pend[idx].sem = xSemaphoreCreateBinary();
+        STRLCPY(C.pend[idx].dst, req->dst_dev);
     }
     xSemaphoreGive(C.lock);
     return idx;
 }
-static void pend_signal(uint32_t corr_id, mesh_status_t st){
+// async: slot zonder semaphore; vrijgegeven door pend_signal of pend_sweep
+static int pend_alloc_async(const mesh_envelope_t *req, uint32_t timeout_ms, mesh_done_cb_t cb, void *user){
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    int idx=-1;
+    for (int i=0;i<MAX_PENDING;i++) if (!C.pend[i].used){ idx=i; break; }
+    if (idx>=0){
+        memset(&C.pend[idx], 0, sizeof C.pend[idx]);
+        C.pend[idx].used=1;
+        C.pend[idx].corr_id=req->corr_id;
+        C.pend[idx].cb=cb; C.pend[idx].user=user;
+        C.pend[idx].deadline_ms=now_ms()+timeout_ms;
+        STRLCPY(C.pend[idx].dst, req->dst_dev);
+        C.n_async++;
+    }
+    xSemaphoreGive(C.lock);
+    return idx;
+}
+static void pend_free_async_unsafe(int i){ C.pend[i].used=0; C.pend[i].cb=NULL; C.n_async--; }
+
+// RESPONSE van src: zelfde corr kan bij meerdere toestellen openstaan (batch) → ook op dst matchen.
+// Callback buiten de lock (mag zelf opnieuw versturen)
+static void pend_signal(corr_id_t corr_id, const char *src, mesh_status_t st){
+    mesh_done_cb_t cb=NULL; void *user=NULL; char dst[32]="";
     xSemaphoreTake(C.lock, portMAX_DELAY);
     for (int i=0;i<MAX_PENDING;i++){
-        if (C.pend[i].used && C.pend[i].corr_id==corr_id){
-            C.pend[i].st = st;
-            xSemaphoreGive(C.pend[i].sem);
-            break;
-        }
+        if (!C.pend[i].used || C.pend[i].corr_id!=corr_id) continue;
+        if (C.pend[i].dst[0] && src && strcmp(C.pend[i].dst, src)!=0) continue;
+        C.pend[i].st = st;
+        if (C.pend[i].sem){ xSemaphoreGive(C.pend[i].sem); break; }
+        cb=C.pend[i].cb; user=C.pend[i].user; memcpy(dst, C.pend[i].dst, sizeof dst);
+        pend_free_async_unsafe(i);
+        break;
     }
     xSemaphoreGive(C.lock);
+    if (cb) cb(corr_id, dst, st, user);
+}
+
+// worker: verlopen async-slots → TIMEOUT (geen retransmit: QoS1 tot de broker volstaat).
+// Niet in de timer-daemon: de callbacks (router) publiceren via MQTT.
+static void pend_sweep(void){
+    uint64_t now = now_ms();
+    for (int i=0;i<MAX_PENDING;i++){
+        mesh_done_cb_t cb=NULL; void *user=NULL; corr_id_t corr=0; char dst[32]="";
+        xSemaphoreTake(C.lock, portMAX_DELAY);
+        if (C.pend[i].used && !C.pend[i].sem && now >= C.pend[i].deadline_ms){
+            cb=C.pend[i].cb; user=C.pend[i].user; corr=C.pend[i].corr_id;
+            memcpy(dst, C.pend[i].dst, sizeof dst);
+            pend_free_async_unsafe(i);
+        }
+        xSemaphoreGive(C.lock);
+        if (cb) cb(corr, dst, MESH_TIMEOUT, user);
+    }
+}
+static void pend_timer_cb(TimerHandle_t t){ (void)t; if (!C.n_async) return; uint8_t w=W_PEND_SWEEP; xQueueSend(s_workq, &w, 0); }
+
+static void backend_worker(void *arg){
+    (void)arg;
+    uint8_t w;
+    for(;;){
+        if (xQueueReceive(s_workq, &w, portMAX_DELAY) != pdTRUE) continue;
+        switch(w){
+            case W_PEND_SWEEP: pend_sweep(); break;
+        }
+    }
 }
 static mesh_status_t pend_wait_and_free(int idx, uint32_t tmo_ms){
     if (idx<0) return MESH_ERR;
@@ -79,23 +153,38 @@ static mesh_status_t pend_wait_and_free(int idx, uint32_t tmo_ms){
 }
 
 /* ---------- JSON helpers ---------- */
+// corr_id als 16 hex-tekens: 64-bit past niet in een JSON-number (double)
+static void corr_to_json(cJSON *o, corr_id_t c){
+    char hex[17];
+    snprintf(hex, sizeof hex, "%016" PRIx64, c);
+    cJSON_AddStringToObject(o, "corr_id", hex);
+}
+static corr_id_t corr_from_json(const cJSON *j){
+    const char *s = cJSON_GetStringValue(j);
+    return s ? (corr_id_t)strtoull(s, NULL, 16) : 0;
+}
+
+static const char *const s_kind_str[] = { "relay", "pwm", "config", "input", "diag" };
+
+static mesh_kind_t kind_from_str(const char *k){
+    if (k) for (int i=0;i<=ML_KIND_DIAG;i++) if (!strcmp(k, s_kind_str[i])) return (mesh_kind_t)i;
+    return ML_KIND_DIAG;
+}
+
 static char* build_json(const char *type, const mesh_envelope_t *e){
     cJSON *o = cJSON_CreateObject();
     cJSON_AddStringToObject(o,"schema","v1");
     cJSON_AddStringToObject(o,"type",type);                 // "REQUEST"|"RESPONSE"|"EVENT"
-    cJSON_AddNumberToObject(o,"corr_id", e?e->corr_id:0);
+    corr_to_json(o, e?e->corr_id:0);
     cJSON_AddNumberToObject(o,"ts_ms",   e?e->ts_ms:0);
     cJSON_AddStringToObject(o,"src_dev", e?e->src_dev:C.O.local_dev);
     if (e && e->dst_dev) cJSON_AddStringToObject(o,"dst_dev", e->dst_dev);
     if (e){
-        const char *kind =
-            (e->kind==ML_KIND_RELAY)?"relay":
-            (e->kind==ML_KIND_PWM)?"pwm":
-            (e->kind==ML_KIND_CONFIG)?"config":
-            (e->kind==ML_KIND_INPUT)?"input":"diag";
-        cJSON_AddStringToObject(o,"kind", kind);
+        cJSON_AddStringToObject(o,"kind", s_kind_str[e->kind<=ML_KIND_DIAG ? e->kind : ML_KIND_DIAG]);
         cJSON_AddNumberToObject(o,"ttl",  e->ttl);
         cJSON_AddNumberToObject(o,"hop",  e->hop);
+        if (e->prio) cJSON_AddNumberToObject(o,"prio", e->prio);
+        if (e->exec_us) cJSON_AddNumberToObject(o,"exec_us", e->exec_us);
         if (e->origin_set_topic) cJSON_AddStringToObject(o,"origin_set_topic", e->origin_set_topic);
         if (e->payload) cJSON_AddItemToObject(o,"payload", cJSON_Duplicate(e->payload, 1));
     }
@@ -104,24 +193,40 @@ static char* build_json(const char *type, const mesh_envelope_t *e){
     return js;
 }
 
+static bool publish_box(const char *dev, const char *type, const mesh_envelope_t *e){
+    char *js = build_json(type, e);
+    if (!js) return false;
+    char t[128]; mailbox_topic(t, sizeof t, dev);
+    bool ok = mqtt_link_publish(t, js, 1, false);
+    free(js);
+    return ok;
+}
+
 /* ---------- RX ---------- */
-static void send_response_ack(const char *dst_dev, uint32_t corr_id){
+static void send_response_ack(const char *dst_dev, corr_id_t corr_id){
     mesh_envelope_t e = { .corr_id=corr_id, .src_dev=C.O.local_dev, .dst_dev=dst_dev };
-    char *js = build_json("RESPONSE", &e);
-    char t[128]; mailbox_topic(t, sizeof t, dst_dev);
-    mqtt_link_publish(t, js, 1, false);
-    free(js);
+    (void)publish_box(dst_dev, "RESPONSE", &e);
 }
 
-static void on_rx(const char* topic, const char* payload, void* user){
-    (void)topic; (void)user;
+// Commando van Node-RED (…/Cmd/Set): de ontvanger kreeg hetzelfde bericht zelf van de broker
+static bool from_broker_cmd(const char *origin){
+    if (!origin) return false;
+    size_t n = strlen(origin);
+    return (n>=8 && !strcmp(origin+n-8, "/Cmd/Set")) || (n>=9 && !strcmp(origin+n-9, "/Cmd/SetB"));
+}
+
+// mqtt_link levert elk bericht aan elke extra subscriber: zelf op topic filteren
+static void on_rx(const char* topic, const char* payload){
+    if (!topic || !payload || strcmp(topic, C.local_box)!=0) return;
     cJSON *o = cJSON_Parse(payload); if (!o) return;
 
     const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(o,"type"));
     const char *src  = cJSON_GetStringValue(cJSON_GetObjectItem(o,"src_dev"));
     const char *dst  = cJSON_GetStringValue(cJSON_GetObjectItem(o,"dst_dev"));
-    uint32_t corr_id = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"corr_id"));
+    corr_id_t corr_id = corr_from_json(cJSON_GetObjectItem(o,"corr_id"));
     cJSON *payload_j = cJSON_GetObjectItem(o,"payload");
+    const cJSON *jprio = cJSON_GetObjectItem(o,"prio");
+    const cJSON *jexec = cJSON_GetObjectItem(o,"exec_us");
 
     mesh_envelope_t e = {
         .schema = cJSON_GetStringValue(cJSON_GetObjectItem(o,"schema")),
@@ -129,19 +234,22 @@ static void on_rx(const char* topic, const char* payload, void* user){
         .ts_ms = (uint64_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"ts_ms")),
         .src_dev = src,
         .dst_dev = dst,
-        .kind = ML_KIND_DIAG,
+        .kind = kind_from_str(cJSON_GetStringValue(cJSON_GetObjectItem(o,"kind"))),
+        .prio = cJSON_IsNumber(jprio) ? (mesh_prio_t)jprio->valueint : ML_PRIO_NONE,
         .ttl = (int8_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"ttl")),
         .hop = (uint8_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"hop")),
         .origin_set_topic = cJSON_GetStringValue(cJSON_GetObjectItem(o,"origin_set_topic")),
-        .payload = payload_j
+        .payload = payload_j,
+        .exec_us = cJSON_IsNumber(jexec) ? (uint32_t)jexec->valuedouble : 0
     };
 
     if (!type){ cJSON_Delete(o); return; }
 
     if (strcmp(type,"RESPONSE")==0){
-        pend_signal(corr_id, MESH_OK);
+        pend_signal(corr_id, src, MESH_OK);
     } else if (strcmp(type,"REQUEST")==0){
-        if (C.on_req) C.on_req(&e);
+        // dubbel via broker én mailbox: enkel bevestigen, de eigen Cmd/Set-subscription voert uit
+        if (C.on_req && !from_broker_cmd(e.origin_set_topic)) C.on_req(&e);
         if (src) send_response_ack(src, corr_id);  // leverings-ACK
     } else if (strcmp(type,"EVENT")==0){
         if (C.on_evt) C.on_evt(&e);
@@ -156,9 +264,19 @@ static void init(const mesh_opts_t *opts){
     memset(&C, 0, sizeof C);
     C.O = *opts;
     C.lock = xSemaphoreCreateMutex();
+    if (!s_workq){
+        s_workq = xQueueCreate(4, sizeof(uint8_t));
+        xTaskCreate(backend_worker, "mbox_bkw", 4096, NULL, 5, NULL);
+    }
 
     mailbox_topic(C.local_box, sizeof C.local_box, C.O.local_dev);
-    mqtt_link_subscribe(C.local_box, on_rx, NULL);
+    mqtt_link_subscribe_extra(C.local_box, 1, on_rx);   // (her)subscribe bij elke connect
+    C.pend_timer = xTimerCreate("mbox_pend", pdMS_TO_TICKS(PEND_TICK_MS), pdTRUE, NULL, pend_timer_cb);
+    if (C.pend_timer) xTimerStart(C.pend_timer, 0);
+    mesh_time_clock(esp_timer_get_time);
+#ifndef CONFIG_ML_HYBRID_BACKEND
+    mesh_time_role(true);   // eigen broker-sessie: eigen klok (Mesh/Time); hybride → ESP-MESH beslist
+#endif
 }
 
 static void register_rx(mesh_request_cb_t on_request, mesh_event_cb_t on_event){
@@ -168,25 +286,32 @@ static void register_rx(mesh_request_cb_t on_request, mesh_event_cb_t on_event){
 
 static mesh_status_t request(const mesh_envelope_t *req, uint32_t timeout_ms){
     if (!req || !req->dst_dev || !*req->dst_dev) return MESH_NO_ROUTE;
+    if (!mqtt_link_connected()) return MESH_NO_ROUTE;
 
-    int p = pend_alloc(req->corr_id, timeout_ms);
+    int p = pend_alloc(req);
     if (p<0) return MESH_ERR;
 
-    char *js = build_json("REQUEST", req);
-    char topic[128]; mailbox_topic(topic, sizeof topic, req->dst_dev);
-    mqtt_link_publish(topic, js, 1, false);
-    free(js);
-
+    if (!publish_box(req->dst_dev, "REQUEST", req)){ (void)pend_wait_and_free(p, 0); return MESH_ERR; }
     return pend_wait_and_free(p, timeout_ms); // wacht op RESPONSE-ACK
 }
 
+// niet-blokkerend: RESPONSE-ACK (on_rx) of deadline (pend_sweep) roept cb exact één keer
+static mesh_status_t request_async(const mesh_envelope_t *req, uint32_t timeout_ms, mesh_done_cb_t cb, void *user){
+    if (!req || !req->dst_dev || !*req->dst_dev) return MESH_NO_ROUTE;
+    if (!mqtt_link_connected()) return MESH_NO_ROUTE;
+    int p = pend_alloc_async(req, timeout_ms, cb, user);
+    if (p<0) return MESH_ERR;
+    if (!publish_box(req->dst_dev, "REQUEST", req)){
+        xSemaphoreTake(C.lock, portMAX_DELAY); pend_free_async_unsafe(p); xSemaphoreGive(C.lock);
+        return MESH_ERR;
+    }
+    return MESH_OK;
+}
+
 static mesh_status_t send_event(const mesh_envelope_t *evt){
     if (!evt || !evt->dst_dev || !*evt->dst_dev) return MESH_NO_ROUTE;
-    char *js = build_json("EVENT", evt);
-    char topic[128]; mailbox_topic(topic, sizeof topic, evt->dst_dev);
-    int rc = mqtt_link_publish(topic, js, 1, false);
-    free(js);
-    return (rc==0)? MESH_OK : MESH_ERR;
+    if (!mqtt_link_connected()) return MESH_NO_ROUTE;
+    return publish_box(evt->dst_dev, "EVENT", evt) ? MESH_OK : MESH_ERR;
 }
 
 static cJSON* snapshot(void){
@@ -204,11 +329,18 @@ typedef struct {
     mesh_status_t (*request)(const mesh_envelope_t*, uint32_t);
     mesh_status_t (*send_event)(const mesh_envelope_t*);
     cJSON* (*snapshot)(void);
+    mesh_status_t (*request_async)(const mesh_envelope_t*, uint32_t, mesh_done_cb_t, void*);
+    mesh_status_t (*set_groups)(const char *const*, int);
+    mesh_status_t (*send_group)(const mesh_envelope_t*);
+    mesh_status_t (*link_info)(mesh_link_info_t*);
+    int (*txq)(int*, mesh_txq_info_t*, int, bool);
+    void (*rx_stats)(mesh_rx_stats_t*, bool);
+    int (*paths)(mesh_path_info_t*, int, bool);
 } ml_backend_t;
 
 static void register_root(mesh_root_cb_t cb){ (void)cb; /* mailbox-backend meldt geen root-wissels */ }
 
 const ml_backend_t* ml_backend_mailbox(void){
-    static const ml_backend_t V = { name_backend, init, register_rx, register_root, request, send_event, snapshot };
+    static const ml_backend_t V = { name_backend, init, register_rx, register_root, request, send_event, snapshot, request_async, NULL, NULL, NULL, NULL, NULL, NULL };
     return &V;
 }
@@ -0,0 +1,756 @@
+// components/mesh_link/backends/backend_sim.c
+// Gesimuleerde mesh voor de host (IDF-target linux): N toestellen over UDP-loopback.
+// Eén proces = één echt toestel (router, parser, mqtt_link draaien ongewijzigd op deze
+// backend) + optioneel virtuele toestellen die REQUESTs ACKen en met een EVENT antwoorden.
+// Meerdere processen (ML_SIM_SELF verschillend, ML_SIM_VIRTUAL=none) vormen samen één mesh.
+//
+// Topologie: vaste boom, parent(i) = (i-1)/ML_SIM_FANOUT (1 = lijn, ≥ N = ster); een
+// weggevallen toestel → zijn kinderen hangen aan de eerste levende voorouder. Per hop
+// ML_SIM_HOP_MS + 0..ML_SIM_JITTER_MS vertraging en ML_SIM_LOSS_PM ‰ verlies (bij de
+// ontvanger toegepast). Root = laagste levende index; de root meldt wijzigingen zoals
+// MESH_EVENT_ROUTING_TABLE_* via mesh_diag_publish_route_table() en het vlootregister.
+//
+// Instellingen: de macro's hieronder, of dezelfde naam als omgevingsvariabele.
+#include "mesh_link.h"
+#include "mesh_wire.h"
+#include "mesh_fleet.h"
+#include "mesh_time.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <strings.h>
+#include <inttypes.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+
+#define LOG_TAG "backend_sim"
+
+#ifndef ML_SIM_MAX
+#define ML_SIM_MAX         256     // bovengrens voor ML_SIM_NODES
+#endif
+#ifndef ML_SIM_NODES
+#define ML_SIM_NODES       50
+#endif
+#ifndef ML_SIM_SELF
+#define ML_SIM_SELF        0       // index van dit proces (0 = root zolang het leeft)
+#endif
+#ifndef ML_SIM_VIRTUAL
+#define ML_SIM_VIRTUAL     "all"   // "all" (alle andere), "none", of "lo-hi"
+#endif
+#ifndef ML_SIM_PORT
+#define ML_SIM_PORT        47000   // toestel i luistert op 127.0.0.1:ML_SIM_PORT+i
+#endif
+#ifndef ML_SIM_FANOUT
+#define ML_SIM_FANOUT      6       // kinderen per toestel (zoals CONFIG_MESH_AP_CONNECTIONS)
+#endif
+#ifndef ML_SIM_HOP_MS
+#define ML_SIM_HOP_MS      8
+#endif
+#ifndef ML_SIM_JITTER_MS
+#define ML_SIM_JITTER_MS   4
+#endif
+#ifndef ML_SIM_LOSS_PM
+#define ML_SIM_LOSS_PM     0       // verlies per hop, promille
+#endif
+#ifndef ML_SIM_EXEC_MS
+#define ML_SIM_EXEC_MS     2       // uitvoering op een virtueel toestel (REQUEST → EVENT)
+#endif
+#ifndef ML_SIM_GROUPS
+#define ML_SIM_GROUPS      4       // virtueel toestel i zit in groep "SIM_G<i % n>"; 0 = geen
+#endif
+#ifndef ML_SIM_SEED
+#define ML_SIM_SEED        1
+#endif
+#ifndef ML_SIM_BEACON_MS
+#define ML_SIM_BEACON_MS   500
+#endif
+#define ML_SIM_DEAD_MS     (4*ML_SIM_BEACON_MS)
+#define ML_SIM_NAME_FMT    "SIM_%03d"
+#define ML_SIM_TIME_TICK_MS 250    // root: vervallen tijdprobes (mesh_time)
+#define ML_SIM_INFLIGHT    512     // frames onderweg (vertraging), vol → weg en geteld
+#define ML_SIM_FRAME_MAX   1024
+#define MAX_PENDING        16
+#define SIM_RTO_INIT_MS    300
+#define SIM_RTO_MIN_MS     20
+#define SIM_RTO_MAX_MS     2000
+#define SIM_RETX_MAX       3
+
+// datagram: header + mesh_wire-frame, of header + beacon
+enum { D_FRAME = 'F', D_BEACON = 'B' };
+typedef struct __attribute__((packed)) {
+    uint8_t  magic, kind;
+    uint16_t src, dst;
+    uint16_t len;
+} sim_hdr_t;
+#define SIM_MAGIC 0x5D
+
+// beacon: levende toestellen van het proces (bitmap) + naam van zijn echte toestel
+typedef struct __attribute__((packed)) {
+    uint16_t self;
+    char     name[32];
+    uint8_t  alive[ML_SIM_MAX/8];
+} sim_beacon_t;
+
+// frame onderweg of uitgestelde verzending (virtueel EVENT na ML_SIM_EXEC_MS)
+typedef struct {
+    uint64_t due_ms;
+    uint16_t src, dst;      // dst: toestelindex (ontvanger of, bij send, bestemming)
+    uint16_t len;
+    bool     send;          // true = op due_ms verzenden vanaf src
+    uint8_t *data;          // mesh_wire-frame (heap)
+} sim_item_t;
+
+typedef struct { corr_id_t corr_id; SemaphoreHandle_t sem; mesh_status_t st; bool used;
+                 char dst[32]; mesh_done_cb_t cb; void *user; uint64_t deadline_ms;
+                 uint16_t to, frame_n; uint8_t tries; uint32_t rto_ms; uint64_t sent_ms, next_ms;
+                 uint8_t frame[ML_SIM_FRAME_MAX]; } pend_t;
+
+typedef struct {
+    uint32_t relays;        // relay-toestand
+    corr_id_t seen[4];      // laatste corr_ids: retransmit → enkel ACK
+    uint8_t  seen_i;
+} virt_t;
+
+typedef struct {
+    mesh_opts_t O;
+    mesh_request_cb_t on_req;
+    mesh_event_cb_t   on_evt;
+    mesh_root_cb_t    on_root;
+    SemaphoreHandle_t lock;
+    int      nodes, self, fanout, hop_ms, jitter_ms, loss_pm, exec_ms, groups_n, port;
+    unsigned seed;
+    int      vlo, vhi;                   // virtuele toestellen in dit proces (lo > hi = geen)
+    int      fd[ML_SIM_MAX];             // socket per lokaal toestel, -1 = niet lokaal
+    uint64_t seen_ms[ML_SIM_MAX];        // laatste beacon
+    char     names[ML_SIM_MAX][32];      // naam per index (beacon of ML_SIM_NAME_FMT)
+    uint8_t  alive[ML_SIM_MAX/8];        // actuele toestand (net-taak)
+    uint8_t  rt_prev[ML_SIM_MAX/8];      // laatst gemelde (root)
+    int      root;                       // -1 = onbekend
+    bool     is_root;
+    virt_t  *virt;                       // [nodes]
+    char     groups[MESH_GROUP_MAX][32];
+    int      groups_n_own;
+    pend_t   pend[MAX_PENDING];
+    int      n_async;
+    sim_item_t heap[ML_SIM_INFLIGHT];
+    int      heap_n;
+    QueueHandle_t dispq;                 // sim_item_t* naar de dispatch-taak
+    mesh_wire_pool_t net_pool, disp_pool;
+    struct { uint32_t frames, dropped, min_free, lag_max_us, run_max_us; uint64_t lag_sum_us; } st;
+} ctx_t;
+
+static ctx_t C;
+
+// forward
+static void pend_complete(corr_id_t corr_id, const char *src, mesh_status_t st);
+
+// utils
+static uint64_t now_ms(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return (uint64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000; }
+static uint64_t now_us(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000; }
+static int64_t clock_us(void){ return (int64_t)now_us(); }
+static const char* name_backend(void){ return "sim-udp"; }
+static bool bit(const uint8_t *m, int i){ return m[i>>3] & (1u<<(i&7)); }
+static void bit_set(uint8_t *m, int i, bool v){ if (v) m[i>>3] |= 1u<<(i&7); else m[i>>3] &= ~(1u<<(i&7)); }
+static bool is_local(int i){ return i>=0 && i<C.nodes && C.fd[i] >= 0; }
+static bool is_virt(int i){ return i != C.self && i >= C.vlo && i <= C.vhi; }
+static void sim_mac(int i, uint8_t mac[6]){ mac[0]=0x02; mac[1]='S'; mac[2]='I'; mac[3]='M'; mac[4]=(uint8_t)(i>>8); mac[5]=(uint8_t)i; }
+static int  mac_index(const uint8_t mac[6]){ return (mac[0]==0x02 && mac[1]=='S' && mac[2]=='I' && mac[3]=='M') ? (mac[4]<<8 | mac[5]) : -1; }
+
+static int env_int(const char *k, int def){ const char *v = getenv(k); return (v && *v) ? atoi(v) : def; }
+
+// ---- topologie ----
+// parent in de vaste boom, overgeslagen zolang hij dood is
+static int parent_of(int i){
+    while (i > 0){ i = (i-1) / C.fanout; if (bit(C.alive, i) || i == 0) return i; }
+    return -1;
+}
+static int depth_of(int i){ int d = 0; while (i > 0 && d < ML_SIM_MAX){ i = parent_of(i); d++; } return d; }
+// hops = boomafstand via de laagste gemeenschappelijke voorouder
+static int hops(int a, int b){
+    int da = depth_of(a), db = depth_of(b), h = 0;
+    while (da > db){ a = parent_of(a); da--; h++; }
+    while (db > da){ b = parent_of(b); db--; h++; }
+    while (a != b){ a = parent_of(a); b = parent_of(b); h += 2; }
+    return h ? h : 1;
+}
+static bool in_subtree(int i, int top){ while (i > 0 && i != top) i = parent_of(i); return i == top; }
+
+// ---- vertraging: min-heap op due_ms (enkel de net-taak) ----
+static bool heap_push(const sim_item_t *it){
+    if (C.heap_n >= ML_SIM_INFLIGHT){ C.st.dropped++; free(it->data); return false; }
+    int i = C.heap_n++;
+    while (i > 0 && C.heap[(i-1)/2].due_ms > it->due_ms){ C.heap[i] = C.heap[(i-1)/2]; i = (i-1)/2; }
+    C.heap[i] = *it;
+    uint32_t nfree = ML_SIM_INFLIGHT - C.heap_n;
+    if (nfree < C.st.min_free) C.st.min_free = nfree;
+    return true;
+}
+static bool heap_pop_due(uint64_t now, sim_item_t *out){
+    if (!C.heap_n || C.heap[0].due_ms > now) return false;
+    *out = C.heap[0];
+    sim_item_t last = C.heap[--C.heap_n];
+    int i = 0;
+    for (;;){
+        int c = 2*i+1;
+        if (c >= C.heap_n) break;
+        if (c+1 < C.heap_n && C.heap[c+1].due_ms < C.heap[c].due_ms) c++;
+        if (C.heap[c].due_ms >= last.due_ms) break;
+        C.heap[i] = C.heap[c]; i = c;
+    }
+    if (C.heap_n) C.heap[i] = last;
+    return true;
+}
+
+// ---- verzenden ----
+static int udp_send(int from, int to, uint8_t kind, const void *data, size_t n){
+    if (!is_local(from) || to < 0 || to >= C.nodes) return -1;
+    uint8_t buf[sizeof(sim_hdr_t) + ML_SIM_FRAME_MAX];
+    if (n > ML_SIM_FRAME_MAX) return -1;
+    sim_hdr_t h = { .magic = SIM_MAGIC, .kind = kind, .src = (uint16_t)from, .dst = (uint16_t)to, .len = (uint16_t)n };
+    memcpy(buf, &h, sizeof h); memcpy(buf + sizeof h, data, n);
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons((uint16_t)(C.port + to)), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    return sendto(C.fd[from], buf, sizeof h + n, 0, (struct sockaddr*)&a, sizeof a) < 0 ? -1 : 0;
+}
+
+static int resolve_dst(const char *dst_dev){
+    if (!dst_dev || !*dst_dev || strcmp(dst_dev,"*ROOT*")==0) return C.root;
+    uint8_t mac[6];
+    if (!mesh_fleet_resolve(dst_dev, mac)) return -1;
+    int i = mac_index(mac);
+    return (i >= 0 && i < C.nodes && bit(C.alive, i)) ? i : -1;
+}
+
+static esp_err_t send_env(int from, int to, mesh_wire_type_t type, const mesh_envelope_t *e){
+    uint8_t buf[ML_SIM_FRAME_MAX];
+    size_t n = mesh_wire_encode(buf, sizeof buf, type, e);
+    if (!n){ ESP_LOGW(LOG_TAG, "frame past niet (%s)", mesh_wire_type_str(type)); return ESP_FAIL; }
+    return udp_send(from, to, D_FRAME, buf, n) ? ESP_FAIL : ESP_OK;
+}
+
+// ---- virtuele toestellen (net-taak) ----
+static void virt_name_groups(int i, char *grp, size_t n){ snprintf(grp, n, "SIM_G%d", C.groups_n ? i % C.groups_n : 0); }
+
+// EVENT van v naar de root, verstuurd na delay_ms
+static void virt_emit(int v, const mesh_envelope_t *req, cJSON *payload, uint32_t exec_us, uint32_t delay_ms){
+    mesh_envelope_t ev = { .schema="v1", .corr_id = req ? req->corr_id : 0, .src_dev = C.names[v], .dst_dev = "*ROOT*",
+                           .kind = req ? req->kind : ML_KIND_DIAG, .ttl = 3,
+                           .origin_set_topic = req ? req->origin_set_topic : NULL, .payload = payload, .exec_us = exec_us };
+    uint8_t *buf = malloc(ML_SIM_FRAME_MAX);
+    size_t n = buf ? mesh_wire_encode(buf, ML_SIM_FRAME_MAX, MW_EVENT, &ev) : 0;
+    if (!n || C.root < 0){ free(buf); return; }
+    sim_item_t it = { .due_ms = now_ms() + delay_ms, .src = (uint16_t)v, .dst = (uint16_t)C.root, .len = (uint16_t)n, .send = true, .data = buf };
+    heap_push(&it);
+}
+
+static void virt_hello(int v, uint32_t delay_ms){
+    cJSON *h = cJSON_CreateObject();
+    cJSON_AddStringToObject(h, "type", "HELLO");
+    cJSON_AddItemToObject(h, "device", cJSON_CreateObject());
+    cJSON_AddStringToObject(cJSON_GetObjectItem(h, "device"), "name", C.names[v]);
+    cJSON_AddNumberToObject(h, "relay_count", 4);
+    cJSON_AddNumberToObject(h, "pwm_count",   2);
+    cJSON_AddNumberToObject(h, "input_count", 2);
+    cJSON *m = cJSON_CreateObject();
+    int d = depth_of(v);
+    cJSON_AddNumberToObject(m, "layer", d + 1);
+    cJSON_AddNumberToObject(m, "rssi",  -40 - 6*d);
+    cJSON_AddItemToObject(h, "mesh", m);
+    cJSON *g = cJSON_CreateArray();
+    if (C.groups_n){ char grp[16]; virt_name_groups(v, grp, sizeof grp); cJSON_AddItemToArray(g, cJSON_CreateString(grp)); }
+    cJSON_AddItemToObject(h, "groups", g);
+    virt_emit(v, NULL, h, 0, delay_ms);
+    cJSON_Delete(h);
+}
+
+// één commando: relay → toestand bijhouden; rest → enkel status
+static cJSON *virt_exec(virt_t *vs, int v, const cJSON *cmd){
+    const char *io  = cJSON_GetStringValue(cJSON_GetObjectItem(cmd, "io"));
+    const char *act = cJSON_GetStringValue(cJSON_GetObjectItem(cmd, "action"));
+    int id = (int)cJSON_GetNumberValue(cJSON_GetObjectItem(cmd, "io_id"));
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "dev", C.names[v]);
+    if (io) cJSON_AddStringToObject(o, "io", io);
+    cJSON_AddNumberToObject(o, "io_id", id);
+    if (io && !strcasecmp(io, "relay") && act && id >= 0 && id < 32){
+        if (!strcasecmp(act, "ON")) vs->relays |= 1u<<id;
+        else if (!strcasecmp(act, "OFF")) vs->relays &= ~(1u<<id);
+        else if (!strcasecmp(act, "TOGGLE")) vs->relays ^= 1u<<id;
+        cJSON_AddStringToObject(o, "state", (vs->relays & 1u<<id) ? "ON" : "OFF");
+    }
+    cJSON_AddStringToObject(o, "status", "OK");
+    return o;
+}
+
+static void virt_handle(int v, int from, mesh_wire_type_t type, const mesh_envelope_t *e){
+    virt_t *vs = &C.virt[v];
+    if (type == MW_GROUP){
+        char grp[16]; virt_name_groups(v, grp, sizeof grp);
+        if (!C.groups_n || !e->dst_dev || strcmp(e->dst_dev, grp)) return;
+    } else if (type != MW_REQUEST) return;          // EVENT/RESPONSE naar een virtueel toestel: niets te doen
+    if (type == MW_REQUEST){
+        mesh_envelope_t ack = { .corr_id = e->corr_id, .kind = e->kind, .src_dev = C.names[v], .dst_dev = e->src_dev };
+        (void)send_env(v, from, MW_RESPONSE, &ack);
+    }
+    for (int k=0;k<4;k++) if (e->corr_id && vs->seen[k] == e->corr_id) return;   // retransmit
+    vs->seen[vs->seen_i++ & 3] = e->corr_id;
+    const cJSON *cmds = cJSON_GetObjectItemCaseSensitive(e->payload, "cmds");
+    cJSON *out;
+    if (cJSON_IsArray(cmds)){
+        out = cJSON_CreateObject();
+        cJSON_AddStringToObject(out, "dev", C.names[v]);
+        cJSON_AddStringToObject(out, "status", "OK");
+        cJSON *items = cJSON_AddArrayToObject(out, "items"), *c;
+        cJSON_ArrayForEach(c, cmds) cJSON_AddItemToArray(items, virt_exec(vs, v, c));
+    } else out = virt_exec(vs, v, e->payload);
+    virt_emit(v, e, out, (uint32_t)C.exec_ms * 1000, (uint32_t)C.exec_ms);
+    cJSON_Delete(out);
+}
+
+// ---- echt toestel (dispatch-taak) ----
+static bool own_group(const char *g){
+    for (int i=0;i<C.groups_n_own;i++) if (g && !strcmp(C.groups[i], g)) return true;
+    return false;
+}
+
+static bool is_hello(const mesh_envelope_t *e){
+    const cJSON *t = cJSON_GetObjectItemCaseSensitive(e->payload, "type");
+    return e->kind==ML_KIND_DIAG && cJSON_IsString(t) && strcasecmp(t->valuestring, "HELLO")==0;
+}
+
+static void dispatch_frame(int from, mesh_wire_type_t type, const mesh_envelope_t *e){
+    uint8_t mac[6]; sim_mac(from, mac);
+    if (e->src_dev) (void)mesh_fleet_touch(e->src_dev, mac, (uint32_t)now_ms());
+    switch (type){
+        case MW_RESPONSE: pend_complete(e->corr_id, e->src_dev, MESH_OK); break;
+        case MW_REQUEST: {
+            mesh_envelope_t ack = { .corr_id = e->corr_id, .kind = e->kind, .src_dev = C.O.local_dev, .dst_dev = e->src_dev };
+            (void)send_env(C.self, from, MW_RESPONSE, &ack);
+            if (C.on_req) C.on_req(e);
+            break;
+        }
+        case MW_GROUP:
+            if (!C.is_root && own_group(e->dst_dev) && C.on_req) C.on_req(e);
+            break;
+        case MW_EVENT:
+            if (is_hello(e)) mesh_fleet_hello(e->src_dev, e->payload);
+            if (C.on_evt) C.on_evt(e);
+            break;
+    }
+}
+
+static void disp_task(void *arg){
+    (void)arg;
+    sim_item_t *it;
+    for(;;){
+        if (xQueueReceive(C.dispq, &it, portMAX_DELAY) != pdTRUE) continue;
+        uint64_t t0 = now_us();
+        mesh_wire_type_t type; mesh_envelope_t e;
+        if (mesh_wire_decode(it->data, it->len, &type, &e, &C.disp_pool)) dispatch_frame(it->src, type, &e);
+        uint32_t lag = (uint32_t)(t0 - it->due_ms*1000), run = (uint32_t)(now_us() - t0);
+        free(it->data); free(it);
+        xSemaphoreTake(C.lock, portMAX_DELAY);
+        C.st.frames++; C.st.lag_sum_us += lag;
+        if (lag > C.st.lag_max_us) C.st.lag_max_us = lag;
+        if (run > C.st.run_max_us) C.st.run_max_us = run;
+        xSemaphoreGive(C.lock);
+    }
+}
+
+// ---- net-taak: ontvangen, vertragen, afleveren, beacons, root, pending ----
+static void rx_datagram(int at, const uint8_t *buf, size_t n){
+    sim_hdr_t h;
+    if (n < sizeof h) return;
+    memcpy(&h, buf, sizeof h);
+    if (h.magic != SIM_MAGIC || h.src >= C.nodes || h.len != n - sizeof h) return;
+    if (h.kind == D_BEACON){
+        if (h.len != sizeof(sim_beacon_t) || at != C.self) return;   // één keer per proces verwerken
+        sim_beacon_t b; memcpy(&b, buf + sizeof h, sizeof b);
+        uint64_t now = now_ms();
+        for (int i=0;i<C.nodes;i++){
+            if (!bit(b.alive, i) || is_local(i)) continue;
+            C.seen_ms[i] = now;
+            if (i == b.self){ b.name[sizeof b.name - 1] = '\0'; snprintf(C.names[i], sizeof C.names[i], "%s", b.name); }
+        }
+        return;
+    }
+    if (h.kind != D_FRAME) return;
+    int hp = hops(h.src, at);
+    for (int k=0;k<hp;k++) if (C.loss_pm && (int)(rand_r(&C.seed) % 1000) < C.loss_pm) return;   // verloren
+    uint32_t d = 0;
+    for (int k=0;k<hp;k++) d += C.hop_ms + (C.jitter_ms ? rand_r(&C.seed) % (C.jitter_ms+1) : 0);
+    uint8_t *data = malloc(h.len);
+    if (!data){ C.st.dropped++; return; }
+    memcpy(data, buf + sizeof h, h.len);
+    sim_item_t it = { .due_ms = now_ms() + d, .src = h.src, .dst = (uint16_t)at, .len = h.len, .data = data };
+    heap_push(&it);
+}
+
+// tijdframe: meteen in de net-taak (ontvangsttijd = nu); een virtueel toestel deelt de klok
+// van het proces en antwoordt zonder de schatting over te nemen
+static void time_frame(sim_item_t *it){
+    uint8_t in[MESH_TIME_FRAME], out[MESH_TIME_FRAME], mac[6];
+    memcpy(in, it->data, sizeof in);
+    if (it->dst != C.self) in[3] = 0;
+    sim_mac(it->src, mac);
+    size_t n = mesh_time_rx(mac, in, sizeof in, clock_us(), out, sizeof out);
+    if (!n) return;
+    mesh_time_stamp_tx(out, n);
+    (void)udp_send(it->dst, it->src, D_FRAME, out, n);
+}
+
+// root: vervallen probes versturen
+static void time_tick(void){
+    uint8_t self[6], macs[4][6], buf[MESH_TIME_FRAME];
+    sim_mac(C.self, self);
+    int n = mesh_time_due((uint32_t)now_ms(), self, macs, 4);
+    for (int k=0;k<n;k++){
+        int to = mac_index(macs[k]);
+        if (to < 0 || to >= C.nodes || !bit(C.alive, to) || !mesh_time_probe(macs[k], buf, sizeof buf)) continue;
+        mesh_time_stamp_tx(buf, sizeof buf);
+        (void)udp_send(C.self, to, D_FRAME, buf, sizeof buf);
+    }
+}
+
+static void deliver(sim_item_t *it){
+    if (it->send){ (void)udp_send(it->src, it->dst, D_FRAME, it->data, it->len); free(it->data); return; }
+    if (mesh_time_is_frame(it->data, it->len)){ time_frame(it); free(it->data); return; }
+    if (it->dst == C.self){
+        sim_item_t *p = malloc(sizeof *p);
+        if (p){ *p = *it; if (xQueueSend(C.dispq, &p, 0) == pdTRUE) return; free(p); }
+        C.st.dropped++; free(it->data); return;
+    }
+    mesh_wire_type_t type; mesh_envelope_t e;
+    if (mesh_wire_decode(it->data, it->len, &type, &e, &C.net_pool)) virt_handle(it->dst, it->src, type, &e);
+    free(it->data);
+}
+
+static void beacon_send(void){
+    sim_beacon_t b = { .self = (uint16_t)C.self };
+    snprintf(b.name, sizeof b.name, "%s", C.O.local_dev ? C.O.local_dev : "");
+    for (int i=0;i<C.nodes;i++) if (is_local(i)) bit_set(b.alive, i, true);
+    for (int i=0;i<C.nodes;i++) if (!is_local(i)) (void)udp_send(C.self, i, D_BEACON, &b, sizeof b);
+}
+
+static cJSON *snapshot_unsafe(void){
+    cJSON *arr = cJSON_CreateArray();
+    for (int i=0;i<C.nodes;i++){
+        if (!bit(C.alive, i) || !(C.is_root || in_subtree(i, C.self))) continue;
+        uint8_t m[6]; sim_mac(i, m);
+        char mac[18]; snprintf(mac, sizeof mac, "%02x:%02x:%02x:%02x:%02x:%02x", m[0],m[1],m[2],m[3],m[4],m[5]);
+        cJSON_AddItemToArray(arr, cJSON_CreateString(mac));
+    }
+    return arr;
+}
+
+// levenden herberekenen; nieuwe root → callback en HELLO's; root meldt tabelwijzigingen
+static void topology_tick(void){
+    uint64_t now = now_ms();
+    uint8_t alive[ML_SIM_MAX/8] = {0};
+    for (int i=0;i<C.nodes;i++){
+        bool up = is_local(i) || (C.seen_ms[i] && now - C.seen_ms[i] < ML_SIM_DEAD_MS);
+        bit_set(alive, i, up);
+        if (up){ uint8_t m[6]; sim_mac(i, m); (void)mesh_fleet_touch(C.names[i], m, (uint32_t)now); }
+    }
+    int root = -1;
+    for (int i=0;i<C.nodes && root<0;i++) if (bit(alive, i)) root = i;
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    memcpy(C.alive, alive, sizeof alive);
+    bool root_changed = root != C.root;
+    C.root = root;
+    xSemaphoreGive(C.lock);
+
+    if (root_changed){
+        bool was = C.is_root;
+        C.is_root = root == C.self;
+        memset(C.rt_prev, 0, sizeof C.rt_prev);
+        ESP_LOGI(LOG_TAG, "root = %d (%s)", root, root >= 0 ? C.names[root] : "-");
+        mesh_time_role(C.is_root);
+        if (was != C.is_root && C.on_root) C.on_root(C.is_root);
+        // virtuele toestellen melden zich bij de (nieuwe) root, gespreid over ~50 ms
+        for (int v=0; v<C.nodes; v++) if (is_virt(v) && v != root) virt_hello(v, v % 50);
+    }
+    if (!C.is_root || !memcmp(alive, C.rt_prev, sizeof alive)) return;
+
+    const char *ev = "ADD";
+    for (int i=0;i<C.nodes;i++) if (bit(C.rt_prev, i) && !bit(alive, i)){ ev = "REMOVE"; break; }
+    memcpy(C.rt_prev, alive, sizeof alive);
+    uint8_t macs[ML_SIM_MAX][6]; int n = 0;
+    for (int i=0;i<C.nodes;i++) if (bit(alive, i)) sim_mac(i, macs[n++]);
+    mesh_fleet_sync(&macs[0][0], n, 6);
+    cJSON *snap = snapshot_unsafe();
+    mesh_diag_publish_route_table(ev, snap);
+    cJSON_Delete(snap);
+}
+
+// async REQUESTs: retransmit na de RTO, timeout op de deadline (callbacks buiten de lock)
+static void pend_sweep(void){
+    struct { mesh_done_cb_t cb; void *user; corr_id_t corr; char dst[32]; } done[MAX_PENDING];
+    int nd = 0;
+    uint64_t now = now_ms();
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    for (int i=0;i<MAX_PENDING;i++){
+        pend_t *p = &C.pend[i];
+        if (!p->used || !p->cb || now < p->next_ms) continue;
+        if (now >= p->deadline_ms || p->tries > SIM_RETX_MAX){
+            done[nd].cb = p->cb; done[nd].user = p->user; done[nd].corr = p->corr_id;
+            snprintf(done[nd].dst, sizeof done[nd].dst, "%s", p->dst); nd++;
+            p->used = false; C.n_async--;
+            continue;
+        }
+        (void)udp_send(C.self, p->to, D_FRAME, p->frame, p->frame_n);
+        p->tries++;
+        p->rto_ms = p->rto_ms*2 > SIM_RTO_MAX_MS ? SIM_RTO_MAX_MS : p->rto_ms*2;
+        p->next_ms = now + p->rto_ms;
+        if (p->next_ms > p->deadline_ms) p->next_ms = p->deadline_ms;
+    }
+    xSemaphoreGive(C.lock);
+    for (int i=0;i<nd;i++) done[i].cb(done[i].corr, done[i].dst, MESH_TIMEOUT, done[i].user);
+}
+
+static void net_task(void *arg){
+    (void)arg;
+    static uint8_t buf[sizeof(sim_hdr_t) + ML_SIM_FRAME_MAX];
+    uint64_t next_beacon = 0, next_time = 0;
+    for(;;){
+        bool busy = false;
+        // niet-blokkerend: een blokkerende syscall houdt in de POSIX-port de scheduler op
+        for (int i=0;i<C.nodes;i++){
+            if (!is_local(i)) continue;
+            ssize_t n;
+            while ((n = recv(C.fd[i], buf, sizeof buf, MSG_DONTWAIT)) > 0){ rx_datagram(i, buf, (size_t)n); busy = true; }
+        }
+        uint64_t now = now_ms();
+        sim_item_t it;
+        while (heap_pop_due(now, &it)){ deliver(&it); busy = true; }
+        if (now >= next_beacon){ beacon_send(); topology_tick(); next_beacon = now + ML_SIM_BEACON_MS; }
+        if (C.n_async) pend_sweep();
+        if (C.is_root && now >= next_time){ time_tick(); next_time = now + ML_SIM_TIME_TICK_MS; }
+        if (!busy) vTaskDelay(1);
+    }
+}
+
+// ---- pending ----
+static uint32_t peer_rto(const char *dev){
+    mesh_node_info_t ni;
+    if (!mesh_fleet_get(dev, &ni) || !ni.srtt_ms) return SIM_RTO_INIT_MS;
+    uint32_t rto = ni.srtt_ms + 4*ni.rttvar_ms;
+    return rto < SIM_RTO_MIN_MS ? SIM_RTO_MIN_MS : rto > SIM_RTO_MAX_MS ? SIM_RTO_MAX_MS : rto;
+}
+
+static int pend_alloc(const mesh_envelope_t *req, int to, mesh_done_cb_t cb, void *user, uint32_t timeout_ms){
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    int idx = -1;
+    for (int i=0;i<MAX_PENDING;i++) if (!C.pend[i].used){ idx = i; break; }
+    if (idx >= 0){
+        pend_t *p = &C.pend[idx];
+        SemaphoreHandle_t sem = p->sem;
+        memset(p, 0, sizeof *p);
+        p->sem = sem ? sem : xSemaphoreCreateBinary();
+        xSemaphoreTake(p->sem, 0);
+        p->used = true; p->corr_id = req->corr_id; p->st = MESH_TIMEOUT; p->to = (uint16_t)to;
+        p->cb = cb; p->user = user; p->tries = 1;
+        snprintf(p->dst, sizeof p->dst, "%s", req->dst_dev ? req->dst_dev : "");
+        p->frame_n = (uint16_t)mesh_wire_encode(p->frame, sizeof p->frame, MW_REQUEST, req);
+        p->rto_ms = peer_rto(p->dst);
+        p->sent_ms = now_ms();
+        p->deadline_ms = p->sent_ms + timeout_ms;
+        p->next_ms = p->sent_ms + p->rto_ms;
+        if (!p->frame_n){ p->used = false; idx = -1; }
+        else if (cb) C.n_async++;
+    }
+    xSemaphoreGive(C.lock);
+    return idx;
+}
+
+// RESPONSE van src: zelfde corr mag bij meerdere children openstaan (batch) → ook op dst matchen
+static void pend_complete(corr_id_t corr_id, const char *src, mesh_status_t st){
+    mesh_done_cb_t cb = NULL; void *user = NULL; char dst[32] = "";
+    uint32_t rtt = 0; bool first = false;
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    for (int i=0;i<MAX_PENDING;i++){
+        pend_t *p = &C.pend[i];
+        if (!p->used || p->corr_id != corr_id) continue;
+        if (p->dst[0] && src && strcmp(p->dst, src) != 0) continue;
+        rtt = (uint32_t)(now_ms() - p->sent_ms); first = p->tries == 1;
+        if (p->cb){ cb = p->cb; user = p->user; snprintf(dst, sizeof dst, "%s", p->dst); p->used = false; C.n_async--; }
+        else { p->st = st; xSemaphoreGive(p->sem); }
+        break;
+    }
+    xSemaphoreGive(C.lock);
+    if (first && src) mesh_fleet_rtt_sample(src, rtt);
+    if (cb) cb(corr_id, dst, st, user);
+}
+
+// ---- vtable ----
+static void init(const mesh_opts_t *opts){
+    mesh_request_cb_t saved_req = C.on_req; mesh_event_cb_t saved_evt = C.on_evt; mesh_root_cb_t saved_root = C.on_root;
+    memset(&C, 0, sizeof C);
+    C.O = *opts;
+    C.on_req = saved_req; C.on_evt = saved_evt; C.on_root = saved_root;
+    C.lock = xSemaphoreCreateMutex();
+    C.nodes     = env_int("ML_SIM_NODES", ML_SIM_NODES);
+    C.self      = env_int("ML_SIM_SELF", ML_SIM_SELF);
+    C.port      = env_int("ML_SIM_PORT", ML_SIM_PORT);
+    C.fanout    = env_int("ML_SIM_FANOUT", ML_SIM_FANOUT);
+    C.hop_ms    = env_int("ML_SIM_HOP_MS", ML_SIM_HOP_MS);
+    C.jitter_ms = env_int("ML_SIM_JITTER_MS", ML_SIM_JITTER_MS);
+    C.loss_pm   = env_int("ML_SIM_LOSS_PM", ML_SIM_LOSS_PM);
+    C.exec_ms   = env_int("ML_SIM_EXEC_MS", ML_SIM_EXEC_MS);
+    C.groups_n  = env_int("ML_SIM_GROUPS", ML_SIM_GROUPS);
+    C.seed      = (unsigned)env_int("ML_SIM_SEED", ML_SIM_SEED);
+    if (C.nodes < 1) C.nodes = 1;
+    if (C.nodes > ML_SIM_MAX) C.nodes = ML_SIM_MAX;
+    if (C.fanout < 1) C.fanout = 1;
+    if (C.self < 0 || C.self >= C.nodes) C.self = 0;
+    const char *vr = getenv("ML_SIM_VIRTUAL"); if (!vr || !*vr) vr = ML_SIM_VIRTUAL;
+    if (!strcmp(vr, "all")){ C.vlo = 0; C.vhi = C.nodes-1; }
+    else if (sscanf(vr, "%d-%d", &C.vlo, &C.vhi) != 2){ C.vlo = 1; C.vhi = 0; }
+    C.root = -1;
+    C.st.min_free = ML_SIM_INFLIGHT;
+    C.virt = calloc(C.nodes, sizeof *C.virt);
+
+    for (int i=0;i<C.nodes;i++){
+        C.fd[i] = -1;
+        if (i == C.self) snprintf(C.names[i], sizeof C.names[i], "%s", C.O.local_dev ? C.O.local_dev : "");
+        else snprintf(C.names[i], sizeof C.names[i], ML_SIM_NAME_FMT, i);
+        if (i != C.self && !is_virt(i)) continue;
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons((uint16_t)(C.port + i)), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+        if (fd < 0 || bind(fd, (struct sockaddr*)&a, sizeof a) < 0){
+            ESP_LOGE(LOG_TAG, "poort %d bezet → toestel %d niet lokaal", C.port + i, i);
+            if (fd >= 0) close(fd);
+            continue;
+        }
+        int rcv = 1 << 20; setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcv, sizeof rcv);
+        C.fd[i] = fd;
+    }
+    ESP_LOGI(LOG_TAG, "%d toestellen, zelf %d (%s), virtueel %d-%d, %d ms/hop ±%d, verlies %d‰",
+             C.nodes, C.self, C.names[C.self], C.vlo, C.vhi, C.hop_ms, C.jitter_ms, C.loss_pm);
+    mesh_time_clock(clock_us);
+    C.dispq = xQueueCreate(64, sizeof(sim_item_t*));
+    xTaskCreate(disp_task, "sim_disp", 6144, NULL, 5, NULL);
+    xTaskCreate(net_task,  "sim_net",  6144, NULL, 6, NULL);
+}
+
+static void register_rx(mesh_request_cb_t on_request, mesh_event_cb_t on_event){ C.on_req = on_request; C.on_evt = on_event; }
+static void register_root(mesh_root_cb_t cb){ C.on_root = cb; }
+
+static mesh_status_t request(const mesh_envelope_t *req, uint32_t timeout_ms){
+    int to = resolve_dst(req->dst_dev);
+    if (to < 0) return MESH_NO_ROUTE;
+    int p = pend_alloc(req, to, NULL, NULL, timeout_ms);
+    if (p < 0) return MESH_ERR;
+    pend_t *pp = &C.pend[p];
+    uint64_t end = now_ms() + timeout_ms;
+    uint32_t rto = pp->rto_ms;
+    mesh_status_t st = MESH_TIMEOUT;
+    for (int tries=0;; tries++){
+        if (udp_send(C.self, to, D_FRAME, pp->frame, pp->frame_n)){ st = MESH_NO_ROUTE; break; }
+        uint64_t t0 = now_ms(), left = end > t0 ? end - t0 : 0;
+        if (xSemaphoreTake(pp->sem, pdMS_TO_TICKS(rto < left ? rto : left)) == pdTRUE){ st = pp->st; break; }
+        if (tries >= SIM_RETX_MAX || now_ms() >= end) break;
+        xSemaphoreTake(C.lock, portMAX_DELAY); pp->tries++; xSemaphoreGive(C.lock);
+        rto = rto*2 > SIM_RTO_MAX_MS ? SIM_RTO_MAX_MS : rto*2;
+    }
+    xSemaphoreTake(C.lock, portMAX_DELAY); pp->used = false; xSemaphoreGive(C.lock);
+    return st;
+}
+
+static mesh_status_t request_async(const mesh_envelope_t *req, uint32_t timeout_ms, mesh_done_cb_t cb, void *user){
+    int to = resolve_dst(req->dst_dev);
+    if (to < 0) return MESH_NO_ROUTE;
+    if (!cb) return request(req, timeout_ms);
+    int p = pend_alloc(req, to, cb, user, timeout_ms);
+    if (p < 0) return MESH_ERR;
+    if (udp_send(C.self, to, D_FRAME, C.pend[p].frame, C.pend[p].frame_n) == 0) return MESH_OK;
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    if (C.pend[p].used){ C.pend[p].used = false; C.n_async--; }
+    xSemaphoreGive(C.lock);
+    return MESH_NO_ROUTE;
+}
+
+static mesh_status_t send_event(const mesh_envelope_t *evt){
+    int to = resolve_dst(evt->dst_dev);
+    if (to < 0) return MESH_NO_ROUTE;
+    return send_env(C.self, to, MW_EVENT, evt) == ESP_OK ? MESH_OK : MESH_ERR;
+}
+
+static mesh_status_t set_groups(const char *const *names, int n){
+    if (n > MESH_GROUP_MAX) n = MESH_GROUP_MAX;
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    for (int i=0;i<n;i++) snprintf(C.groups[i], sizeof C.groups[i], "%s", names[i]);
+    C.groups_n_own = n;
+    xSemaphoreGive(C.lock);
+    return MESH_OK;
+}
+
+// zoals een esp-mesh groepsframe: naar iedereen, de ontvanger kijkt of hij lid is
+static mesh_status_t send_group(const mesh_envelope_t *req){
+    if (!req || !req->dst_dev || !*req->dst_dev) return MESH_ERR;
+    uint8_t buf[ML_SIM_FRAME_MAX];
+    size_t n = mesh_wire_encode(buf, sizeof buf, MW_GROUP, req);
+    if (!n) return MESH_ERR;
+    for (int i=0;i<C.nodes;i++) if (i != C.self && bit(C.alive, i)) (void)udp_send(C.self, i, D_FRAME, buf, n);
+    return MESH_OK;
+}
+
+static mesh_status_t link_info(mesh_link_info_t *out){
+    int d = depth_of(C.self);
+    out->layer = (uint8_t)(d + 1);
+    out->rssi = C.is_root ? 0 : (int8_t)(-40 - 6*d);
+    return MESH_OK;
+}
+
+static cJSON* snapshot(void){
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    cJSON *arr = snapshot_unsafe();
+    xSemaphoreGive(C.lock);
+    return arr;
+}
+
+// frames = afgeleverd aan dit toestel; dropped = vertragingslijst of dispatch-queue vol
+// (gesimuleerd verlies telt niet); lag = geplande aflevering → dispatch
+static void rx_stats(mesh_rx_stats_t *out, bool reset){
+    xSemaphoreTake(C.lock, portMAX_DELAY);
+    out->pool = ML_SIM_INFLIGHT; out->workers = 1;
+    out->frames = C.st.frames; out->dropped = C.st.dropped; out->min_free = C.st.min_free;
+    out->lag_avg_us = C.st.frames ? (uint32_t)(C.st.lag_sum_us / C.st.frames) : 0;
+    out->lag_max_us = C.st.lag_max_us; out->run_max_us = C.st.run_max_us;
+    if (reset){ memset(&C.st, 0, sizeof C.st); C.st.min_free = ML_SIM_INFLIGHT; }
+    xSemaphoreGive(C.lock);
+}
+
+/* Zelfde vtable-struct als in mesh_link.c */
+typedef struct {
+    const char* (*name)(void);
+    void (*init)(const mesh_opts_t*);
+    void (*register_rx)(mesh_request_cb_t, mesh_event_cb_t);
+    void (*register_root)(mesh_root_cb_t);
+    mesh_status_t (*request)(const mesh_envelope_t*, uint32_t);
+    mesh_status_t (*send_event)(const mesh_envelope_t*);
+    cJSON* (*snapshot)(void);
+    mesh_status_t (*request_async)(const mesh_envelope_t*, uint32_t, mesh_done_cb_t, void*);
+    mesh_status_t (*set_groups)(const char *const*, int);
+    mesh_status_t (*send_group)(const mesh_envelope_t*);
+    mesh_status_t (*link_info)(mesh_link_info_t*);
+    int (*txq)(int*, mesh_txq_info_t*, int, bool);
+    void (*rx_stats)(mesh_rx_stats_t*, bool);
+    int (*paths)(mesh_path_info_t*, int, bool);
+} ml_backend_t;
+
+const ml_backend_t* ml_backend_sim(void){
+    static const ml_backend_t V = { name_backend, init, register_rx, register_root, request, send_event, snapshot,
+                                    request_async, set_groups, send_group, link_info, NULL, rx_stats, NULL };
+    return &V;
+}
@@ -0,0 +1,43 @@
+// components/mesh_link/include/mesh_fleet.h
+#pragma once
+// Vlootregister: één slot per gekend toestel (naam ↔ MAC) met de laatste HELLO-gegevens,
+// online-status en RTT. Twee hash-indexen (naam, MAC; open addressing) → opzoeken in O(1).
+// Lezen zonder lock: elk slot heeft een sequence-teller (oneven = schrijver bezig), lezers
+// kopiëren en proberen opnieuw als de teller veranderde. Schrijvers (RX-taak, worker)
+// nemen een korte spinlock. Vol → enkel een offline toestel wordt verdrongen, nooit een
+// levend (dan wordt de nieuwe geweigerd en geteld).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mesh_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_MESH_MAX_NODES
+#define CONFIG_MESH_MAX_NODES  128      // Kconfig (components/mesh_link/Kconfig)
+#endif
+#define MESH_FLEET_MAX   CONFIG_MESH_MAX_NODES
+
+// Elk frame van dev (via mac): aanmaken/bijwerken, online. false = register vol.
+bool mesh_fleet_touch(const char *dev, const uint8_t mac[6], uint32_t now_ms);
+// HELLO-payload van dev: capability (relay/pwm/input_count) en "mesh":{"layer","rssi"}
+void mesh_fleet_hello(const char *dev, const cJSON *hello);
+// Routing-tabel van de root: wie er niet in staat is offline (stride = sizeof(mesh_addr_t))
+void mesh_fleet_sync(const uint8_t *macs, int n, size_t stride);
+
+bool mesh_fleet_resolve(const char *dev, uint8_t mac[6]);         // lock-vrij
+bool mesh_fleet_get(const char *dev, mesh_node_info_t *out);      // lock-vrij
+bool mesh_fleet_find_mac(const uint8_t mac[6], mesh_node_info_t *out);
+
+// RTT-meting naar dev (Jacobson/Karels); de backend leidt er de RTO uit af
+void mesh_fleet_rtt_sample(const char *dev, uint32_t rtt_ms);
+
+int  mesh_fleet_list(int *pos, mesh_node_info_t *out, int max);   // zie mesh_get_fleet
+void mesh_fleet_stats_get(mesh_fleet_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
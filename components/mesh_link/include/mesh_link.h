@@ -8,27 +8,40 @@
 extern "C" {
 #endif
 
+// binaire correlatie-id, end-to-end (zelfde type als in parser.h)
+#ifndef CORR_ID_T_DEFINED
+#define CORR_ID_T_DEFINED
+typedef uint64_t corr_id_t;   // 0 = geen
+#endif
+
 typedef enum { MESH_ROLE_ROOT=0, MESH_ROLE_CHILD } mesh_role_t;
 typedef enum { MESH_OK=0, MESH_TIMEOUT, MESH_NO_ROUTE, MESH_ERR } mesh_status_t;
 typedef enum { ML_KIND_RELAY=0, ML_KIND_PWM, ML_KIND_CONFIG, ML_KIND_INPUT, ML_KIND_DIAG } mesh_kind_t;
+// Prioriteitsklasse van een commando (router-lanes); child voert in dezelfde volgorde uit
+typedef enum { ML_PRIO_NONE=0, ML_PRIO_SAFETY, ML_PRIO_SWITCH, ML_PRIO_SETPOINT, ML_PRIO_READ } mesh_prio_t;
 
 typedef struct {
     const char *schema;        // "v1"
-    uint32_t    corr_id;       // door router ingesteld
+    corr_id_t   corr_id;       // door router ingesteld (op de draad: 16 hex-tekens)
     uint64_t    ts_ms;         // millis
     const char *src_dev;       // afzender (naam)
     const char *dst_dev;       // ontvanger (naam)
     mesh_kind_t kind;          // functionele soort
+    mesh_prio_t prio;          // NONE = ontvanger classificeert zelf
     int8_t      ttl;           // levensduur hops
     uint8_t     hop;           // huidig hops
     const char *origin_set_topic; // optioneel voor juiste MQTT State
     cJSON      *payload;       // inhoud (eigendom bij caller)
+    uint32_t    exec_us;       // EVENT: uitvoering op de child (REQUEST → EVENT), 0 = onbekend
 } mesh_envelope_t;
 
 typedef void (*mesh_request_cb_t)(const mesh_envelope_t *req); // REQUEST rx
 typedef void (*mesh_event_cb_t)(const mesh_envelope_t *evt);   // EVENT rx
 // Callback voor root-status wijzigingen (auto-root)
 typedef void (*mesh_root_cb_t)(bool is_root);
+// Afloop van een asynchrone REQUEST: OK (RESPONSE-ACK), TIMEOUT, NO_ROUTE of ERR.
+// Loopt in een mesh-taak (RX of worker); enkel backends zonder async-pad roepen hem synchroon.
+typedef void (*mesh_done_cb_t)(corr_id_t corr_id, const char *dst_dev, mesh_status_t st, void *user);
 
 typedef struct {
     mesh_role_t role;
@@ -41,10 +54,124 @@ void        mesh_init(const mesh_opts_t *opts);
 void        mesh_register_rx(mesh_request_cb_t on_request, mesh_event_cb_t on_event);
 void        mesh_register_root_cb(mesh_root_cb_t cb);
 mesh_status_t mesh_request(const mesh_envelope_t *req, uint32_t timeout_ms); // wacht op RESPONSE-ACK
+// Niet-blokkerend: MESH_OK = verstuurd, cb volgt exact één keer; anders geen cb.
+// Pending-tabel is begrensd (vol → MESH_ERR). Zonder ACK herhaalt de backend de REQUEST
+// na een RTO uit de gemeten RTT van de peer; timeout_ms is de bovengrens (ook voor mesh_request).
+mesh_status_t mesh_request_async(const mesh_envelope_t *req, uint32_t timeout_ms,
+                                 mesh_done_cb_t cb, void *user);
 mesh_status_t mesh_send_event(const mesh_envelope_t *evt);                   // fire & forget
+// Groepen (fan-out): één frame naar alle leden i.p.v. één unicast per lid. Elk toestel
+// registreert zijn eigen groepen; een groepsframe krijgt geen RESPONSE-ACK (de leden
+// antwoorden met hun EVENT). De root voert zijn eigen deel lokaal uit.
+#ifndef MESH_GROUP_MAX
+#define MESH_GROUP_MAX 4             // groepen per toestel
+#endif
+mesh_status_t mesh_set_groups(const char *const *names, int n);    // vervangt de vorige set
+// req->dst_dev = groepsnaam; MESH_ERR = backend zonder groepsframes → caller doet unicast
+mesh_status_t mesh_send_group(const mesh_envelope_t *req);
 cJSON*      mesh_get_routing_snapshot(void);
 const char* mesh_backend_name(void);
 
+// Vloot (root): per gekend toestel de laatste HELLO-gegevens, online-status en RTT
+typedef struct {
+    char     dev[32];
+    uint8_t  mac[6];
+    bool     online;         // in de routing-tabel / frame sinds de laatste sync
+    bool     hello;          // HELLO ontvangen (velden hieronder geldig)
+    int8_t   rssi;           // RSSI naar zijn parent, 0 = onbekend
+    uint8_t  layer;          // 1 = root, 2 = eerste hop, ...; 0 = onbekend
+    uint8_t  relays, pwms, inputs;   // capability
+    uint32_t last_ms;        // laatste frame (ms sinds boot, 32-bit)
+    uint32_t srtt_ms, rttvar_ms;     // 0 = nog geen RTT-meting
+} mesh_node_info_t;
+
+typedef struct {
+    uint16_t nodes, online;
+    uint32_t refused;        // register vol zonder offline toestel om te verdringen
+    uint32_t evicted;        // offline toestellen verdrongen
+} mesh_fleet_stats_t;
+
+// In delen: *pos = 0 bij de start, daarna doorgeven; 0 ingevuld = klaar
+int  mesh_get_fleet(int *pos, mesh_node_info_t *out, int max);
+void mesh_get_fleet_stats(mesh_fleet_stats_t *out);
+
+// Eigen positie in de mesh (voor de HELLO); MESH_ERR = onbekend / backend zonder
+typedef struct { uint8_t layer; int8_t rssi; } mesh_link_info_t;
+mesh_status_t mesh_get_link_info(mesh_link_info_t *out);
+
+// TX-queues per bestemming (toestel of groep); tellers sinds de vorige reset
+typedef struct {
+    uint8_t  mac[6];
+    char     dev[32];        // "" = onbekend / groep
+    uint8_t  depth, max_depth;       // frames in de queue, piek
+    uint8_t  inflight;       // REQUESTs zonder ACK (≤ MESH_TX_WINDOW)
+    uint32_t sent;
+    uint32_t dropped;        // queue vol (verdrongen of geweigerd)
+    uint32_t expired;        // te lang gewacht (MESH_TXQ_MAX_AGE_MS)
+    uint32_t busy;           // esp_mesh_send geweigerd → backoff
+} mesh_txq_info_t;
+
+// In delen zoals mesh_get_fleet; reset = tellers daarna op 0. 0 = backend zonder queues
+int  mesh_get_txq(int *pos, mesh_txq_info_t *out, int max, bool reset);
+
+// Ontvangst: framepool + dispatch-taken; tellers sinds de vorige reset
+typedef struct {
+    uint16_t pool, workers;  // configuratie (CONFIG_MESH_RX_POOL / _WORKERS)
+    uint32_t frames;         // ontvangen
+    uint32_t dropped;        // pool leeg → weggegooid
+    uint32_t min_free;       // laagste aantal vrije buffers
+    uint32_t lag_avg_us, lag_max_us;   // ontvangen → dispatch begint
+    uint32_t run_max_us;     // langste dispatch (decode + callbacks)
+} mesh_rx_stats_t;
+
+// MESH_ERR = backend zonder framepool
+mesh_status_t mesh_get_rx_stats(mesh_rx_stats_t *out, bool reset);
+
+// Hybride backend: per pad (ESP-MESH, MQTT-mailbox) REQUEST → RESPONSE-ACK; tellers sinds de vorige reset
+typedef struct {
+    char     name[8];        // "mesh" | "mailbox"
+    uint32_t sent;           // REQUESTs over dit pad
+    uint32_t ok, timeout, no_route;
+    uint32_t fallback;       // pad weigerde → andere pad genomen
+    uint32_t probes;         // trager pad toch gekozen om de meting vers te houden
+    uint32_t srtt_ms;        // gladgestreken ACK-tijd over alle bestemmingen, 0 = geen meting
+    uint32_t max_ms;
+} mesh_path_info_t;
+
+// Aantal ingevulde paden; 0 = backend met één pad
+int  mesh_get_paths(mesh_path_info_t *out, int max, bool reset);
+
+// Mesh-tijd (zie mesh_time.h): gedeelde klok over alle toestellen, vult ts_ms in elke envelop.
+// Unix-tijd (ms) zodra de root ze kent (Mesh/Time), anders de uptime van de root.
+uint64_t mesh_time_now_ms(void);
+void     mesh_time_set_wall_ms(uint64_t unix_ms);   // root: tijd van de broker/NTP
+
+typedef struct {
+    bool     root;
+    bool     synced;         // root: altijd; child: schatting van de root ontvangen
+    bool     wall;           // mesh-tijd = unix-tijd
+    int64_t  offset_us;      // child: lokale klok − mesh-tijd
+    int32_t  drift_ppb;      // child: lokale klok t.o.v. de root
+    uint32_t err_us;         // child: geschatte fout (residu-jitter van de root)
+    uint32_t age_ms;         // child: sinds de laatste schatting
+} mesh_time_info_t;
+void mesh_get_time_info(mesh_time_info_t *out);
+
+// Root: per child de laatste schatting
+typedef struct {
+    char     dev[32];        // "" = niet (meer) in het vlootregister
+    uint8_t  mac[6];
+    int64_t  offset_us;
+    int32_t  drift_ppb;
+    uint32_t rtt_us;         // kleinste recente round-trip; asymmetrie-fout ≤ rtt/2
+    uint32_t err_us;         // gladgestreken |residu| van de offset-schatting
+    uint32_t samples, rejected;      // verworpen: round-trip ver boven rtt_us
+    uint32_t age_ms;         // sinds het laatste sample
+} mesh_time_node_t;
+
+// In delen zoals mesh_get_fleet
+int  mesh_get_time_nodes(int *pos, mesh_time_node_t *out, int max);
+
 // zwakke hook → implementeer in mqtt_link om diag te publiceren
 __attribute__((weak)) void mesh_diag_publish_route_table(const char *event, const cJSON *snapshot);
 
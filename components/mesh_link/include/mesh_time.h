@@ -0,0 +1,69 @@
+// components/mesh_link/include/mesh_time.h
+#pragma once
+// Mesh-tijd: de root meet per child offset en drift met een NTP-achtige uitwisseling over
+// de mesh en stuurt de schatting mee in de volgende probe; de child rekent er zijn lokale
+// klok mee om. Mesh-tijd = lokale klok van de root + basis (unix-tijd via Mesh/Time, anders
+// 0 = uptime van de root). Een child die root wordt, neemt zijn mesh-tijd mee als basis.
+//
+//   root  ── PROBE (t1: mesh, bij verzenden; schatting voor deze child) ──▶ child
+//   root  ◀─ REPLY (t1, t2: ontvangst, t3: verzenden; lokale klok child) ── child
+//   root: t4 = ontvangst.  offset θ = ((t2−t1) + (t3−t4)) / 2   (lokaal − mesh)
+//                           round-trip δ = (t4−t1) − (t3−t2)
+//
+// t1/t3 stempelt de TX-taak vlak voor de radio (mesh_time_stamp_tx), t2/t4 de RX-taak bij
+// het kopiëren: queue- en dispatchtijd tellen niet mee. Samples met een δ ver boven de
+// kleinste recente δ (queueing onderweg) worden verworpen. Per child een alpha-beta-filter
+// op offset en drift; fout = gladgestreken |residu|.
+//
+// Frame (56 bytes, little-endian, eigen magic naast mesh_wire):
+//    0  u8  magic 0xB7    4  u32 seq        32  i64 schatting offset (µs)
+//    1  u8  versie        8  i64 t1         40  i64 schatting referentie (lokaal, µs)
+//    2  u8  type         16  i64 t2         48  i32 schatting drift (ppb)
+//    3  u8  flags        24  i64 t3         52  u32 schatting fout (µs)
+// géén esp_* includes: de backend geeft zijn klok mee (mesh_time_clock)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mesh_fleet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_TIME_MAGIC   0xB7
+#define MESH_TIME_VER     1
+#define MESH_TIME_FRAME   56
+
+#ifndef MESH_TIME_PERIOD_MS
+#define MESH_TIME_PERIOD_MS   10000   // probe per child; de eerste MESH_TIME_FAST elke seconde
+#endif
+#ifndef MESH_TIME_FAST
+#define MESH_TIME_FAST        4
+#endif
+#ifndef MESH_TIME_NODES
+#define MESH_TIME_NODES       MESH_FLEET_MAX   // children met een schatting (root)
+#endif
+
+static inline bool mesh_time_is_frame(const uint8_t *buf, size_t len) {
+    return len >= MESH_TIME_FRAME && buf[0] == MESH_TIME_MAGIC;
+}
+
+void   mesh_time_clock(int64_t (*local_us)(void));   // backend-init
+void   mesh_time_role(bool is_root);                 // bij elke rolwissel
+
+// Root: tot max MACs (online in het vlootregister, niet self) die nu een probe krijgen
+int    mesh_time_due(uint32_t now_ms, const uint8_t self[6], uint8_t mac[][6], int max);
+// Root: probe voor mac in buf (t1 volgt bij verzenden); 0 = buf te klein
+size_t mesh_time_probe(const uint8_t mac[6], uint8_t *buf, size_t cap);
+// TX-taak: t1 (PROBE) of t3 (REPLY) op het moment van verzenden
+void   mesh_time_stamp_tx(uint8_t *buf, size_t len);
+// RX: rx_us = lokale klok bij ontvangst. PROBE (child) → REPLY in out, lengte; anders 0
+size_t mesh_time_rx(const uint8_t from[6], const uint8_t *buf, size_t len, int64_t rx_us,
+                    uint8_t *out, size_t cap);
+
+int    mesh_time_list(int *pos, mesh_time_node_t *out, int max);   // zie mesh_get_time_nodes
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+// components/mesh_link/include/mesh_wire.h
+#pragma once
+// Binair mesh-frame (v1): vaste header + src/dst/origin + TLV-payload. Encode en decode
+// zonder heap: de encoder schrijft in een buffer van de caller, de decoder laat strings
+// en de payload-boom (cJSON-nodes uit een pool van de caller) in het frame wijzen.
+// JSON blijft als terugval (MESH_WIRE_JSON, te grote boom); ontvangers herkennen beide.
+//
+//    0  u8  magic 0xA5        8  u8  dst_len          16  u64 corr_id
+//    1  u8  versie            9  u8  org_len          24  u64 ts_ms
+//    2  u8  type             10  u16 payload_len      32  src '\0' dst '\0' origin '\0' payload
+//    3  u8  kind             12  u32 exec_us
+//    4  u8  prio                                       (little-endian; *_len incl. '\0', 0 = geen)
+//    5  i8  ttl
+//    6  u8  hop
+//    7  u8  src_len
+//
+// TLV: 1 byte type + waarde; null/false/true, int8, int32, double, string (u16 len + bytes
+// + '\0'), array (u16 n + items), object (u16 n + per lid u8 keylen + key '\0' + waarde).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mesh_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_WIRE_MAGIC  0xA5
+#define MESH_WIRE_VER    1
+#define MESH_WIRE_HDR    32
+
+#ifndef MESH_WIRE_NODES
+#define MESH_WIRE_NODES  128   // cJSON-nodes per gedecodeerd frame (meer → zender valt terug op JSON)
+#endif
+#ifndef MESH_WIRE_DEPTH
+#define MESH_WIRE_DEPTH  8
+#endif
+
+typedef enum { MW_REQUEST = 1, MW_RESPONSE, MW_EVENT, MW_GROUP } mesh_wire_type_t;
+
+// Payload-boom van één gedecodeerd frame; leeft zolang het frame en de pool leven.
+// Niet cJSON_Delete'n; cJSON_Duplicate maakt een gewone kopie.
+typedef struct {
+    cJSON node[MESH_WIRE_NODES];
+    int   used;
+} mesh_wire_pool_t;
+
+const char *mesh_wire_type_str(mesh_wire_type_t t);      // "REQUEST", ... (JSON "type")
+mesh_wire_type_t mesh_wire_type_from_str(const char *s); // 0 = onbekend
+
+static inline bool mesh_wire_is_bin(const uint8_t *buf, size_t len) {
+    return len >= MESH_WIRE_HDR && buf[0] == MESH_WIRE_MAGIC;
+}
+
+// Aantal bytes, of 0 = past niet (cap, diepte, MESH_WIRE_NODES, cJSON_Raw) → JSON gebruiken
+size_t mesh_wire_encode(uint8_t *buf, size_t cap, mesh_wire_type_t type, const mesh_envelope_t *e);
+// false = geen geldig v1-frame. e->src_dev/dst_dev/origin_set_topic/payload wijzen in buf.
+bool   mesh_wire_decode(const uint8_t *buf, size_t len, mesh_wire_type_t *type,
+                        mesh_envelope_t *e, mesh_wire_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,324 @@
+// components/mesh_link/mesh_fleet.c
+// Vlootregister (zie mesh_fleet.h); géén esp_* includes
+#include "mesh_fleet.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+
+#ifndef MESH_FLEET_TOUCH_MS
+#define MESH_FLEET_TOUCH_MS  1000   // last_ms-resolutie: vaker → geen schrijf per frame
+#endif
+
+// hash-tabellen: macht van 2, minstens 2× het aantal slots (korte probe-ketens)
+#if   MESH_FLEET_MAX <= 32
+#define FLEET_HASH  64
+#elif MESH_FLEET_MAX <= 64
+#define FLEET_HASH  128
+#elif MESH_FLEET_MAX <= 128
+#define FLEET_HASH  256
+#elif MESH_FLEET_MAX <= 256
+#define FLEET_HASH  512
+#else
+#define FLEET_HASH  1024
+#endif
+#define HASH_MASK   (FLEET_HASH - 1)
+_Static_assert(MESH_FLEET_MAX < 1000 && FLEET_HASH >= 2 * MESH_FLEET_MAX, "MESH_MAX_NODES te groot");
+
+// index-waarde: 0 = leeg (einde keten), -1 = verwijderd (keten loopt door), k = slot k-1
+typedef struct {
+    atomic_short name[FLEET_HASH];
+    atomic_short mac [FLEET_HASH];
+} index_t;
+
+typedef struct {
+    atomic_uint      seq;       // oneven = schrijver bezig
+    bool             used;
+    uint32_t         h_name;
+    mesh_node_info_t n;
+} slot_t;
+
+static slot_t       s_slot[MESH_FLEET_MAX];
+// twee indexen: na veel verwijderingen wordt de andere opnieuw opgebouwd en omgeschakeld,
+// zodat een lezer nooit een half gewiste tabel ziet
+static index_t      s_ix[2];
+static atomic_int   s_ix_cur;
+static atomic_uint  s_ix_gen;               // +1 per rebuild, vóór de andere index gewist wordt
+static int          s_dead;                 // verwijderd-markeringen in de huidige index
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;   // schrijvers
+static uint32_t     s_refused, s_evicted;
+
+static uint32_t fnv1a(const uint8_t *p, size_t n) {
+    uint32_t h = 2166136261u;
+    while (n--) { h ^= *p++; h *= 16777619u; }
+    return h;
+}
+static uint32_t hash_name(const char *dev)     { return fnv1a((const uint8_t *)dev, strlen(dev)); }
+static uint32_t hash_mac(const uint8_t mac[6]) { return fnv1a(mac, 6); }
+
+static index_t *ix_now(void) { return &s_ix[atomic_load_explicit(&s_ix_cur, memory_order_acquire)]; }
+
+// ---------- seqlock per slot ----------
+static bool slot_read(int i, mesh_node_info_t *out) {
+    slot_t *s = &s_slot[i];
+    for (;;) {
+        unsigned q = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (q & 1) continue;                   // schrijver in zijn critical section: kort
+        bool used = s->used;
+        memcpy(out, &s->n, sizeof *out);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) == q) return used;
+    }
+}
+static void slot_wr_begin(slot_t *s) {
+    atomic_fetch_add_explicit(&s->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+static void slot_wr_end(slot_t *s) { atomic_fetch_add_explicit(&s->seq, 1, memory_order_release); }
+
+// ---------- opzoeken (lock-vrij) ----------
+// Een treffer is via de seqlock van het slot gecontroleerd. Een misser kan vals zijn als de
+// lezer na ix_now() zo lang stilstond dat zijn index intussen gewist werd voor een volgende
+// rebuild: dan is s_ix_gen veranderd en zoekt hij opnieuw in de huidige index.
+static bool ix_same_gen(unsigned g) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&s_ix_gen, memory_order_relaxed) == g;
+}
+
+static int find_name(const char *dev, uint32_t h, mesh_node_info_t *out) {
+    for (;;) {
+        unsigned g = atomic_load_explicit(&s_ix_gen, memory_order_acquire);
+        const index_t *x = ix_now();
+        for (int k = 0, j = h & HASH_MASK; k < FLEET_HASH; ++k, j = (j + 1) & HASH_MASK) {
+            int v = atomic_load_explicit(&x->name[j], memory_order_acquire);
+            if (!v) break;
+            if (v > 0 && slot_read(v - 1, out) && !strcmp(out->dev, dev)) return v - 1;
+        }
+        if (ix_same_gen(g)) return -1;
+    }
+}
+
+static int find_mac(const uint8_t mac[6], mesh_node_info_t *out) {
+    uint32_t h = hash_mac(mac);
+    for (;;) {
+        unsigned g = atomic_load_explicit(&s_ix_gen, memory_order_acquire);
+        const index_t *x = ix_now();
+        for (int k = 0, j = h & HASH_MASK; k < FLEET_HASH; ++k, j = (j + 1) & HASH_MASK) {
+            int v = atomic_load_explicit(&x->mac[j], memory_order_acquire);
+            if (!v) break;
+            if (v > 0 && slot_read(v - 1, out) && !memcmp(out->mac, mac, 6)) return v - 1;
+        }
+        if (ix_same_gen(g)) return -1;
+    }
+}
+
+// ---------- schrijven (onder s_mux) ----------
+static void ix_put(atomic_short *tbl, uint32_t h, int slot) {
+    int j = h & HASH_MASK, v;
+    while ((v = atomic_load_explicit(&tbl[j], memory_order_relaxed)) > 0) j = (j + 1) & HASH_MASK;
+    if (v < 0) s_dead--;                    // verwijderd-markering hergebruikt
+    atomic_store_explicit(&tbl[j], (short)(slot + 1), memory_order_release);
+}
+
+static void ix_del(atomic_short *tbl, uint32_t h, int slot) {
+    for (int k = 0, j = h & HASH_MASK; k < FLEET_HASH; ++k, j = (j + 1) & HASH_MASK) {
+        int v = atomic_load_explicit(&tbl[j], memory_order_relaxed);
+        if (!v) return;
+        if (v == slot + 1) { atomic_store_explicit(&tbl[j], (short)-1, memory_order_release); s_dead++; return; }
+    }
+}
+
+static void ix_rebuild_unsafe(void) {
+    int nxt = atomic_load_explicit(&s_ix_cur, memory_order_relaxed) ^ 1;
+    index_t *x = &s_ix[nxt];
+    atomic_fetch_add_explicit(&s_ix_gen, 1, memory_order_relaxed);   // lezers van nxt: opnieuw
+    atomic_thread_fence(memory_order_release);
+    for (int j = 0; j < FLEET_HASH; ++j) {
+        atomic_store_explicit(&x->name[j], (short)0, memory_order_relaxed);
+        atomic_store_explicit(&x->mac[j],  (short)0, memory_order_relaxed);
+    }
+    for (int i = 0; i < MESH_FLEET_MAX; ++i) {
+        if (!s_slot[i].used) continue;
+        ix_put(x->name, s_slot[i].h_name, i);
+        ix_put(x->mac,  hash_mac(s_slot[i].n.mac), i);
+    }
+    atomic_store_explicit(&s_ix_cur, nxt, memory_order_release);
+    s_dead = 0;
+}
+
+static void slot_drop_unsafe(int i) {
+    slot_t *s = &s_slot[i];
+    index_t *x = ix_now();
+    ix_del(x->name, s->h_name, i);
+    ix_del(x->mac,  hash_mac(s->n.mac), i);
+    slot_wr_begin(s);
+    s->used = false;
+    memset(&s->n, 0, sizeof s->n);
+    slot_wr_end(s);
+    if (s_dead > FLEET_HASH / 4) ix_rebuild_unsafe();
+}
+
+// vrij slot, anders het langst geziene offline toestel; -1 = iedereen online
+static int slot_alloc_unsafe(uint32_t now_ms) {
+    int old = -1;
+    for (int i = 0; i < MESH_FLEET_MAX; ++i) {
+        if (!s_slot[i].used) return i;
+        if (s_slot[i].n.online) continue;
+        if (old < 0 || now_ms - s_slot[i].n.last_ms > now_ms - s_slot[old].n.last_ms) old = i;
+    }
+    if (old >= 0) { slot_drop_unsafe(old); s_evicted++; }
+    return old;
+}
+
+bool mesh_fleet_touch(const char *dev, const uint8_t mac[6], uint32_t now_ms) {
+    if (!dev || !*dev || !mac) return false;
+    uint32_t h = hash_name(dev);
+    mesh_node_info_t cur;
+    int i = find_name(dev, h, &cur);
+    // snelpad (elk frame): zelfde MAC, online en recent bijgewerkt → niets te schrijven
+    if (i >= 0 && cur.online && !memcmp(cur.mac, mac, 6) && now_ms - cur.last_ms < MESH_FLEET_TOUCH_MS) return true;
+
+    bool ok = true;
+    portENTER_CRITICAL(&s_mux);
+    i = find_name(dev, h, &cur);
+    bool new_mac = i < 0 || memcmp(cur.mac, mac, 6) != 0;
+    if (new_mac) {
+        mesh_node_info_t other;
+        int o = find_mac(mac, &other);                      // MAC had een andere naam: hernoemd
+        if (o >= 0 && o != i) slot_drop_unsafe(o);
+        if (i >= 0) ix_del(ix_now()->mac, hash_mac(cur.mac), i);   // zelfde naam, andere hardware
+    }
+    if (i < 0) {
+        i = slot_alloc_unsafe(now_ms);
+        if (i < 0) { s_refused++; ok = false; }
+        else {
+            slot_t *s = &s_slot[i];
+            slot_wr_begin(s);
+            memset(&s->n, 0, sizeof s->n);
+            strlcpy(s->n.dev, dev, sizeof s->n.dev);
+            s->h_name = h;
+            s->used = true;
+            slot_wr_end(s);
+            ix_put(ix_now()->name, h, i);
+        }
+    }
+    if (ok) {
+        slot_t *s = &s_slot[i];
+        slot_wr_begin(s);
+        memcpy(s->n.mac, mac, 6);
+        s->n.online = true;
+        s->n.last_ms = now_ms;
+        slot_wr_end(s);
+        if (new_mac) ix_put(ix_now()->mac, hash_mac(mac), i);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+static int json_int(const cJSON *o, const char *key, int lo, int hi) {
+    const cJSON *v = cJSON_GetObjectItemCaseSensitive(o, key);
+    if (!cJSON_IsNumber(v)) return 0;
+    return v->valueint < lo ? lo : v->valueint > hi ? hi : v->valueint;
+}
+
+void mesh_fleet_hello(const char *dev, const cJSON *hello) {
+    if (!dev || !*dev || !cJSON_IsObject(hello)) return;
+    const cJSON *m = cJSON_GetObjectItemCaseSensitive(hello, "mesh");
+    uint8_t relays = (uint8_t)json_int(hello, "relay_count", 0, 255);
+    uint8_t pwms   = (uint8_t)json_int(hello, "pwm_count",   0, 255);
+    uint8_t inputs = (uint8_t)json_int(hello, "input_count", 0, 255);
+    uint8_t layer  = (uint8_t)json_int(m, "layer", 0, 255);
+    int8_t  rssi   = (int8_t) json_int(m, "rssi", -128, 0);
+
+    uint32_t h = hash_name(dev);
+    mesh_node_info_t cur;
+    portENTER_CRITICAL(&s_mux);
+    int i = find_name(dev, h, &cur);
+    if (i >= 0) {
+        slot_t *s = &s_slot[i];
+        slot_wr_begin(s);
+        s->n.hello = true;
+        s->n.relays = relays; s->n.pwms = pwms; s->n.inputs = inputs;
+        s->n.layer = layer; s->n.rssi = rssi;
+        slot_wr_end(s);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void mesh_fleet_sync(const uint8_t *macs, int n, size_t stride) {
+    bool seen[MESH_FLEET_MAX] = { 0 };
+    mesh_node_info_t tmp;
+    for (int k = 0; k < n; ++k) {                           // buiten de lock: O(n) via de MAC-index
+        int i = find_mac(macs + (size_t)k * stride, &tmp);
+        if (i >= 0) seen[i] = true;
+    }
+    portENTER_CRITICAL(&s_mux);
+    for (int i = 0; i < MESH_FLEET_MAX; ++i) {
+        slot_t *s = &s_slot[i];
+        if (!s->used || s->n.online == seen[i]) continue;
+        slot_wr_begin(s);
+        s->n.online = seen[i];
+        slot_wr_end(s);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool mesh_fleet_get(const char *dev, mesh_node_info_t *out) {
+    if (!dev || !*dev || !out) return false;
+    return find_name(dev, hash_name(dev), out) >= 0;
+}
+
+bool mesh_fleet_find_mac(const uint8_t mac[6], mesh_node_info_t *out) {
+    if (!mac || !out) return false;
+    return find_mac(mac, out) >= 0;
+}
+
+bool mesh_fleet_resolve(const char *dev, uint8_t mac[6]) {
+    mesh_node_info_t n;
+    if (!mesh_fleet_get(dev, &n)) return false;
+    memcpy(mac, n.mac, 6);
+    return true;
+}
+
+// Jacobson/Karels zoals TCP: srtt += (rtt - srtt)/8, rttvar += (|rtt - srtt| - rttvar)/4
+void mesh_fleet_rtt_sample(const char *dev, uint32_t rtt_ms) {
+    if (!dev || !*dev) return;
+    if (!rtt_ms) rtt_ms = 1;
+    uint32_t h = hash_name(dev);
+    mesh_node_info_t cur;
+    portENTER_CRITICAL(&s_mux);
+    int i = find_name(dev, h, &cur);
+    if (i >= 0) {
+        mesh_node_info_t *p = &s_slot[i].n;
+        slot_wr_begin(&s_slot[i]);
+        if (!p->srtt_ms) { p->srtt_ms = rtt_ms; p->rttvar_ms = rtt_ms / 2; }
+        else {
+            uint32_t d = rtt_ms > p->srtt_ms ? rtt_ms - p->srtt_ms : p->srtt_ms - rtt_ms;
+            p->rttvar_ms = (3 * p->rttvar_ms + d) / 4;
+            p->srtt_ms   = (7 * p->srtt_ms + rtt_ms) / 8;
+            if (!p->srtt_ms) p->srtt_ms = 1;
+        }
+        slot_wr_end(&s_slot[i]);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+int mesh_fleet_list(int *pos, mesh_node_info_t *out, int max) {
+    int n = 0, i = pos ? *pos : 0;
+    for (; i < MESH_FLEET_MAX && n < max; ++i)
+        if (slot_read(i, &out[n])) n++;
+    if (pos) *pos = i;
+    return n;
+}
+
+void mesh_fleet_stats_get(mesh_fleet_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof *out);
+    mesh_node_info_t tmp;
+    for (int i = 0; i < MESH_FLEET_MAX; ++i) {
+        if (!slot_read(i, &tmp)) continue;
+        out->nodes++;
+        if (tmp.online) out->online++;
+    }
+    out->refused = s_refused;
+    out->evicted = s_evicted;
+}
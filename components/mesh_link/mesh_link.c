@@ -1,6 +1,8 @@
 // components/mesh_link/mesh_link.c
 // Dunne façade: API → backend vtable (géén esp_* includes hier)
 #include "mesh_link.h"
+#include "mesh_fleet.h"
+#include "mesh_time.h"
 
 
 
@@ -12,16 +14,29 @@ typedef struct {
     mesh_status_t (*request)(const mesh_envelope_t*, uint32_t);
     mesh_status_t (*send_event)(const mesh_envelope_t*);
     cJSON* (*snapshot)(void);
+    mesh_status_t (*request_async)(const mesh_envelope_t*, uint32_t, mesh_done_cb_t, void*);  // optioneel
+    mesh_status_t (*set_groups)(const char *const*, int);                                     // optioneel
+    mesh_status_t (*send_group)(const mesh_envelope_t*);                                      // optioneel
+    mesh_status_t (*link_info)(mesh_link_info_t*);                                            // optioneel
+    int (*txq)(int*, mesh_txq_info_t*, int, bool);                                            // optioneel
+    void (*rx_stats)(mesh_rx_stats_t*, bool);                                                 // optioneel
+    int (*paths)(mesh_path_info_t*, int, bool);                                               // optioneel
 } ml_backend_t;
 
 // Backends (alleen declaraties; implementatie zit in backends/*.c)
 const ml_backend_t* ml_backend_espmesh(void);
 const ml_backend_t* ml_backend_mailbox(void); // optioneel
+const ml_backend_t* ml_backend_sim(void);     // host (IDF-target linux)
+const ml_backend_t* ml_backend_hybrid(void);  // ESP-MESH + mailbox (componeert de twee hierboven)
 
 static const ml_backend_t *B = NULL;
 
 static inline const ml_backend_t* pick_backend(void) {
-#if defined(CONFIG_USE_ESP_MESH_BACKEND)
+#if defined(CONFIG_ML_SIM_BACKEND)
+    return ml_backend_sim();
+#elif defined(CONFIG_ML_HYBRID_BACKEND)
+    return ml_backend_hybrid();
+#elif defined(CONFIG_USE_ESP_MESH_BACKEND)
     return ml_backend_espmesh();
 #elif defined(CONFIG_ML_ENABLE_MAILBOX)
     return ml_backend_mailbox();
@@ -31,6 +46,14 @@ static inline const ml_backend_t* pick_backend(void) {
 #endif
 }
 
+// ts_ms = 0 → mesh-tijd bij het versturen (kopie: de envelop van de aanroeper blijft const)
+static inline const mesh_envelope_t* stamp(const mesh_envelope_t *e, mesh_envelope_t *tmp) {
+    if (!e || e->ts_ms) return e;
+    *tmp = *e;
+    tmp->ts_ms = mesh_time_now_ms();
+    return tmp;
+}
+
 void mesh_init(const mesh_opts_t *opts) {
     if (!B) B = pick_backend();
     B->init(opts);
@@ -48,12 +71,37 @@ void mesh_register_root_cb(mesh_root_cb_t cb) {
 
 mesh_status_t mesh_request(const mesh_envelope_t *req, uint32_t timeout_ms) {
     if (!B) B = pick_backend();
-    return B->request(req, timeout_ms);
+    mesh_envelope_t tmp;
+    return B->request(stamp(req, &tmp), timeout_ms);
+}
+
+mesh_status_t mesh_request_async(const mesh_envelope_t *req, uint32_t timeout_ms,
+                                 mesh_done_cb_t cb, void *user) {
+    if (!B) B = pick_backend();
+    mesh_envelope_t tmp;
+    req = stamp(req, &tmp);
+    if (B->request_async) return B->request_async(req, timeout_ms, cb, user);
+    // backend zonder async-pad: blokkerend, resultaat via dezelfde callback
+    mesh_status_t st = B->request(req, timeout_ms);
+    if (st == MESH_OK && cb) cb(req->corr_id, req->dst_dev, st, user);
+    return st;
 }
 
 mesh_status_t mesh_send_event(const mesh_envelope_t *evt) {
     if (!B) B = pick_backend();
-    return B->send_event(evt);
+    mesh_envelope_t tmp;
+    return B->send_event(stamp(evt, &tmp));
+}
+
+mesh_status_t mesh_set_groups(const char *const *names, int n) {
+    if (!B) B = pick_backend();
+    return B->set_groups ? B->set_groups(names, n) : MESH_ERR;
+}
+
+mesh_status_t mesh_send_group(const mesh_envelope_t *req) {
+    if (!B) B = pick_backend();
+    mesh_envelope_t tmp;
+    return B->send_group ? B->send_group(stamp(req, &tmp)) : MESH_ERR;
 }
 
 cJSON* mesh_get_routing_snapshot(void) {
@@ -61,6 +109,42 @@ cJSON* mesh_get_routing_snapshot(void) {
     return B->snapshot();
 }
 
+// vlootregister: gedeeld door de backends (mesh_fleet.c), geen vtable nodig
+int mesh_get_fleet(int *pos, mesh_node_info_t *out, int max) {
+    return mesh_fleet_list(pos, out, max);
+}
+
+void mesh_get_fleet_stats(mesh_fleet_stats_t *out) {
+    mesh_fleet_stats_get(out);
+}
+
+mesh_status_t mesh_get_link_info(mesh_link_info_t *out) {
+    if (!B) B = pick_backend();
+    return (B->link_info && out) ? B->link_info(out) : MESH_ERR;
+}
+
+int mesh_get_txq(int *pos, mesh_txq_info_t *out, int max, bool reset) {
+    if (!B) B = pick_backend();
+    return (B->txq && out) ? B->txq(pos, out, max, reset) : 0;
+}
+
+mesh_status_t mesh_get_rx_stats(mesh_rx_stats_t *out, bool reset) {
+    if (!B) B = pick_backend();
+    if (!B->rx_stats || !out) return MESH_ERR;
+    B->rx_stats(out, reset);
+    return MESH_OK;
+}
+
+int mesh_get_paths(mesh_path_info_t *out, int max, bool reset) {
+    if (!B) B = pick_backend();
+    return (B->paths && out && max > 0) ? B->paths(out, max, reset) : 0;
+}
+
+// mesh-tijd: gedeeld door de backends (mesh_time.c), de root meet per child
+int mesh_get_time_nodes(int *pos, mesh_time_node_t *out, int max) {
+    return (out && max > 0) ? mesh_time_list(pos, out, max) : 0;
+}
+
 const char* mesh_backend_name(void) {
     if (!B) B = pick_backend();
     return B->name();
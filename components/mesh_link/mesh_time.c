@@ -0,0 +1,302 @@
+// components/mesh_link/mesh_time.c
+// Mesh-tijd (zie mesh_time.h); géén esp_* includes
+#include "mesh_time.h"
+#include "mesh_fleet.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#ifndef MESH_TIME_RTT_MAX_US
+#define MESH_TIME_RTT_MAX_US   2000000   // langer onderweg: sample zinloos
+#endif
+#ifndef MESH_TIME_STEP_US
+#define MESH_TIME_STEP_US      50000     // residu groter → opnieuw beginnen (klok versprongen)
+#endif
+#ifndef MESH_TIME_DRIFT_MAX_PPB
+#define MESH_TIME_DRIFT_MAX_PPB 200000   // ±200 ppm (kristal + temperatuur ruim)
+#endif
+#define RTT_SLACK_US           2000      // sample aanvaard tot 2·rtt_min + slack
+
+enum { T_PROBE = 1, T_REPLY = 2 };
+enum { F_EST = 1, F_WALL = 2 };
+
+typedef struct {
+    uint8_t  mac[6];
+    bool     used;
+    uint16_t n;                  // aanvaarde samples sinds de laatste (her)start
+    uint32_t next_ms, last_ms;   // volgende probe, laatste sample
+    int64_t  off_us, ref_us;     // lokaal − mesh = off + drift·(t − ref), t = lokale klok child
+    int32_t  drift_ppb;
+    uint32_t rtt_min_us, err_us;
+    uint32_t samples, rejected;
+    uint32_t seq;
+} node_t;
+
+static int64_t    (*s_clock)(void);
+static bool         s_root;
+static bool         s_wall;
+static int64_t      s_base_us;           // root: mesh = lokaal + basis
+static struct {                          // child: schatting van de root
+    bool     valid;
+    int64_t  off_us, ref_us;
+    int32_t  drift_ppb;
+    uint32_t err_us;
+    int64_t  at_us;                      // lokaal, ontvangen
+} s_est;
+static node_t       s_node[MESH_TIME_NODES];
+static int          s_scan;              // vlootcursor van mesh_time_due
+static uint32_t     s_seq;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t local_us(void) { return s_clock ? s_clock() : 0; }
+
+static int64_t est_at(int64_t off, int64_t ref, int32_t drift, int64_t t) {
+    return off + (int64_t)drift * (t - ref) / 1000000000;
+}
+
+// lokale klok → mesh-tijd (onder s_mux)
+static int64_t to_mesh_unsafe(int64_t t) {
+    if (s_root) return t + s_base_us;
+    if (!s_est.valid) return t + s_base_us;                // nog geen schatting: laatste basis
+    return t - est_at(s_est.off_us, s_est.ref_us, s_est.drift_ppb, t);
+}
+
+static int64_t mesh_now_us(void) {
+    int64_t t = local_us();
+    portENTER_CRITICAL(&s_mux);
+    int64_t m = to_mesh_unsafe(t);
+    portEXIT_CRITICAL(&s_mux);
+    return m;
+}
+
+uint64_t mesh_time_now_ms(void) {
+    int64_t m = mesh_now_us();
+    return m > 0 ? (uint64_t)(m / 1000) : 0;
+}
+
+void mesh_time_clock(int64_t (*clock_us)(void)) { s_clock = clock_us; }
+
+// rolwissel: mesh-tijd loopt door (nieuwe root neemt zijn schatting als basis)
+void mesh_time_role(bool is_root) {
+    int64_t t = local_us();
+    portENTER_CRITICAL(&s_mux);
+    if (is_root != s_root) {
+        int64_t m = to_mesh_unsafe(t);
+        s_root = is_root;
+        s_base_us = m - t;
+        s_est.valid = false;
+        memset(s_node, 0, sizeof s_node);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void mesh_time_set_wall_ms(uint64_t unix_ms) {
+    int64_t t = local_us();
+    portENTER_CRITICAL(&s_mux);
+    if (s_root) {
+        int64_t d = (int64_t)unix_ms * 1000 - t - s_base_us;
+        s_base_us += d;
+        s_wall = true;
+        // mesh-tijd verschuift met d → offset (lokaal − mesh) van elke child met −d
+        for (int i = 0; i < MESH_TIME_NODES; ++i) if (s_node[i].used && s_node[i].n) s_node[i].off_us -= d;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void mesh_get_time_info(mesh_time_info_t *out) {
+    int64_t t = local_us();
+    memset(out, 0, sizeof *out);
+    portENTER_CRITICAL(&s_mux);
+    out->root = s_root;
+    out->wall = s_wall;
+    out->synced = s_root || s_est.valid;
+    if (!s_root && s_est.valid) {
+        out->offset_us = est_at(s_est.off_us, s_est.ref_us, s_est.drift_ppb, t);
+        out->drift_ppb = s_est.drift_ppb;
+        out->err_us = s_est.err_us;
+        out->age_ms = (uint32_t)((t - s_est.at_us) / 1000);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// ---------- frame ----------
+static void put32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+static void put64(uint8_t *p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+static uint32_t get32(const uint8_t *p) { uint32_t v = 0; for (int i = 3; i >= 0; --i) v = v << 8 | p[i]; return v; }
+static int64_t  get64(const uint8_t *p) { uint64_t v = 0; for (int i = 7; i >= 0; --i) v = v << 8 | p[i]; return (int64_t)v; }
+
+// ---------- root ----------
+static node_t *node_find_unsafe(const uint8_t mac[6]) {
+    for (int i = 0; i < MESH_TIME_NODES; ++i) if (s_node[i].used && !memcmp(s_node[i].mac, mac, 6)) return &s_node[i];
+    return NULL;
+}
+
+// bestaand slot, anders een vrij of het langst niet gemeten
+static node_t *node_get_unsafe(const uint8_t mac[6]) {
+    node_t *n = node_find_unsafe(mac);
+    if (n) return n;
+    n = &s_node[0];
+    for (int i = 0; i < MESH_TIME_NODES; ++i) {
+        if (!s_node[i].used) { n = &s_node[i]; break; }
+        if ((int32_t)(s_node[i].last_ms - n->last_ms) < 0) n = &s_node[i];
+    }
+    memset(n, 0, sizeof *n);
+    memcpy(n->mac, mac, 6);
+    n->used = true;
+    return n;
+}
+
+// vloot in stukjes overlopen (cursor): online children waarvan de probe vervallen is.
+// Hoogstens 8 toestellen per oproep; de cursor komt net na het laatst bekeken toestel,
+// zodat wie na een volle `mac` niet meer aan bod kwam de volgende keer eerst komt.
+int mesh_time_due(uint32_t now_ms, const uint8_t self[6], uint8_t mac[][6], int max) {
+    if (!s_root || max <= 0) return 0;
+    mesh_node_info_t ni;
+    int got = 0, pos = s_scan;
+    for (int k = 0; k < 8 && got < max; ++k) {
+        if (!mesh_fleet_list(&pos, &ni, 1)) { pos = 0; break; }   // einde → volgende keer van voren
+        if (!ni.online || (self && !memcmp(ni.mac, self, 6))) continue;
+        portENTER_CRITICAL(&s_mux);
+        node_t *nd = node_get_unsafe(ni.mac);
+        bool due = !nd->next_ms || (int32_t)(now_ms - nd->next_ms) >= 0;
+        if (due) nd->next_ms = now_ms + (nd->n < MESH_TIME_FAST ? 1000 : MESH_TIME_PERIOD_MS);
+        portEXIT_CRITICAL(&s_mux);
+        if (due) memcpy(mac[got++], ni.mac, 6);
+    }
+    s_scan = pos;
+    return got;
+}
+
+size_t mesh_time_probe(const uint8_t mac[6], uint8_t *buf, size_t cap) {
+    if (cap < MESH_TIME_FRAME) return 0;
+    memset(buf, 0, MESH_TIME_FRAME);
+    buf[0] = MESH_TIME_MAGIC; buf[1] = MESH_TIME_VER; buf[2] = T_PROBE;
+    portENTER_CRITICAL(&s_mux);
+    node_t *nd = node_get_unsafe(mac);
+    nd->seq = ++s_seq;
+    put32(buf + 4, nd->seq);
+    if (s_wall) buf[3] |= F_WALL;
+    if (nd->n) {
+        buf[3] |= F_EST;
+        put64(buf + 32, (uint64_t)nd->off_us);
+        put64(buf + 40, (uint64_t)nd->ref_us);
+        put32(buf + 48, (uint32_t)nd->drift_ppb);
+        put32(buf + 52, nd->n > 1 ? nd->err_us : nd->rtt_min_us / 2);   // één sample: nog geen jitter
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return MESH_TIME_FRAME;
+}
+
+void mesh_time_stamp_tx(uint8_t *buf, size_t len) {
+    if (!mesh_time_is_frame(buf, len)) return;
+    if (buf[2] == T_PROBE) put64(buf + 8, (uint64_t)mesh_now_us());
+    else if (buf[2] == T_REPLY) put64(buf + 24, (uint64_t)local_us());
+}
+
+static int32_t clamp_ppb(int64_t v) {
+    return (int32_t)(v > MESH_TIME_DRIFT_MAX_PPB ? MESH_TIME_DRIFT_MAX_PPB : v < -MESH_TIME_DRIFT_MAX_PPB ? -MESH_TIME_DRIFT_MAX_PPB : v);
+}
+
+// één REPLY: clock filter op δ, dan alpha-beta op offset (¼ van het residu) en drift (1/16 van residu/Δt)
+static void sample_unsafe(node_t *nd, int64_t theta, int64_t tm, uint32_t rtt, uint32_t now_ms) {
+    if (!nd->rtt_min_us || rtt < nd->rtt_min_us) nd->rtt_min_us = rtt;
+    else nd->rtt_min_us += (rtt - nd->rtt_min_us) / 64;   // traag mee omhoog (route veranderd)
+    if (nd->n && rtt > 2 * nd->rtt_min_us + RTT_SLACK_US) { nd->rejected++; return; }
+    nd->samples++;
+    nd->last_ms = now_ms;
+    if (!nd->n) {
+        nd->off_us = theta; nd->ref_us = tm; nd->drift_ppb = 0; nd->err_us = rtt / 2;
+        nd->n = 1;
+        return;
+    }
+    int64_t dt = tm - nd->ref_us;
+    if (dt <= 0) return;
+    int64_t pred = est_at(nd->off_us, nd->ref_us, nd->drift_ppb, tm);
+    int64_t r = theta - pred;
+    uint32_t ar = (uint32_t)(r < 0 ? -r : r);
+    if (ar > MESH_TIME_STEP_US) {                          // klok versprongen (reboot, nieuwe basis)
+        nd->off_us = theta; nd->ref_us = tm; nd->drift_ppb = 0; nd->err_us = rtt / 2;
+        nd->n = 1;
+        return;
+    }
+    if (nd->n == 1 && dt >= 500000) {
+        // tweede punt: drift rechtstreeks uit de helling
+        nd->drift_ppb = clamp_ppb((theta - nd->off_us) * 1000000000 / dt);
+        nd->off_us = theta;
+        nd->err_us = ar;
+    } else {
+        nd->off_us = pred + r / 4;
+        nd->drift_ppb = clamp_ppb(nd->drift_ppb + r * 1000000000 / dt / 16);
+        nd->err_us = nd->err_us + ((int32_t)ar - (int32_t)nd->err_us) / 8;
+    }
+    nd->ref_us = tm;
+    if (nd->n < UINT16_MAX) nd->n++;
+}
+
+size_t mesh_time_rx(const uint8_t from[6], const uint8_t *buf, size_t len, int64_t rx_us,
+                    uint8_t *out, size_t cap) {
+    if (!mesh_time_is_frame(buf, len) || buf[1] != MESH_TIME_VER) return 0;
+    if (buf[2] == T_PROBE) {
+        // child: schatting overnemen, antwoorden (t3 stempelt de TX-taak)
+        if (buf[3] & F_EST) {
+            portENTER_CRITICAL(&s_mux);
+            if (!s_root) {
+                s_est.off_us = get64(buf + 32);
+                s_est.ref_us = get64(buf + 40);
+                s_est.drift_ppb = (int32_t)get32(buf + 48);
+                s_est.err_us = get32(buf + 52);
+                s_est.at_us = rx_us;
+                s_est.valid = true;
+                s_wall = buf[3] & F_WALL;
+            }
+            portEXIT_CRITICAL(&s_mux);
+        }
+        if (!out || cap < MESH_TIME_FRAME) return 0;
+        memcpy(out, buf, 8);
+        out[2] = T_REPLY; out[3] = 0;
+        memcpy(out + 8, buf + 8, 8);                        // t1
+        put64(out + 16, (uint64_t)rx_us);                   // t2
+        memset(out + 24, 0, MESH_TIME_FRAME - 24);
+        return MESH_TIME_FRAME;
+    }
+    if (buf[2] == T_REPLY) {
+        int64_t t1 = get64(buf + 8), t2 = get64(buf + 16), t3 = get64(buf + 24);
+        uint32_t now_ms = (uint32_t)(rx_us / 1000);
+        portENTER_CRITICAL(&s_mux);
+        node_t *nd = s_root ? node_find_unsafe(from) : NULL;
+        if (nd && nd->seq == get32(buf + 4) && t1 && t3) {
+            int64_t t4 = rx_us + s_base_us;
+            int64_t rtt = (t4 - t1) - (t3 - t2);
+            if (rtt >= 0 && rtt <= MESH_TIME_RTT_MAX_US)
+                sample_unsafe(nd, ((t2 - t1) + (t3 - t4)) / 2, t2 + (t3 - t2) / 2, (uint32_t)rtt, now_ms);
+            else nd->rejected++;
+        }
+        portEXIT_CRITICAL(&s_mux);
+    }
+    return 0;
+}
+
+int mesh_time_list(int *pos, mesh_time_node_t *out, int max) {
+    int n = 0, i = pos ? *pos : 0;
+    uint32_t now_ms = (uint32_t)(local_us() / 1000);
+    for (; i < MESH_TIME_NODES && n < max; ++i) {
+        mesh_time_node_t *o = &out[n];
+        portENTER_CRITICAL(&s_mux);
+        const node_t *nd = &s_node[i];
+        bool use = nd->used && nd->n;
+        if (use) {
+            memset(o, 0, sizeof *o);
+            memcpy(o->mac, nd->mac, 6);
+            o->offset_us = nd->off_us; o->drift_ppb = nd->drift_ppb;
+            o->rtt_us = nd->rtt_min_us; o->err_us = nd->err_us;
+            o->samples = nd->samples; o->rejected = nd->rejected;
+            o->age_ms = now_ms - nd->last_ms;
+        }
+        portEXIT_CRITICAL(&s_mux);
+        if (!use) continue;
+        mesh_node_info_t ni;
+        if (mesh_fleet_find_mac(o->mac, &ni)) memcpy(o->dev, ni.dev, sizeof o->dev);
+        n++;
+    }
+    if (pos) *pos = i;
+    return n;
+}
@@ -0,0 +1,257 @@
+// components/mesh_link/mesh_wire.c
+// Binaire envelop-codec (géén esp_* includes: ook op de host te bouwen)
+#include "mesh_wire.h"
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+enum { T_NULL = 0, T_FALSE, T_TRUE, T_I8, T_I32, T_F64, T_STR, T_ARR, T_OBJ };
+
+static const char *const s_type_str[] = { "?", "REQUEST", "RESPONSE", "EVENT", "GROUP" };
+
+const char *mesh_wire_type_str(mesh_wire_type_t t) {
+    return (t >= MW_REQUEST && t <= MW_GROUP) ? s_type_str[t] : s_type_str[0];
+}
+
+mesh_wire_type_t mesh_wire_type_from_str(const char *s) {
+    if (!s) return 0;
+    for (int t = MW_REQUEST; t <= MW_GROUP; ++t) if (!strcmp(s, s_type_str[t])) return (mesh_wire_type_t)t;
+    return 0;
+}
+
+// ---------- encode ----------
+typedef struct {
+    uint8_t *buf;
+    size_t   cap, len;
+    int      nodes;
+    bool     fail;
+} wr_t;
+
+static void put(wr_t *w, const void *p, size_t n) {
+    if (w->fail || w->len + n > w->cap) { w->fail = true; return; }
+    memcpy(w->buf + w->len, p, n);
+    w->len += n;
+}
+static void put_u8(wr_t *w, uint8_t v)   { put(w, &v, 1); }
+static void put_u16(wr_t *w, uint16_t v) { uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) }; put(w, b, 2); }
+static void put_u32(wr_t *w, uint32_t v) { uint8_t b[4]; for (int i = 0; i < 4; ++i) b[i] = (uint8_t)(v >> (8 * i)); put(w, b, 4); }
+static void put_u64(wr_t *w, uint64_t v) { uint8_t b[8]; for (int i = 0; i < 8; ++i) b[i] = (uint8_t)(v >> (8 * i)); put(w, b, 8); }
+
+// string incl. '\0' (de decoder wijst er rechtstreeks naar)
+static void put_str16(wr_t *w, const char *s) {
+    size_t n = strlen(s) + 1;
+    if (n > UINT16_MAX) { w->fail = true; return; }
+    put_u16(w, (uint16_t)n);
+    put(w, s, n);
+}
+
+static int count(const cJSON *it) {
+    int n = 0;
+    for (const cJSON *c = it->child; c; c = c->next) n++;
+    return n;
+}
+
+static void put_value(wr_t *w, const cJSON *it, int depth) {
+    if (w->fail) return;
+    if (++w->nodes > MESH_WIRE_NODES || depth > MESH_WIRE_DEPTH) { w->fail = true; return; }
+    switch (it->type & 0xFF) {
+        case cJSON_NULL:  put_u8(w, T_NULL);  break;
+        case cJSON_False: put_u8(w, T_FALSE); break;
+        case cJSON_True:  put_u8(w, T_TRUE);  break;
+        case cJSON_Number: {
+            double d = it->valuedouble;
+            if (d == floor(d) && d >= INT8_MIN && d <= INT8_MAX) { put_u8(w, T_I8); put_u8(w, (uint8_t)(int8_t)d); }
+            else if (d == floor(d) && d >= INT32_MIN && d <= INT32_MAX) { put_u8(w, T_I32); put_u32(w, (uint32_t)(int32_t)d); }
+            else { uint64_t u; memcpy(&u, &d, 8); put_u8(w, T_F64); put_u64(w, u); }
+            break;
+        }
+        case cJSON_String:
+            put_u8(w, T_STR);
+            put_str16(w, it->valuestring ? it->valuestring : "");
+            break;
+        case cJSON_Array: {
+            int n = count(it);
+            if (n > UINT16_MAX) { w->fail = true; return; }
+            put_u8(w, T_ARR); put_u16(w, (uint16_t)n);
+            for (const cJSON *c = it->child; c; c = c->next) put_value(w, c, depth + 1);
+            break;
+        }
+        case cJSON_Object: {
+            int n = count(it);
+            if (n > UINT16_MAX) { w->fail = true; return; }
+            put_u8(w, T_OBJ); put_u16(w, (uint16_t)n);
+            for (const cJSON *c = it->child; c; c = c->next) {
+                const char *k = c->string ? c->string : "";
+                size_t kn = strlen(k) + 1;
+                if (kn > UINT8_MAX) { w->fail = true; return; }
+                put_u8(w, (uint8_t)kn); put(w, k, kn);
+                put_value(w, c, depth + 1);
+            }
+            break;
+        }
+        default: w->fail = true; break;   // cJSON_Raw / ongeldig → JSON-pad
+    }
+}
+
+static uint8_t str_len8(const char *s, bool *fail) {
+    if (!s) return 0;
+    size_t n = strlen(s) + 1;
+    if (n > UINT8_MAX) { *fail = true; return 0; }
+    return (uint8_t)n;
+}
+
+size_t mesh_wire_encode(uint8_t *buf, size_t cap, mesh_wire_type_t type, const mesh_envelope_t *e) {
+    if (!buf || !e || cap < MESH_WIRE_HDR) return 0;
+    bool fail = false;
+    uint8_t src_n = str_len8(e->src_dev, &fail);
+    uint8_t dst_n = str_len8(e->dst_dev, &fail);
+    uint8_t org_n = str_len8(e->origin_set_topic, &fail);
+    if (fail) return 0;
+
+    // payload eerst, na de strings; lengte achteraf in de header
+    wr_t w = { .buf = buf, .cap = cap, .len = MESH_WIRE_HDR };
+    if (src_n) put(&w, e->src_dev, src_n);
+    if (dst_n) put(&w, e->dst_dev, dst_n);
+    if (org_n) put(&w, e->origin_set_topic, org_n);
+    size_t pl0 = w.len;
+    if (e->payload) put_value(&w, e->payload, 0);
+    size_t pl_n = w.len - pl0;
+    if (w.fail || pl_n > UINT16_MAX) return 0;
+
+    size_t total = w.len;
+    w.len = 0;
+    put_u8(&w, MESH_WIRE_MAGIC);
+    put_u8(&w, MESH_WIRE_VER);
+    put_u8(&w, (uint8_t)type);
+    put_u8(&w, (uint8_t)e->kind);
+    put_u8(&w, (uint8_t)e->prio);
+    put_u8(&w, (uint8_t)e->ttl);
+    put_u8(&w, e->hop);
+    put_u8(&w, src_n);
+    put_u8(&w, dst_n);
+    put_u8(&w, org_n);
+    put_u16(&w, (uint16_t)pl_n);
+    put_u32(&w, e->exec_us);
+    put_u64(&w, e->corr_id);
+    put_u64(&w, e->ts_ms);
+    return total;
+}
+
+// ---------- decode ----------
+typedef struct {
+    const uint8_t    *buf;
+    size_t            len, pos;
+    mesh_wire_pool_t *pool;
+    bool              fail;
+} rd_t;
+
+static const uint8_t *take(rd_t *r, size_t n) {
+    if (r->fail || r->pos + n > r->len) { r->fail = true; return NULL; }
+    const uint8_t *p = r->buf + r->pos;
+    r->pos += n;
+    return p;
+}
+static uint8_t  get_u8(rd_t *r)  { const uint8_t *p = take(r, 1); return p ? p[0] : 0; }
+static uint16_t get_u16(rd_t *r) { const uint8_t *p = take(r, 2); return p ? (uint16_t)(p[0] | p[1] << 8) : 0; }
+static uint32_t get_u32(rd_t *r) {
+    const uint8_t *p = take(r, 4); uint32_t v = 0;
+    if (p) for (int i = 3; i >= 0; --i) v = v << 8 | p[i];
+    return v;
+}
+static uint64_t get_u64(rd_t *r) {
+    const uint8_t *p = take(r, 8); uint64_t v = 0;
+    if (p) for (int i = 7; i >= 0; --i) v = v << 8 | p[i];
+    return v;
+}
+
+// n bytes met '\0' als laatste → pointer in het frame
+static char *get_str(rd_t *r, size_t n) {
+    if (!n) return NULL;
+    const uint8_t *p = take(r, n);
+    if (!p || p[n - 1] != '\0') { r->fail = true; return NULL; }
+    return (char *)p;
+}
+
+static cJSON *node_new(rd_t *r, int type) {
+    if (r->pool->used >= MESH_WIRE_NODES) { r->fail = true; return NULL; }
+    cJSON *n = &r->pool->node[r->pool->used++];
+    memset(n, 0, sizeof *n);
+    n->type = type;
+    return n;
+}
+
+static void set_number(cJSON *n, double d) {
+    n->valuedouble = d;
+    n->valueint = d >= INT_MAX ? INT_MAX : d <= (double)INT_MIN ? INT_MIN : (int)d;
+}
+
+static cJSON *get_value(rd_t *r, int depth);
+
+// kinderen koppelen zoals cJSON: child->prev = laatste element
+static bool get_children(rd_t *r, cJSON *parent, bool keyed, int depth) {
+    uint16_t n = get_u16(r);
+    cJSON *last = NULL;
+    for (uint16_t i = 0; i < n && !r->fail; ++i) {
+        char *key = keyed ? get_str(r, get_u8(r)) : NULL;
+        if (keyed && !key) { r->fail = true; break; }
+        cJSON *c = get_value(r, depth + 1);
+        if (!c) break;
+        c->string = key;
+        if (last) { last->next = c; c->prev = last; }
+        else parent->child = c;
+        last = c;
+    }
+    if (parent->child) parent->child->prev = last;
+    return !r->fail;
+}
+
+static cJSON *get_value(rd_t *r, int depth) {
+    if (depth > MESH_WIRE_DEPTH) { r->fail = true; return NULL; }
+    cJSON *n = NULL;
+    switch (get_u8(r)) {
+        case T_NULL:  n = node_new(r, cJSON_NULL);  break;
+        case T_FALSE: n = node_new(r, cJSON_False); break;
+        case T_TRUE:  n = node_new(r, cJSON_True);  break;
+        case T_I8:    if ((n = node_new(r, cJSON_Number))) set_number(n, (int8_t)get_u8(r)); break;
+        case T_I32:   if ((n = node_new(r, cJSON_Number))) set_number(n, (int32_t)get_u32(r)); break;
+        case T_F64:   if ((n = node_new(r, cJSON_Number))) { uint64_t u = get_u64(r); double d; memcpy(&d, &u, 8); set_number(n, d); } break;
+        case T_STR:   if ((n = node_new(r, cJSON_String))) n->valuestring = get_str(r, get_u16(r)); break;
+        case T_ARR:   if ((n = node_new(r, cJSON_Array)))  get_children(r, n, false, depth); break;
+        case T_OBJ:   if ((n = node_new(r, cJSON_Object))) get_children(r, n, true, depth); break;
+        default:      r->fail = true; break;
+    }
+    return r->fail ? NULL : n;
+}
+
+bool mesh_wire_decode(const uint8_t *buf, size_t len, mesh_wire_type_t *type,
+                      mesh_envelope_t *e, mesh_wire_pool_t *pool) {
+    if (!buf || !e || !pool || !mesh_wire_is_bin(buf, len)) return false;
+    rd_t r = { .buf = buf, .len = len, .pool = pool };
+    pool->used = 0;
+
+    (void)get_u8(&r);                              // magic
+    if (get_u8(&r) != MESH_WIRE_VER) return false; // andere versie: niet gokken
+    uint8_t t = get_u8(&r);
+    memset(e, 0, sizeof *e);
+    e->schema  = "v1";
+    e->kind    = (mesh_kind_t)get_u8(&r);
+    e->prio    = (mesh_prio_t)get_u8(&r);
+    e->ttl     = (int8_t)get_u8(&r);
+    e->hop     = get_u8(&r);
+    uint8_t src_n = get_u8(&r), dst_n = get_u8(&r), org_n = get_u8(&r);
+    uint16_t pl_n = get_u16(&r);
+    e->exec_us = get_u32(&r);
+    e->corr_id = get_u64(&r);
+    e->ts_ms   = get_u64(&r);
+    e->src_dev = get_str(&r, src_n);
+    e->dst_dev = get_str(&r, dst_n);
+    e->origin_set_topic = get_str(&r, org_n);
+    if (r.fail || t < MW_REQUEST || t > MW_GROUP || e->kind > ML_KIND_DIAG) return false;
+    if (r.len - r.pos != pl_n) return false;
+    if (pl_n) {
+        e->payload = get_value(&r, 0);
+        if (r.fail || r.pos != r.len) { e->payload = NULL; return false; }
+    }
+    if (type) *type = (mesh_wire_type_t)t;
+    return true;
+}
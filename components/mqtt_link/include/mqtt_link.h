@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,7 @@ extern "C" {
 #endif
 
 typedef void (*mqtt_parser_entry_cb)(const char *json, const char *topic);
+typedef void (*mqtt_parser_bin_cb)(const uint8_t *data, size_t len, const char *topic);
 typedef void (*mqtt_config_entry_cb)(const char *json, const char *topic);
 typedef uint64_t (*mqtt_now_ms_cb)(void);
 typedef void (*mqtt_rx_cb)(const char *topic, const char *payload);
@@ -65,6 +67,7 @@ typedef struct {
 // Callbacks naar jouw app
 typedef struct {
     mqtt_parser_entry_cb   parser_entry;     // voor .../Cmd/Set
+    mqtt_parser_bin_cb     parser_bin_entry; // optioneel: .../Cmd/SetB, of binaire payload op .../Cmd/Set
     mqtt_config_entry_cb   config_set_entry; // voor .../Config/Set
     mqtt_now_ms_cb         now_ms;           // optioneel (fallback = esp_timer_get_time)
 } mqtt_cbs_t;
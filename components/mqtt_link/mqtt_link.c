@@ -7,6 +7,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "cJSON.h"
+#include "json_wr.h"
+#include "lat_trace.h"
 
 static const char *TAG = "mqtt_link";
 
@@ -89,17 +91,23 @@ static void queue_flush_if_connected(void){
     }
 }
 
+// {"status":"online","dev":...} / {"status":"offline"}
+static void status_json(char *buf, size_t n, const char *dev, bool online){
+    jw_t w; jw_init(&w, buf, n);
+    jw_obj(&w, NULL);
+    jw_str(&w, "status", online ? "online" : "offline");
+    if (online) jw_str(&w, "dev", dev);
+    jw_obj_end(&w);
+    if (!jw_done(&w) && n) buf[0] = '\0';
+}
+
 static void publish_online_status(bool online){
     if (!g_client) return;
     char topic[128];
     const char *base = (G.base_prefix[0] ? G.base_prefix : "Devices");
     snprintf(topic, sizeof(topic), "%s/%s/Status", base, G.local_dev);
     char payload[128];
-    if (online) {
-        snprintf(payload, sizeof(payload), "{\"status\":\"online\",\"dev\":\"%s\"}", G.local_dev);
-    } else {
-        snprintf(payload, sizeof(payload), "{\"status\":\"offline\"}");
-    }
+    status_json(payload, sizeof payload, G.local_dev, online);
     int id = esp_mqtt_client_publish(g_client, topic, payload, 0, 1, true);
     ESP_LOGI(TAG, "status %s -> id=%d", online?"online":"offline", id);
 }
@@ -108,18 +116,22 @@ static void do_subscriptions(void){
     if (!g_connected || !g_client) return;
     const char *base = (G.base_prefix[0] ? G.base_prefix : "Devices");
     char topic1[160], topic2[160];
+    const char *dev = G.is_root ? "+" : G.local_dev;
 
-    if (G.is_root) {
-        snprintf(topic1, sizeof(topic1), "%s/+/Cmd/Set", base);
-        snprintf(topic2, sizeof(topic2), "%s/+/Config/Set", base);
-    } else {
-        snprintf(topic1, sizeof(topic1), "%s/%s/Cmd/Set", base, G.local_dev);
-        snprintf(topic2, sizeof(topic2), "%s/%s/Config/Set", base, G.local_dev);
-    }
+    snprintf(topic1, sizeof(topic1), "%s/%s/Cmd/Set", base, dev);
+    snprintf(topic2, sizeof(topic2), "%s/%s/Config/Set", base, dev);
     int s1 = esp_mqtt_client_subscribe(g_client, topic1, 1);
     int s2 = esp_mqtt_client_subscribe(g_client, topic2, 1);
     ESP_LOGI(TAG, "subscribed: %s (%d), %s (%d)", topic1, s1, topic2, s2);
 
+    // binaire commando's (compacte frames, bv. snel dimmen vanuit Node-RED)
+    if (C.parser_bin_entry) {
+        char topic3[160];
+        snprintf(topic3, sizeof(topic3), "%s/%s/Cmd/SetB", base, dev);
+        int s3 = esp_mqtt_client_subscribe(g_client, topic3, 1);
+        ESP_LOGI(TAG, "subscribed: %s (%d)", topic3, s3);
+    }
+
     // extra app subscriptions
     for (int i=0;i<EXTRA_N;i++){
         if (EXTRA[i].topic && EXTRA[i].cb){
@@ -135,14 +147,26 @@ static bool topic_endswith(const char *topic, const char *suffix){
     return (strcasecmp(topic + (nt - ns), suffix) == 0);
 }
 
-static void route_rx_message(const char *topic, const char *data){
+// binaire payload: MessagePack-map (fixmap/map16/map32); JSON begint nooit zo
+static bool payload_is_binary(const char *data, size_t len){
+    if (!len) return false;
+    const uint8_t b = (uint8_t)data[0];
+    return (b & 0xF0) == 0x80 || b == 0xDE || b == 0xDF;
+}
+
+static void route_rx_message(const char *topic, const char *data, size_t len){
     if (!topic || !data) return;
     if (topic_endswith(topic, "/Config/Set")) {
         if (C.config_set_entry) C.config_set_entry(data, topic);
         return;
     }
+    if (topic_endswith(topic, "/Cmd/SetB")) {
+        if (C.parser_bin_entry) C.parser_bin_entry((const uint8_t*)data, len, topic);
+        return;
+    }
     if (topic_endswith(topic, "/Cmd/Set")) {
-        if (C.parser_entry) C.parser_entry(data, topic);
+        if (C.parser_bin_entry && payload_is_binary(data, len)) C.parser_bin_entry((const uint8_t*)data, len, topic);
+        else if (C.parser_entry) C.parser_entry(data, topic);
         return;
     }
     // andere topics: stil houden (of loggen)
@@ -168,14 +192,17 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         // LWT wordt door broker verzonden bij onverwachte disconnect; wij sturen zelf niets hier
         break;
     case MQTT_EVENT_DATA: {
+        lat_rx_begin();
         // Maak null-terminated kopieën
         char *t = (char*)malloc(e->topic_len + 1);
         char *d = (char*)malloc(e->data_len + 1);
         if (!t || !d) { free(t); free(d); break; }
         memcpy(t, e->topic, e->topic_len); t[e->topic_len] = 0;
         memcpy(d, e->data,  e->data_len);  d[e->data_len]  = 0;
-        ESP_LOGI(TAG, "RX [%s] %.*s", t, (int)(e->data_len>512?512:e->data_len), d);
-        route_rx_message(t, d);
+        lat_rx_mark(LAT_COPY);
+        if (payload_is_binary(d, e->data_len)) ESP_LOGI(TAG, "RX [%s] <%d bytes binary>", t, e->data_len);
+        else ESP_LOGI(TAG, "RX [%s] %.*s", t, (int)(e->data_len>512?512:e->data_len), d);
+        route_rx_message(t, d, (size_t)e->data_len);
         // deliver to any extra subscribers
         for (int i=0;i<EXTRA_N;i++){
             if (EXTRA[i].cb) EXTRA[i].cb(t, d);
@@ -281,13 +308,15 @@ void mqtt_link_publish_cb(const char *topic, const char *payload, int qos, bool
 }
 
 void mesh_diag_publish_route_table(const char *event, const cJSON *snapshot){
-  cJSON *o = cJSON_CreateObject();
-  cJSON_AddStringToObject(o, "event", event);
-  cJSON_AddItemToObject(o, "list", cJSON_Duplicate(snapshot, 1));
-  char *js = cJSON_PrintUnformatted(o);
-  mqtt_link_publish("Mesh/RouteTable", js, 0, true);
-  free(js);
-  cJSON_Delete(o);
+  jw_t w;
+  if (!jw_init_pooled(&w)) return;
+  jw_obj(&w, NULL);
+  jw_str(&w, "event", event);
+  jw_cjson(&w, "list", snapshot);
+  jw_obj_end(&w);
+  const char *js = jw_done(&w);
+  if (js) mqtt_link_publish("Mesh/RouteTable", js, 0, true);
+  jw_release(&w);
 }
 
 void mesh_diag_publish_status(const char *dev, bool online){
@@ -295,8 +324,7 @@ void mesh_diag_publish_status(const char *dev, bool online){
     char topic[128], payload[160];
     const char *base = (G.base_prefix[0] ? G.base_prefix : "Devices");
     snprintf(topic, sizeof(topic), "%s/%s/Status", base, dev);
-    if (online) snprintf(payload, sizeof(payload), "{\"status\":\"online\",\"dev\":\"%s\"}", dev);
-    else        snprintf(payload, sizeof(payload), "{\"status\":\"offline\"}");
+    status_json(payload, sizeof payload, dev, online);
     mqtt_link_publish(topic, payload, 1, true); // retained
 }
 
@@ -1,10 +1,11 @@
 // parser.h
 #pragma once
 // ESP32 Runtime Parser (JSON -> canonieke Msg)
-// Afhankelijkheden: cJSON
+// Afhankelijkheden: geen (eigen streaming tokenizer, geen heap)
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,7 +14,14 @@ extern "C" {
 // --- Limits ---
 #define PARSER_TOPIC_MAX 128
 #define PARSER_DEVNAME_MAX 32
-#define PARSER_CORR_MAX  40   // "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" + '\0'
+#define PARSER_CORR_MAX  40   // client corr_id (gegenereerd: 16 hex-tekens)
+#define PARSER_GROUP_MAX 15   // groepsnaam (fan-out), zie "group"
+
+// --- Correlatie-id: binair end-to-end (parser → router → mesh → EVENT) ---
+#ifndef CORR_ID_T_DEFINED
+#define CORR_ID_T_DEFINED
+typedef uint64_t corr_id_t;   // 0 = geen
+#endif
 
 // --- Meta bron ---
 typedef enum {
@@ -62,27 +70,42 @@ typedef enum {
 // --- Meta meegegeven door caller (RX-context) ---
 typedef struct {
     parser_source_t source;
-    const char *topic_hint;     // optioneel, mag NULL
+    const char *topic_hint;     // optioneel, mag NULL; wordt geleend → moet leven zolang de Msg gebruikt wordt
     uint64_t received_ts_ms;    // optioneel (0 indien onbekend)
+    uint32_t flags;             // PARSER_F_*
 } parser_meta_t;
 
+#define PARSER_F_DIAG  (1u << 0)   // error.detail + unknown_keys invullen (enkel voor foutrapportage/debug)
+#define PARSER_F_CACHE (1u << 1)   // parse-cache gebruiken (enkel parser_parse, zonder PARSER_F_DIAG)
+
+// --- Parse-cache: identieke payloads (zelfde topic, enkel corr_id anders) slaan het parsen over ---
+#ifndef PARSER_CACHE_SLOTS
+#define PARSER_CACHE_SLOTS       8     // 0 = uit
+#endif
+#ifndef PARSER_CACHE_PAYLOAD_MAX
+#define PARSER_CACHE_PAYLOAD_MAX 192   // langere payloads (zonder corr_id) worden niet gecachet
+#endif
+
 // --- Canonieke Msg + params ---
 typedef struct {
     int duration_ms;       bool has_duration_ms;
     int brightness_pct;    bool has_brightness_pct;
     int ramp_ms;           bool has_ramp_ms;
     int debounce_ms;       bool has_debounce_ms;
+    int max_age_ms;        bool has_max_age_ms;      // READ: shadow-antwoord mag zo oud zijn (0 = altijd live)
 } parser_params_t;
 
 typedef struct {
     msg_type_t     type;
-    char           topic_hint[PARSER_TOPIC_MAX];
-    char           target_dev[PARSER_DEVNAME_MAX + 1];
+    const char    *topic_hint;         // geleend: meta->topic_hint of parser_result_t.topic_buf ("" = geen)
+    char           target_dev[PARSER_DEVNAME_MAX + 1];   // "" als group gezet is
+    char           group[PARSER_GROUP_MAX + 1];          // fan-out naar alle leden ("" = geen)
     io_kind_t      io_kind;
     int            io_id;              // 0..63 (logisch kanaal of GPIO, downstream mapping)
     action_t       action;
     parser_params_t params;
-    char           corr_id[PARSER_CORR_MAX];
+    corr_id_t      corr;               // binair; reist mee over mesh en komt terug in het EVENT
+    char           corr_id[PARSER_CORR_MAX];  // client-string (root); "" op het mesh-pad
     struct {
         parser_source_t source;
         uint64_t received_ts_ms;
@@ -91,23 +114,100 @@ typedef struct {
 } parser_msg_t;
 
 // --- Error detail ---
+// path/detail wijzen naar vaste strings (nooit NULL)
 typedef struct {
     parser_err_code_t code;
-    char path[64];    // bv. "params.duration_ms"
-    char detail[96];  // korte uitleg/waarden
+    const char *path;    // bv. "params.duration_ms"
+    const char *detail;  // korte uitleg; "" zonder PARSER_F_DIAG
 } parser_error_t;
 
-// --- Resultaat ---
+// --- Resultaat (opslag door caller: static/pool, niet per commando op de stack) ---
 typedef struct {
     bool ok;
     parser_msg_t msg;        // geldig als ok==true
     parser_error_t error;    // geldig als ok==false
-    char unknown_keys[128];  // csv-lijst met onbekende top-level velden ("" = geen)
+    char topic_buf[PARSER_TOPIC_MAX];  // enkel gebruikt als de topic uit de payload komt
+    char unknown_keys[128];  // csv-lijst met onbekende top-level velden (enkel met PARSER_F_DIAG)
 } parser_result_t;
 
+// --- Batch (Cmd/Set met JSON-array of {"cmds":[...]}) ---
+#ifndef PARSER_BATCH_MAX
+#define PARSER_BATCH_MAX 32   // max. items per batch (scenes schakelen 10..30 kanalen)
+#endif
+
+typedef struct {
+    uint8_t        index;     // positie in de cmds-array
+    parser_error_t error;     // path binnen het item, bv. "io_id" (→ "cmds[3].io_id")
+} parser_item_error_t;
+
+typedef struct {
+    bool ok;                                   // false = envelop onbruikbaar (zie error)
+    parser_error_t error;                      // envelop-fout (geldig als ok==false)
+    corr_id_t corr;                            // binair batch-corr (één mesh-frame per child)
+    char corr_id[PARSER_CORR_MAX];             // batch-corr; items zonder eigen corr_id: "<corr>#<index>"
+    bool corr_generated;                       // geen corr_id van de client (niet te dedupliceren)
+    uint8_t count;                             // geldige items in msg[]
+    parser_msg_t msg[PARSER_BATCH_MAX];
+    uint8_t index[PARSER_BATCH_MAX];           // originele positie van msg[i] in de cmds-array
+    uint8_t err_count;                         // items die niet geparsed konden worden
+    parser_item_error_t errors[PARSER_BATCH_MAX];
+    char topic_buf[PARSER_TOPIC_MAX];          // topic uit de envelop (als meta er geen geeft)
+    char unknown_keys[128];                    // csv over envelop + items (enkel met PARSER_F_DIAG)
+} parser_batch_t;
+
+// --- Binair formaat (Cmd/SetB of auto-detect) ---
+// MessagePack-map met korte string-sleutels; enums als getal (io_kind_t, action_t).
+//   {"t":"ESP32_BINNEN","k":1,"i":0,"a":3,"b":40,"r":500}
+#define PARSER_BIN_TARGET   "t"   // str   target_dev (of PARSER_BIN_GROUP)
+#define PARSER_BIN_GROUP    "g"   // str   group
+#define PARSER_BIN_IOKIND   "k"   // uint  io_kind_t (optioneel: afgeleid zoals JSON)
+#define PARSER_BIN_IOID     "i"   // uint  0..63
+#define PARSER_BIN_ACTION   "a"   // uint  action_t
+#define PARSER_BIN_DURATION "d"   // uint  duration_ms (RELAY)
+#define PARSER_BIN_BRIGHT   "b"   // uint  brightness_pct 0..100 (PWM)
+#define PARSER_BIN_RAMP     "r"   // uint  ramp_ms (PWM)
+#define PARSER_BIN_DEBOUNCE "db"  // uint  debounce_ms (INPUT/READ)
+#define PARSER_BIN_CORR     "c"   // str   corr_id (optioneel)
+#define PARSER_BIN_VALUE    "v"   // any   report-waarde (INPUT/REPORT)
+#define PARSER_BIN_MAXAGE   "ma"  // uint  max_age_ms (READ)
+
 // --- API ---
-void parser_init(void);  // momenteel no-op; laat staan voor toekomst
-parser_result_t parser_parse(const char *json, const parser_meta_t *meta);
+void parser_init(void);  // bouwt de alias-hashindex (anders lazy bij eerste parse)
+
+// Nieuwe corr: random salt per boot (hoog) + teller (laag); geen heap, één esp_random per boot.
+corr_id_t parser_corr_new(void);
+
+// Parse in caller-opslag; retourneert out->ok. out->msg.topic_hint is geleend (zie boven).
+// Tip: parse zonder PARSER_F_DIAG en herhaal enkel bij een fout mét de vlag.
+bool parser_parse(const char *json, const parser_meta_t *meta, parser_result_t *out);
+
+// Batch: root-array, of object met "cmds":[...]. Envelop-velden (bv. target_dev)
+// gelden als default voor items die ze niet zelf zetten; de topic komt enkel uit meta
+// of de envelop (geldt voor alle items). parser_batch_t is groot
+// (~PARSER_BATCH_MAX × parser_msg_t): caller voorziet de opslag (static/heap).
+bool parser_is_batch(const char *json);
+bool parser_parse_batch(const char *json, const parser_meta_t *meta, parser_batch_t *out);
+
+// Binair: zelfde validatie en foutpaden als parser_parse(); geen heap.
+bool            parser_is_bin(const uint8_t *buf, size_t len);   // eerste byte = msgpack-map
+bool            parser_parse_bin(const uint8_t *buf, size_t len, const parser_meta_t *meta, parser_result_t *out);
+size_t          parser_encode_bin(const parser_msg_t *m, uint8_t *out, size_t outsz);  // 0 = past niet
+
+// --- Statistiek (kost per bericht; goedkoop: één klok-read voor en na) ---
+#ifndef PARSER_STATS
+#define PARSER_STATS 1
+#endif
+
+typedef struct {
+    uint32_t n;          // geparste berichten (JSON, batch en binair)
+    uint32_t n_err;      // waarvan met fout
+    uint64_t total_ns;   // som parse-tijd (op het doel uit de cyclusteller)
+    uint32_t max_us;     // traagste bericht
+    uint32_t cache_hit;  // parser_parse() zonder parsen (PARSER_F_CACHE)
+    uint32_t cache_miss;
+} parser_stats_t;
+
+void parser_stats_get(parser_stats_t *out, bool reset);   // nullen zonder PARSER_STATS
 
 // (optioneel) helpers voor logging/debug
 const char *parser_err_str(parser_err_code_t c);
@@ -5,36 +5,260 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
-#include "cJSON.h"
 #include <strings.h>
 
 #if defined(ESP_PLATFORM)
 #include "esp_random.h"
+#include "esp_timer.h"
+#endif
+// echte chip (niet env:native / IDF-linux): cyclusteller en spinlock voor de tellers
+#if defined(ESP_PLATFORM) && (defined(__XTENSA__) || defined(__riscv))
+#define PARSER_ON_CHIP 1
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#else
+#define PARSER_ON_CHIP 0
+#include <time.h>
+#endif
+
+// tellers (statistiek, cache): de RX-taak telt, de diag-taak leest en nult in één keer
+#if PARSER_ON_CHIP
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+#define STATS_LOCK()    portENTER_CRITICAL(&s_stats_mux)
+#define STATS_UNLOCK()  portEXIT_CRITICAL(&s_stats_mux)
+#else
+#define STATS_LOCK()    ((void)0)   // host: tests tellen en lezen in één thread
+#define STATS_UNLOCK()  ((void)0)
 #endif
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a) (sizeof(a)/sizeof((a)[0]))
 #endif
 
+// Zelfde nesting-limiet als cJSON (CJSON_NESTING_LIMIT): geldig/ongeldig blijft identiek
+#define JSON_NESTING_LIMIT 1000
+
 // ------------ intern: utils ------------
-static void set_error(parser_result_t *r, parser_err_code_t code, const char *path, const char *detail) {
-    r->ok = false;
-    r->error.code = code;
-    if (path)  snprintf(r->error.path,   sizeof(r->error.path),   "%s", path);
-    else       r->error.path[0] = '\0';
-    if (detail)snprintf(r->error.detail, sizeof(r->error.detail), "%s", detail);
-    else       r->error.detail[0] = '\0';
+// path/detail zijn altijd vaste strings: enkel pointers zetten, niets kopiëren
+static void set_error(parser_error_t *e, parser_err_code_t code, const char *path, const char *detail) {
+    e->code   = code;
+    e->path   = path   ? path   : "";
+    e->detail = detail ? detail : "";
+}
+
+// ------------ intern: streaming JSON tokenizer (geen heap, geen DOM) ------------
+// Eén pass over de payload; enkel top-level velden worden onthouden (als verwijzing
+// in de bronbuffer). Syntaxregels volgen cJSON_Parse: whitespace = bytes <= 32,
+// optionele UTF-8 BOM, trailing bytes na de root-waarde worden genegeerd.
+typedef enum { JV_NONE = 0, JV_NULL, JV_FALSE, JV_TRUE, JV_NUMBER, JV_STRING, JV_ARRAY, JV_OBJECT } jv_type_t;
+
+typedef struct {
+    uint8_t     type;   // jv_type_t
+    const char *raw;    // STRING: na de openende quote; NUMBER: eerste teken
+    size_t      len;    // STRING: ruwe lengte tot de sluitende quote
+} jv_t;
+
+static const char *skip_ws(const char *p) {
+    while (*p && (unsigned char)*p <= 32) p++;
+    return p;
+}
+
+// zoek de sluitende quote (p staat net na de openende)
+static const char *json_str_end(const char *p) {
+    while (*p != '"') {
+        if (*p == '\0') return NULL;
+        if (*p == '\\') { p++; if (*p == '\0') return NULL; }
+        p++;
+    }
+    return p;
+}
+
+static unsigned json_hex4(const char *p) {
+    unsigned h = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        if      (c >= '0' && c <= '9') h += (unsigned)(c - '0');
+        else if (c >= 'A' && c <= 'F') h += (unsigned)(10 + c - 'A');
+        else if (c >= 'a' && c <= 'f') h += (unsigned)(10 + c - 'a');
+        else return 0;                  // zoals cJSON: ongeldig → 0
+        if (i < 3) h <<= 4;
+    }
+    return h;
+}
+
+// \uXXXX (evt. surrogate pair) → codepoint; retourneert verbruikte bytes of 0 bij fout
+static int json_utf16(const char *s, const char *end, unsigned *cp) {
+    if (end - s < 6) return 0;
+    unsigned first = json_hex4(s + 2);
+    if (first >= 0xDC00 && first <= 0xDFFF) return 0;
+    if (first >= 0xD800 && first <= 0xDBFF) {
+        const char *s2 = s + 6;
+        if (end - s2 < 6) return 0;
+        if (s2[0] != '\\' || s2[1] != 'u') return 0;
+        unsigned second = json_hex4(s2 + 2);
+        if (second < 0xDC00 || second > 0xDFFF) return 0;
+        *cp = 0x10000 + (((first & 0x3FF) << 10) | (second & 0x3FF));
+        return 12;
+    }
+    *cp = first;
+    return 6;
 }
 
-static int parse_int_like(const cJSON *item, bool allow_percent, bool *is_percent, bool *ok) {
+// Valideer + decodeer een JSON-string [s,end) naar out (mag NULL zijn: enkel valideren).
+// Schrijft hoogstens outsz-1 bytes en stopt bij een ge-escapete NUL (C-string zoals cJSON).
+// Retourneert de volledige C-lengte, of -1 bij een ongeldige escape.
+static long json_str_decode(const char *s, const char *end, char *out, size_t outsz) {
+    size_t n = 0;
+    bool cut = false;
+#define PUT_CH(ch) do { char c_ = (char)(ch); \
+        if (!cut) { if (c_ == '\0') cut = true; else { if (out && n + 1 < outsz) out[n] = c_; n++; } } } while (0)
+    while (s < end) {
+        if (*s != '\\') { PUT_CH(*s); s++; continue; }
+        switch (s[1]) {
+            case 'b': PUT_CH('\b'); s += 2; break;
+            case 'f': PUT_CH('\f'); s += 2; break;
+            case 'n': PUT_CH('\n'); s += 2; break;
+            case 'r': PUT_CH('\r'); s += 2; break;
+            case 't': PUT_CH('\t'); s += 2; break;
+            case '"': case '\\': case '/': PUT_CH(s[1]); s += 2; break;
+            case 'u': {
+                unsigned cp = 0;
+                int used = json_utf16(s, end, &cp);
+                if (!used) return -1;
+                if (cp < 0x80) {
+                    PUT_CH(cp);
+                } else if (cp < 0x800) {
+                    PUT_CH(0xC0 | (cp >> 6));  PUT_CH(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    PUT_CH(0xE0 | (cp >> 12)); PUT_CH(0x80 | ((cp >> 6) & 0x3F)); PUT_CH(0x80 | (cp & 0x3F));
+                } else {
+                    PUT_CH(0xF0 | (cp >> 18)); PUT_CH(0x80 | ((cp >> 12) & 0x3F));
+                    PUT_CH(0x80 | ((cp >> 6) & 0x3F)); PUT_CH(0x80 | (cp & 0x3F));
+                }
+                s += used;
+                break;
+            }
+            default: return -1;
+        }
+    }
+#undef PUT_CH
+    if (out && outsz) out[n < outsz ? n : outsz - 1] = '\0';
+    return (long)n;
+}
+
+// Getal zoals cJSON: max. 63 tekens uit [0-9+-eE.] kopiëren en strtod; *used = 0 bij fout
+static double json_number(const char *p, size_t *used) {
+    char buf[64];
+    size_t n = 0;
+    while (n < sizeof(buf) - 1 && p[n] && strchr("0123456789+-eE.", p[n])) { buf[n] = p[n]; n++; }
+    buf[n] = '\0';
+    char *end = NULL;
+    double d = strtod(buf, &end);
+    *used = (size_t)(end - buf);
+    return d;
+}
+
+// "key" : → p op de waarde; key wordt gedecodeerd in out (mag NULL zijn)
+static const char *scan_key(const char *p, char *out, size_t outsz) {
+    if (*p != '"') return NULL;
+    const char *e = json_str_end(p + 1);
+    if (!e || json_str_decode(p + 1, e, out, outsz) < 0) return NULL;
+    p = skip_ws(e + 1);
+    if (*p != ':') return NULL;
+    return skip_ws(p + 1);
+}
+
+static const char *scan_scalar(const char *p, jv_t *v) {
+    v->raw = p; v->len = 0;
+    if (!strncmp(p, "null", 4))  { v->type = JV_NULL;  return p + 4; }
+    if (!strncmp(p, "false", 5)) { v->type = JV_FALSE; return p + 5; }
+    if (!strncmp(p, "true", 4))  { v->type = JV_TRUE;  return p + 4; }
+    if (*p == '"') {
+        const char *e = json_str_end(p + 1);
+        if (!e || json_str_decode(p + 1, e, NULL, 0) < 0) return NULL;
+        v->type = JV_STRING; v->raw = p + 1; v->len = (size_t)(e - (p + 1));
+        return e + 1;
+    }
+    if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        size_t used = 0;
+        (void)json_number(p, &used);
+        if (!used) return NULL;
+        v->type = JV_NUMBER;
+        return p + used;
+    }
+    return NULL;
+}
+
+// Valideert een (geneste) array/object zonder iets op te slaan. Iteratief met een
+// bit-stack i.p.v. recursie; depth = nesting-niveau vóór deze container.
+static const char *skip_container(const char *p, unsigned depth) {
+    uint8_t is_obj[(JSON_NESTING_LIMIT + 7) / 8];
+    unsigned sp = 0;
+    jv_t dummy;
+    for (;;) {
+        // verwacht een waarde op p
+        if (*p == '{' || *p == '[') {
+            if (depth + sp >= JSON_NESTING_LIMIT) return NULL;
+            bool obj = (*p == '{');
+            if (obj) is_obj[sp / 8] |=  (uint8_t)(1u << (sp % 8));
+            else     is_obj[sp / 8] &= (uint8_t)~(1u << (sp % 8));
+            sp++;
+            p = skip_ws(p + 1);
+            if (*p != (obj ? '}' : ']')) {
+                if (obj && !(p = scan_key(p, NULL, 0))) return NULL;
+                continue;
+            }
+            p++; sp--;          // lege container
+        } else if (!(p = scan_scalar(p, &dummy))) {
+            return NULL;
+        }
+        // na een waarde: ',' of sluiter (evt. meerdere niveaus)
+        for (;;) {
+            if (sp == 0) return p;
+            bool obj = (is_obj[(sp - 1) / 8] >> ((sp - 1) % 8)) & 1u;
+            p = skip_ws(p);
+            if (*p == ',') {
+                p = skip_ws(p + 1);
+                if (obj && !(p = scan_key(p, NULL, 0))) return NULL;
+                break;
+            }
+            if (*p != (obj ? '}' : ']')) return NULL;
+            p++; sp--;
+        }
+    }
+}
+
+static const char *scan_value(const char *p, unsigned depth, jv_t *v) {
+    if (*p == '{' || *p == '[') {
+        v->type = (*p == '{') ? JV_OBJECT : JV_ARRAY;
+        v->raw = p; v->len = 0;
+        return skip_container(p, depth);
+    }
+    return scan_scalar(p, v);
+}
+
+static double jv_number(const jv_t *v) {
+    size_t used;
+    return json_number(v->raw, &used);
+}
+
+// gedecodeerde string (afgekapt op outsz); retourneert de volledige lengte
+static size_t jv_string(const jv_t *v, char *out, size_t outsz) {
+    long n = json_str_decode(v->raw, v->raw + v->len, out, outsz);
+    return (n < 0) ? 0 : (size_t)n;
+}
+
+static int parse_int_like(const jv_t *item, bool allow_percent, bool *is_percent, bool *ok) {
     *ok = false;
     if (is_percent) *is_percent = false;
 
-    if (cJSON_IsNumber(item)) { *ok = true; return (int)(item->valuedouble); }
+    if (item->type == JV_NUMBER) { *ok = true; return (int)jv_number(item); }
 
-    if (cJSON_IsString(item) && item->valuestring) {
-        const char *s = item->valuestring;
-        size_t n = strlen(s);
+    if (item->type == JV_STRING) {
+        char s[34];
+        size_t n = jv_string(item, s, sizeof(s));
+        if (n > 32) return 0;                    // past nooit in buf (met of zonder '%')
         bool has_pct = (allow_percent && n>0 && s[n-1]=='%');
         char buf[32];
         if (has_pct) {
@@ -61,99 +285,199 @@ static int parse_int_like(const cJSON *item, bool allow_percent, bool *is_percen
     return 0;
 }
 
-static bool parse_bool_like(const cJSON *item, bool *out) {
-    if (cJSON_IsBool(item)) { *out = cJSON_IsTrue(item); return true; }
-    if (cJSON_IsNumber(item)) { *out = (item->valuedouble != 0.0); return true; }
-    if (cJSON_IsString(item) && item->valuestring) {
-        const char *s = item->valuestring;
+static bool parse_bool_like(const jv_t *item, bool *out) {
+    if (item->type == JV_TRUE || item->type == JV_FALSE) { *out = (item->type == JV_TRUE); return true; }
+    if (item->type == JV_NUMBER) { *out = (jv_number(item) != 0.0); return true; }
+    if (item->type == JV_STRING) {
+        char s[8];
+        if (jv_string(item, s, sizeof(s)) >= sizeof(s)) return false;   // langer dan "false"
         if (!strcasecmp(s,"on") || !strcasecmp(s,"true"))  { *out = true;  return true; }
         if (!strcasecmp(s,"off")|| !strcasecmp(s,"false")) { *out = false; return true; }
     }
     return false;
 }
 
-static const cJSON* get_any(const cJSON *obj, const char *const *keys) {
-    for (size_t i=0; keys[i]; ++i) {
-        const cJSON *it = cJSON_GetObjectItemCaseSensitive((cJSON*)obj, keys[i]);
-        if (it) return it;
-    }
-    return NULL;
-}
+// ------------ alias-spec (enige bron voor alle sleutel-aliassen) ------------
+// Eén rij per alias: X(veld, naam, unit-factor → ms, canoniek pad).
+// Rijen van hetzelfde veld staan aaneengesloten; de volgorde binnen een veld is de
+// voorrang (eerste = hoogste). Een naam mag in meerdere velden voorkomen ("value").
+#define PARSER_ALIAS_SPEC(X) \
+    X(F_ACTION,   "action",         1,     "action")              \
+    X(F_ACTION,   "command",        1,     "action")              \
+    X(F_ACTION,   "state",          1,     "action")              \
+    X(F_ACTION,   "relay_state",    1,     "action")              \
+    X(F_ACTION,   "cmd",            1,     "action")              \
+    X(F_TARGET,   "target_dev",     1,     "target_dev")          \
+    X(F_TARGET,   "target",         1,     "target_dev")          \
+    X(F_TARGET,   "device",         1,     "target_dev")          \
+    X(F_TARGET,   "dev",            1,     "target_dev")          \
+    X(F_TARGET,   "node",           1,     "target_dev")          \
+    X(F_GROUP,    "group",          1,     "group")               \
+    X(F_IOKIND,   "io_kind",        1,     "io_kind")             \
+    X(F_IOKIND,   "io",             1,     "io_kind")             \
+    X(F_IOKIND,   "type",           1,     "io_kind")             \
+    X(F_IOKIND,   "kind",           1,     "io_kind")             \
+    X(F_IOKIND,   "device_type",    1,     "io_kind")             \
+    X(F_IOID,     "io_id",          1,     "io_id")               \
+    X(F_IOID,     "relay",          1,     "io_id")               \
+    X(F_IOID,     "pin",            1,     "io_id")               \
+    X(F_IOID,     "gpio",           1,     "io_id")               \
+    X(F_IOID,     "channel",        1,     "io_id")               \
+    X(F_IOID,     "index",          1,     "io_id")               \
+    X(F_BRIGHT,   "brightness",     1,     "params.brightness")   \
+    X(F_BRIGHT,   "level",          1,     "params.brightness")   \
+    X(F_BRIGHT,   "duty",           1,     "params.duty")         \
+    X(F_BRIGHT,   "value",          1,     "params.brightness")   \
+    X(F_BRIGHT,   "percent",        1,     "params.brightness")   \
+    X(F_REPORT,   "value",          1,     "params.value")        \
+    X(F_REPORT,   "val",            1,     "params.value")        \
+    X(F_CORR,     "corr_id",        1,     "corr_id")             \
+    X(F_CORR,     "correlation_id", 1,     "corr_id")             \
+    X(F_CORR,     "id",             1,     "corr_id")             \
+    X(F_TOPIC,    "_topic",         1,     "topic_hint")          \
+    X(F_TOPIC,    "topic_hint",     1,     "topic_hint")          \
+    X(F_DURATION, "duration_ms",    1,     "params.duration_ms")  \
+    X(F_DURATION, "duration_s",     1000,  "params.duration_s")   \
+    X(F_DURATION, "duration",       1000,  "params.duration")     \
+    X(F_DURATION, "minutes",        60000, "params.minutes")      \
+    X(F_RAMP,     "ramp_ms",        1,     "params.ramp_ms")      \
+    X(F_RAMP,     "ramp",           1,     "params.ramp_ms")      \
+    X(F_RAMP,     "fade",           1,     "params.ramp_ms")      \
+    X(F_RAMP,     "transition",     1,     "params.ramp_ms")      \
+    X(F_DEBOUNCE, "debounce_ms",    1,     "params.debounce_ms")  \
+    X(F_DEBOUNCE, "debounce",       1,     "params.debounce_ms")  \
+    X(F_MAXAGE,   "max_age_ms",     1,     "params.max_age_ms")   \
+    X(F_MAXAGE,   "max_age_s",      1000,  "params.max_age_s")
 
-static const char *ACTION_KEYS[]   = {"action","command","state","relay_state","cmd",NULL};
-static const char *TARGET_KEYS[]   = {"target_dev","target","device","dev","node",NULL};
-static const char *IOKIND_KEYS[]   = {"io_kind","io","type","kind","device_type",NULL};
-static const char *IOID_KEYS[]     = {"io_id","relay","pin","gpio","channel","index",NULL};
-static const char *BRIGHT_KEYS[]   = {"brightness","level","duty","value","percent",NULL};
-static const char *REPORT_KEYS[]   = {"value","val",NULL};
-static const char *CORR_KEYS[]     = {"corr_id","correlation_id","id",NULL};
-static const char *TOPIC_KEYS[]    = {"_topic","topic_hint",NULL};
+typedef enum {
+    F_ACTION = 0, F_TARGET, F_GROUP, F_IOKIND, F_IOID, F_BRIGHT, F_REPORT, F_CORR, F_TOPIC,
+    F_DURATION, F_RAMP, F_DEBOUNCE, F_MAXAGE, F__COUNT
+} alias_field_t;
 
-// KEYS-tabel met metadata voor ms/s/min (synoniemen met unit-factor)
-struct alias_ms { const char *name; int mult; const char *path; };
+typedef struct {
+    const char *name;
+    uint8_t     field;  // alias_field_t
+    int         mult;   // unit-factor naar ms (enkel relevant voor tijdsvelden)
+    const char *path;   // canoniek pad voor foutmeldingen
+} alias_spec_t;
 
-static const struct alias_ms DURATION_KEYS[] = {
-    {"duration_ms", 1,      "params.duration_ms"},
-    {"duration_s",  1000,   "params.duration_s"},
-    {"duration",    1000,   "params.duration"},
-    {"minutes",     60000,  "params.minutes"},
-};
+#define ALIAS_ROW(f, n, m, p) { (n), (f), (m), (p) },
+static const alias_spec_t ALIASES[] = { PARSER_ALIAS_SPEC(ALIAS_ROW) };
+#undef ALIAS_ROW
+#define ALIAS_COUNT ARRAY_SIZE(ALIASES)
 
+// Hash-index: case-insensitieve FNV-1a, open addressing. Eén bucket per unieke naam;
+// dubbele namen (zelfde sleutel in meerdere velden) hangen via s_alias_next aan elkaar.
+#define ALIAS_HASH_SIZE 128     // macht van 2, ruim 2x ALIAS_COUNT → korte probe-ketens
+#define ALIAS_NONE      0xFF
 
-static const struct alias_ms RAMP_KEYS_MS[] = {
-    {"ramp_ms", 1, "params.ramp_ms"}, {"ramp", 1, "params.ramp_ms"},
-    {"fade",    1, "params.ramp_ms"}, {"transition", 1, "params.ramp_ms"},
-};
+static uint8_t s_alias_bucket[ALIAS_HASH_SIZE];
+static uint8_t s_alias_next[ALIAS_COUNT];
+static uint8_t s_field_first[F__COUNT];
+static uint8_t s_field_end[F__COUNT];
+static bool    s_alias_ready = false;
+
+static uint32_t alias_hash(const char *k) {
+    uint32_t h = 2166136261u;
+    for (; *k; ++k) { h ^= (uint8_t)tolower((unsigned char)*k); h *= 16777619u; }
+    return h;
+}
 
-static const struct alias_ms DEBOUNCE_KEYS_MS[] = {
-    {"debounce_ms", 1, "params.debounce_ms"}, {"debounce", 1, "params.debounce_ms"},
-};
+static void alias_index_build(void) {
+    if (s_alias_ready) return;
+    memset(s_alias_bucket, ALIAS_NONE, sizeof(s_alias_bucket));
+    memset(s_alias_next,   ALIAS_NONE, sizeof(s_alias_next));
+    memset(s_field_first,  ALIAS_NONE, sizeof(s_field_first));
+    memset(s_field_end,    0,          sizeof(s_field_end));
 
+    for (size_t i = 0; i < ALIAS_COUNT; ++i) {
+        const alias_spec_t *a = &ALIASES[i];
+        if (s_field_first[a->field] == ALIAS_NONE) s_field_first[a->field] = (uint8_t)i;
+        s_field_end[a->field] = (uint8_t)(i + 1);
+
+        uint32_t h = alias_hash(a->name) & (ALIAS_HASH_SIZE - 1);
+        for (;;) {
+            uint8_t b = s_alias_bucket[h];
+            if (b == ALIAS_NONE) { s_alias_bucket[h] = (uint8_t)i; break; }
+            if (!strcasecmp(ALIASES[b].name, a->name)) {
+                while (s_alias_next[b] != ALIAS_NONE) b = s_alias_next[b];
+                s_alias_next[b] = (uint8_t)i;
+                break;
+            }
+            h = (h + 1) & (ALIAS_HASH_SIZE - 1);
+        }
+    }
+    s_alias_ready = true;
+}
+
+// eerste spec-rij waarvan de naam (hoofdletterongevoelig) gelijk is aan k, of ALIAS_NONE
+static uint8_t alias_lookup(const char *k) {
+    uint32_t h = alias_hash(k) & (ALIAS_HASH_SIZE - 1);
+    for (;;) {
+        uint8_t b = s_alias_bucket[h];
+        if (b == ALIAS_NONE || !strcasecmp(ALIASES[b].name, k)) return b;
+        h = (h + 1) & (ALIAS_HASH_SIZE - 1);
+    }
+}
+
+// Resultaat van de scan: per spec-rij het eerste voorkomen van die sleutel
+typedef struct {
+    jv_t slot[ALIAS_COUNT];
+} scan_t;
+
+// winnende alias van een veld: eerste gevulde rij in spec-volgorde (zoals vroeger get_any)
+static const jv_t *field_item(const scan_t *S, alias_field_t f, size_t *row) {
+    static const jv_t none = { .type = JV_NONE };
+    for (size_t i = s_field_first[f]; i < s_field_end[f]; ++i) {
+        if (S->slot[i].type != JV_NONE) { if (row) *row = i; return &S->slot[i]; }
+    }
+    return &none;
+}
 
 static void strtolower_inplace(char *s) {
     for (; *s; ++s) *s = (char)tolower((unsigned char)*s);
 }
 
-static bool read_string(const cJSON *obj, const char *const *keys, char *out, size_t outsz) {
-    const cJSON *it = get_any(obj, keys);
-    if (!it || !cJSON_IsString(it) || !it->valuestring) return false;
-    snprintf(out, outsz, "%s", it->valuestring);
+static bool read_string(const jv_t *it, char *out, size_t outsz) {
+    if (it->type != JV_STRING) return false;
+    (void)jv_string(it, out, outsz);
     return true;
 }
 
-static bool read_int_any(const cJSON *obj, const char *const *keys, int *out, const char **path, bool allow_percent, bool *was_percent) {
-    const cJSON *it = get_any(obj, keys);
-    if (!it) return false;
+// groepsnaam komt in een topic terecht (Groups/<g>/State); te lang = afgekapt → fout
+static bool valid_group(const char *g) {
+    size_t n = strlen(g);
+    return n > 0 && n <= PARSER_GROUP_MAX && !strpbrk(g, "/+#");
+}
+
+static bool read_int_any(const jv_t *it, int *out, bool allow_percent, bool *was_percent) {
+    if (it->type == JV_NONE) return false;
     bool ok; int v = parse_int_like(it, allow_percent, was_percent, &ok);
-    if (!ok) {
-        if (path) *path = keys[0];
-        return false;
-    }
+    if (!ok) return false;
     *out = v;
-    if (path) *path = keys[0];
     return true;
 }
 
-static bool read_param_ms(const cJSON *root,
-                          const struct alias_ms *keys, size_t nkeys,
+// alle aliassen van een tijdsveld moeten (na unit-omrekening) dezelfde waarde geven
+static bool read_param_ms(const scan_t *S, alias_field_t f,
                           int min_ms, int max_ms,
                           const char *conflict_path,
                           bool *out_seen, int *out_ms,
-                          parser_result_t *R)
+                          parser_error_t *E)
 {
     int seen = 0, value_ms = 0;
 
-    for (size_t i = 0; i < nkeys; ++i) {
-        const cJSON *it = cJSON_GetObjectItemCaseSensitive(root, keys[i].name);
-        if (!it) continue;
+    for (size_t i = s_field_first[f]; i < s_field_end[f]; ++i) {
+        const jv_t *it = &S->slot[i];
+        if (it->type == JV_NONE) continue;
 
         bool ok=false, pct=false;
         int v = parse_int_like(it, false, &pct, &ok);
-        if (!ok) { set_error(R, PARSER_ERR_TYPE_MISMATCH, keys[i].path, "int expected"); return false; }
+        if (!ok) { set_error(E, PARSER_ERR_TYPE_MISMATCH, ALIASES[i].path, "int expected"); return false; }
 
-        int ms = v * keys[i].mult;
+        int ms = v * ALIASES[i].mult;
         if (seen && ms != value_ms) {
-            set_error(R, PARSER_ERR_CONFLICT, conflict_path, "conflicting values across aliases");
+            set_error(E, PARSER_ERR_CONFLICT, conflict_path, "conflicting values across aliases");
             return false;
         }
         value_ms = ms; seen = 1;
@@ -162,7 +486,7 @@ static bool read_param_ms(const cJSON *root,
     if (!seen) { *out_seen = false; return true; }  // niet opgegeven = OK
 
     if (value_ms < min_ms || value_ms > max_ms) {
-        set_error(R, PARSER_ERR_OUT_OF_RANGE, conflict_path, "out of range");
+        set_error(E, PARSER_ERR_OUT_OF_RANGE, conflict_path, "out of range");
         return false;
     }
     *out_seen = true;
@@ -171,54 +495,88 @@ static bool read_param_ms(const cJSON *root,
 }
 
 // "unknown key" lint helpers ---
-static bool in_strv(const char *k, const char *const *arr) {
-    for (size_t i = 0; arr[i]; ++i) if (!strcasecmp(k, arr[i])) return true;
-    return false;
+// "a,b": sleutel achteraan, afgekapt zodra de buffer vol is
+static void lint_append(char *out, size_t outsz, const char *k) {
+    size_t used = strlen(out);
+    if (used + 1 >= outsz) return;              // vol
+    if (used) out[used++] = ',';
+    size_t n = strlen(k);
+    if (n > outsz - used - 1) n = outsz - used - 1;
+    memcpy(out + used, k, n);
+    out[used + n] = '\0';
 }
-static bool in_alias_ms(const char *k, const struct alias_ms *arr, size_t n) {
-    for (size_t i = 0; i < n; ++i) if (!strcasecmp(k, arr[i].name)) return true;
-    return false;
+
+static void lint_unknown_key(const char *k, char *out, size_t outsz) {
+    if (!out) return;                           // lint uit (geen PARSER_F_DIAG)
+    if (alias_lookup(k) != ALIAS_NONE) return;  // bekende alias (hoofdletterongevoelig)
+    if (k[0] == '_') return;                    // sta private velden toe (bijv. _topic)
+    lint_append(out, outsz, k);
 }
-static bool is_known_top_key(const char *k) {
-    return
-        in_strv(k, ACTION_KEYS) || in_strv(k, TARGET_KEYS) ||
-        in_strv(k, IOKIND_KEYS) || in_strv(k, IOID_KEYS)   ||
-        in_strv(k, BRIGHT_KEYS) || in_strv(k, REPORT_KEYS) ||
-        in_strv(k, CORR_KEYS)   || in_strv(k, TOPIC_KEYS)  ||
-        in_alias_ms(k, DURATION_KEYS, ARRAY_SIZE(DURATION_KEYS)) ||
-        in_alias_ms(k, RAMP_KEYS_MS, ARRAY_SIZE(RAMP_KEYS_MS))   ||
-        in_alias_ms(k, DEBOUNCE_KEYS_MS, ARRAY_SIZE(DEBOUNCE_KEYS_MS));
-}
-static int collect_unknown_top_keys(const cJSON *root, char *out, size_t outsz) {
-    out[0] = '\0'; int count = 0;
-    for (const cJSON *it = root ? root->child : NULL; it; it = it->next) {
-        const char *k = it->string; if (!k) continue;
-        if (is_known_top_key(k)) continue;
-        if (k[0] == '_') continue;              // sta private velden toe (bijv. _topic)
-        size_t used = strlen(out);
-        if (used && used + 1 < outsz) { out[used++] = ','; out[used] = '\0'; }
-        if (used < outsz) strncat(out, k, outsz - used - 1);
-        count++;
-    }
-    return count;
+
+// Eén hash-lookup per sleutel; enkel exacte (hoofdlettergevoelige) namen vullen een
+// slot, en per rij telt het eerste voorkomen (zoals cJSON_GetObjectItemCaseSensitive).
+static void record_member(scan_t *S, const char *k, const jv_t *v) {
+    for (uint8_t i = alias_lookup(k); i != ALIAS_NONE; i = s_alias_next[i]) {
+        if (!strcmp(k, ALIASES[i].name) && S->slot[i].type == JV_NONE) S->slot[i] = *v;
+    }
+}
+
+// Scan één object (p op '{'); onthoudt enkel de eigen (top-level) aliassen.
+// cmds != NULL: de sleutel "cmds" wordt daar bewaard i.p.v. gelint (batch-envelop).
+// Retourneert de positie na '}' of NULL bij ongeldige JSON.
+static const char *scan_object(const char *p, unsigned depth, scan_t *S, jv_t *cmds,
+                               char *unknown, size_t unknown_sz) {
+    p = skip_ws(p + 1);
+    if (*p == '}') return p + 1;
+    for (;;) {
+        char key[128];                          // langere keys matchen nooit een alias; lint kapt toch af
+        jv_t v;
+        if (!(p = scan_key(p, key, sizeof(key))))  return NULL;
+        if (!(p = scan_value(p, depth + 1, &v)))   return NULL;
+        if (cmds && !strcmp(key, "cmds")) {
+            if (cmds->type == JV_NONE) *cmds = v;
+        } else {
+            record_member(S, key, &v);
+            lint_unknown_key(key, unknown, unknown_sz);
+        }
+        p = skip_ws(p);
+        if (*p == '}') return p + 1;
+        if (*p != ',') return NULL;
+        p = skip_ws(p + 1);
+    }
+}
+
+static const char *skip_bom_ws(const char *p) {
+    if (!strncmp(p, "\xEF\xBB\xBF", 3)) p += 3;
+    return skip_ws(p);
+}
+
+// Scan de volledige payload (valideert alles, onthoudt enkel top-level aliassen).
+// Een geldige root die geen object is levert gewoon geen velden op.
+static bool scan_payload(const char *json, scan_t *S, char *unknown, size_t unknown_sz) {
+    memset(S, 0, sizeof(*S));
+    if (unknown) unknown[0] = '\0';
+
+    const char *p = skip_bom_ws(json);
+    if (*p != '{') { jv_t v; return scan_value(p, 0, &v) != NULL; }
+    return scan_object(p, 0, S, NULL, unknown, unknown_sz) != NULL;
 }
 
 // --- enum parsers ---
-static bool parse_action_any(const cJSON *obj, action_t *out, const char **path) {
-    const cJSON *it = get_any(obj, ACTION_KEYS);
-    if (!it) return false;
+static bool parse_action_any(const jv_t *it, action_t *out, const char **path) {
+    if (it->type == JV_NONE) return false;
 
     bool bval;
     if (parse_bool_like(it, &bval)) {
         *out = bval ? ACT_ON : ACT_OFF;
-        if (path) *path = ACTION_KEYS[0];
+        if (path) *path = "action";
         return true;
     }
-    if (!cJSON_IsString(it) || !it->valuestring) {
-        if (path) *path = ACTION_KEYS[0];
+    if (it->type != JV_STRING) {
+        if (path) *path = "action";
         return false;
     }
-    char tmp[16]; snprintf(tmp, sizeof(tmp), "%s", it->valuestring); strtolower_inplace(tmp);
+    char tmp[16]; (void)jv_string(it, tmp, sizeof(tmp)); strtolower_inplace(tmp);
     if (!strcmp(tmp,"on"))      *out = ACT_ON;
     else if (!strcmp(tmp,"off"))*out = ACT_OFF;
     else if (!strcmp(tmp,"toggle")) *out = ACT_TOGGLE;
@@ -227,15 +585,13 @@ static bool parse_action_any(const cJSON *obj, action_t *out, const char **path)
     else if (!strcmp(tmp,"report")) *out = ACT_REPORT;
     else return false;
 
-    if (path) *path = ACTION_KEYS[0];
+    if (path) *path = "action";
     return true;
 }
 
-static bool parse_iokind_any(const cJSON *obj, io_kind_t *out) {
-    const cJSON *it = get_any(obj, IOKIND_KEYS);
-    if (!it) return false;
-    if (!cJSON_IsString(it) || !it->valuestring) return false;
-    char tmp[16]; snprintf(tmp, sizeof(tmp), "%s", it->valuestring); strtolower_inplace(tmp);
+static bool parse_iokind_any(const jv_t *it, io_kind_t *out) {
+    if (it->type != JV_STRING) return false;
+    char tmp[16]; (void)jv_string(it, tmp, sizeof(tmp)); strtolower_inplace(tmp);
     if (!strcmp(tmp,"relay")) *out = IO_RELAY;
     else if (!strcmp(tmp,"pwm")) *out = IO_PWM;
     else if (!strcmp(tmp,"input")) *out = IO_INPUT;
@@ -243,31 +599,35 @@ static bool parse_iokind_any(const cJSON *obj, io_kind_t *out) {
     return true;
 }
 
-static bool derive_iokind_from_hints(const cJSON *obj, action_t act, io_kind_t *out) {
+static bool derive_iokind_from_hints(const scan_t *S, action_t act, io_kind_t *out) {
     // eerst READ/REPORT → INPUT
-    if (act == ACT_READ || act == ACT_REPORT || get_any(obj, REPORT_KEYS)) { *out = IO_INPUT; return true; }
+    if (act == ACT_READ || act == ACT_REPORT || field_item(S, F_REPORT, NULL)->type != JV_NONE) { *out = IO_INPUT; return true; }
     // daarna brightness/duty → PWM
-    if (get_any(obj, BRIGHT_KEYS)) { *out = IO_PWM; return true; }
+    if (field_item(S, F_BRIGHT, NULL)->type != JV_NONE) { *out = IO_PWM; return true; }
     // anders veldnamen zoals relay/pin/gpio → RELAY
-    if (get_any(obj, IOID_KEYS)) { *out = IO_RELAY; return true; }
+    if (field_item(S, F_IOID, NULL)->type != JV_NONE) { *out = IO_RELAY; return true; }
     return false;
 }
 
 // corr-id
-static void gen_corr_id(char out[PARSER_CORR_MAX]) {
+corr_id_t parser_corr_new(void) {
+    static uint32_t salt, seq;
+    if (!salt) {
 #if defined(ESP_PLATFORM)
-    uint32_t r[4] = { esp_random(), esp_random(), esp_random(), esp_random() };
+        salt = esp_random() | 1u;
 #else
-    uint32_t r[4] = { (uint32_t)rand(), (uint32_t)rand(), (uint32_t)rand(), (uint32_t)rand() };
+        salt = (uint32_t)rand() | 1u;
 #endif
-    // gebruik PRI-macros zodat het op elke toolchain klopt
-    snprintf(out, PARSER_CORR_MAX,
-        "%08" PRIx32 "-%04" PRIx16 "-%04" PRIx16 "-%04" PRIx16 "-%08" PRIx32,
-        r[0],
-        (uint16_t)(r[1] & 0xFFFF),
-        (uint16_t)((r[1] >> 16) & 0xFFFF),
-        (uint16_t)(r[2] & 0xFFFF),
-        r[3]);
+    }
+    uint32_t n = __atomic_add_fetch(&seq, 1, __ATOMIC_RELAXED);
+    return ((corr_id_t)salt << 32) | n;
+}
+
+// nieuwe corr + éénmalige string-vorm voor de client (enkel als die er zelf geen gaf)
+static corr_id_t gen_corr_id(char out[PARSER_CORR_MAX]) {
+    corr_id_t c = parser_corr_new();
+    snprintf(out, PARSER_CORR_MAX, "%016" PRIx64, c);
+    return c;
 }
 
 // ------------ public helpers ------------
@@ -300,91 +660,103 @@ const char *parser_msgtype_str(msg_type_t t){
 }
 
 // ------------ API ------------
-void parser_init(void) { /* voor toekomstige lookups/tables */ }
-
-parser_result_t parser_parse(const char *json, const parser_meta_t *meta) {
-    parser_result_t R = {0};
-    R.ok = false;
-
-    if (!json) { set_error(&R, PARSER_ERR_INVALID_JSON, "root", "NULL input"); return R; }
-
-    cJSON *root = cJSON_Parse(json);
-    if (!root) { set_error(&R, PARSER_ERR_INVALID_JSON, "root", "JSON parse failed"); return R; }
+void parser_init(void) { alias_index_build(); }
 
-    // --- unknown keys ---
-    (void)collect_unknown_top_keys(root, R.unknown_keys, sizeof(R.unknown_keys));
-
-    // --- corr_id ---
-    if (!read_string(root, CORR_KEYS, R.msg.corr_id, sizeof(R.msg.corr_id))) {
-        gen_corr_id(R.msg.corr_id);
-        R.msg.meta.corr_generated = true;
-    }
+// Velden uit een gescand object → canonieke Msg (zelfde volgorde/foutpaden als voorheen).
+// topic: reeds bepaalde (geleende) topic_hint; corr_default: corr_id als het object er
+// zelf geen heeft (NULL = nieuwe genereren).
+static bool build_msg(const scan_t *S, const parser_meta_t *meta, const char *topic,
+                      const char *corr_default, bool corr_generated,
+                      parser_msg_t *M, parser_error_t *E)
+{
+    memset(M, 0, sizeof(*M));
 
-    // --- topic_hint (meta > payload) ---
-    if (meta && meta->topic_hint) {
-        snprintf(R.msg.topic_hint, sizeof(R.msg.topic_hint), "%s", meta->topic_hint);
+    // --- corr_id (binair altijd nieuw; string van de client, de batch of gegenereerd) ---
+    if (read_string(field_item(S, F_CORR, NULL), M->corr_id, sizeof(M->corr_id))) {
+        M->corr = parser_corr_new();
+    } else if (corr_default) {
+        snprintf(M->corr_id, sizeof(M->corr_id), "%s", corr_default);
+        M->corr = parser_corr_new();
+        M->meta.corr_generated = corr_generated;
     } else {
-        (void)read_string(root, TOPIC_KEYS, R.msg.topic_hint, sizeof(R.msg.topic_hint));
+        M->corr = gen_corr_id(M->corr_id);
+        M->meta.corr_generated = corr_generated;
     }
 
+    // --- topic_hint (geleend) ---
+    M->topic_hint = topic;
+
     // --- meta ---
-    R.msg.meta.source = meta ? meta->source : PARSER_SRC_LOCAL;
-    R.msg.meta.received_ts_ms = meta ? meta->received_ts_ms : 0;
+    M->meta.source = meta ? meta->source : PARSER_SRC_LOCAL;
+    M->meta.received_ts_ms = meta ? meta->received_ts_ms : 0;
 
-    // --- target_dev ---
-    if (!read_string(root, TARGET_KEYS, R.msg.target_dev, sizeof(R.msg.target_dev))) {
-        set_error(&R, PARSER_ERR_MISSING_FIELD, "target_dev", "expected non-empty string");
-        cJSON_Delete(root); return R;
-    }
-    if (R.msg.target_dev[0] == '\0') {
-        set_error(&R, PARSER_ERR_OUT_OF_RANGE, "target_dev", "empty");
-        cJSON_Delete(root); return R;
+    // --- target_dev of group (één van beide) ---
+    const jv_t *jg = field_item(S, F_GROUP, NULL);
+    if (jg->type != JV_NONE) {
+        if (field_item(S, F_TARGET, NULL)->type != JV_NONE) {
+            set_error(E, PARSER_ERR_CONFLICT, "group", "either target_dev or group");
+            return false;
+        }
+        char g[PARSER_GROUP_MAX + 2];   // één teken extra: te lange naam wordt zichtbaar
+        if (!read_string(jg, g, sizeof g) || !valid_group(g)) {
+            set_error(E, PARSER_ERR_OUT_OF_RANGE, "group", "expected name 1..15 chars, no '/', '+', '#'");
+            return false;
+        }
+        memcpy(M->group, g, sizeof M->group);
+    } else {
+        if (!read_string(field_item(S, F_TARGET, NULL), M->target_dev, sizeof(M->target_dev))) {
+            set_error(E, PARSER_ERR_MISSING_FIELD, "target_dev", "expected non-empty string");
+            return false;
+        }
+        if (M->target_dev[0] == '\0') {
+            set_error(E, PARSER_ERR_OUT_OF_RANGE, "target_dev", "empty");
+            return false;
+        }
     }
 
     // --- action ---
     action_t act;
-    if (!parse_action_any(root, &act, NULL)) {
-        set_error(&R, PARSER_ERR_INVALID_ENUM, "action", "allowed: ON/OFF/TOGGLE/SET/READ/REPORT");
-        cJSON_Delete(root); return R;
+    if (!parse_action_any(field_item(S, F_ACTION, NULL), &act, NULL)) {
+        set_error(E, PARSER_ERR_INVALID_ENUM, "action", "allowed: ON/OFF/TOGGLE/SET/READ/REPORT");
+        return false;
     }
-    R.msg.action = act;
+    M->action = act;
     // msg_type afleiden
-    R.msg.type = (act==ACT_READ) ? MSG_QUERY : (act==ACT_REPORT ? MSG_EVENT : MSG_COMMAND);
+    M->type = (act==ACT_READ) ? MSG_QUERY : (act==ACT_REPORT ? MSG_EVENT : MSG_COMMAND);
 
     // --- io_kind ---
     io_kind_t kind;
-    if (!parse_iokind_any(root, &kind)) {
-        if (!derive_iokind_from_hints(root, act, &kind)) {
-            set_error(&R, PARSER_ERR_INVALID_ENUM, "io_kind", "derive failed; provide io_kind");
-            cJSON_Delete(root); return R;
+    if (!parse_iokind_any(field_item(S, F_IOKIND, NULL), &kind)) {
+        if (!derive_iokind_from_hints(S, act, &kind)) {
+            set_error(E, PARSER_ERR_INVALID_ENUM, "io_kind", "derive failed; provide io_kind");
+            return false;
         }
     }
-    R.msg.io_kind = kind;
+    M->io_kind = kind;
 
     // --- io_id ---
     bool dummy_pct=false; int io_id = -1;
-    if (!read_int_any(root, IOID_KEYS, &io_id, NULL, false, &dummy_pct)) {
-        set_error(&R, PARSER_ERR_MISSING_FIELD, "io_id", "expected int 0..63");
-        cJSON_Delete(root); return R;
+    if (!read_int_any(field_item(S, F_IOID, NULL), &io_id, false, &dummy_pct)) {
+        set_error(E, PARSER_ERR_MISSING_FIELD, "io_id", "expected int 0..63");
+        return false;
     }
     if (io_id < 0 || io_id > 63) {
-        set_error(&R, PARSER_ERR_OUT_OF_RANGE, "io_id", "expected 0..63");
-        cJSON_Delete(root); return R;
+        set_error(E, PARSER_ERR_OUT_OF_RANGE, "io_id", "expected 0..63");
+        return false;
     }
-    R.msg.io_id = io_id;
+    M->io_id = io_id;
 
     // --- params normalisatie ---
-    R.msg.params = (parser_params_t){0};
+    M->params = (parser_params_t){0};
 
     // RELAY: duration*
     if (kind == IO_RELAY) {bool dur_seen=false; int dur_ms=0;
-        if (!read_param_ms(root, DURATION_KEYS, ARRAY_SIZE(DURATION_KEYS),
-                        0, 86400000, "params.duration", &dur_seen, &dur_ms, &R)) {
-            cJSON_Delete(root); return R;  // error gezet
+        if (!read_param_ms(S, F_DURATION, 0, 86400000, "params.duration", &dur_seen, &dur_ms, E)) {
+            return false;  // error gezet
         }
         if (dur_seen) {
-            R.msg.params.duration_ms = dur_ms;       // mag 0 zijn
-            R.msg.params.has_duration_ms = true;
+            M->params.duration_ms = dur_ms;       // mag 0 zijn
+            M->params.has_duration_ms = true;
         }
     }
 
@@ -392,55 +764,774 @@ parser_result_t parser_parse(const char *json, const parser_meta_t *meta) {
     if (kind == IO_PWM) {
         bool is_pct=false, ok=false;
         int b_val=0;
-        const cJSON *b_item = get_any(root, BRIGHT_KEYS);
-        if (b_item) {
+        size_t b_row = 0;
+        const jv_t *b_item = field_item(S, F_BRIGHT, &b_row);
+        if (b_item->type != JV_NONE) {
             b_val = parse_int_like(b_item, true, &is_pct, &ok);
-            if (!ok) { set_error(&R, PARSER_ERR_TYPE_MISMATCH, "params.brightness", "int or \"NN%\" expected"); cJSON_Delete(root); return R; }
+            if (!ok) { set_error(E, PARSER_ERR_TYPE_MISMATCH, "params.brightness", "int or \"NN%\" expected"); return false; }
             if (!is_pct) {
                 // duty 0..255? Detecteer op key-naam "duty"
-                const cJSON *duty_it = cJSON_GetObjectItemCaseSensitive(root,"duty");
-                if (duty_it == b_item) {
+                if (!strcmp(ALIASES[b_row].name, "duty")) {
                     // duty → pct
-                    if (b_val < 0 || b_val > 255) { set_error(&R, PARSER_ERR_OUT_OF_RANGE, "params.duty", "0..255"); cJSON_Delete(root); return R; }
+                    if (b_val < 0 || b_val > 255) { set_error(E, PARSER_ERR_OUT_OF_RANGE, "params.duty", "0..255"); return false; }
                     b_val = (int)((b_val * 100 + 127) / 255); // ronding
                 }
             }
-            if (b_val < 0 || b_val > 100) { set_error(&R, PARSER_ERR_OUT_OF_RANGE, "params.brightness_pct", "0..100"); cJSON_Delete(root); return R; }
-            R.msg.params.brightness_pct = b_val;
-            R.msg.params.has_brightness_pct = true;
+            if (b_val < 0 || b_val > 100) { set_error(E, PARSER_ERR_OUT_OF_RANGE, "params.brightness_pct", "0..100"); return false; }
+            M->params.brightness_pct = b_val;
+            M->params.has_brightness_pct = true;
         }
 
         bool ramp_seen=false; int ramp_ms=0;
-        if (!read_param_ms(root, RAMP_KEYS_MS, ARRAY_SIZE(RAMP_KEYS_MS),
-                        0, 60000, "params.ramp_ms", &ramp_seen, &ramp_ms, &R)) {
-            cJSON_Delete(root); return R;
+        if (!read_param_ms(S, F_RAMP, 0, 60000, "params.ramp_ms", &ramp_seen, &ramp_ms, E)) {
+            return false;
         }
         if (ramp_seen) {
-            R.msg.params.ramp_ms = ramp_ms;
-            R.msg.params.has_ramp_ms = true;
+            M->params.ramp_ms = ramp_ms;
+            M->params.has_ramp_ms = true;
         }
     }
 
     // INPUT: REPORT value (note: READ heeft geen value)
     if (kind == IO_INPUT) {
         if (act == ACT_REPORT) {
-            const cJSON *val = get_any(root, REPORT_KEYS);
-            if (!val) { set_error(&R, PARSER_ERR_MISSING_FIELD, "params.value", "required for REPORT"); cJSON_Delete(root); return R; }
+            if (field_item(S, F_REPORT, NULL)->type == JV_NONE) { set_error(E, PARSER_ERR_MISSING_FIELD, "params.value", "required for REPORT"); return false; }
         } else if (act == ACT_READ) {
             bool seen=false; int ms=0;
-            if (!read_param_ms(root, DEBOUNCE_KEYS_MS, ARRAY_SIZE(DEBOUNCE_KEYS_MS),
-                            0, 5000, "params.debounce_ms", &seen, &ms, &R)) {
-                cJSON_Delete(root); return R;
+            if (!read_param_ms(S, F_DEBOUNCE, 0, 5000, "params.debounce_ms", &seen, &ms, E)) {
+                return false;
             }
             if (seen) {
-                R.msg.params.debounce_ms = ms;
-                R.msg.params.has_debounce_ms = true;
+                M->params.debounce_ms = ms;
+                M->params.has_debounce_ms = true;
             }
         }
     }
 
+    // READ (elk io_kind): max. leeftijd van een antwoord uit de shadow-cache van de root
+    if (act == ACT_READ) {
+        bool seen=false; int ms=0;
+        if (!read_param_ms(S, F_MAXAGE, 0, 3600000, "params.max_age_ms", &seen, &ms, E)) {
+            return false;
+        }
+        if (seen) {
+            M->params.max_age_ms = ms;
+            M->params.has_max_age_ms = true;
+        }
+    }
+
     // --- done ---
-    R.ok = true;
-    cJSON_Delete(root);
-    return R;
+    return true;
+}
+
+// topic_hint: meta wint (geleend); anders uit de payload gedecodeerd in buf
+static const char *resolve_topic(const scan_t *S, const parser_meta_t *meta, char *buf, size_t bufsz) {
+    if (meta && meta->topic_hint) return meta->topic_hint;
+    buf[0] = '\0';
+    (void)read_string(field_item(S, F_TOPIC, NULL), buf, bufsz);
+    return buf;
+}
+
+// zonder PARSER_F_DIAG geen detailtekst (lint wordt dan ook niet uitgevoerd)
+static bool diag_on(const parser_meta_t *meta) {
+    return meta && (meta->flags & PARSER_F_DIAG);
+}
+
+// ------------ parse-cache (LRU) ------------
+// Sleutel: hash van (topic, payload-bytes) zonder de corr_id-waarde. Bij een treffer
+// wordt de bewaarde Msg gekopieerd en enkel corr/corr_id (en meta) opnieuw ingevuld.
+// Enkel vanuit de RX-taak (geen lock).
+#if PARSER_CACHE_SLOTS
+#define CACHE_NO_CORR 0xFFFFu
+
+typedef struct {
+    uint32_t     hash;                              // 0 = leeg
+    uint32_t     last_use;                          // LRU-tik
+    uint16_t     len;                               // payload-lengte zonder corr-waarde
+    uint16_t     pre;                               // offset van de corr-string (openende quote)
+    bool         meta_topic;                        // topic kwam uit meta (staat in topic[])
+    char         topic[PARSER_TOPIC_MAX];           // meta-topic, of de topic uit de payload
+    char         payload[PARSER_CACHE_PAYLOAD_MAX]; // payload zonder de corr-string
+    parser_msg_t msg;
+} cache_ent_t;
+
+static cache_ent_t s_cache[PARSER_CACHE_SLOTS];
+static uint32_t    s_cache_tick;
+static uint32_t    s_cache_hit, s_cache_miss;
+
+static uint32_t fnv1a(uint32_t h, const char *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)p[i]; h *= 16777619u; }
+    return h;
+}
+
+// hash over topic + payload met het stuk [cut, cut+cut_len) weggelaten; nooit 0
+static uint32_t cache_hash(const char *topic, const char *json, size_t len, size_t cut, size_t cut_len) {
+    uint32_t h = fnv1a(2166136261u, topic, strlen(topic) + 1);
+    h = fnv1a(h, json, cut);
+    h = fnv1a(h, json + cut + cut_len, len - cut - cut_len);
+    return h ? h : 1;
+}
+
+static bool cache_lookup(const char *json, const parser_meta_t *meta, parser_result_t *R) {
+    const char *mt = meta->topic_hint;
+    const size_t len = strlen(json);
+    uint16_t memo_pre = 0; uint32_t memo_h = 0; bool memo = false;
+
+    for (int i = 0; i < PARSER_CACHE_SLOTS; ++i) {
+        cache_ent_t *e = &s_cache[i];
+        if (!e->hash || e->meta_topic != (mt != NULL)) continue;
+
+        // corr-string op dezelfde plaats: enkel die mag verschillen
+        size_t cut = 0, cut_len = 0;
+        const char *ce = NULL;
+        if (e->pre != CACHE_NO_CORR) {
+            if (e->pre >= len || json[e->pre] != '"') continue;
+            if (!(ce = json_str_end(json + e->pre + 1))) continue;
+            cut = e->pre;
+            cut_len = (size_t)(ce + 1 - (json + e->pre));
+        }
+        if (len - cut_len != e->len) continue;
+
+        if (!memo || memo_pre != e->pre) {
+            memo_h = cache_hash(mt ? mt : "", json, len, cut, cut_len);
+            memo_pre = e->pre; memo = true;
+        }
+        if (memo_h != e->hash) continue;
+        if (memcmp(e->payload, json, cut) || memcmp(e->payload + cut, json + cut + cut_len, len - cut - cut_len)) continue;
+        if (mt && strcmp(e->topic, mt)) continue;
+
+        // nieuwe corr-string moet geldig zijn (anders was de payload ongeldig JSON)
+        parser_msg_t *M = &R->msg;
+        if (ce && json_str_decode(json + cut + 1, ce, NULL, 0) < 0) continue;
+        *M = e->msg;
+        if (ce) {
+            (void)json_str_decode(json + cut + 1, ce, M->corr_id, sizeof(M->corr_id));
+            M->corr = parser_corr_new();
+            M->meta.corr_generated = false;
+        } else {
+            M->corr = gen_corr_id(M->corr_id);
+            M->meta.corr_generated = true;
+        }
+        if (mt) {
+            M->topic_hint = mt;
+        } else {
+            memcpy(R->topic_buf, e->topic, sizeof(R->topic_buf));
+            M->topic_hint = R->topic_buf;
+        }
+        M->meta.source = meta->source;
+        M->meta.received_ts_ms = meta->received_ts_ms;
+
+        e->last_use = ++s_cache_tick;
+        STATS_LOCK(); s_cache_hit++; STATS_UNLOCK();
+        R->ok = true;
+        return true;
+    }
+    STATS_LOCK(); s_cache_miss++; STATS_UNLOCK();
+    return false;
+}
+
+static void cache_store(const char *json, const scan_t *S, const parser_meta_t *meta, const parser_result_t *R) {
+    const size_t len = strlen(json);
+    size_t cut = 0, cut_len = 0;
+    uint16_t pre = CACHE_NO_CORR;
+    const jv_t *c = field_item(S, F_CORR, NULL);
+    if (c->type == JV_STRING) {              // enkel een string-corr wordt vervangen
+        cut = (size_t)(c->raw - 1 - json);
+        cut_len = c->len + 2;
+        pre = (uint16_t)cut;
+    }
+    if (len - cut_len > PARSER_CACHE_PAYLOAD_MAX || cut >= CACHE_NO_CORR) return;
+
+    cache_ent_t *e = &s_cache[0];            // LRU (lege slots eerst)
+    for (int i = 1; i < PARSER_CACHE_SLOTS && e->hash; ++i)
+        if (!s_cache[i].hash || s_cache[i].last_use < e->last_use) e = &s_cache[i];
+
+    const char *mt = meta->topic_hint;
+    e->hash       = cache_hash(mt ? mt : "", json, len, cut, cut_len);
+    e->last_use   = ++s_cache_tick;
+    e->len        = (uint16_t)(len - cut_len);
+    e->pre        = pre;
+    e->meta_topic = (mt != NULL);
+    snprintf(e->topic, sizeof(e->topic), "%s", mt ? mt : R->topic_buf);
+    memcpy(e->payload, json, cut);
+    memcpy(e->payload + cut, json + cut + cut_len, len - cut - cut_len);
+    e->msg = R->msg;
+}
+#endif
+
+static bool parse_json(const char *json, const parser_meta_t *meta, parser_result_t *R) {
+    if (!R) return false;
+    R->ok = false;
+    R->msg.corr_id[0] = '\0';
+    R->unknown_keys[0] = '\0';
+    set_error(&R->error, PARSER_OK, NULL, NULL);
+
+    if (!json) { set_error(&R->error, PARSER_ERR_INVALID_JSON, "root", "NULL input"); return false; }
+    alias_index_build();    // no-op na parser_init()
+
+    const bool diag = diag_on(meta);
+#if PARSER_CACHE_SLOTS
+    const bool cached = !diag && meta && (meta->flags & PARSER_F_CACHE);
+    if (cached && cache_lookup(json, meta, R)) return true;
+#endif
+
+    // --- single pass: syntax + top-level aliassen (+ unknown keys bij diag) ---
+    scan_t S;
+    if (!scan_payload(json, &S, diag ? R->unknown_keys : NULL, sizeof(R->unknown_keys))) {
+        R->unknown_keys[0] = '\0';
+        set_error(&R->error, PARSER_ERR_INVALID_JSON, "root", "JSON parse failed");
+    } else {
+        const char *topic = resolve_topic(&S, meta, R->topic_buf, sizeof(R->topic_buf));
+        R->ok = build_msg(&S, meta, topic, NULL, true, &R->msg, &R->error);
+#if PARSER_CACHE_SLOTS
+        if (cached && R->ok) cache_store(json, &S, meta, R);
+#endif
+    }
+    if (!diag) R->error.detail = "";
+    return R->ok;
+}
+
+// ------------ batch (array of {"cmds":[...]}) ------------
+// Velden die een item niet zelf zet, erft het van de envelop (bv. gedeelde target_dev).
+// corr_id wordt nooit geërfd: items krijgen "<batch-corr>#<index>".
+static void inherit_fields(scan_t *item, const scan_t *env) {
+    for (int f = 0; f < F__COUNT; ++f) {
+        if (f == F_CORR || field_item(item, (alias_field_t)f, NULL)->type != JV_NONE) continue;
+        for (size_t i = s_field_first[f]; i < s_field_end[f]; ++i) item->slot[i] = env->slot[i];
+    }
+}
+
+// path blijft relatief aan het item; de caller zet er "cmds[<index>]." voor
+static void batch_item_error(parser_batch_t *B, unsigned idx, const parser_error_t *e) {
+    if (B->err_count >= PARSER_BATCH_MAX) return;
+    parser_item_error_t *ie = &B->errors[B->err_count++];
+    ie->index = (uint8_t)idx;
+    ie->error = *e;
+}
+
+bool parser_is_batch(const char *json) {
+    if (!json) return false;
+    const char *p = skip_bom_ws(json);
+    if (*p == '[') return true;
+    if (*p != '{') return false;
+
+    // enkel top-level sleutels bekijken; geneste waarden worden overgeslagen
+    p = skip_ws(p + 1);
+    while (*p == '"') {
+        char key[8];
+        jv_t v;
+        if (!(p = scan_key(p, key, sizeof(key))) || !(p = scan_value(p, 1, &v))) return false;
+        if (!strcmp(key, "cmds")) return true;
+        p = skip_ws(p);
+        if (*p != ',') return false;
+        p = skip_ws(p + 1);
+    }
+    return false;
+}
+
+static bool parse_batch(const char *json, const parser_meta_t *meta, parser_batch_t *B) {
+    if (!B) return false;
+    B->ok = false;
+    B->count = 0;
+    B->err_count = 0;
+    B->corr = 0;
+    B->corr_id[0] = '\0';
+    B->corr_generated = false;
+    B->topic_buf[0] = '\0';
+    B->unknown_keys[0] = '\0';
+    set_error(&B->error, PARSER_OK, NULL, NULL);
+
+    const bool diag = diag_on(meta);
+    if (!json) { set_error(&B->error, PARSER_ERR_INVALID_JSON, "root", "NULL input"); goto fail; }
+    alias_index_build();
+
+    // --- envelop: root-array of object met "cmds" ---
+    static scan_t env;      // enkel vanuit de MQTT-RX-taak; buiten de taakstack gehouden
+    static scan_t item;
+    memset(&env, 0, sizeof(env));
+    char *lint = diag ? B->unknown_keys : NULL;
+    jv_t cmds = { .type = JV_NONE };
+    const char *p = skip_bom_ws(json);
+    unsigned depth = 0;
+
+    if (*p == '{') {
+        p = scan_object(p, 0, &env, &cmds, lint, sizeof(B->unknown_keys));
+        depth = 1;
+    } else if (*p == '[') {
+        jv_t v;
+        if (scan_value(p, 0, &v)) cmds = v;
+        else p = NULL;
+    }
+    if (!p) {
+        B->unknown_keys[0] = '\0';
+        set_error(&B->error, PARSER_ERR_INVALID_JSON, "root", "JSON parse failed");
+        goto fail;
+    }
+    if (cmds.type != JV_ARRAY) {
+        set_error(&B->error, PARSER_ERR_MISSING_FIELD, "cmds", "expected array of commands");
+        goto fail;
+    }
+
+    // --- batch corr_id + topic (één keer, gedeeld door alle items) ---
+    bool corr_gen = false;
+    if (read_string(field_item(&env, F_CORR, NULL), B->corr_id, sizeof(B->corr_id))) {
+        B->corr = parser_corr_new();
+    } else {
+        B->corr = gen_corr_id(B->corr_id);
+        corr_gen = true;
+    }
+    B->corr_generated = corr_gen;
+    const char *topic = resolve_topic(&env, meta, B->topic_buf, sizeof(B->topic_buf));
+
+    // --- items (array is al gevalideerd door de envelop-scan) ---
+    p = skip_ws(cmds.raw + 1);
+    unsigned idx = 0;
+    while (*p != ']') {
+        parser_error_t E;
+        if (idx >= PARSER_BATCH_MAX) {
+            set_error(&B->error, PARSER_ERR_OUT_OF_RANGE, "cmds", "too many items");
+            B->count = 0;
+            B->err_count = 0;
+            goto fail;
+        }
+
+        memset(&item, 0, sizeof(item));
+        if (*p == '{') {
+            p = scan_object(p, depth + 1, &item, NULL, lint, sizeof(B->unknown_keys));
+            inherit_fields(&item, &env);
+
+            char corr[PARSER_CORR_MAX];
+            snprintf(corr, sizeof(corr), "%.*s#%u", PARSER_CORR_MAX - 5, B->corr_id, idx);
+            if (build_msg(&item, meta, topic, corr, corr_gen, &B->msg[B->count], &E)) {
+                B->index[B->count++] = (uint8_t)idx;
+            } else {
+                if (!diag) E.detail = "";
+                batch_item_error(B, idx, &E);
+            }
+        } else {
+            jv_t v;
+            p = scan_value(p, depth + 1, &v);
+            set_error(&E, PARSER_ERR_TYPE_MISMATCH, "", diag ? "object expected" : NULL);
+            batch_item_error(B, idx, &E);
+        }
+        idx++;
+
+        p = skip_ws(p);
+        if (*p == ',') p = skip_ws(p + 1);
+    }
+
+    if (idx == 0) {
+        set_error(&B->error, PARSER_ERR_OUT_OF_RANGE, "cmds", "empty");
+        goto fail;
+    }
+    B->ok = true;
+    return true;
+
+fail:
+    if (!diag) B->error.detail = "";
+    return false;
+}
+
+// ------------ binair formaat (MessagePack-subset) ------------
+// Eén map met korte sleutels, zie PARSER_BIN_* in parser.h. Zelfde validatie,
+// ranges en foutpaden als de JSON-weg; geen heap, geen cJSON.
+typedef struct { const uint8_t *p, *end; } mp_rd_t;
+
+typedef enum { MP_ERR = 0, MP_NIL, MP_BOOL, MP_INT, MP_FLOAT, MP_STR, MP_ARRAY, MP_MAP } mp_type_t;
+
+typedef struct {
+    mp_type_t      type;
+    int64_t        i;       // MP_INT / MP_BOOL
+    double         f;       // MP_FLOAT
+    const char    *s;       // MP_STR (niet 0-getermineerd)
+    uint32_t       n;       // MP_STR: lengte; MP_ARRAY/MP_MAP: aantal elementen
+} mp_val_t;
+
+static bool mp_take(mp_rd_t *r, size_t n, const uint8_t **out) {
+    if ((size_t)(r->end - r->p) < n) return false;
+    *out = r->p; r->p += n;
+    return true;
+}
+
+static uint64_t mp_be(const uint8_t *b, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i) v = (v << 8) | b[i];
+    return v;
+}
+
+// lees één element-header (containers: enkel de lengte, inhoud volgt)
+static mp_val_t mp_read(mp_rd_t *r) {
+    mp_val_t v = { .type = MP_ERR };
+    const uint8_t *b;
+    if (!mp_take(r, 1, &b)) return v;
+    uint8_t c = b[0];
+
+    if (c <= 0x7F)               { v.type = MP_INT; v.i = c; return v; }
+    if (c >= 0xE0)               { v.type = MP_INT; v.i = (int8_t)c; return v; }
+    if ((c & 0xF0) == 0x80)      { v.type = MP_MAP;   v.n = c & 0x0F; return v; }
+    if ((c & 0xF0) == 0x90)      { v.type = MP_ARRAY; v.n = c & 0x0F; return v; }
+    if ((c & 0xE0) == 0xA0)      { v.n = c & 0x1F; if (!mp_take(r, v.n, &b)) return v; v.type = MP_STR; v.s = (const char *)b; return v; }
+
+    size_t w;
+    switch (c) {
+        case 0xC0: v.type = MP_NIL; return v;
+        case 0xC2: case 0xC3: v.type = MP_BOOL; v.i = (c == 0xC3); return v;
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF:           // uint 8/16/32/64
+            w = (size_t)1 << (c - 0xCC);
+            if (!mp_take(r, w, &b)) return v;
+            v.i = (int64_t)mp_be(b, w);
+            if (v.i < 0) return v;                            // > INT64_MAX
+            v.type = MP_INT; return v;
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3: {         // int 8/16/32/64
+            w = (size_t)1 << (c - 0xD0);
+            if (!mp_take(r, w, &b)) return v;
+            uint64_t u = mp_be(b, w);
+            if (w < 8 && (u >> (w * 8 - 1))) u |= ~0ULL << (w * 8);   // sign-extend
+            v.type = MP_INT; v.i = (int64_t)u; return v;
+        }
+        case 0xCA: {                                           // float32
+            if (!mp_take(r, 4, &b)) return v;
+            uint32_t u = (uint32_t)mp_be(b, 4); float f; memcpy(&f, &u, 4);
+            v.type = MP_FLOAT; v.f = f; return v;
+        }
+        case 0xCB: {                                           // float64
+            if (!mp_take(r, 8, &b)) return v;
+            uint64_t u = mp_be(b, 8); double d; memcpy(&d, &u, 8);
+            v.type = MP_FLOAT; v.f = d; return v;
+        }
+        case 0xD9: case 0xDA: case 0xDB:                       // str 8/16/32
+        case 0xC4: case 0xC5: case 0xC6:                       // bin 8/16/32 (als string behandeld)
+            w = (size_t)1 << ((c >= 0xD9 ? c - 0xD9 : c - 0xC4));
+            if (!mp_take(r, w, &b)) return v;
+            v.n = (uint32_t)mp_be(b, w);
+            if (!mp_take(r, v.n, &b)) return v;
+            v.type = MP_STR; v.s = (const char *)b; return v;
+        case 0xDC: case 0xDD:                                  // array 16/32
+        case 0xDE: case 0xDF:                                  // map 16/32
+            w = (c == 0xDC || c == 0xDE) ? 2 : 4;
+            if (!mp_take(r, w, &b)) return v;
+            v.n = (uint32_t)mp_be(b, w);
+            v.type = (c >= 0xDE) ? MP_MAP : MP_ARRAY; return v;
+        default:
+            return v;                                          // ext-types e.d. niet ondersteund
+    }
+}
+
+// sla een (geneste) waarde over; iteratief met een teller van nog te lezen elementen
+static bool mp_skip(mp_rd_t *r, const mp_val_t *first) {
+    uint64_t todo = 0;
+    mp_val_t v = *first;
+    for (;;) {
+        if (v.type == MP_ERR) return false;
+        if (v.type == MP_ARRAY) todo += v.n;
+        if (v.type == MP_MAP)   todo += 2ull * v.n;
+        if (todo == 0) return true;
+        if (todo > (uint64_t)(r->end - r->p)) return false;    // elk element kost ≥1 byte
+        todo--;
+        v = mp_read(r);
+    }
+}
+
+static bool mp_int(const mp_val_t *v, int64_t *out) {
+    if (v->type == MP_INT || v->type == MP_BOOL) { *out = v->i; return true; }
+    if (v->type == MP_FLOAT && v->f > -1e15 && v->f < 1e15) { *out = (int64_t)v->f; return true; }  // zoals (int) in JSON-pad
+    return false;
+}
+
+static bool mp_key_is(const mp_val_t *k, const char *name) {
+    return k->type == MP_STR && k->n == strlen(name) && !memcmp(k->s, name, k->n);
+}
+
+static void bin_unknown_key(const mp_val_t *k, char *out, size_t outsz) {
+    char key[32];
+    if (k->type == MP_STR)      snprintf(key, sizeof(key), "%.*s", (int)(k->n < sizeof(key) ? k->n : sizeof(key) - 1), k->s);
+    else if (k->type == MP_INT) snprintf(key, sizeof(key), "#%d", (int)k->i);
+    else                        snprintf(key, sizeof(key), "#?");   // nil/float/container als sleutel
+    lint_append(out, outsz, key);
+}
+
+bool parser_is_bin(const uint8_t *buf, size_t len) {
+    if (!buf || !len) return false;
+    return (buf[0] & 0xF0) == 0x80 || buf[0] == 0xDE || buf[0] == 0xDF;   // fixmap / map16 / map32
+}
+
+// range-check van een optionele ms/pct-param
+static bool bin_param(parser_error_t *E, const mp_val_t *v, int lo, int hi, const char *path,
+                      int *out, bool *has) {
+    int64_t x;
+    if (v->type == MP_ERR) return true;                        // niet opgegeven
+    if (!mp_int(v, &x)) { set_error(E, PARSER_ERR_TYPE_MISMATCH, path, "int expected"); return false; }
+    if (x < lo || x > hi) { set_error(E, PARSER_ERR_OUT_OF_RANGE, path, "out of range"); return false; }
+    *out = (int)x; *has = true;
+    return true;
+}
+
+static bool parse_bin_map(const uint8_t *buf, size_t len, const parser_meta_t *meta, parser_result_t *R) {
+    char *lint = diag_on(meta) ? R->unknown_keys : NULL;
+
+    if (!buf) { set_error(&R->error, PARSER_ERR_INVALID_JSON, "root", "NULL input"); return false; }
+
+    mp_rd_t rd = { buf, buf + len };
+    mp_val_t root = mp_read(&rd);
+    if (root.type != MP_MAP) { set_error(&R->error, PARSER_ERR_INVALID_JSON, "root", "msgpack map expected"); return false; }
+
+    // eerste voorkomen per sleutel wint (zoals de JSON-weg)
+    enum { K_TARGET, K_GROUP, K_KIND, K_ID, K_ACTION, K_DUR, K_BRIGHT, K_RAMP, K_DEB, K_CORR, K_VALUE, K_MAXAGE, K__N };
+    static const char *const KEYS[K__N] = {
+        [K_TARGET] = PARSER_BIN_TARGET, [K_GROUP] = PARSER_BIN_GROUP, [K_KIND] = PARSER_BIN_IOKIND, [K_ID] = PARSER_BIN_IOID,
+        [K_ACTION] = PARSER_BIN_ACTION, [K_DUR] = PARSER_BIN_DURATION, [K_BRIGHT] = PARSER_BIN_BRIGHT,
+        [K_RAMP] = PARSER_BIN_RAMP, [K_DEB] = PARSER_BIN_DEBOUNCE, [K_CORR] = PARSER_BIN_CORR,
+        [K_VALUE] = PARSER_BIN_VALUE, [K_MAXAGE] = PARSER_BIN_MAXAGE,
+    };
+    mp_val_t F[K__N];
+    for (int k = 0; k < K__N; ++k) F[k].type = MP_ERR;
+
+    // onbekende sleutels en waarden mogen containers zijn (msgpack laat ook een map/array als
+    // sleutel toe): die worden per elementtelling overgeslagen, anders loopt de lezer scheef
+    for (uint32_t i = 0; i < root.n; ++i) {
+        mp_val_t key = mp_read(&rd);
+        if ((key.type == MP_ARRAY || key.type == MP_MAP) && !mp_skip(&rd, &key)) goto bad;
+        mp_val_t val = mp_read(&rd);
+        if (key.type == MP_ERR || val.type == MP_ERR) goto bad;
+        int k = 0;
+        while (k < K__N && !mp_key_is(&key, KEYS[k])) k++;
+        if (val.type == MP_ARRAY || val.type == MP_MAP) {
+            if (!mp_skip(&rd, &val)) goto bad;
+            if (k < K__N && F[k].type == MP_ERR) F[k] = val;   // fout type → hieronder gemeld
+        } else if (k < K__N) {
+            if (F[k].type == MP_ERR) F[k] = val;
+        }
+        if (k == K__N && lint) bin_unknown_key(&key, lint, sizeof(R->unknown_keys));
+    }
+
+    // --- corr_id ---
+    if (F[K_CORR].type == MP_STR && F[K_CORR].n) {
+        snprintf(R->msg.corr_id, sizeof(R->msg.corr_id), "%.*s", (int)F[K_CORR].n, F[K_CORR].s);
+        R->msg.corr = parser_corr_new();
+    } else {
+        R->msg.corr = gen_corr_id(R->msg.corr_id);
+        R->msg.meta.corr_generated = true;
+    }
+
+    // --- topic_hint + meta ---
+    R->msg.topic_hint = (meta && meta->topic_hint) ? meta->topic_hint : "";
+    R->msg.meta.source = meta ? meta->source : PARSER_SRC_LOCAL;
+    R->msg.meta.received_ts_ms = meta ? meta->received_ts_ms : 0;
+
+    // --- target_dev of group ---
+    if (F[K_GROUP].type != MP_ERR) {
+        if (F[K_TARGET].type != MP_ERR) { set_error(&R->error, PARSER_ERR_CONFLICT, "group", "either target_dev or group"); return false; }
+        if (F[K_GROUP].type == MP_STR && F[K_GROUP].n < sizeof(R->msg.group))
+            snprintf(R->msg.group, sizeof(R->msg.group), "%.*s", (int)F[K_GROUP].n, F[K_GROUP].s);
+        if (!valid_group(R->msg.group)) { set_error(&R->error, PARSER_ERR_OUT_OF_RANGE, "group", "expected name 1..15 chars, no '/', '+', '#'"); return false; }
+    } else {
+        if (F[K_TARGET].type != MP_STR) { set_error(&R->error, PARSER_ERR_MISSING_FIELD, "target_dev", "expected non-empty string"); return false; }
+        if (F[K_TARGET].n == 0)         { set_error(&R->error, PARSER_ERR_OUT_OF_RANGE, "target_dev", "empty"); return false; }
+        snprintf(R->msg.target_dev, sizeof(R->msg.target_dev), "%.*s", (int)F[K_TARGET].n, F[K_TARGET].s);
+    }
+
+    // --- action (enum-waarde, zie action_t) ---
+    int64_t x;
+    if (!mp_int(&F[K_ACTION], &x) || x < ACT_ON || x > ACT_REPORT) {
+        set_error(&R->error, PARSER_ERR_INVALID_ENUM, "action", "allowed: ON/OFF/TOGGLE/SET/READ/REPORT");
+        return false;
+    }
+    action_t act = (action_t)x;
+    R->msg.action = act;
+    R->msg.type = (act==ACT_READ) ? MSG_QUERY : (act==ACT_REPORT ? MSG_EVENT : MSG_COMMAND);
+
+    // --- io_kind (enum-waarde; ontbreekt → afleiden zoals JSON) ---
+    io_kind_t kind;
+    if (F[K_KIND].type != MP_ERR) {
+        if (!mp_int(&F[K_KIND], &x) || x < IO_RELAY || x > IO_INPUT) {
+            set_error(&R->error, PARSER_ERR_INVALID_ENUM, "io_kind", "allowed: 0=RELAY 1=PWM 2=INPUT");
+            return false;
+        }
+        kind = (io_kind_t)x;
+    } else if (act == ACT_READ || act == ACT_REPORT || F[K_VALUE].type != MP_ERR) {
+        kind = IO_INPUT;
+    } else if (F[K_BRIGHT].type != MP_ERR) {
+        kind = IO_PWM;
+    } else if (F[K_ID].type != MP_ERR) {
+        kind = IO_RELAY;
+    } else {
+        set_error(&R->error, PARSER_ERR_INVALID_ENUM, "io_kind", "derive failed; provide io_kind");
+        return false;
+    }
+    R->msg.io_kind = kind;
+
+    // --- io_id ---
+    if (!mp_int(&F[K_ID], &x)) { set_error(&R->error, PARSER_ERR_MISSING_FIELD, "io_id", "expected int 0..63"); return false; }
+    if (x < 0 || x > 63)       { set_error(&R->error, PARSER_ERR_OUT_OF_RANGE, "io_id", "expected 0..63"); return false; }
+    R->msg.io_id = (int)x;
+
+    // --- params (enkel relevant per io_kind, zoals JSON) ---
+    parser_params_t *P = &R->msg.params;
+    if (kind == IO_RELAY &&
+        !bin_param(&R->error, &F[K_DUR], 0, 86400000, "params.duration", &P->duration_ms, &P->has_duration_ms)) return false;
+    if (kind == IO_PWM) {
+        if (!bin_param(&R->error, &F[K_BRIGHT], 0, 100, "params.brightness_pct", &P->brightness_pct, &P->has_brightness_pct)) return false;
+        if (!bin_param(&R->error, &F[K_RAMP], 0, 60000, "params.ramp_ms", &P->ramp_ms, &P->has_ramp_ms)) return false;
+    }
+    if (kind == IO_INPUT) {
+        if (act == ACT_REPORT && F[K_VALUE].type == MP_ERR) {
+            set_error(&R->error, PARSER_ERR_MISSING_FIELD, "params.value", "required for REPORT"); return false;
+        }
+        if (act == ACT_READ &&
+            !bin_param(&R->error, &F[K_DEB], 0, 5000, "params.debounce_ms", &P->debounce_ms, &P->has_debounce_ms)) return false;
+    }
+    if (act == ACT_READ &&
+        !bin_param(&R->error, &F[K_MAXAGE], 0, 3600000, "params.max_age_ms", &P->max_age_ms, &P->has_max_age_ms)) return false;
+
+    return true;
+
+bad:
+    R->unknown_keys[0] = '\0';
+    set_error(&R->error, PARSER_ERR_INVALID_JSON, "root", "msgpack decode failed");
+    return false;
+}
+
+static bool parse_bin(const uint8_t *buf, size_t len, const parser_meta_t *meta, parser_result_t *R) {
+    if (!R) return false;
+    memset(&R->msg, 0, sizeof(R->msg));
+    R->unknown_keys[0] = '\0';
+    R->topic_buf[0] = '\0';
+    set_error(&R->error, PARSER_OK, NULL, NULL);
+    R->ok = parse_bin_map(buf, len, meta, R);
+    if (!diag_on(meta)) R->error.detail = "";
+    return R->ok;
+}
+
+// --- encoder (zelfde subset; voor tests/tools en compacte doorgifte) ---
+typedef struct { uint8_t *p, *end; bool ok; } mp_wr_t;
+
+static void mp_put(mp_wr_t *w, const void *b, size_t n) {
+    if (!w->ok || (size_t)(w->end - w->p) < n) { w->ok = false; return; }
+    memcpy(w->p, b, n); w->p += n;
+}
+static void mp_put_uint(mp_wr_t *w, uint32_t v) {
+    uint8_t b[5];
+    if (v <= 0x7F)        { b[0] = (uint8_t)v; mp_put(w, b, 1); }
+    else if (v <= 0xFF)   { b[0] = 0xCC; b[1] = (uint8_t)v; mp_put(w, b, 2); }
+    else if (v <= 0xFFFF) { b[0] = 0xCD; b[1] = (uint8_t)(v >> 8); b[2] = (uint8_t)v; mp_put(w, b, 3); }
+    else { b[0] = 0xCE; b[1] = (uint8_t)(v >> 24); b[2] = (uint8_t)(v >> 16); b[3] = (uint8_t)(v >> 8); b[4] = (uint8_t)v; mp_put(w, b, 5); }
+}
+static void mp_put_str(mp_wr_t *w, const char *s) {
+    size_t n = strlen(s);
+    uint8_t h[2];
+    if (n <= 31) { h[0] = (uint8_t)(0xA0 | n); mp_put(w, h, 1); }
+    else         { h[0] = 0xD9; h[1] = (uint8_t)(n > 255 ? 255 : n); n = h[1]; mp_put(w, h, 2); }
+    mp_put(w, s, n);
+}
+static void mp_put_kv_uint(mp_wr_t *w, const char *k, uint32_t v) { mp_put_str(w, k); mp_put_uint(w, v); }
+
+size_t parser_encode_bin(const parser_msg_t *m, uint8_t *out, size_t outsz) {
+    if (!m || !out) return 0;
+    const parser_params_t *P = &m->params;
+    bool report = m->io_kind == IO_INPUT && m->action == ACT_REPORT;   // waarde zit niet in de Msg
+    uint8_t n = 4 + (m->corr_id[0] ? 1 : 0) + report
+              + P->has_duration_ms + P->has_brightness_pct + P->has_ramp_ms + P->has_debounce_ms
+              + P->has_max_age_ms;
+
+    mp_wr_t w = { out, out + outsz, true };
+    uint8_t h = (uint8_t)(0x80 | n);
+    mp_put(&w, &h, 1);
+    if (m->group[0]) { mp_put_str(&w, PARSER_BIN_GROUP);  mp_put_str(&w, m->group); }
+    else             { mp_put_str(&w, PARSER_BIN_TARGET); mp_put_str(&w, m->target_dev); }
+    mp_put_kv_uint(&w, PARSER_BIN_IOKIND, (uint32_t)m->io_kind);
+    mp_put_kv_uint(&w, PARSER_BIN_IOID,   (uint32_t)m->io_id);
+    mp_put_kv_uint(&w, PARSER_BIN_ACTION, (uint32_t)m->action);
+    if (P->has_duration_ms)    mp_put_kv_uint(&w, PARSER_BIN_DURATION, (uint32_t)P->duration_ms);
+    if (P->has_brightness_pct) mp_put_kv_uint(&w, PARSER_BIN_BRIGHT,   (uint32_t)P->brightness_pct);
+    if (P->has_ramp_ms)        mp_put_kv_uint(&w, PARSER_BIN_RAMP,     (uint32_t)P->ramp_ms);
+    if (P->has_debounce_ms)    mp_put_kv_uint(&w, PARSER_BIN_DEBOUNCE, (uint32_t)P->debounce_ms);
+    if (P->has_max_age_ms)     mp_put_kv_uint(&w, PARSER_BIN_MAXAGE,   (uint32_t)P->max_age_ms);
+    if (report)                { static const uint8_t nil = 0xC0; mp_put_str(&w, PARSER_BIN_VALUE); mp_put(&w, &nil, 1); }
+    if (m->corr_id[0])         { mp_put_str(&w, PARSER_BIN_CORR); mp_put_str(&w, m->corr_id); }
+    return w.ok ? (size_t)(w.p - out) : 0;
+}
+
+// ------------ statistiek + publieke ingangen ------------
+#if PARSER_STATS
+static parser_stats_t s_stats;   // onder STATS_LOCK
+
+// ns-resolutie: een parse duurt tientallen µs, esp_timer telt in µs. Op het doel dus de
+// cyclusteller; die loopt per core, dus bij een core-wissel tussendoor de µs-klok.
+typedef struct {
+#if PARSER_ON_CHIP
+    int64_t  us;
+    uint32_t cyc;
+    int      core;
+#else
+    int64_t  ns;
+#endif
+} stats_clk_t;
+
+static inline stats_clk_t stats_clk(void) {
+    stats_clk_t t;
+#if PARSER_ON_CHIP
+    t.core = xPortGetCoreID();
+    t.cyc  = esp_cpu_get_cycle_count();
+    t.us   = esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t.ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return t;
+}
+
+static inline uint32_t stats_ns(stats_clk_t t0) {
+    stats_clk_t t1 = stats_clk();
+#if PARSER_ON_CHIP
+    if (t1.core == t0.core)
+        return (uint32_t)((uint64_t)(uint32_t)(t1.cyc - t0.cyc) * 1000u / esp_rom_get_cpu_ticks_per_us());
+    return (uint32_t)(t1.us - t0.us) * 1000u;
+#else
+    return (uint32_t)(t1.ns - t0.ns);
+#endif
+}
+
+static inline bool stats_add(stats_clk_t t0, bool ok) {
+    uint32_t ns = stats_ns(t0), us = ns / 1000u;
+    STATS_LOCK();
+    s_stats.n++;
+    if (!ok) s_stats.n_err++;
+    s_stats.total_ns += ns;
+    if (us > s_stats.max_us) s_stats.max_us = us;
+    STATS_UNLOCK();
+    return ok;
+}
+#define STATS_WRAP(call)  do { stats_clk_t t0_ = stats_clk(); return stats_add(t0_, (call)); } while (0)
+#else
+#define STATS_WRAP(call)  return (call)
+#endif
+
+void parser_stats_get(parser_stats_t *out, bool reset) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    STATS_LOCK();   // één snapshot: geen bericht dat tussen lezen en nullen verloren gaat
+#if PARSER_STATS
+    *out = s_stats;
+    if (reset) memset(&s_stats, 0, sizeof(s_stats));
+#endif
+#if PARSER_CACHE_SLOTS
+    out->cache_hit  = s_cache_hit;
+    out->cache_miss = s_cache_miss;
+    if (reset) s_cache_hit = s_cache_miss = 0;
+#endif
+    STATS_UNLOCK();
+    (void)reset;
+}
+
+bool parser_parse(const char *json, const parser_meta_t *meta, parser_result_t *out) {
+    STATS_WRAP(parse_json(json, meta, out));
+}
+
+bool parser_parse_batch(const char *json, const parser_meta_t *meta, parser_batch_t *out) {
+    STATS_WRAP(parse_batch(json, meta, out));
+}
+
+bool parser_parse_bin(const uint8_t *buf, size_t len, const parser_meta_t *meta, parser_result_t *out) {
+    STATS_WRAP(parse_bin(buf, len, meta, out));
 }
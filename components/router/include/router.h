@@ -15,7 +15,8 @@ typedef enum {
   ROUTER_ERR_OUT_OF_RANGE,
   ROUTER_ERR_NO_ROUTE,
   ROUTER_ERR_TIMEOUT,
-  ROUTER_ERR_INTERNAL
+  ROUTER_ERR_INTERNAL,
+  ROUTER_ERR_BUSY          // lane vol
 } router_status_t;
 
 // Publish naar MQTT (bv. mqtt_link_publish_cb)
@@ -36,7 +37,69 @@ typedef struct {
 // API
 void            router_init(const router_cbs_t *cbs);
 void            router_set_local_dev(const char *dev_name);
+// Zet het commando in de lane van zijn klasse (zie router_classify); de router-taak
+// voert uit/verstuurt. Retourneert ROUTER_OK (aanvaard) of ROUTER_ERR_BUSY (lane vol).
 router_status_t router_handle(const parser_msg_t *msg);
+// Batch: lokaal items uitvoeren → één State; per remote child één mesh-frame
+// ("cmds"-payload) → child antwoordt met één gebundeld EVENT. Retourneert de
+// eerste lokale fout (remote resultaten volgen asynchroon). Blokkeert tot de router-taak
+// de batch verwerkt heeft; mag vanuit meerdere taken.
+router_status_t router_handle_batch(const parser_batch_t *batch);
+
+// Coalescing: remote commando's per doeltoestel binnen het venster → één "cmds"-frame.
+// PWM SET op hetzelfde kanaal: laatste waarde wint (de vorige krijgt State "SUPERSEDED").
+typedef struct {
+  uint32_t cmds;       // remote commando's via het venster
+  uint32_t frames;     // mesh-frames daarvoor verstuurd (uitgespaard = cmds - frames)
+  uint32_t collapsed;  // overschreven PWM-setpoints
+} router_coalesce_stats_t;
+
+void router_set_coalesce_ms(uint32_t window_ms);   // 0 = uit (default ROUTER_COALESCE_MS)
+void router_coalesce_stats_get(router_coalesce_stats_t *out, bool reset);
+
+// Idempotency: een herhaalde corr_id (QoS1-herlevering, mesh-retransmit) wordt niet
+// opnieuw uitgevoerd; het bewaarde antwoord gaat opnieuw uit (ROUTER_DEDUP_TTL_MS).
+typedef struct {
+  uint32_t dups;       // duplicaten niet uitgevoerd
+  uint32_t replayed;   // bewaarde State/EVENT opnieuw verstuurd
+} router_dedup_stats_t;
+
+void router_dedup_stats_get(router_dedup_stats_t *out, bool reset);
+
+// Priority lanes: per klasse een begrensde queue, strikte prioriteit (SAFETY eerst) met
+// starvation-bescherming: na ROUTER_LANE_BURST opeenvolgende beurten voor een hogere
+// klasse krijgt een wachtende lagere klasse één beurt. De klasse reist mee in de
+// mesh-envelop zodat de child in dezelfde volgorde uitvoert.
+#define ROUTER_LANES        4   // ML_PRIO_SAFETY .. ML_PRIO_READ
+#define ROUTER_LAT_BUCKETS  10
+#define ROUTER_LAT_EDGES_MS { 1, 2, 5, 10, 20, 50, 100, 200, 500 }   // laatste bucket: >= 500 ms
+
+typedef struct {
+  uint32_t n;                          // uitgevoerd
+  uint32_t dropped;                    // lane vol
+  uint32_t max_us;
+  uint32_t hist[ROUTER_LAT_BUCKETS];   // enqueue → klaar (wachttijd + uitvoering/overdracht)
+} router_lane_stats_t;
+
+mesh_prio_t router_classify(const parser_msg_t *m);   // READ/REPORT → READ, OFF → SAFETY, relay → SWITCH, PWM → SETPOINT, rest → READ
+void        router_lane_stats_get(router_lane_stats_t out[ROUTER_LANES], bool reset);
+
+// Shadow-state (root): laatst gekende waarde per child/kanaal uit de EVENTs (relay 0/1,
+// PWM-pct, input 0/1). READs naar een child met params.max_age_ms worden hieruit beantwoord
+// zolang de waarde niet ouder is; zonder max_age_ms (of 0) gaat de READ live via de mesh.
+#define ROUTER_SHADOW_TOPIC "Mesh/Shadow"   // retained snapshot voor dashboards
+
+bool router_shadow_get(const char *dev, io_kind_t kind, int io_id, uint32_t max_age_ms,
+                       int *val, uint32_t *age_ms);
+
+// Groepen (fan-out): Cmd/Set met "group" i.p.v. target_dev → één mesh-groepsframe naar
+// alle leden. De root bundelt de EVENTs van de leden tot één State op
+// ROUTER_GROUP_TOPIC_FMT: status OK/PARTIAL/ERROR, "items" per lid, "missing" voor leden
+// die niet binnen ROUTER_GROUP_WAIT_MS antwoorden. Lidmaatschap: uit de HELLO van elk
+// toestel; de root registreert zichzelf met router_set_groups().
+#define ROUTER_GROUP_TOPIC_FMT "Groups/%s/State"
+
+void router_set_groups(const char *dev, const char *const *groups, int n);   // vervangt de vorige set van dev
 
 void router_handle_mesh_request(const mesh_envelope_t *req);
 void router_handle_mesh_event(const mesh_envelope_t *evt);
@@ -46,10 +109,11 @@ void router_send_cmd_to_target(const char *target_dev,
                                const char *origin_set_topic,
                                mesh_kind_t kind,
                                const cJSON *payload,
-                               uint32_t corr_id);
+                               corr_id_t corr_id,
+                               mesh_prio_t prio);
 
 // voor drivers die EVENT willen uitsturen (child)
-void router_emit_event(mesh_kind_t kind, uint32_t corr_id,
+void router_emit_event(mesh_kind_t kind, corr_id_t corr_id,
                        const char *origin_set_topic, const cJSON *state_payload);
 
 // (mag ook in .h staan; of laat hem 'extern' weg en maak hem static in router.c)
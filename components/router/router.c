@@ -1,25 +1,279 @@
 #include "router.h"
 #include <string.h>
 #include "mesh_link.h"
-#include "mqtt_link.h" 
 #include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
 #include <string.h>
 #include "cJSON.h"
+#include "json_wr.h"
+#include "lat_trace.h"
 #include "parser.h"
 #include <strings.h>   // strcasecmp
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 static router_cbs_t CB;
 static char g_local_dev[32] = "ESP32_ROOT"; // pas evt. aan jouw lengte aan
 
-// helper: 32-bit corr_id uit string (FNV-1a)
-static uint32_t corr_id_u32(const char *s){
+// ---------- corr-tabel (root) ----------
+// Binaire corr → client-string + verzendtijd. Het EVENT van de child brengt de corr
+// terug; de root zet de originele corr_id en de round-trip in de State.
+#ifndef ROUTER_CORR_SLOTS
+#define ROUTER_CORR_SLOTS 16
+#endif
+#ifndef ROUTER_MESH_TIMEOUT_MS
+#define ROUTER_MESH_TIMEOUT_MS 1000   // leverings-ACK van de child (niet de uitvoering)
+#endif
+
+typedef struct {
+    corr_id_t id;                 // 0 = vrij
+    corr_id_t frame;              // coalesced item: corr van het frame (0 = eigen frame)
+    int64_t   sent_us;
+    char      dev[32];            // batch: zelfde corr naar meerdere children
+    char      str[PARSER_CORR_MAX];
+} corr_slot_t;
+
+static corr_slot_t  s_corr[ROUTER_CORR_SLOTS];
+static unsigned     s_corr_next;  // ring: bij vol wordt de oudste overschreven
+static portMUX_TYPE s_corr_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void corr_remember_in(corr_id_t id, corr_id_t frame, const char *dev, const char *str){
+    if (!id) return;
+    portENTER_CRITICAL(&s_corr_mux);
+    corr_slot_t *c = &s_corr[s_corr_next++ % ROUTER_CORR_SLOTS];
+    c->id = id;
+    c->frame = frame;
+    c->sent_us = esp_timer_get_time();
+    snprintf(c->dev, sizeof c->dev, "%s", dev ? dev : "");
+    snprintf(c->str, sizeof c->str, "%s", str ? str : "");
+    portEXIT_CRITICAL(&s_corr_mux);
+}
+
+static void corr_remember(corr_id_t id, const char *dev, const char *str){
+    corr_remember_in(id, 0, dev, str);
+}
+
+// haalt de entry (id + child) op én geeft hem vrij; str/rtt_ms mogen NULL zijn (enkel vrijgeven)
+static bool corr_take(corr_id_t id, const char *dev, char *str, size_t n, uint32_t *rtt_ms){
+    if (!id) return false;
+    bool found = false;
+    portENTER_CRITICAL(&s_corr_mux);
+    for (int i = 0; i < ROUTER_CORR_SLOTS; ++i) {
+        corr_slot_t *c = &s_corr[i];
+        if (c->id != id) continue;
+        if (dev && c->dev[0] && strcmp(c->dev, dev) != 0) continue;
+        if (str)    snprintf(str, n, "%s", c->str);
+        if (rtt_ms) *rtt_ms = (uint32_t)((esp_timer_get_time() - c->sent_us) / 1000);
+        c->id = 0;
+        found = true;
+        break;
+    }
+    portEXIT_CRITICAL(&s_corr_mux);
+    return found;
+}
+
+// volgend item dat mee in het frame van `frame` zat (EVENT of fout geldt voor het hele frame)
+static bool corr_take_sibling(corr_id_t frame, const char *dev, corr_id_t *id, char *str, size_t n){
+    if (!frame) return false;
+    bool found = false;
+    portENTER_CRITICAL(&s_corr_mux);
+    for (int i = 0; i < ROUTER_CORR_SLOTS; ++i) {
+        corr_slot_t *c = &s_corr[i];
+        if (!c->id || c->frame != frame) continue;
+        if (dev && c->dev[0] && strcmp(c->dev, dev) != 0) continue;
+        *id = c->id;
+        if (str) snprintf(str, n, "%s", c->str);
+        c->id = 0;
+        found = true;
+        break;
+    }
+    portEXIT_CRITICAL(&s_corr_mux);
+    return found;
+}
+
+// binaire corr als dedup-sleutel op de child (zelfde vorm als gegenereerde corr_id's)
+static void corr_hex(corr_id_t id, char out[17]){
+    snprintf(out, 17, "%016" PRIx64, id);
+}
+
+// ---------- idempotency: corr_id-dedup ----------
+// Cmd/Set is QoS1: na een reconnect kan de broker opnieuw afleveren, en de mesh kan een
+// REQUEST herhalen. Per (corr_id, uitvoerend toestel) één entry in een ring met hash-index
+// en TTL. Een duplicaat wordt niet opnieuw uitgevoerd: het bewaarde antwoord (root: State,
+// child: EVENT) gaat opnieuw uit; is er nog geen antwoord, dan wordt het stil genegeerd.
+#ifndef ROUTER_DEDUP_SLOTS
+#define ROUTER_DEDUP_SLOTS  16      // 0 = uit; max. 254
+#endif
+#ifndef ROUTER_DEDUP_TTL_MS
+#define ROUTER_DEDUP_TTL_MS 60000
+#endif
+#ifndef ROUTER_DEDUP_BODY
+#define ROUTER_DEDUP_BODY   256     // langer antwoord: duplicaat wordt genegeerd i.p.v. herhaald
+#endif
+
+static router_dedup_stats_t s_dd_stats;
+
+#if ROUTER_DEDUP_SLOTS
+#define DD_BUCKETS (ROUTER_DEDUP_SLOTS * 2)
+#define DD_NONE    0xFF
+
+typedef struct {
+    int64_t  t_us;                      // 0 = vrij
+    uint32_t hash;
+    uint8_t  next;                      // keten binnen de bucket
+    uint8_t  kind;                      // child: mesh_kind_t van het EVENT
+    bool     done;                      // antwoord gezien
+    char     corr[PARSER_CORR_MAX];
+    char     dev[32];
+    char     topic[PARSER_TOPIC_MAX];   // root: State-topic; child: origin_set_topic
+    char     body[ROUTER_DEDUP_BODY];   // "" = geen (nog niet / te groot)
+} dd_slot_t;
+
+static dd_slot_t         s_dd[ROUTER_DEDUP_SLOTS];
+static uint8_t           s_dd_bucket[DD_BUCKETS];
+static unsigned          s_dd_next;     // ring: de oudste wordt overschreven
+static SemaphoreHandle_t s_dd_lock;
+
+static uint32_t dd_hash(const char *corr){
     uint32_t h = 2166136261u;
-    if (!s) return h;
-    for (; *s; s++){ h ^= (uint8_t)*s; h *= 16777619u; }
+    while (*corr) { h ^= (uint8_t)*corr++; h *= 16777619u; }
     return h;
 }
 
+static bool dd_live(const dd_slot_t *d, int64_t now){
+    return d->t_us && now - d->t_us < (int64_t)ROUTER_DEDUP_TTL_MS * 1000;
+}
+
+static void dd_unlink_unsafe(unsigned i){
+    uint8_t *pp = &s_dd_bucket[s_dd[i].hash % DD_BUCKETS];
+    while (*pp != DD_NONE && *pp != i) pp = &s_dd[*pp].next;
+    if (*pp == i) *pp = s_dd[i].next;
+    s_dd[i].t_us = 0;
+}
+
+// dev == NULL: eender welk toestel
+static int dd_find_unsafe(const char *corr, const char *dev, int64_t now){
+    uint32_t h = dd_hash(corr);
+    for (uint8_t i = s_dd_bucket[h % DD_BUCKETS]; i != DD_NONE; i = s_dd[i].next) {
+        const dd_slot_t *d = &s_dd[i];
+        if (d->hash != h || !dd_live(d, now) || strcmp(d->corr, corr)) continue;
+        if (dev && strcmp(d->dev, dev)) continue;
+        return i;
+    }
+    return -1;
+}
+
+static void dd_insert_unsafe(const char *corr, const char *dev, int64_t now){
+    unsigned i = s_dd_next++ % ROUTER_DEDUP_SLOTS;
+    if (s_dd[i].t_us) dd_unlink_unsafe(i);
+    dd_slot_t *d = &s_dd[i];
+    d->t_us = now;
+    d->hash = dd_hash(corr);
+    d->done = false;
+    d->body[0] = d->topic[0] = '\0';
+    snprintf(d->corr, sizeof d->corr, "%s", corr);
+    snprintf(d->dev,  sizeof d->dev,  "%s", dev ? dev : "");
+    uint8_t *b = &s_dd_bucket[d->hash % DD_BUCKETS];
+    d->next = *b;
+    *b = (uint8_t)i;
+}
+
+static void dd_init(void){
+    if (s_dd_lock) return;
+    memset(s_dd_bucket, DD_NONE, sizeof s_dd_bucket);
+    s_dd_lock = xSemaphoreCreateMutex();
+}
+
+// true = nieuw (entry aangemaakt voor dev); false = duplicaat (of dedup niet actief)
+static bool dd_claim(const char *corr, const char *dev){
+    if (!s_dd_lock || !corr || !*corr) return true;
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_dd_lock, portMAX_DELAY);
+    bool fresh = dd_find_unsafe(corr, NULL, now) < 0;
+    if (fresh) dd_insert_unsafe(corr, dev, now);
+    else       s_dd_stats.dups++;
+    xSemaphoreGive(s_dd_lock);
+    return fresh;
+}
+
+// extra toestel onder dezelfde corr (batch naar meerdere children)
+static void dd_add(const char *corr, const char *dev){
+    if (!s_dd_lock || !corr || !*corr) return;
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_dd_lock, portMAX_DELAY);
+    if (dd_find_unsafe(corr, dev, now) < 0) dd_insert_unsafe(corr, dev, now);
+    xSemaphoreGive(s_dd_lock);
+}
+
+// niet aanvaard (BUSY): een nieuwe levering moet wél uitgevoerd worden
+static void dd_forget(const char *corr){
+    if (!s_dd_lock || !corr || !*corr) return;
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_dd_lock, portMAX_DELAY);
+    for (int i; (i = dd_find_unsafe(corr, NULL, now)) >= 0; ) dd_unlink_unsafe(i);
+    xSemaphoreGive(s_dd_lock);
+}
+
+// antwoord bewaren voor een latere herhaling (enkel als de entry bestaat)
+static void dd_record(const char *corr, const char *dev, const char *topic, const char *body, mesh_kind_t kind){
+    if (!s_dd_lock || !corr || !*corr) return;
+    size_t n = body ? strlen(body) : 0;
+    xSemaphoreTake(s_dd_lock, portMAX_DELAY);
+    int i = dd_find_unsafe(corr, dev, esp_timer_get_time());
+    if (i >= 0) {
+        dd_slot_t *d = &s_dd[i];
+        d->done = true;
+        d->kind = (uint8_t)kind;
+        snprintf(d->topic, sizeof d->topic, "%s", topic ? topic : "");
+        if (body && n < sizeof d->body) memcpy(d->body, body, n + 1);
+        else d->body[0] = '\0';
+    }
+    xSemaphoreGive(s_dd_lock);
+}
+
+// bewaarde antwoorden opnieuw versturen; mesh_corr != 0 → als EVENT (child), anders als State
+static void dd_replay(const char *corr, corr_id_t mesh_corr){
+    if (!s_dd_lock) return;
+    char topic[PARSER_TOPIC_MAX], body[ROUTER_DEDUP_BODY];
+    for (int i = 0; i < ROUTER_DEDUP_SLOTS; ++i) {
+        xSemaphoreTake(s_dd_lock, portMAX_DELAY);
+        const dd_slot_t *d = &s_dd[i];
+        bool hit = dd_live(d, esp_timer_get_time()) && d->done && d->body[0] && !strcmp(d->corr, corr);
+        mesh_kind_t kind = (mesh_kind_t)d->kind;
+        if (hit) { memcpy(topic, d->topic, sizeof topic); memcpy(body, d->body, sizeof body); s_dd_stats.replayed++; }
+        xSemaphoreGive(s_dd_lock);
+        if (!hit) continue;
+
+        if (!mesh_corr) {
+            if (CB.mqtt_pub) CB.mqtt_pub(topic, body, /*qos=*/1, /*retain=*/false);
+        } else {
+            cJSON *p = cJSON_Parse(body);   // zeldzaam pad: enkel bij een herhaalde REQUEST
+            if (p) router_emit_event(kind, mesh_corr, topic[0] ? topic : NULL, p);
+            cJSON_Delete(p);
+        }
+    }
+}
+#else
+static void dd_init(void) {}
+static bool dd_claim(const char *corr, const char *dev) { (void)corr; (void)dev; return true; }
+static void dd_add(const char *corr, const char *dev) { (void)corr; (void)dev; }
+static void dd_forget(const char *corr) { (void)corr; }
+static void dd_record(const char *corr, const char *dev, const char *topic, const char *body, mesh_kind_t kind)
+{ (void)corr; (void)dev; (void)topic; (void)body; (void)kind; }
+static void dd_replay(const char *corr, corr_id_t mesh_corr) { (void)corr; (void)mesh_corr; }
+#endif
+
+void router_dedup_stats_get(router_dedup_stats_t *out, bool reset){
+    if (!out) return;
+    *out = s_dd_stats;
+    if (reset) memset(&s_dd_stats, 0, sizeof s_dd_stats);
+}
+
 // --- HELLO detectie ---
 static inline bool json_is_hello(const cJSON *p){
     if (!p) return false;
@@ -31,11 +285,14 @@ static inline bool json_is_hello(const cJSON *p){
 }
 
 static void publish_status_for(const char *dev, bool online){
-    char topic[128], payload[160];
+    char topic[128], payload[96];
     snprintf(topic, sizeof(topic), "Devices/%s/Status", dev);
-    if (online) snprintf(payload, sizeof(payload), "{\"status\":\"online\",\"dev\":\"%s\"}", dev);
-    else        snprintf(payload, sizeof(payload), "{\"status\":\"offline\"}");
-    mqtt_link_publish(topic, payload, 1, true);  // retain
+    jw_t w; jw_init(&w, payload, sizeof payload);
+    jw_obj(&w, NULL);
+    jw_str(&w, "status", online ? "online" : "offline");
+    if (online) jw_str(&w, "dev", dev);
+    jw_obj_end(&w);
+    if (jw_done(&w) && CB.mqtt_pub) CB.mqtt_pub(topic, payload, 1, true);  // retain
 }
 
 // helper: mapping parser → mesh_kind_t
@@ -54,7 +311,15 @@ static cJSON* mesh_payload_from_msg(const parser_msg_t *m){
     cJSON_AddStringToObject(o, "io",     parser_iokind_str(m->io_kind));
     cJSON_AddNumberToObject(o, "io_id",  m->io_id);
     cJSON_AddStringToObject(o, "action", parser_action_str(m->action));
-    // TODO (PWM): als je later params nodig hebt, hier toevoegen als "params": {...}
+    // params voor de uitvoering op de child (max_age_ms blijft op de root: shadow)
+    const parser_params_t *P = &m->params;
+    if (P->has_duration_ms || P->has_brightness_pct || P->has_ramp_ms || P->has_debounce_ms) {
+        cJSON *jp = cJSON_AddObjectToObject(o, "params");
+        if (P->has_duration_ms)    cJSON_AddNumberToObject(jp, "duration_ms",    P->duration_ms);
+        if (P->has_brightness_pct) cJSON_AddNumberToObject(jp, "brightness_pct", P->brightness_pct);
+        if (P->has_ramp_ms)        cJSON_AddNumberToObject(jp, "ramp_ms",        P->ramp_ms);
+        if (P->has_debounce_ms)    cJSON_AddNumberToObject(jp, "debounce_ms",    P->debounce_ms);
+    }
     return o;
 }
 
@@ -65,12 +330,58 @@ static const char* stat_str(router_status_t s){
         case ROUTER_ERR_OUT_OF_RANGE:return "OUT_OF_RANGE";
         case ROUTER_ERR_NO_ROUTE:   return "NO_ROUTE";
         case ROUTER_ERR_TIMEOUT:    return "TIMEOUT";
+        case ROUTER_ERR_BUSY:       return "BUSY";
         default:                    return "ERROR";
     }
 }
 
+// ---------- timerwerk ----------
+// esp_timer-callbacks draaien in de esp_timer-taak (kleine stack, gedeeld met wifi/mesh):
+// daar geen locks, cJSON of MQTT. Een callback zet enkel een bit; router_tmr doet het werk.
+// Bits gaan niet verloren en vallen samen als de taak achterloopt (geen queue die volloopt).
+#define RTW_CO_FLUSH   (1u << 0)   // coalesce-vensters verlopen
+#define RTW_GRP_FINISH (1u << 1)   // groepsantwoorden: wachttijd verlopen
+#define RTW_SHADOW_PUB (1u << 2)   // shadow-snapshot publiceren (gedebounced)
+
+static TaskHandle_t s_rtw_task;
+
+static void co_sweep(void);
+static void grp_sweep(void);
+static void publish_shadow_snapshot(void);
+
+static void rtw_post(uint32_t bits){
+    if (s_rtw_task) xTaskNotify(s_rtw_task, bits, eSetBits);
+}
+
+static void rtw_task(void *arg){
+    (void)arg;
+    for (;;) {
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY) != pdTRUE) continue;
+        if (bits & RTW_CO_FLUSH)   co_sweep();
+        if (bits & RTW_GRP_FINISH) grp_sweep();
+        if (bits & RTW_SHADOW_PUB) publish_shadow_snapshot();
+    }
+}
+
+static void rtw_init(void){
+    if (s_rtw_task) return;
+    if (xTaskCreate(rtw_task, "router_tmr", 6144, NULL, 5, &s_rtw_task) != pdPASS) s_rtw_task = NULL;
+}
+
+static void shadow_init(void);
+static void groups_init(void);
+static void coalesce_init(void);
+static void lanes_init(void);
+
 void router_init(const router_cbs_t *cbs){
     if (cbs) CB = *cbs;
+    rtw_init();   // vóór de timers: hun callbacks posten naar deze taak
+    dd_init();
+    shadow_init();
+    groups_init();
+    coalesce_init();
+    lanes_init();
 }
 
 void router_set_local_dev(const char *dev_name){
@@ -88,38 +399,47 @@ static void publish_state(const parser_msg_t *m, router_status_t st,
     snprintf(topic, sizeof(topic), "Devices/%s/State", m->target_dev);
 
     char body[256];
-    int n = snprintf(body, sizeof(body),
-        "{ \"corr_id\":\"%s\",\"dev\":\"%s\",\"status\":\"%s\","
-        "\"io\":\"%s\",\"io_id\":%d,\"action\":\"%s\"",
-        m->corr_id, m->target_dev, stat_str(st),
-        parser_iokind_str(m->io_kind), m->io_id, parser_action_str(m->action));
-
-    if (has_val) n += snprintf(body+n, sizeof(body)-n, ",\"value\":%d", extra_val);
-    if (has_pct) n += snprintf(body+n, sizeof(body)-n, ",\"brightness_pct\":%d", extra_pct);
-    if (detail && *detail) n += snprintf(body+n, sizeof(body)-n, ",\"detail\":\"%s\"", detail);
-
-    snprintf(body+n, sizeof(body)-n, " }");
+    jw_t w; jw_init(&w, body, sizeof body);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", m->corr_id);
+    jw_str(&w, "dev",     m->target_dev);
+    jw_str(&w, "status",  stat_str(st));
+    jw_str(&w, "io",      parser_iokind_str(m->io_kind));
+    jw_int(&w, "io_id",   m->io_id);
+    jw_str(&w, "action",  parser_action_str(m->action));
+    if (has_val) jw_int(&w, "value", extra_val);
+    if (has_pct) jw_int(&w, "brightness_pct", extra_pct);
+    if (detail && *detail) jw_str(&w, "detail", detail);
+    jw_obj_end(&w);
+    if (!jw_done(&w)) return;
     CB.mqtt_pub(topic, body, /*qos=*/1, /*retain=*/false);
+    dd_record(m->corr_id, m->target_dev, topic, body, kind_from_msg(m));
+    lat_done(m->corr);
 }
 
-router_status_t router_handle(const parser_msg_t *m){
-    if (!m) return ROUTER_ERR_INTERNAL;
-
-    // --- Remote? → via mesh versturen en NIET lokaal publishen ---
-    if (strcmp(m->target_dev, g_local_dev) != 0) {
-        cJSON *payload = mesh_payload_from_msg(m);
-        mesh_kind_t kind = kind_from_msg(m);
-        uint32_t cid = corr_id_u32(m->corr_id);      // maak 32-bit corr_id
-        const char *origin = m->topic_hint;    // als je die al bijhoudt; anders NULL
-
-        router_send_cmd_to_target(m->target_dev, origin, kind, payload, cid);
-        cJSON_Delete(payload);
-        return ROUTER_OK;  // accepted; uiteindelijke State volgt via EVENT
-    }
+// korte State zonder io-velden: {"corr_id","dev","status"[,"by"]}
+static void publish_corr_status(const char *dev, const char *corr, const char *status, const char *by){
+    if (!CB.mqtt_pub) return;
+    char topic[96], body[160];
+    snprintf(topic, sizeof topic, "Devices/%s/State", dev);
+    jw_t w; jw_init(&w, body, sizeof body);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", corr);
+    jw_str(&w, "dev",     dev);
+    jw_str(&w, "status",  status);
+    if (by) jw_str(&w, "by", by);
+    jw_obj_end(&w);
+    if (!jw_done(&w)) return;
+    CB.mqtt_pub(topic, body, /*qos=*/1, /*retain=*/false);
+    dd_record(corr, dev, topic, body, ML_KIND_DIAG);
+}
 
-    // --- Lokaal pad ---
+// lokaal uitvoeren via de driver-callbacks (zonder State publish)
+static router_status_t exec_local(const parser_msg_t *m, int *value, bool *has_val,
+                                  int *pct, bool *has_pct)
+{
     router_status_t st = ROUTER_ERR_INVALID;
-    int value = 0, pct = 0; bool has_val=false, has_pct=false;
+    *has_val = false; *has_pct = false;
 
     switch (m->io_kind) {
         case IO_RELAY:
@@ -128,13 +448,13 @@ router_status_t router_handle(const parser_msg_t *m){
             break;
 
         case IO_PWM:
-            if (CB.exec_pwm) { st = CB.exec_pwm(m, &pct); has_pct = (st==ROUTER_OK); }
+            if (CB.exec_pwm) { st = CB.exec_pwm(m, pct); *has_pct = (st==ROUTER_OK); }
             else st = ROUTER_ERR_INTERNAL;
             break;
 
         case IO_INPUT:
             if (m->action == ACT_READ) {
-                if (CB.exec_input) { st = CB.exec_input(m, &value); has_val = (st==ROUTER_OK); }
+                if (CB.exec_input) { st = CB.exec_input(m, value); *has_val = (st==ROUTER_OK); }
                 else st = ROUTER_ERR_INTERNAL;
             } else {
                 st = ROUTER_ERR_INVALID;
@@ -145,11 +465,1096 @@ router_status_t router_handle(const parser_msg_t *m){
             st = ROUTER_ERR_INVALID;
             break;
     }
+    return st;
+}
+
+// ---------- groepen: fan-out (root) ----------
+// Een Cmd/Set met "group" i.p.v. target_dev gaat als één mesh-groepsframe naar alle
+// leden (mesh_send_group): één verzending en geen RESPONSE-ACK per lid. Het lidmaatschap
+// komt uit de HELLO van elk toestel ("groups":[...], zie router_set_groups). Elk lid
+// voert lokaal uit en stuurt zijn EVENT; de root verzamelt ze onder de corr en publiceert
+// één State op ROUTER_GROUP_TOPIC_FMT zodra alle leden antwoordden, of na
+// ROUTER_GROUP_WAIT_MS met de ontbrekende leden in "missing". Is de root zelf lid, dan
+// voert hij zijn deel lokaal uit. Backend zonder groepsframes: unicast per lid, zelfde State.
+#ifndef ROUTER_GROUPS
+#define ROUTER_GROUPS        8
+#endif
+#ifndef ROUTER_GROUP_MEMBERS
+#define ROUTER_GROUP_MEMBERS 16     // max. 32 (bitmasker)
+#endif
+#ifndef ROUTER_GROUP_PENDING
+#define ROUTER_GROUP_PENDING 4      // groepscommando's die tegelijk op EVENTs wachten
+#endif
+#ifndef ROUTER_GROUP_WAIT_MS
+#define ROUTER_GROUP_WAIT_MS 1500
+#endif
+
+typedef struct {
+    char name[PARSER_GROUP_MAX + 1];                         // "" = vrij
+    char dev[ROUTER_GROUP_MEMBERS][PARSER_DEVNAME_MAX + 1];  // "" = vrij; een lid houdt zijn slot (bitmaskers)
+} grp_t;
+
+typedef struct {
+    corr_id_t   corr;                     // 0 = vrij
+    char        corr_id[PARSER_CORR_MAX];
+    char        group[PARSER_GROUP_MAX + 1];
+    uint8_t     g;                        // index in s_grp
+    uint8_t     n, n_ok;                  // leden bij het versturen / geslaagd
+    uint32_t    wait;                     // bit k: lid k moet nog antwoorden
+    int64_t     deadline_us;
+    mesh_kind_t kind;
+    cJSON      *items;                    // per lid: EVENT-velden + "dev"
+} gpend_t;
+
+static grp_t              s_grp[ROUTER_GROUPS];
+static gpend_t            s_gp[ROUTER_GROUP_PENDING];
+static SemaphoreHandle_t  s_grp_lock;
+static esp_timer_handle_t s_grp_timer;
+
+static const char *batch_status_str(int n_ok, int n);
+
+static grp_t *grp_find_unsafe(const char *name){
+    for (int i = 0; i < ROUTER_GROUPS; ++i)
+        if (s_grp[i].name[0] && !strcmp(s_grp[i].name, name)) return &s_grp[i];
+    return NULL;
+}
+
+static int grp_slot(const grp_t *g, const char *dev){
+    for (int k = 0; k < ROUTER_GROUP_MEMBERS; ++k)
+        if (g->dev[k][0] && !strcmp(g->dev[k], dev)) return k;
+    return -1;
+}
+
+static bool grp_pending_unsafe(int gi){
+    for (int i = 0; i < ROUTER_GROUP_PENDING; ++i)
+        if (s_gp[i].corr && s_gp[i].g == gi) return true;
+    return false;
+}
+
+static void publish_group_status(const char *group, const char *corr, const char *status){
+    if (!CB.mqtt_pub) return;
+    char topic[96], body[160];
+    snprintf(topic, sizeof topic, ROUTER_GROUP_TOPIC_FMT, group);
+    jw_t w; jw_init(&w, body, sizeof body);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", corr);
+    jw_str(&w, "group",   group);
+    jw_str(&w, "status",  status);
+    jw_obj_end(&w);
+    if (!jw_done(&w)) return;
+    CB.mqtt_pub(topic, body, /*qos=*/1, /*retain=*/false);
+    dd_record(corr, group, topic, body, ML_KIND_DIAG);
+}
+
+// één State voor het hele groepscommando; slot komt vrij
+static void grp_finish_unsafe(gpend_t *p){
+    const grp_t *g = &s_grp[p->g];
+    char topic[96];
+    snprintf(topic, sizeof topic, ROUTER_GROUP_TOPIC_FMT, p->group);
+
+    jw_t w;
+    if (!jw_init_pooled(&w)) ESP_LOGW("router", "json_wr-pool leeg → groeps-State %s valt weg", p->corr_id);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", p->corr_id);
+    jw_str(&w, "group",   p->group);
+    jw_str(&w, "status",  batch_status_str(p->n_ok, p->n));
+    jw_int(&w, "n",       p->n);
+    jw_int(&w, "n_ok",    p->n_ok);
+    jw_cjson(&w, "items", p->items);
+    if (p->wait) {
+        jw_arr(&w, "missing");
+        for (int k = 0; k < ROUTER_GROUP_MEMBERS; ++k)
+            if ((p->wait & (1u << k)) && g->dev[k][0]) jw_str(&w, NULL, g->dev[k]);
+        jw_arr_end(&w);
+    }
+    jw_obj_end(&w);
+    const char *js = jw_done(&w);
+    if (js && CB.mqtt_pub) {
+        CB.mqtt_pub(topic, js, /*qos=*/1, /*retain=*/false);
+        dd_record(p->corr_id, p->group, topic, js, p->kind);
+        lat_done(p->corr);
+    }
+    jw_release(&w);
+    cJSON_Delete(p->items);
+    memset(p, 0, sizeof *p);
+}
+
+// antwoord van lid k; payload = EVENT (of lokaal resultaat), eigendom blijft bij de caller
+static void grp_item_unsafe(gpend_t *p, int k, const cJSON *payload){
+    cJSON *it = cJSON_IsObject(payload) ? cJSON_Duplicate(payload, 1) : cJSON_CreateObject();
+    cJSON_DeleteItemFromObjectCaseSensitive(it, "dev");
+    cJSON_AddStringToObject(it, "dev", s_grp[p->g].dev[k]);
+    const cJSON *st = cJSON_GetObjectItemCaseSensitive(it, "status");
+    if (!cJSON_IsString(st) || !strcmp(st->valuestring, "OK")) p->n_ok++;   // driver-EVENT: geen status = gelukt
+    cJSON_AddItemToArray(p->items, it);
+    p->wait &= ~(1u << k);
+}
+
+// router_tmr: verlopen groepen afsluiten (State met "missing"), timer opnieuw op het vroegste
+static void grp_sweep(void){
+    if (!s_grp_lock) return;
+    xSemaphoreTake(s_grp_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time(), next = 0;
+    for (int i = 0; i < ROUTER_GROUP_PENDING; ++i) {
+        gpend_t *p = &s_gp[i];
+        if (!p->corr) continue;
+        if (p->deadline_us <= now) grp_finish_unsafe(p);
+        else if (!next || p->deadline_us < next) next = p->deadline_us;
+    }
+    if (next) esp_timer_start_once(s_grp_timer, (uint64_t)(next - now));
+    xSemaphoreGive(s_grp_lock);
+}
+
+static void grp_timer_cb(void *arg){
+    (void)arg;
+    rtw_post(RTW_GRP_FINISH);
+}
+
+static void groups_init(void){
+    if (s_grp_lock) return;
+    s_grp_lock = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t args = { .callback = &grp_timer_cb, .name = "router_grp" };
+    if (!s_rtw_task || esp_timer_create(&args, &s_grp_timer) != ESP_OK) s_grp_timer = NULL;
+}
+
+void router_set_groups(const char *dev, const char *const *groups, int n){
+    if (!dev || !*dev || !s_grp_lock) return;
+    xSemaphoreTake(s_grp_lock, portMAX_DELAY);
+    // bestaande groepen: lid eruit of erbij (een blijvend lid houdt zijn slot)
+    for (int i = 0; i < ROUTER_GROUPS; ++i) {
+        grp_t *g = &s_grp[i];
+        if (!g->name[0]) continue;
+        bool want = false;
+        for (int j = 0; j < n && !want; ++j) want = groups[j] && !strcmp(groups[j], g->name);
+        int k = grp_slot(g, dev);
+        if (k >= 0 && !want) g->dev[k][0] = '\0';
+        if (k < 0 && want) {
+            for (k = 0; k < ROUTER_GROUP_MEMBERS && g->dev[k][0]; ++k) {}
+            if (k < ROUTER_GROUP_MEMBERS) snprintf(g->dev[k], sizeof g->dev[k], "%s", dev);
+            else ESP_LOGW("router", "groep %s vol → %s niet toegevoegd", g->name, dev);
+        }
+        bool empty = true;
+        for (k = 0; k < ROUTER_GROUP_MEMBERS && empty; ++k) empty = !g->dev[k][0];
+        if (empty && !grp_pending_unsafe(i)) g->name[0] = '\0';
+    }
+    // nieuwe groepen
+    for (int j = 0; j < n; ++j) {
+        if (!groups[j] || !*groups[j] || strlen(groups[j]) > PARSER_GROUP_MAX || grp_find_unsafe(groups[j])) continue;
+        grp_t *g = NULL;
+        for (int i = 0; i < ROUTER_GROUPS && !g; ++i) if (!s_grp[i].name[0] && !grp_pending_unsafe(i)) g = &s_grp[i];
+        if (!g) { ESP_LOGW("router", "groepentabel vol → %s niet toegevoegd", groups[j]); continue; }
+        memset(g, 0, sizeof *g);
+        snprintf(g->name, sizeof g->name, "%s", groups[j]);
+        snprintf(g->dev[0], sizeof g->dev[0], "%s", dev);
+    }
+    xSemaphoreGive(s_grp_lock);
+}
+
+// HELLO: {"groups":[...]} (ontbreekt = geen groepen)
+static void group_learn(const char *dev, const cJSON *hello){
+    const char *names[MESH_GROUP_MAX];
+    int n = 0;
+    const cJSON *arr = cJSON_GetObjectItemCaseSensitive(hello, "groups"), *it;
+    cJSON_ArrayForEach(it, arr)
+        if (cJSON_IsString(it) && n < MESH_GROUP_MAX) names[n++] = it->valuestring;
+    router_set_groups(dev, names, n);
+}
+
+static bool group_is_member(const char *group, const char *dev){
+    if (!s_grp_lock) return false;
+    xSemaphoreTake(s_grp_lock, portMAX_DELAY);
+    const grp_t *g = grp_find_unsafe(group);
+    bool in = g && grp_slot(g, dev) >= 0;
+    xSemaphoreGive(s_grp_lock);
+    return in;
+}
+
+// EVENT/fout van dev onder corr; false = geen lopend groepscommando
+static bool group_take(corr_id_t corr, const char *dev, const cJSON *payload){
+    if (!corr || !dev || !s_grp_lock) return false;
+    bool hit = false;
+    xSemaphoreTake(s_grp_lock, portMAX_DELAY);
+    for (int i = 0; i < ROUTER_GROUP_PENDING && !hit; ++i) {
+        gpend_t *p = &s_gp[i];
+        if (p->corr != corr) continue;
+        hit = true;
+        int k = grp_slot(&s_grp[p->g], dev);
+        if (k >= 0 && (p->wait & (1u << k))) grp_item_unsafe(p, k, payload);
+        if (!p->wait) grp_finish_unsafe(p);
+    }
+    xSemaphoreGive(s_grp_lock);
+    return hit;
+}
+
+// unicast-terugval: leveringsfout van één lid telt als zijn antwoord
+static bool group_fail(corr_id_t corr, const char *dev, const char *status){
+    cJSON *st = cJSON_CreateObject();
+    cJSON_AddStringToObject(st, "status", status);
+    bool hit = group_take(corr, dev, st);
+    cJSON_Delete(st);
+    return hit;
+}
+
+// Eén frame naar alle leden; local = resultaat van de root als lid (eigendom gaat over).
+static router_status_t group_send(const char *group, const char *corr_id, corr_id_t corr,
+                                  const char *origin, mesh_kind_t kind, const cJSON *payload,
+                                  mesh_prio_t prio, cJSON *local)
+{
+    if (!s_grp_lock) { cJSON_Delete(local); return ROUTER_ERR_INTERNAL; }
+    xSemaphoreTake(s_grp_lock, portMAX_DELAY);
+    grp_t *g = grp_find_unsafe(group);
+    uint32_t mask = 0;
+    int n = 0;
+    for (int k = 0; g && k < ROUTER_GROUP_MEMBERS; ++k)
+        if (g->dev[k][0]) { mask |= 1u << k; n++; }
+    gpend_t *p = NULL;
+    for (int i = 0; n && i < ROUTER_GROUP_PENDING && !p; ++i) if (!s_gp[i].corr) p = &s_gp[i];
+    if (!p) {
+        xSemaphoreGive(s_grp_lock);
+        cJSON_Delete(local);
+        router_status_t st = n ? ROUTER_ERR_BUSY : ROUTER_ERR_NO_ROUTE;   // geen vrij slot / onbekende groep
+        publish_group_status(group, corr_id, stat_str(st));
+        return st;
+    }
+
+    p->corr = corr ? corr : parser_corr_new();
+    snprintf(p->corr_id, sizeof p->corr_id, "%s", corr_id);
+    snprintf(p->group, sizeof p->group, "%s", group);
+    p->g = (uint8_t)(g - s_grp);
+    p->n = (uint8_t)n;
+    p->n_ok = 0;
+    p->wait = mask;
+    p->kind = kind;
+    p->deadline_us = esp_timer_get_time() + (int64_t)ROUTER_GROUP_WAIT_MS * 1000;
+    p->items = cJSON_CreateArray();
+    int self = grp_slot(g, g_local_dev);
+    if (self >= 0) {
+        if (local) grp_item_unsafe(p, self, local);
+        else       p->wait &= ~(1u << self);
+    }
+    cJSON_Delete(local);
+
+    if (!p->wait) {                 // enkel de root zelf
+        grp_finish_unsafe(p);
+        xSemaphoreGive(s_grp_lock);
+        return ROUTER_OK;
+    }
+    if (s_grp_timer && !esp_timer_is_active(s_grp_timer))
+        esp_timer_start_once(s_grp_timer, (uint64_t)ROUTER_GROUP_WAIT_MS * 1000);
+
+    mesh_envelope_t env = {
+        .schema="v1", .corr_id=p->corr, .src_dev=g_local_dev, .dst_dev=group,
+        .kind=kind, .prio=prio, .ttl=3, .hop=0,
+        .origin_set_topic=origin, .payload=(cJSON*)payload
+    };
+    uint32_t todo = p->wait;
+    corr_id_t c = p->corr;
+    mesh_status_t ms = mesh_send_group(&env);
+    xSemaphoreGive(s_grp_lock);     // unicast-fouten komen synchroon terug via group_fail()
+
+    if (ms != MESH_OK) {
+        ESP_LOGI("router", "groep %s: geen groepsframe → unicast naar %d leden", group, n);
+        for (int k = 0; k < ROUTER_GROUP_MEMBERS; ++k) {
+            if (!(todo & (1u << k))) continue;
+            char dev[PARSER_DEVNAME_MAX + 1];
+            xSemaphoreTake(s_grp_lock, portMAX_DELAY);
+            snprintf(dev, sizeof dev, "%s", g->dev[k]);
+            xSemaphoreGive(s_grp_lock);
+            if (dev[0]) router_send_cmd_to_target(dev, origin, kind, payload, c, prio);
+        }
+    }
+    return ROUTER_OK;   // aanvaard; de geaggregeerde State volgt
+}
+
+// root als lid: zelfde velden als een item van een lokale batch
+static cJSON *local_item(const parser_msg_t *m, router_status_t *st){
+    parser_msg_t lm = *m;
+    snprintf(lm.target_dev, sizeof lm.target_dev, "%s", g_local_dev);
+    int value = 0, pct = 0; bool has_val = false, has_pct = false;
+    *st = exec_local(&lm, &value, &has_val, &pct, &has_pct);
+    cJSON *it = mesh_payload_from_msg(m);
+    cJSON_AddStringToObject(it, "status", stat_str(*st));
+    if (has_val) cJSON_AddNumberToObject(it, "value", value);
+    if (has_pct) cJSON_AddNumberToObject(it, "brightness_pct", pct);
+    return it;
+}
+
+static router_status_t group_dispatch(const parser_msg_t *m, mesh_prio_t prio){
+    router_status_t st = ROUTER_OK;
+    cJSON *local = group_is_member(m->group, g_local_dev) ? local_item(m, &st) : NULL;
+    cJSON *payload = mesh_payload_from_msg(m);
+    const char *origin = (m->topic_hint && *m->topic_hint) ? m->topic_hint : NULL;
+    router_status_t gs = group_send(m->group, m->corr_id, m->corr, origin, kind_from_msg(m), payload, prio, local);
+    cJSON_Delete(payload);
+    return gs != ROUTER_OK ? gs : st;
+}
+
+// ---------- coalescing (root → child) ----------
+// Remote commando's naar hetzelfde toestel binnen het venster gaan samen in één
+// "cmds"-frame (zelfde formaat als een batch). PWM SET op hetzelfde kanaal: laatste
+// waarde wint; al de rest (bv. relay ON → OFF) behoudt strikt de volgorde.
+#ifndef ROUTER_COALESCE_MS
+#define ROUTER_COALESCE_MS      10    // 0 = uit (elk commando meteen een eigen frame)
+#endif
+#ifndef ROUTER_COALESCE_TARGETS
+#define ROUTER_COALESCE_TARGETS 4     // toestellen met een open venster
+#endif
+#ifndef ROUTER_COALESCE_ITEMS
+#define ROUTER_COALESCE_ITEMS   8     // vol → meteen versturen
+#endif
+
+typedef struct {
+    io_kind_t       io_kind;
+    int             io_id;
+    action_t        action;
+    parser_params_t params;
+    corr_id_t       corr;
+    char            corr_id[PARSER_CORR_MAX];
+} co_item_t;
+
+typedef struct {
+    char      dev[PARSER_DEVNAME_MAX + 1];   // "" = vrij
+    char      origin[PARSER_TOPIC_MAX];
+    int64_t   deadline_us;
+    uint8_t   n;
+    uint8_t   prio;                          // hoogste klasse in het frame (laagste waarde)
+    co_item_t it[ROUTER_COALESCE_ITEMS];
+} co_bucket_t;
+
+static co_bucket_t              s_co[ROUTER_COALESCE_TARGETS];
+static SemaphoreHandle_t        s_co_lock;
+static esp_timer_handle_t       s_co_timer;
+static uint32_t                 s_co_window_ms = ROUTER_COALESCE_MS;
+static router_coalesce_stats_t  s_co_stats;
+
+static void co_flush_unsafe(co_bucket_t *b){
+    if (!b->dev[0] || !b->n) { b->dev[0] = '\0'; b->n = 0; return; }
+
+    parser_msg_t m = {0};
+    m.topic_hint = b->origin;
+    snprintf(m.target_dev, sizeof m.target_dev, "%s", b->dev);
+    const co_item_t *c0 = &b->it[0];
+    m.io_kind = c0->io_kind; m.io_id = c0->io_id; m.action = c0->action; m.params = c0->params;
+
+    cJSON *payload;
+    if (b->n == 1) {
+        payload = mesh_payload_from_msg(&m);
+    } else {
+        // items dragen hun eigen client-corr_id; de child geeft die terug per item
+        cJSON *items = cJSON_CreateArray();
+        for (int i = 0; i < b->n; ++i) {
+            const co_item_t *c = &b->it[i];
+            m.io_kind = c->io_kind; m.io_id = c->io_id; m.action = c->action; m.params = c->params;
+            cJSON *it = mesh_payload_from_msg(&m);
+            cJSON_AddNumberToObject(it, "i", i);
+            cJSON_AddStringToObject(it, "corr_id", c->corr_id);
+            cJSON_AddItemToArray(items, it);
+        }
+        payload = cJSON_CreateObject();
+        cJSON_AddItemToObject(payload, "cmds", items);
+    }
+
+    // elk item eigen entry: EVENT of fout van het frame (corr van c0) vindt ze terug
+    corr_remember(c0->corr, b->dev, c0->corr_id);
+    for (int i = 1; i < b->n; ++i) corr_remember_in(b->it[i].corr, c0->corr, b->dev, b->it[i].corr_id);
+    router_send_cmd_to_target(b->dev, b->origin[0] ? b->origin : NULL,
+                              kind_from_msg(&m), payload, c0->corr, (mesh_prio_t)b->prio);
+    cJSON_Delete(payload);
+    s_co_stats.frames++;
+    b->dev[0] = '\0';
+    b->n = 0;
+}
+
+// router_tmr: verlopen vensters versturen, timer opnieuw op het vroegste
+static void co_sweep(void){
+    if (!s_co_lock) return;
+    xSemaphoreTake(s_co_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time(), next = 0;
+    for (int i = 0; i < ROUTER_COALESCE_TARGETS; ++i) {
+        co_bucket_t *b = &s_co[i];
+        if (!b->dev[0]) continue;
+        if (b->deadline_us <= now) co_flush_unsafe(b);
+        else if (!next || b->deadline_us < next) next = b->deadline_us;
+    }
+    if (next) esp_timer_start_once(s_co_timer, (uint64_t)(next - now));
+    xSemaphoreGive(s_co_lock);
+}
+
+static void co_timer_cb(void *arg){
+    (void)arg;
+    rtw_post(RTW_CO_FLUSH);
+}
+
+// zonder router_tmr geen timer → coalesce_add buffert niet (alles gaat direct)
+static void coalesce_init(void){
+    if (s_co_lock) return;
+    s_co_lock = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t args = { .callback = &co_timer_cb, .name = "router_co" };
+    if (!s_rtw_task || esp_timer_create(&args, &s_co_timer) != ESP_OK) s_co_timer = NULL;
+}
+
+static co_bucket_t *co_find_unsafe(const char *dev){
+    for (int i = 0; i < ROUTER_COALESCE_TARGETS; ++i)
+        if (s_co[i].dev[0] && strcmp(s_co[i].dev, dev) == 0) return &s_co[i];
+    return NULL;
+}
+
+// open venster van dev eerst versturen (volgorde t.o.v. een batch of een nieuwe origin)
+static void coalesce_flush_dev(const char *dev){
+    if (!s_co_lock) return;
+    xSemaphoreTake(s_co_lock, portMAX_DELAY);
+    co_bucket_t *b = co_find_unsafe(dev);
+    if (b) co_flush_unsafe(b);
+    xSemaphoreGive(s_co_lock);
+}
+
+// false = niet gebufferd (venster uit / geen vrij slot) → caller verstuurt zelf.
+// SAFETY wacht niet op het venster: het frame (met wat ervoor zat) gaat meteen weg.
+static bool coalesce_add(const parser_msg_t *m, mesh_prio_t prio){
+    if (!s_co_window_ms || !s_co_lock || !s_co_timer) return false;
+    const char *origin = m->topic_hint ? m->topic_hint : "";
+    char superseded[PARSER_CORR_MAX] = "";
+    corr_id_t superseded_corr = 0;
+    bool queued = true;
+
+    xSemaphoreTake(s_co_lock, portMAX_DELAY);
+    co_bucket_t *b = co_find_unsafe(m->target_dev);
+    if (b && (b->n == ROUTER_COALESCE_ITEMS || strcmp(b->origin, origin) != 0)) {
+        co_flush_unsafe(b);
+        b = NULL;
+    }
+
+    // PWM SET met brightness: vorige SET op hetzelfde kanaal vervangen, tenzij er iets anders
+    // tussen zit. Zonder brightness (bv. enkel ramp_ms) geen set-point → gewoon achteraan.
+    co_item_t *dup = NULL;
+    if (b && m->io_kind == IO_PWM && m->action == ACT_SET && m->params.has_brightness_pct) {
+        for (int i = b->n - 1; i >= 0; --i) {
+            co_item_t *c = &b->it[i];
+            if (c->io_kind != m->io_kind || c->io_id != m->io_id) continue;
+            if (c->action == ACT_SET) dup = c;
+            break;
+        }
+    }
+
+    if (!b) {
+        for (int i = 0; i < ROUTER_COALESCE_TARGETS && !b; ++i)
+            if (!s_co[i].dev[0]) b = &s_co[i];
+        if (b) {
+            snprintf(b->dev, sizeof b->dev, "%s", m->target_dev);
+            snprintf(b->origin, sizeof b->origin, "%s", origin);
+            b->deadline_us = esp_timer_get_time() + (int64_t)s_co_window_ms * 1000;
+            b->n = 0;
+            b->prio = ML_PRIO_READ;
+            if (!esp_timer_is_active(s_co_timer))
+                esp_timer_start_once(s_co_timer, (uint64_t)s_co_window_ms * 1000);
+        }
+    }
+
+    if (!b) {
+        queued = false;
+    } else {
+        co_item_t *c = dup;
+        if (c) {
+            snprintf(superseded, sizeof superseded, "%s", c->corr_id);
+            superseded_corr = c->corr;
+            s_co_stats.collapsed++;
+        }
+        else   c = &b->it[b->n++];
+        c->io_kind = m->io_kind; c->io_id = m->io_id; c->action = m->action;
+        c->params  = m->params;  c->corr  = m->corr;
+        snprintf(c->corr_id, sizeof c->corr_id, "%s", m->corr_id);
+        s_co_stats.cmds++;
+        if (prio < b->prio) b->prio = prio;
+        if (prio == ML_PRIO_SAFETY) co_flush_unsafe(b);
+    }
+    xSemaphoreGive(s_co_lock);
+
+    // overschreven setpoint: geen EVENT te verwachten → client meteen informeren
+    if (superseded_corr) lat_drop(superseded_corr);
+    if (superseded[0]) publish_corr_status(m->target_dev, superseded, "SUPERSEDED", m->corr_id);
+    return queued;
+}
+
+void router_set_coalesce_ms(uint32_t ms){
+    s_co_window_ms = ms;
+    if (ms || !s_co_lock) return;
+    xSemaphoreTake(s_co_lock, portMAX_DELAY);     // uit: open vensters meteen versturen
+    for (int i = 0; i < ROUTER_COALESCE_TARGETS; ++i) co_flush_unsafe(&s_co[i]);
+    xSemaphoreGive(s_co_lock);
+}
+
+void router_coalesce_stats_get(router_coalesce_stats_t *out, bool reset){
+    if (!out) return;
+    if (s_co_lock) xSemaphoreTake(s_co_lock, portMAX_DELAY);
+    *out = s_co_stats;
+    if (reset) memset(&s_co_stats, 0, sizeof s_co_stats);
+    if (s_co_lock) xSemaphoreGive(s_co_lock);
+}
+
+// uitvoering van één commando (router-taak; of meteen als de lanes ontbreken)
+static router_status_t dispatch_msg(const parser_msg_t *m, mesh_prio_t prio){
+    // --- Groep? → één groepsframe, geaggregeerde State ---
+    if (m->group[0]) {
+        router_status_t st = group_dispatch(m, prio);
+        lat_mark(m->corr, LAT_DISPATCH);
+        return st;
+    }
+
+    // --- Remote? → via mesh versturen en NIET lokaal publishen ---
+    if (strcmp(m->target_dev, g_local_dev) != 0) {
+        if (coalesce_add(m, prio)) { lat_mark(m->corr, LAT_DISPATCH); return ROUTER_OK; }   // frame volgt na het venster
+
+        cJSON *payload = mesh_payload_from_msg(m);
+        mesh_kind_t kind = kind_from_msg(m);
+        const char *origin = (m->topic_hint && *m->topic_hint) ? m->topic_hint : NULL;
+
+        corr_remember(m->corr, m->target_dev, m->corr_id);
+        router_send_cmd_to_target(m->target_dev, origin, kind, payload, m->corr, prio);
+        cJSON_Delete(payload);
+        lat_mark(m->corr, LAT_DISPATCH);
+        return ROUTER_OK;  // accepted; uiteindelijke State volgt via EVENT
+    }
+
+    // --- Lokaal pad ---
+    int value = 0, pct = 0; bool has_val=false, has_pct=false;
+    router_status_t st = exec_local(m, &value, &has_val, &pct, &has_pct);
+    lat_mark(m->corr, LAT_DISPATCH);
 
     publish_state(m, st, (st==ROUTER_OK? NULL : "exec failed"), value, has_val, pct, has_pct);
     return st;
 }
 
+// ---------- priority lanes ----------
+#ifndef ROUTER_LANE_DEPTH
+#define ROUTER_LANE_DEPTH 6    // items per klasse (~330 B per item)
+#endif
+#ifndef ROUTER_LANE_BURST
+#define ROUTER_LANE_BURST 8    // max. opeenvolgende beurten voor hoger terwijl lager wacht
+#endif
+
+typedef struct {
+    int64_t      enq_us;
+    bool         from_mesh;                 // child: REQUEST van de root (geen State, drivers sturen EVENT)
+    parser_msg_t m;                         // !from_mesh
+    char         topic[PARSER_TOPIC_MAX];   // kopie van m.topic_hint / origin_set_topic (geleend in de RX-context)
+    cJSON       *payload;                   // from_mesh: eigendom van het item
+    mesh_kind_t  kind;
+    corr_id_t    corr;
+    const parser_batch_t *batch;            // root-batch: caller wacht op done
+    router_status_t      *res;
+    SemaphoreHandle_t     done;             // van de caller (op zijn stack): meerdere callers mogelijk
+} lane_item_t;
+
+static int io_from_str(const char *s);
+static int action_from_str(const char *s);
+static void execute_batch_local(mesh_kind_t kind, corr_id_t corr_id, const char *origin, const cJSON *cmds);
+static router_status_t dispatch_batch(const parser_batch_t *b);
+static void exec_begin(void);
+static void exec_end(void);
+router_status_t router_execute_local(mesh_kind_t kind, const cJSON *payload,
+                                     corr_id_t corr_id, const char *origin_set_topic);
+
+static QueueHandle_t        s_lane_q[ROUTER_LANES];
+static SemaphoreHandle_t    s_lane_sem;     // telt items over alle lanes
+static int                  s_lane_streak, s_lane_rr;
+static router_lane_stats_t  s_lane_stats[ROUTER_LANES];
+static portMUX_TYPE         s_lane_mux = portMUX_INITIALIZER_UNLOCKED;
+static const uint16_t       s_lat_edges_ms[ROUTER_LAT_BUCKETS - 1] = ROUTER_LAT_EDGES_MS;
+
+mesh_prio_t router_classify(const parser_msg_t *m){
+    if (m->action == ACT_READ || m->action == ACT_REPORT) return ML_PRIO_READ;   // ook relay/PWM
+    if (m->action == ACT_OFF) return ML_PRIO_SAFETY;
+    switch (m->io_kind) {
+        case IO_RELAY: return ML_PRIO_SWITCH;
+        case IO_PWM:   return ML_PRIO_SETPOINT;
+        default:       return ML_PRIO_READ;
+    }
+}
+
+// child: klasse uit de envelop, anders uit de payload (zelfde regels)
+static mesh_prio_t classify_payload(const mesh_envelope_t *req){
+    if (req->prio >= ML_PRIO_SAFETY && req->prio <= ML_PRIO_READ) return req->prio;
+    const cJSON *jio  = cJSON_GetObjectItemCaseSensitive(req->payload, "io");
+    const cJSON *jact = cJSON_GetObjectItemCaseSensitive(req->payload, "action");
+    if (cJSON_IsString(jact) && (!strcasecmp(jact->valuestring, "READ") ||
+                                 !strcasecmp(jact->valuestring, "REPORT"))) return ML_PRIO_READ;
+    if (!cJSON_IsString(jio)) return ML_PRIO_SWITCH;            // bv. "cmds"-frame zonder klasse
+    parser_msg_t m = { .io_kind = io_from_str(jio->valuestring),
+                       .action  = action_from_str(cJSON_IsString(jact) ? jact->valuestring : NULL) };
+    return router_classify(&m);
+}
+
+static void lane_account(int c, int64_t enq_us){
+    uint32_t us = (uint32_t)(esp_timer_get_time() - enq_us);
+    int b = 0;
+    while (b < ROUTER_LAT_BUCKETS - 1 && us >= (uint32_t)s_lat_edges_ms[b] * 1000u) b++;
+    portENTER_CRITICAL(&s_lane_mux);
+    router_lane_stats_t *st = &s_lane_stats[c];
+    st->n++;
+    st->hist[b]++;
+    if (us > st->max_us) st->max_us = us;
+    portEXIT_CRITICAL(&s_lane_mux);
+}
+
+// strikte prioriteit; na ROUTER_LANE_BURST beurten op rij met wachtende lagere lanes
+// krijgt één lagere lane (round-robin) een beurt
+static int lane_pick(void){
+    int top = -1;
+    for (int c = 0; c < ROUTER_LANES && top < 0; ++c)
+        if (uxQueueMessagesWaiting(s_lane_q[c])) top = c;
+    if (top < 0) return -1;
+
+    bool lower = false;
+    for (int c = top + 1; c < ROUTER_LANES; ++c)
+        if (uxQueueMessagesWaiting(s_lane_q[c])) lower = true;
+    if (!lower || ++s_lane_streak <= ROUTER_LANE_BURST) { if (!lower) s_lane_streak = 0; return top; }
+
+    s_lane_streak = 0;
+    for (int k = 0; k < ROUTER_LANES; ++k) {
+        int c = (s_lane_rr + k) % ROUTER_LANES;
+        if (c > top && uxQueueMessagesWaiting(s_lane_q[c])) { s_lane_rr = c + 1; return c; }
+    }
+    return top;
+}
+
+static void lane_task(void *arg){
+    SemaphoreHandle_t sem = arg;   // niet s_lane_sem: die is nog NULL als de taak meteen start
+    lane_item_t it;
+    for (;;) {
+        if (xSemaphoreTake(sem, portMAX_DELAY) != pdTRUE) continue;
+        int c = lane_pick();
+        if (c < 0 || xQueueReceive(s_lane_q[c], &it, 0) != pdTRUE) continue;
+
+        if (it.batch) {
+            *it.res = dispatch_batch(it.batch);
+            xSemaphoreGive(it.done);
+        } else if (it.from_mesh) {
+            exec_begin();
+            const cJSON *cmds = cJSON_GetObjectItemCaseSensitive(it.payload, "cmds");
+            const char *origin = it.topic[0] ? it.topic : NULL;
+            if (cJSON_IsArray(cmds)) execute_batch_local(it.kind, it.corr, origin, cmds);
+            else (void)router_execute_local(it.kind, it.payload, it.corr, origin);
+            exec_end();
+            cJSON_Delete(it.payload);
+        } else {
+            lat_mark(it.m.corr, LAT_QUEUE);
+            it.m.topic_hint = it.topic;
+            (void)dispatch_msg(&it.m, (mesh_prio_t)(c + ML_PRIO_SAFETY));
+        }
+        lane_account(c, it.enq_us);
+    }
+}
+
+static bool lane_push(mesh_prio_t prio, lane_item_t *it){
+    int c = prio - ML_PRIO_SAFETY;
+    it->enq_us = esp_timer_get_time();
+    if (xQueueSend(s_lane_q[c], it, 0) != pdTRUE) {
+        portENTER_CRITICAL(&s_lane_mux);
+        s_lane_stats[c].dropped++;
+        portEXIT_CRITICAL(&s_lane_mux);
+        return false;
+    }
+    xSemaphoreGive(s_lane_sem);
+    return true;
+}
+
+static void lanes_init(void){
+    if (s_lane_sem) return;
+    for (int c = 0; c < ROUTER_LANES; ++c) {
+        s_lane_q[c] = xQueueCreate(ROUTER_LANE_DEPTH, sizeof(lane_item_t));
+        if (!s_lane_q[c]) { ESP_LOGE("router", "lane %d: geen geheugen → direct uitvoeren", c); return; }
+    }
+    SemaphoreHandle_t sem = xSemaphoreCreateCounting(ROUTER_LANES * ROUTER_LANE_DEPTH, 0);
+    if (!sem) return;
+    if (xTaskCreate(lane_task, "router_lane", 6144, sem, 5, NULL) != pdPASS) { vSemaphoreDelete(sem); return; }
+    s_lane_sem = sem;
+}
+
+void router_lane_stats_get(router_lane_stats_t out[ROUTER_LANES], bool reset){
+    if (!out) return;
+    portENTER_CRITICAL(&s_lane_mux);
+    memcpy(out, s_lane_stats, sizeof s_lane_stats);
+    if (reset) memset(s_lane_stats, 0, sizeof s_lane_stats);
+    portEXIT_CRITICAL(&s_lane_mux);
+}
+
+// ---------- shadow-state (root) ----------
+// Laatst gekende toestand van elk kanaal van elke child (relay aan/uit, PWM-pct,
+// input-niveau) met tijdstempel, gevoed door de EVENTs in router_handle_mesh_event().
+// Een READ met params.max_age_ms wordt hieruit beantwoord als de waarde jonger is:
+// geen mesh-round-trip. Zonder max_age_ms geldt ROUTER_SHADOW_MAX_AGE_MS (0 = live).
+// Bij elke wijziging volgt (gedebounced) één retained snapshot op ROUTER_SHADOW_TOPIC.
+#ifndef ROUTER_SHADOW_DEVS
+#define ROUTER_SHADOW_DEVS       16
+#endif
+#ifndef ROUTER_SHADOW_CH
+#define ROUTER_SHADOW_CH         8      // kanalen per io_kind
+#endif
+#ifndef ROUTER_SHADOW_MAX_AGE_MS
+#define ROUTER_SHADOW_MAX_AGE_MS 0      // READ zonder max_age_ms: live (cache enkel op vraag)
+#endif
+#ifndef ROUTER_SHADOW_PUB_MS
+#define ROUTER_SHADOW_PUB_MS     1000   // snapshot hoogstens zo vaak
+#endif
+#define SH_KINDS 3                      // IO_RELAY, IO_PWM, IO_INPUT
+
+typedef struct {
+    char     dev[PARSER_DEVNAME_MAX + 1];             // "" = vrij
+    uint32_t seen_ms;                                 // laatste EVENT (LRU bij vol)
+    uint32_t t_ms[SH_KINDS][ROUTER_SHADOW_CH];        // laatste update per kanaal
+    int8_t   val[SH_KINDS][ROUTER_SHADOW_CH];         // relay 0/1, pwm 0..100, input 0/1; -1 = onbekend
+} shadow_dev_t;
+
+static shadow_dev_t       s_sh[ROUTER_SHADOW_DEVS];
+static portMUX_TYPE       s_sh_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_sh_timer;
+
+static inline uint32_t now_ms32(void){ return (uint32_t)(esp_timer_get_time() / 1000); }
+
+static shadow_dev_t *sh_find_unsafe(const char *dev){
+    for (int i = 0; i < ROUTER_SHADOW_DEVS; ++i)
+        if (s_sh[i].dev[0] && !strcmp(s_sh[i].dev, dev)) return &s_sh[i];
+    return NULL;
+}
+
+// nieuw toestel: vrij slot, anders het langst niet geziene
+static shadow_dev_t *sh_get_unsafe(const char *dev, uint32_t now){
+    shadow_dev_t *d = sh_find_unsafe(dev), *old = &s_sh[0];
+    if (d) return d;
+    for (int i = 0; i < ROUTER_SHADOW_DEVS; ++i) {
+        if (!s_sh[i].dev[0]) { old = &s_sh[i]; break; }
+        if (now - s_sh[i].seen_ms > now - old->seen_ms) old = &s_sh[i];
+    }
+    memset(old, 0, sizeof *old);
+    memset(old->val, -1, sizeof old->val);
+    snprintf(old->dev, sizeof old->dev, "%s", dev);
+    return old;
+}
+
+// router_tmr
+static void publish_shadow_snapshot(void){
+    static const char *const kind_name[SH_KINDS] = { "relay", "pwm", "input" };
+    jw_t w;
+    if (!jw_init_pooled(&w)) { ESP_LOGW("router", "json_wr-pool leeg → shadow-snapshot uitgesteld"); return; }
+    uint32_t now = now_ms32();
+    jw_obj(&w, NULL);
+    jw_obj(&w, "devs");
+    for (int i = 0; i < ROUTER_SHADOW_DEVS; ++i) {
+        shadow_dev_t cp;   // per toestel kopiëren: geen JSON-werk in de critical section
+        portENTER_CRITICAL(&s_sh_mux);
+        cp = s_sh[i];
+        portEXIT_CRITICAL(&s_sh_mux);
+        const shadow_dev_t *d = &cp;
+        if (!d->dev[0]) continue;
+        jw_obj(&w, d->dev);
+        jw_uint(&w, "age_ms", now - d->seen_ms);
+        for (int k = 0; k < SH_KINDS; ++k) {
+            int n = ROUTER_SHADOW_CH;
+            while (n && d->val[k][n - 1] < 0) n--;   // onbekende staart weglaten
+            if (!n) continue;
+            jw_arr(&w, kind_name[k]);                // index = io_id; null = onbekend
+            for (int c = 0; c < n; ++c) {
+                if (d->val[k][c] < 0) jw_null(&w, NULL);
+                else                  jw_int(&w, NULL, d->val[k][c]);
+            }
+            jw_arr_end(&w);
+        }
+        jw_obj_end(&w);
+    }
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    const char *js = jw_done(&w);
+    if (!js)              ESP_LOGW("router", "shadow-snapshot past niet in %d B", JW_POOL_BUF);
+    else if (CB.mqtt_pub) CB.mqtt_pub(ROUTER_SHADOW_TOPIC, js, 0, true);   // retain
+    jw_release(&w);
+}
+
+static void shadow_timer_cb(void *arg){
+    (void)arg;
+    rtw_post(RTW_SHADOW_PUB);
+}
+
+static void shadow_init(void){
+    if (s_sh_timer) return;
+    const esp_timer_create_args_t a = { .callback = &shadow_timer_cb, .name = "router_shadow" };
+    if (!s_rtw_task || esp_timer_create(&a, &s_sh_timer) != ESP_OK) s_sh_timer = NULL;
+}
+
+static void shadow_changed(void){
+    if (s_sh_timer && !esp_timer_is_active(s_sh_timer))
+        esp_timer_start_once(s_sh_timer, (uint64_t)ROUTER_SHADOW_PUB_MS * 1000);
+}
+
+static void shadow_set(const char *dev, io_kind_t kind, int ch, int val){
+    if (!dev || !*dev || (unsigned)kind >= SH_KINDS || ch < 0 || ch >= ROUTER_SHADOW_CH) return;
+    uint32_t now = now_ms32();
+    portENTER_CRITICAL(&s_sh_mux);
+    shadow_dev_t *d = sh_get_unsafe(dev, now);
+    bool changed = d->val[kind][ch] != val;
+    d->seen_ms = now;
+    d->t_ms[kind][ch] = now;
+    d->val[kind][ch] = (int8_t)val;
+    portEXIT_CRITICAL(&s_sh_mux);
+    if (changed) shadow_changed();
+}
+
+// HELLO: child (her)start → oude kanaalwaarden gelden niet meer
+static void shadow_reset(const char *dev){
+    if (!dev || !*dev) return;
+    portENTER_CRITICAL(&s_sh_mux);
+    shadow_dev_t *d = sh_get_unsafe(dev, now_ms32());
+    d->seen_ms = now_ms32();
+    memset(d->val, -1, sizeof d->val);
+    portEXIT_CRITICAL(&s_sh_mux);
+    shadow_changed();
+}
+
+// EVENT-payload van een driver ({"io","io_id","state"|"brightness_pct"|"value"}) of een
+// gebundeld EVENT ({"items":[...]}); foutitems (status != OK) worden overgeslagen
+static void shadow_feed(const char *dev, const cJSON *p){
+    const cJSON *items = cJSON_GetObjectItemCaseSensitive(p, "items");
+    if (cJSON_IsArray(items)) {
+        const cJSON *it;
+        cJSON_ArrayForEach(it, items) shadow_feed(dev, it);
+        return;
+    }
+    const cJSON *jst = cJSON_GetObjectItemCaseSensitive(p, "status");
+    if (cJSON_IsString(jst) && strcmp(jst->valuestring, "OK")) return;
+    const cJSON *jio = cJSON_GetObjectItemCaseSensitive(p, "io");
+    const cJSON *jid = cJSON_GetObjectItemCaseSensitive(p, "io_id");
+    if (!cJSON_IsString(jio) || !cJSON_IsNumber(jid)) return;
+
+    const cJSON *v;
+    if (!strcasecmp(jio->valuestring, "relay")) {
+        v = cJSON_GetObjectItemCaseSensitive(p, "state");
+        if (cJSON_IsString(v)) shadow_set(dev, IO_RELAY, jid->valueint, !strcasecmp(v->valuestring, "ON"));
+    } else if (!strcasecmp(jio->valuestring, "pwm")) {
+        v = cJSON_GetObjectItemCaseSensitive(p, "brightness_pct");
+        if (cJSON_IsNumber(v)) shadow_set(dev, IO_PWM, jid->valueint, v->valueint);
+    } else if (!strcasecmp(jio->valuestring, "input")) {
+        v = cJSON_GetObjectItemCaseSensitive(p, "value");
+        if (cJSON_IsNumber(v)) shadow_set(dev, IO_INPUT, jid->valueint, v->valueint ? 1 : 0);
+    }
+}
+
+bool router_shadow_get(const char *dev, io_kind_t kind, int io_id, uint32_t max_age_ms,
+                       int *val, uint32_t *age_ms){
+    if (!dev || (unsigned)kind >= SH_KINDS || io_id < 0 || io_id >= ROUTER_SHADOW_CH) return false;
+    bool hit = false;
+    uint32_t now = now_ms32();
+    portENTER_CRITICAL(&s_sh_mux);
+    const shadow_dev_t *d = sh_find_unsafe(dev);
+    if (d && d->val[kind][io_id] >= 0) {
+        uint32_t age = now - d->t_ms[kind][io_id];
+        if (age <= max_age_ms) {
+            hit = true;
+            if (val)    *val = d->val[kind][io_id];
+            if (age_ms) *age_ms = age;
+        }
+    }
+    portEXIT_CRITICAL(&s_sh_mux);
+    return hit;
+}
+
+// READ naar een child uit de shadow beantwoorden; false = live via de mesh
+static bool shadow_answer(const parser_msg_t *m){
+    if (m->action != ACT_READ || !CB.mqtt_pub) return false;
+    uint32_t max_age = m->params.has_max_age_ms ? (uint32_t)m->params.max_age_ms : ROUTER_SHADOW_MAX_AGE_MS;
+    int val; uint32_t age;
+    if (!max_age || !router_shadow_get(m->target_dev, m->io_kind, m->io_id, max_age, &val, &age)) return false;
+
+    // zelfde velden als het EVENT van de child, plus de leeftijd van de waarde
+    char topic[96], body[256];
+    snprintf(topic, sizeof topic, "Devices/%s/State", m->target_dev);
+    jw_t w; jw_init(&w, body, sizeof body);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", m->corr_id);
+    jw_str(&w, "dev",     m->target_dev);
+    jw_str(&w, "status",  stat_str(ROUTER_OK));
+    jw_str(&w, "io",      parser_iokind_str(m->io_kind));
+    jw_int(&w, "io_id",   m->io_id);
+    switch (m->io_kind) {
+        case IO_RELAY: jw_str(&w, "state", val ? "ON" : "OFF"); break;
+        case IO_PWM:   jw_int(&w, "brightness_pct", val);        break;
+        default:       jw_int(&w, "value", val);                 break;
+    }
+    jw_str(&w,  "source", "shadow");
+    jw_uint(&w, "age_ms", age);
+    jw_obj_end(&w);
+    if (!jw_done(&w)) return false;
+    CB.mqtt_pub(topic, body, /*qos=*/1, /*retain=*/false);
+    dd_record(m->corr_id, m->target_dev, topic, body, kind_from_msg(m));
+    return true;
+}
+
+// doeltoestel of groep (dedup-sleutel, foutmeldingen)
+static const char *msg_dest(const parser_msg_t *m){
+    return m->group[0] ? m->group : m->target_dev;
+}
+
+router_status_t router_handle(const parser_msg_t *m){
+    if (!m) return ROUTER_ERR_INTERNAL;
+    // QoS1-herlevering: niet opnieuw uitvoeren, enkel het antwoord herhalen
+    if (!m->meta.corr_generated && !dd_claim(m->corr_id, msg_dest(m))) {
+        ESP_LOGI("router", "duplicaat corr=%s → replay", m->corr_id);
+        dd_replay(m->corr_id, 0);
+        return ROUTER_OK;
+    }
+    // READ naar een child: recente waarde uit de shadow, zonder radio
+    if (!m->group[0] && strcmp(m->target_dev, g_local_dev) != 0 && shadow_answer(m)) return ROUTER_OK;
+    mesh_prio_t prio = router_classify(m);
+    lat_bind(m->corr, (uint8_t)m->io_kind);   // gesampeld commando: trace volgt voortaan de corr
+    if (!s_lane_sem) return dispatch_msg(m, prio);
+
+    lane_item_t it = { .m = *m };   // kopie gaat de queue in
+    snprintf(it.topic, sizeof it.topic, "%s", m->topic_hint ? m->topic_hint : "");
+    it.m.topic_hint = NULL;
+    if (!lane_push(prio, &it)) {
+        lat_drop(m->corr);
+        if (m->group[0]) publish_group_status(m->group, m->corr_id, stat_str(ROUTER_ERR_BUSY));
+        else             publish_state(m, ROUTER_ERR_BUSY, "lane full", 0, false, 0, false);
+        dd_forget(m->corr_id);
+        return ROUTER_ERR_BUSY;
+    }
+    return ROUTER_OK;   // aanvaard; State volgt na uitvoering
+}
+
+// ---------- batch ----------
+// Eén State/EVENT per doeltoestel: status OK (alles gelukt), PARTIAL of ERROR (niets gelukt)
+static const char *batch_status_str(int n_ok, int n){
+    if (n_ok == n) return "OK";
+    return n_ok ? "PARTIAL" : "ERROR";
+}
+
+static void publish_batch_state(const char *corr, const char *dev, cJSON *items, int n_ok, int n){
+    if (!CB.mqtt_pub) { cJSON_Delete(items); return; }
+
+    char topic[96];
+    snprintf(topic, sizeof(topic), "Devices/%s/State", dev);
+
+    jw_t w;
+    if (!jw_init_pooled(&w)) ESP_LOGW("router", "json_wr-pool leeg → batch-State %s valt weg", corr);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", corr);
+    jw_str(&w, "dev",     dev);
+    jw_str(&w, "status",  batch_status_str(n_ok, n));
+    jw_cjson(&w, "items", items);
+    jw_obj_end(&w);
+    const char *js = jw_done(&w);
+    if (js) { CB.mqtt_pub(topic, js, /*qos=*/1, /*retain=*/false); dd_record(corr, dev, topic, js, ML_KIND_DIAG); }
+    jw_release(&w);
+    cJSON_Delete(items);
+}
+
+// Via de lanes (één uitvoerende taak voor de drivers); de caller wacht tot de batch
+// verwerkt is, want parser_batch_t blijft zijn opslag. Elke caller wacht op zijn eigen
+// semafoor (geen heap), dus ook vanuit meerdere taken tegelijk.
+router_status_t router_handle_batch(const parser_batch_t *b){
+    if (!b || !b->ok) return ROUTER_ERR_INVALID;
+    if (b->count && !b->corr_generated) {
+        if (!dd_claim(b->corr_id, msg_dest(&b->msg[0]))) {
+            ESP_LOGI("router", "duplicaat batch corr=%s → replay", b->corr_id);
+            dd_replay(b->corr_id, 0);
+            return ROUTER_OK;
+        }
+        for (int i = 1; i < b->count; ++i) dd_add(b->corr_id, msg_dest(&b->msg[i]));
+    }
+    if (!s_lane_sem || !b->count) return dispatch_batch(b);
+
+    mesh_prio_t prio = ML_PRIO_READ;
+    for (int i = 0; i < b->count; ++i)
+        if (router_classify(&b->msg[i]) < prio) prio = router_classify(&b->msg[i]);
+
+    router_status_t res = ROUTER_OK;
+    StaticSemaphore_t done_buf;
+    lane_item_t it = { .batch = b, .res = &res, .done = xSemaphoreCreateBinaryStatic(&done_buf) };
+    if (!lane_push(prio, &it)) {
+        if (b->msg[0].group[0]) publish_group_status(b->msg[0].group, b->corr_id, stat_str(ROUTER_ERR_BUSY));
+        else publish_corr_status(b->msg[0].target_dev, b->corr_id, stat_str(ROUTER_ERR_BUSY), NULL);
+        dd_forget(b->corr_id);
+        vSemaphoreDelete(it.done);
+        return ROUTER_ERR_BUSY;
+    }
+    xSemaphoreTake(it.done, portMAX_DELAY);
+    vSemaphoreDelete(it.done);
+    return res;
+}
+
+static router_status_t dispatch_batch(const parser_batch_t *b){
+
+    router_status_t res = ROUTER_OK;
+    bool done[PARSER_BATCH_MAX] = {0};
+
+    // items per doeltoestel (of groep) groeperen (volgorde binnen een toestel blijft behouden)
+    for (int i = 0; i < b->count; ++i) {
+        if (done[i]) continue;
+        const char *dev = b->msg[i].target_dev;
+        const char *grp = b->msg[i].group[0] ? b->msg[i].group : NULL;
+        const bool local = !grp && (strcmp(dev, g_local_dev) == 0);
+        cJSON *items = cJSON_CreateArray();
+        cJSON *lres = (grp && group_is_member(grp, g_local_dev)) ? cJSON_CreateArray() : NULL;
+        int n = 0, n_ok = 0;
+        mesh_prio_t prio = ML_PRIO_READ;           // frame krijgt de hoogste klasse van zijn items
+
+        for (int j = i; j < b->count; ++j) {
+            const parser_msg_t *m = &b->msg[j];
+            if (done[j] || strcmp(m->target_dev, dev) != 0 || strcmp(m->group, b->msg[i].group) != 0) continue;
+            done[j] = true;
+            if (router_classify(m) < prio) prio = router_classify(m);
+
+            cJSON *it = mesh_payload_from_msg(m);
+            cJSON_AddNumberToObject(it, "i", b->index[j]);
+            if (local) {
+                int value = 0, pct = 0; bool has_val=false, has_pct=false;
+                router_status_t st = exec_local(m, &value, &has_val, &pct, &has_pct);
+                cJSON_AddStringToObject(it, "corr_id", m->corr_id);
+                cJSON_AddStringToObject(it, "status", stat_str(st));
+                if (has_val) cJSON_AddNumberToObject(it, "value", value);
+                if (has_pct) cJSON_AddNumberToObject(it, "brightness_pct", pct);
+                if (st == ROUTER_OK) n_ok++;
+                else if (res == ROUTER_OK) res = st;
+            } else if (lres) {
+                // root is lid van de groep: zijn deel meteen lokaal
+                router_status_t st;
+                cJSON *r = local_item(m, &st);
+                cJSON_AddNumberToObject(r, "i", b->index[j]);
+                cJSON_AddItemToArray(lres, r);
+                if (st == ROUTER_OK) n_ok++;
+                else if (res == ROUTER_OK) res = st;
+            }
+            cJSON_AddItemToArray(items, it);
+            n++;
+        }
+
+        if (local) {
+            publish_batch_state(b->corr_id, dev, items, n_ok, n);
+        } else if (grp) {
+            // één groepsframe met alle items; elk lid antwoordt met één gebundeld EVENT
+            cJSON *payload = cJSON_CreateObject();
+            cJSON_AddItemToObject(payload, "cmds", items);
+            cJSON *agg = NULL;
+            if (lres) {
+                agg = cJSON_CreateObject();
+                cJSON_AddStringToObject(agg, "status", batch_status_str(n_ok, n));
+                cJSON_AddItemToObject(agg, "items", lres);
+            }
+            router_status_t gs = group_send(grp, b->corr_id, b->corr, b->msg[i].topic_hint,
+                                            kind_from_msg(&b->msg[i]), payload, prio, agg);
+            if (gs != ROUTER_OK && res == ROUTER_OK) res = gs;
+            cJSON_Delete(payload);
+        } else {
+            // één mesh-frame per child; child antwoordt met één gebundeld EVENT
+            cJSON *payload = cJSON_CreateObject();
+            cJSON_AddItemToObject(payload, "cmds", items);
+            coalesce_flush_dev(dev);                  // eerdere losse commando's eerst
+            corr_remember(b->corr, dev, b->corr_id);   // één entry per child (elk zijn eigen EVENT)
+            router_send_cmd_to_target(dev, b->msg[i].topic_hint, kind_from_msg(&b->msg[i]), payload, b->corr, prio);
+            cJSON_Delete(payload);
+        }
+    }
+    return res;
+}
+
 // --- hieronder tbv Wifi Mesh
 
 static int io_from_str(const char *s){
@@ -169,46 +1574,63 @@ static int action_from_str(const char *s){
     return ACT_SET;
 }
 
-void router_execute_local(mesh_kind_t kind, const cJSON *payload,
-                          uint32_t corr_id, const char *origin_set_topic)
+// "params" uit mesh_payload_from_msg(); al gevalideerd door de parser op de root
+static void param_from_json(const cJSON *jpar, const char *key, int *val, bool *has){
+    const cJSON *j = cJSON_GetObjectItemCaseSensitive(jpar, key);
+    if (!cJSON_IsNumber(j)) return;
+    *val = j->valueint;
+    *has = true;
+}
+
+router_status_t router_execute_local(mesh_kind_t kind, const cJSON *payload,
+                                     corr_id_t corr_id, const char *origin_set_topic)
 {
     (void)kind; (void)origin_set_topic;
 
     const cJSON *jio   = cJSON_GetObjectItemCaseSensitive(payload, "io");
     const cJSON *jioid = cJSON_GetObjectItemCaseSensitive(payload, "io_id");
     const cJSON *jact  = cJSON_GetObjectItemCaseSensitive(payload, "action");
-    // const cJSON *jpar  = cJSON_GetObjectItemCaseSensitive(payload, "params"); // TODO: later voor PWM
+    const cJSON *jpar  = cJSON_GetObjectItemCaseSensitive(payload, "params");
 
     parser_msg_t m = (parser_msg_t){0};
+    m.topic_hint = "";   // geen MQTT-topic op het mesh-pad
 
     // arrays invullen met snprintf (géén pointer-assign!)
     snprintf(m.target_dev, sizeof m.target_dev, "%s", g_local_dev);
-    snprintf(m.corr_id,   sizeof m.corr_id,   "%08X", (unsigned)corr_id);
+    m.corr = corr_id;    // binair doorgeven; de client-string blijft op de root
 
     m.io_kind = io_from_str(cJSON_IsString(jio)   ? jio->valuestring   : NULL);
     m.io_id   =            cJSON_IsNumber(jioid) ? jioid->valueint     : 0;
     m.action  = action_from_str(cJSON_IsString(jact)  ? jact->valuestring  : NULL);
 
-    // m.params voorlopig niet vullen (jouw type ≠ cJSON)
+    if (cJSON_IsObject(jpar)) {
+        parser_params_t *P = &m.params;
+        param_from_json(jpar, "duration_ms",    &P->duration_ms,    &P->has_duration_ms);
+        param_from_json(jpar, "brightness_pct", &P->brightness_pct, &P->has_brightness_pct);
+        param_from_json(jpar, "ramp_ms",        &P->ramp_ms,        &P->has_ramp_ms);
+        param_from_json(jpar, "debounce_ms",    &P->debounce_ms,    &P->has_debounce_ms);
+    }
 
+    router_status_t st = ROUTER_ERR_INVALID;
     switch (m.io_kind){
         case IO_RELAY:
-            if (CB.exec_relay) (void)CB.exec_relay(&m);
+            if (CB.exec_relay) st = CB.exec_relay(&m);
             break;
         case IO_PWM: {
             int pct = 0;
-            if (CB.exec_pwm) (void)CB.exec_pwm(&m, &pct);
+            if (CB.exec_pwm) st = CB.exec_pwm(&m, &pct);
             break;
         }
         case IO_INPUT: {
             if (m.action == ACT_READ && CB.exec_input){
-                int val=0; (void)CB.exec_input(&m, &val);
+                int val=0; st = CB.exec_input(&m, &val);
             }
             break;
         }
         default: break;
     }
     // GEEN MQTT publish hier; drivers sturen later EVENT via router_emit_event(...)
+    return st;
 }
 
 
@@ -228,11 +1650,96 @@ void derive_state_topic(const char *set_topic, char *out, size_t out_sz){
     snprintf(out, out_sz, "Devices/%s/State", g_local_dev);
 }
 
+// ---------- batch-capture (child) ----------
+// Tijdens een batch-REQUEST worden de EVENTs van de drivers (uit dezelfde taak)
+// niet verstuurd maar verzameld; na het laatste item gaat één EVENT naar de root.
+static struct {
+    TaskHandle_t task;
+    cJSON       *items;
+    int          index;     // cmds-positie van het lopende item
+    const cJSON *corr;      // client-corr_id van het item (coalesced frame), anders NULL
+    bool         emitted;
+} s_cap;
+
+// uitvoeringstijd op de child (REQUEST → EVENT), reist mee in de envelop voor lat_trace
+static struct {
+    TaskHandle_t task;
+    int64_t      t0_us;
+} s_exec;
+
+static void exec_begin(void){
+    s_exec.t0_us = esp_timer_get_time();
+    s_exec.task  = xTaskGetCurrentTaskHandle();
+}
+
+static void exec_end(void){ s_exec.task = NULL; }
+
+static uint32_t exec_us(void){
+    if (s_exec.task != xTaskGetCurrentTaskHandle()) return 0;   // later EVENT (timer, input)
+    int64_t d = esp_timer_get_time() - s_exec.t0_us;
+    return d > 0 ? (uint32_t)d : 1;
+}
+
+static bool capture_event(const cJSON *state_payload){
+    if (!s_cap.items || s_cap.task != xTaskGetCurrentTaskHandle()) return false;
+    cJSON *it = state_payload ? cJSON_Duplicate(state_payload, 1) : cJSON_CreateObject();
+    cJSON_AddNumberToObject(it, "i", s_cap.index);
+    if (s_cap.corr) cJSON_AddStringToObject(it, "corr_id", s_cap.corr->valuestring);
+    cJSON_AddStringToObject(it, "status", "OK");
+    cJSON_AddItemToArray(s_cap.items, it);
+    s_cap.emitted = true;
+    return true;
+}
+
+static void execute_batch_local(mesh_kind_t kind, corr_id_t corr_id, const char *origin, const cJSON *cmds){
+    s_cap.task  = xTaskGetCurrentTaskHandle();
+    s_cap.items = cJSON_CreateArray();
+    int n = 0, n_ok = 0;
+
+    const cJSON *c;
+    cJSON_ArrayForEach(c, cmds) {
+        const cJSON *ji = cJSON_GetObjectItemCaseSensitive(c, "i");
+        const cJSON *jc = cJSON_GetObjectItemCaseSensitive(c, "corr_id");
+        s_cap.index   = cJSON_IsNumber(ji) ? ji->valueint : n;
+        s_cap.corr    = cJSON_IsString(jc) ? jc : NULL;
+        s_cap.emitted = false;
+        router_status_t st = router_execute_local(kind, c, corr_id, origin);
+        if (!s_cap.emitted) {
+            // driver gaf geen EVENT (fout of niets te melden) → item toch rapporteren
+            cJSON *it = cJSON_Duplicate(c, 1);
+            cJSON_DeleteItemFromObjectCaseSensitive(it, "i");
+            cJSON_AddNumberToObject(it, "i", s_cap.index);
+            cJSON_AddStringToObject(it, "status", stat_str(st));
+            cJSON_AddItemToArray(s_cap.items, it);
+        }
+        if (st == ROUTER_OK) n_ok++;
+        n++;
+    }
+
+    cJSON *agg = cJSON_CreateObject();
+    cJSON_AddStringToObject(agg, "dev",    g_local_dev);
+    cJSON_AddStringToObject(agg, "status", batch_status_str(n_ok, n));
+    cJSON_AddItemToObject(agg,   "items",  s_cap.items);
+    s_cap.items = NULL;
+
+    router_emit_event(kind, corr_id, origin, agg);
+    cJSON_Delete(agg);
+}
+
 // ---------- router_emit_event ----------
 // drivers (child) → EVENT naar root sturen na fysieke actie
-void router_emit_event(mesh_kind_t kind, uint32_t corr_id,
+void router_emit_event(mesh_kind_t kind, corr_id_t corr_id,
                        const char *origin_set_topic, const cJSON *state_payload)
 {
+    if (capture_event(state_payload)) return;   // deel van een lopende batch
+    if (corr_id && ROUTER_DEDUP_SLOTS) {
+        // antwoord bewaren: een herhaalde REQUEST krijgt dit EVENT opnieuw
+        char key[17], body[ROUTER_DEDUP_BODY];
+        corr_hex(corr_id, key);
+        jw_t w; jw_init(&w, body, sizeof body);
+        jw_cjson(&w, NULL, state_payload);
+        dd_record(key, g_local_dev, origin_set_topic, jw_done(&w), kind);
+    }
     mesh_envelope_t ev = {
         .schema="v1",
         .corr_id=corr_id,
@@ -242,47 +1749,104 @@ void router_emit_event(mesh_kind_t kind, uint32_t corr_id,
         .kind=kind,
         .ttl=3, .hop=0,
         .origin_set_topic=origin_set_topic,
-        .payload=(cJSON*)state_payload
+        .payload=(cJSON*)state_payload,
+        .exec_us=exec_us()
     };
     (void)mesh_send_event(&ev);
 }
 
-// 1) Root: stuur naar child via mesh (non-local target)
+static router_status_t status_from_mesh(mesh_status_t st){
+    switch (st){
+        case MESH_OK:       return ROUTER_OK;
+        case MESH_NO_ROUTE: return ROUTER_ERR_NO_ROUTE;
+        case MESH_TIMEOUT:  return ROUTER_ERR_TIMEOUT;
+        default:            return ROUTER_ERR_INTERNAL;
+    }
+}
+
+// geen EVENT te verwachten → State met de fout, onder de client-corr_id
+static void publish_mesh_failure(corr_id_t corr_id, const char *dev, mesh_status_t st){
+    lat_drop(corr_id);
+    if (group_fail(corr_id, dev, stat_str(status_from_mesh(st)))) return;   // unicast-terugval van een groep
+    char corr[PARSER_CORR_MAX] = "";
+    (void)corr_take(corr_id, dev, corr, sizeof corr, NULL);
+    ESP_LOGW("router", "mesh → %s mislukt (%s) corr=%s", dev, stat_str(status_from_mesh(st)), corr);
+    if (!dev || !*dev) return;
+    publish_corr_status(dev, corr, stat_str(status_from_mesh(st)), NULL);
+    // coalesced frame: ook de andere items melden
+    corr_id_t sib;
+    while (corr_take_sibling(corr_id, dev, &sib, corr, sizeof corr)) {
+        lat_drop(sib);
+        publish_corr_status(dev, corr, stat_str(status_from_mesh(st)), NULL);
+    }
+}
+
+// mesh-completion (worker van de backend): enkel fouten; bij OK volgt het EVENT
+static void on_mesh_done(corr_id_t corr_id, const char *dst_dev, mesh_status_t st, void *user){
+    (void)user;
+    if (st != MESH_OK) publish_mesh_failure(corr_id, dst_dev, st);
+}
+
+// 1) Root: stuur naar child via mesh (non-local target); blokkeert niet op de round-trip
 void router_send_cmd_to_target(const char *target_dev,
                                const char *origin_set_topic,
                                mesh_kind_t kind,
                                const cJSON *payload,
-                               uint32_t corr_id)
+                               corr_id_t corr_id,
+                               mesh_prio_t prio)
 {
     const char *local = g_local_dev;
 
     if (strcmp(target_dev, local)==0){
-        router_execute_local(kind, payload, corr_id, origin_set_topic);
+        (void)router_execute_local(kind, payload, corr_id, origin_set_topic);
         return;
     }
 
     mesh_envelope_t env = {
         .schema="v1",
         .corr_id=corr_id,
-        .ts_ms=0,                    // backend vult evt. in
+        .ts_ms=0,                    // 0 → mesh_link vult de mesh-tijd in
         .src_dev=local,
         .dst_dev=target_dev,
         .kind=kind,
+        .prio=prio,
         .ttl=3, .hop=0,
         .origin_set_topic=origin_set_topic,
         .payload=(cJSON*)payload
     };
-    mesh_status_t st = mesh_request(&env, 1000);
-    if (st!=MESH_OK){
-        // publiceer jouw ERROR zoals je al deed
-        // router_publish_error(corr_id, st==MESH_NO_ROUTE?"NO_ROUTE":"TIMEOUT");
-    }
+    mesh_status_t st = mesh_request_async(&env, ROUTER_MESH_TIMEOUT_MS, on_mesh_done, NULL);
+    if (st!=MESH_OK) publish_mesh_failure(corr_id, target_dev, st);   // geen callback meer
     // Succes: uiteindelijke State komt als EVENT via router_handle_mesh_event()
 }
 
 // 2a) Child: ontvangen REQUEST → voer lokaal uit (géén MQTT publish hier)
 void router_handle_mesh_request(const mesh_envelope_t *req){
-    router_execute_local(req->kind, req->payload, req->corr_id, req->origin_set_topic);
+    // herhaalde REQUEST (retransmit/dubbele levering): niet opnieuw uitvoeren
+    char key[17] = "";
+    if (req->corr_id) {
+        corr_hex(req->corr_id, key);
+        if (!dd_claim(key, g_local_dev)) { dd_replay(key, req->corr_id); return; }
+    }
+    if (s_lane_sem && req->payload) {
+        // via de lanes: zelfde volgorde als op de root (payload leeft enkel tijdens deze callback)
+        lane_item_t it = { .from_mesh = true, .kind = req->kind, .corr = req->corr_id,
+                           .payload = cJSON_Duplicate(req->payload, 1) };
+        snprintf(it.topic, sizeof it.topic, "%s", req->origin_set_topic ? req->origin_set_topic : "");
+        if (it.payload && lane_push(classify_payload(req), &it)) return;
+        cJSON_Delete(it.payload);
+        dd_forget(key);
+        cJSON *st = cJSON_CreateObject();
+        cJSON_AddStringToObject(st, "dev",    g_local_dev);
+        cJSON_AddStringToObject(st, "status", stat_str(ROUTER_ERR_BUSY));
+        router_emit_event(req->kind, req->corr_id, req->origin_set_topic, st);
+        cJSON_Delete(st);
+        return;
+    }
+    exec_begin();
+    const cJSON *cmds = cJSON_GetObjectItemCaseSensitive(req->payload, "cmds");
+    if (cJSON_IsArray(cmds)) execute_batch_local(req->kind, req->corr_id, req->origin_set_topic, cmds);
+    else (void)router_execute_local(req->kind, req->payload, req->corr_id, req->origin_set_topic);
+    exec_end();
 }
 
 // 2b) Root: ontvangen EVENT → publiceer naar juiste State-topic
@@ -297,22 +1861,63 @@ void router_handle_mesh_event(const mesh_envelope_t *evt){
     if (is_hello){
         ESP_LOGI("router", "HELLO from %s -> publish Status/Info", evt->src_dev);
         publish_status_for(evt->src_dev, true);               // online (retain)
+        shadow_reset(evt->src_dev);
+        group_learn(evt->src_dev, evt->payload);
         char tinfo[160];
         snprintf(tinfo, sizeof(tinfo), "Devices/%s/Info", evt->src_dev);
-        char *js = cJSON_PrintUnformatted(evt->payload);
-        mqtt_link_publish(tinfo, js, 1, true);                // retain
-        free(js);
+        jw_t w;
+        if (jw_init_pooled(&w)) {
+            jw_cjson(&w, NULL, evt->payload);
+            const char *js = jw_done(&w);
+            if (js && CB.mqtt_pub) CB.mqtt_pub(tinfo, js, 1, true);    // retain
+            jw_release(&w);
+        }
         return;
     }
 
-    // 2) default: publiceer naar State (niet-retained)
+    // 2) shadow bijwerken (relay/PWM/input-waarden uit het EVENT)
+    if (cJSON_IsObject(evt->payload)) shadow_feed(evt->src_dev, evt->payload);
+
+    // 3) antwoord van een groepslid → in de geaggregeerde State
+    if (group_take(evt->corr_id, evt->src_dev, evt->payload)) return;
+    lat_event(evt->corr_id, evt->exec_us);
+
+    // coalesced frame: de andere items antwoorden in hetzelfde EVENT ("items")
+    corr_id_t sib[ROUTER_COALESCE_ITEMS];
+    int n_sib = 0;
+    while (n_sib < ROUTER_COALESCE_ITEMS && corr_take_sibling(evt->corr_id, evt->src_dev, &sib[n_sib], NULL, 0))
+        lat_event(sib[n_sib++], evt->exec_us);
+
+    // 4) corr terug naar de client-string + round-trip root→child→root
+    char corr[PARSER_CORR_MAX];
+    uint32_t rtt_ms = 0;
+    bool has_corr = evt->payload && evt->corr_id &&
+                    corr_take(evt->corr_id, evt->src_dev, corr, sizeof corr, &rtt_ms);
+    if (has_corr) ESP_LOGI("router", "corr=%s from=%s rtt=%" PRIu32 " ms", corr, evt->src_dev, rtt_ms);
+
+    // 5) default: publiceer naar State (niet-retained)
     char topic[160];
     if (evt->origin_set_topic && *evt->origin_set_topic)
         derive_state_topic(evt->origin_set_topic, topic, sizeof topic);
     else
         snprintf(topic, sizeof topic, "Devices/%s/State", evt->src_dev);
 
-    char *js = cJSON_PrintUnformatted(evt->payload);
-    mqtt_link_publish(topic, js, /*qos*/1, /*retain*/false);
-    free(js);
+    // payload-velden + corr_id/rtt_ms rechtstreeks in de pool-buffer (boom blijft ongewijzigd)
+    if (!evt->payload) return;
+    jw_t w;
+    if (!jw_init_pooled(&w)) { ESP_LOGW("router", "json_wr-pool leeg → EVENT van %s valt weg", evt->src_dev); return; }
+    if (cJSON_IsObject(evt->payload)) {
+        jw_obj(&w, NULL);
+        jw_cjson_fields(&w, evt->payload);
+        if (has_corr) { jw_str(&w, "corr_id", corr); jw_uint(&w, "rtt_ms", rtt_ms); }
+        jw_obj_end(&w);
+    } else {
+        jw_cjson(&w, NULL, evt->payload);
+    }
+    const char *js = jw_done(&w);
+    if (js && CB.mqtt_pub) CB.mqtt_pub(topic, js, /*qos*/1, /*retain*/false);
+    if (js && has_corr) dd_record(corr, evt->src_dev, topic, js, evt->kind);
+    jw_release(&w);
+    lat_done(evt->corr_id);
+    for (int i = 0; i < n_sib; ++i) lat_done(sib[i]);
 }
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include <string.h>
 #include <inttypes.h>
 #include "esp_log.h"
-#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include "wifi_link.h"
 #include "mqtt_link.h"
@@ -16,15 +18,12 @@
 #include "pwm_ctrl.h"
 #include "input_ctrl.h"
 #include "cJSON.h"
+#include "json_wr.h"
+#include "lat_trace.h"
 
 // --------------------------------------------------
 // Mesh/event helpers
 // --------------------------------------------------
-static inline uint32_t corr32(const char *s){
-    uint32_t h = 2166136261u; if (!s) return h;
-    for (; *s; s++){ h ^= (uint8_t)*s; h *= 16777619u; }
-    return h;
-}
 // Wordt gezet bij mesh-init; root publiceert zelf via router, child stuurt EVENTs upstream
 static bool s_is_root = false;   // auto-root: wordt gezet via mesh_root-callback
 static char s_local_dev[32] = MQTT_CLIENT_ID;
@@ -55,43 +54,434 @@ static bool s_mqtt_started = false;
 #ifndef MQTT_BASE_PREFIX
 #define MQTT_BASE_PREFIX "Devices"
 #endif
+#ifndef MESH_TIME_TOPIC
+#define MESH_TIME_TOPIC "Mesh/Time"   // broker → root: unix-tijd (03 §6)
+#endif
 
 // --------------------------------------------------
 // Helpers
 // --------------------------------------------------
 static void gen_corr_id_app(char out[48]){
-    uint32_t r0=esp_random(), r1=esp_random(), r2=esp_random(), r3=esp_random();
-    snprintf(out, 48,
-        "%08" PRIx32 "-%04" PRIx16 "-%04" PRIx16 "-%04" PRIx16 "-%08" PRIx32,
-        r0, (uint16_t)(r1 & 0xFFFF), (uint16_t)((r1>>16) & 0xFFFF), (uint16_t)(r2 & 0xFFFF), r3);
+    snprintf(out, 48, "%016" PRIx64, parser_corr_new());   // zelfde vorm als de parser
 }
 
-static void publish_parse_error(const parser_result_t *r, const char *local_dev){
+static void publish_parse_error(const parser_error_t *e, const char *corr_id, const char *local_dev){
     char corr[48];
-    const char *cid = (r->msg.corr_id[0] ? r->msg.corr_id : (gen_corr_id_app(corr), corr));
+    const char *cid = ((corr_id && corr_id[0]) ? corr_id : (gen_corr_id_app(corr), corr));
 
     char topic[96];
     snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/State", local_dev ? local_dev : "");
 
-    // JSON veilig opbouwen zonder vaste buffer
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "corr_id", cid ? cid : "");
-    cJSON_AddStringToObject(root, "dev",     local_dev ? local_dev : "");
-    cJSON_AddStringToObject(root, "status",  "ERROR");
-    cJSON_AddStringToObject(root, "code",    parser_err_str(r->error.code));
-    cJSON_AddStringToObject(root, "path",   (r->error.path[0]   ? r->error.path   : ""));
-    cJSON_AddStringToObject(root, "detail", (r->error.detail[0] ? r->error.detail : ""));
-
-    char *payload = cJSON_PrintUnformatted(root);   // alloc
-    mqtt_link_publish_cb(topic, payload ? payload : "{}", 1, false);
-    if (payload) free(payload);
-    cJSON_Delete(root);
+    char body[256];
+    jw_t w; jw_init(&w, body, sizeof body);
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", cid ? cid : "");
+    jw_str(&w, "dev",     local_dev ? local_dev : "");
+    jw_str(&w, "status",  "ERROR");
+    jw_str(&w, "code",    parser_err_str(e->code));
+    jw_str(&w, "path",    e->path);
+    jw_str(&w, "detail",  e->detail);
+    jw_obj_end(&w);
+    mqtt_link_publish_cb(topic, jw_done(&w) ? body : "{}", 1, false);
+}
+
+// Batch: per-item parsefouten gebundeld in één ERROR-State, met hun cmds-index
+static void publish_batch_errors(const parser_batch_t *b, const char *local_dev){
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/State", local_dev ? local_dev : "");
+
+    jw_t w;   // tot PARSER_BATCH_MAX fouten: pool-buffer i.p.v. de stack van de RX-taak
+    if (!jw_init_pooled(&w)) { ESP_LOGW("MQ_RX", "json_wr-pool leeg → batch-fouten %s niet gemeld", b->corr_id); return; }
+    jw_obj(&w, NULL);
+    jw_str(&w, "corr_id", b->corr_id);
+    jw_str(&w, "dev",     local_dev ? local_dev : "");
+    jw_str(&w, "status",  "ERROR");
+    jw_arr(&w, "errors");
+    for (int i = 0; i < b->err_count; ++i) {
+        const parser_item_error_t *e = &b->errors[i];
+        char path[64];   // pad relatief aan de batch, zodat de client het item terugvindt
+        snprintf(path, sizeof(path), "cmds[%u]%s%s", (unsigned)e->index, e->error.path[0] ? "." : "", e->error.path);
+        jw_obj(&w, NULL);
+        jw_int(&w, "i",      e->index);
+        jw_str(&w, "code",   parser_err_str(e->error.code));
+        jw_str(&w, "path",   path);
+        jw_str(&w, "detail", e->error.detail);
+        jw_obj_end(&w);
+    }
+    jw_arr_end(&w);
+    jw_obj_end(&w);
+    const char *js = jw_done(&w);
+    mqtt_link_publish_cb(topic, js ? js : "{}", 1, false);
+    jw_release(&w);
+}
+
+// Parser-kost per periode als machine-leesbare JSON (regressies volgen tussen releases).
+// De parser gebruikt geen heap (zie parser.h); stack = vrije ruimte van de RX-taak.
+#ifndef PARSER_STATS_PERIOD_S
+#define PARSER_STATS_PERIOD_S 60
+#endif
+static TaskHandle_t s_rx_task;   // MQTT-taak die parset (voor de stack-watermark)
+
+static void publish_parser_stats(void){
+    parser_stats_t st;
+    parser_stats_get(&st, true);   // telt per periode
+    if (!st.n) return;
+
+    char topic[96], body[256];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/Parser", s_local_dev);
+    snprintf(body, sizeof(body),
+        "{\"dev\":\"%s\",\"period_s\":%d,\"n\":%" PRIu32 ",\"err\":%" PRIu32
+        ",\"avg_ns\":%" PRIu64 ",\"max_us\":%" PRIu32 ",\"cache_hit\":%" PRIu32
+        ",\"cache_miss\":%" PRIu32 ",\"stack_free\":%u}",
+        s_local_dev, PARSER_STATS_PERIOD_S, st.n, st.n_err,
+        st.total_ns / st.n, st.max_us, st.cache_hit, st.cache_miss,
+        s_rx_task ? (unsigned)uxTaskGetStackHighWaterMark(s_rx_task) : 0u);
+    mqtt_link_publish(topic, body, 0, false);
+}
+
+// Router: uitgespaarde mesh-frames (coalescing), duplicaten en latentie per priority lane
+static void publish_router_stats(void){
+    router_coalesce_stats_t st;
+    router_dedup_stats_t dd;
+    router_lane_stats_t lanes[ROUTER_LANES];
+    router_coalesce_stats_get(&st, true);
+    router_dedup_stats_get(&dd, true);
+    router_lane_stats_get(lanes, true);
+    uint32_t n_lane = 0;
+    for (int c = 0; c < ROUTER_LANES; ++c) n_lane += lanes[c].n + lanes[c].dropped;
+    if (!st.cmds && !n_lane && !dd.dups) return;
+
+    static const char *const lane_name[ROUTER_LANES] = { "safety", "switch", "setpoint", "read" };
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/Router", s_local_dev);
+    jw_t w;
+    if (!jw_init_pooled(&w)) return;
+    jw_obj(&w, NULL);
+    jw_str(&w,  "dev",          s_local_dev);
+    jw_int(&w,  "period_s",     PARSER_STATS_PERIOD_S);
+    jw_uint(&w, "cmds",         st.cmds);
+    jw_uint(&w, "frames",       st.frames);
+    jw_uint(&w, "frames_saved", st.cmds > st.frames ? st.cmds - st.frames : 0u);
+    jw_uint(&w, "collapsed",    st.collapsed);
+    jw_uint(&w, "dups",         dd.dups);
+    jw_uint(&w, "replayed",     dd.replayed);
+    jw_obj(&w, "lanes");
+    for (int c = 0; c < ROUTER_LANES; ++c) {
+        if (!lanes[c].n && !lanes[c].dropped) continue;
+        jw_obj(&w, lane_name[c]);
+        jw_uint(&w, "n",       lanes[c].n);
+        jw_uint(&w, "dropped", lanes[c].dropped);
+        jw_uint(&w, "max_us",  lanes[c].max_us);
+        jw_arr(&w, "hist");
+        for (int b = 0; b < ROUTER_LAT_BUCKETS; ++b) jw_uint(&w, NULL, lanes[c].hist[b]);
+        jw_arr_end(&w);
+        jw_obj_end(&w);
+    }
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    const char *body = jw_done(&w);
+    if (body) mqtt_link_publish(topic, body, 0, false);
+    jw_release(&w);
+}
+
+// Latency per pijplijn-stap (steekproef, zie lat_trace.h): één bericht per io_kind
+static void publish_latency_stats(void){
+    static lat_stats_t s_lat[LAT_KINDS];   // ~2 KB → niet op de diag-stack
+    static const char *const kind_name[LAT_KINDS] = { "relay", "pwm", "input" };
+    uint32_t lost;
+    lat_stats_get(s_lat, &lost, true);
+
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/Latency", s_local_dev);
+    for (int k = 0; k < LAT_KINDS; ++k) {
+        if (!s_lat[k].st[LAT_TOTAL].n && !s_lat[k].st[LAT_ROUTE].n) continue;
+        jw_t w;
+        if (!jw_init_pooled(&w)) return;
+        jw_obj(&w, NULL);
+        jw_str(&w,  "dev",          s_local_dev);
+        jw_str(&w,  "io",           kind_name[k]);
+        jw_int(&w,  "period_s",     PARSER_STATS_PERIOD_S);
+        jw_int(&w,  "sample_every", LAT_SAMPLE_EVERY);
+        jw_uint(&w, "lost",         lost);
+        jw_arr(&w, "edges_us");
+        for (int b = 0; b < LAT_BUCKETS - 1; ++b) jw_uint(&w, NULL, lat_bucket_edge_us(b));
+        jw_arr_end(&w);
+        jw_obj(&w, "stages");
+        for (int st = 0; st < LAT_STAGES; ++st) {
+            const lat_hist_t *h = &s_lat[k].st[st];
+            if (!h->n) continue;
+            jw_obj(&w, lat_stage_name((lat_stage_t)st));
+            jw_uint(&w, "n",      h->n);
+            jw_uint(&w, "max_us", h->max_us);
+            jw_arr(&w, "hist");
+            for (int b = 0; b < LAT_BUCKETS; ++b) jw_uint(&w, NULL, h->hist[b]);
+            jw_arr_end(&w);
+            jw_obj_end(&w);
+        }
+        jw_obj_end(&w);
+        jw_obj_end(&w);
+        const char *body = jw_done(&w);
+        if (body) mqtt_link_publish(topic, body, 0, false);
+        jw_release(&w);
+    }
+}
+
+// Vloot (root): samenvatting + per toestel online/RSSI/laag/RTT, in delen van FLEET_PAGE
+#define FLEET_PAGE 12   // ~100 B per toestel → past in een pool-buffer
+static void publish_fleet_stats(void){
+    mesh_fleet_stats_t fs;
+    mesh_get_fleet_stats(&fs);
+    if (!fs.nodes) return;
+
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/Fleet", s_local_dev);
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    mesh_node_info_t nodes[FLEET_PAGE];
+    int pos = 0, n, page = 0;
+    do {
+        n = mesh_get_fleet(&pos, nodes, FLEET_PAGE);
+        if (!n && page) break;
+        jw_t w;
+        if (!jw_init_pooled(&w)) return;
+        jw_obj(&w, NULL);
+        jw_str(&w,  "dev",     s_local_dev);
+        jw_int(&w,  "page",    page++);
+        jw_uint(&w, "nodes",   fs.nodes);
+        jw_uint(&w, "online",  fs.online);
+        jw_uint(&w, "refused", fs.refused);
+        jw_uint(&w, "evicted", fs.evicted);
+        jw_arr(&w, "fleet");
+        for (int i = 0; i < n; ++i) {
+            const mesh_node_info_t *d = &nodes[i];
+            jw_obj(&w, NULL);
+            jw_str(&w,  "dev",    d->dev);
+            jw_bool(&w, "online", d->online);
+            jw_uint(&w, "age_s",  (now - d->last_ms) / 1000);
+            if (d->hello) {
+                jw_int(&w, "rssi",  d->rssi);
+                jw_int(&w, "layer", d->layer);
+                jw_arr(&w, "io");   // relays, pwm, inputs
+                jw_int(&w, NULL, d->relays); jw_int(&w, NULL, d->pwms); jw_int(&w, NULL, d->inputs);
+                jw_arr_end(&w);
+            }
+            if (d->srtt_ms) jw_uint(&w, "rtt_ms", d->srtt_ms);
+            jw_obj_end(&w);
+        }
+        jw_arr_end(&w);
+        jw_obj_end(&w);
+        const char *body = jw_done(&w);
+        if (body) mqtt_link_publish(topic, body, 0, false);
+        jw_release(&w);
+    } while (n == FLEET_PAGE);
+}
+
+// TX-queues van deze node (root): enkel bestemmingen met verkeer of een volle queue sinds
+// de vorige periode; tellers gaan daarna op 0
+#define TXQ_PAGE 12
+static void publish_txq_stats(void){
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/MeshTx", s_local_dev);
+    mesh_txq_info_t q[TXQ_PAGE];
+    int pos = 0, n, page = 0;
+    do {
+        n = mesh_get_txq(&pos, q, TXQ_PAGE, true);
+        if (!n) break;
+        jw_t w;
+        if (!jw_init_pooled(&w)) return;
+        jw_obj(&w, NULL);
+        jw_str(&w, "dev",  s_local_dev);
+        jw_int(&w, "page", page++);
+        jw_arr(&w, "queues");
+        for (int i = 0; i < n; ++i) {
+            const mesh_txq_info_t *d = &q[i];
+            if (!d->sent && !d->dropped && !d->expired && !d->busy && !d->depth) continue;
+            char mac[18];
+            snprintf(mac, sizeof mac, "%02x:%02x:%02x:%02x:%02x:%02x",
+                     d->mac[0], d->mac[1], d->mac[2], d->mac[3], d->mac[4], d->mac[5]);
+            jw_obj(&w, NULL);
+            jw_str(&w,  "to",        d->dev[0] ? d->dev : mac);
+            jw_uint(&w, "depth",     d->depth);
+            jw_uint(&w, "max_depth", d->max_depth);
+            jw_uint(&w, "inflight",  d->inflight);
+            jw_uint(&w, "sent",      d->sent);
+            jw_uint(&w, "dropped",   d->dropped);
+            jw_uint(&w, "expired",   d->expired);
+            jw_uint(&w, "busy",      d->busy);
+            jw_obj_end(&w);
+        }
+        jw_arr_end(&w);
+        jw_obj_end(&w);
+        const char *body = jw_done(&w);
+        if (body) mqtt_link_publish(topic, body, 0, false);
+        jw_release(&w);
+    } while (n == TXQ_PAGE);
+}
+
+// Ontvangst van deze node (root): framepool en dispatch-vertraging sinds de vorige periode
+static void publish_rx_stats(void){
+    mesh_rx_stats_t st;
+    if (mesh_get_rx_stats(&st, true) != MESH_OK) return;
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/MeshRx", s_local_dev);
+    jw_t w;
+    if (!jw_init_pooled(&w)) return;
+    jw_obj(&w, NULL);
+    jw_str(&w,  "dev",        s_local_dev);
+    jw_uint(&w, "pool",       st.pool);
+    jw_uint(&w, "workers",    st.workers);
+    jw_uint(&w, "frames",     st.frames);
+    jw_uint(&w, "dropped",    st.dropped);
+    jw_uint(&w, "min_free",   st.min_free);
+    jw_uint(&w, "lag_avg_us", st.lag_avg_us);
+    jw_uint(&w, "lag_max_us", st.lag_max_us);
+    jw_uint(&w, "run_max_us", st.run_max_us);
+    jw_obj_end(&w);
+    const char *body = jw_done(&w);
+    if (body) mqtt_link_publish(topic, body, 0, false);
+    jw_release(&w);
+}
+
+// enkel met de hybride backend (mesh + mailbox): ACK-tijd en afloop per pad
+static void publish_path_stats(void){
+    mesh_path_info_t p[2];
+    int n = mesh_get_paths(p, 2, true);
+    if (n <= 0) return;
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/MeshPath", s_local_dev);
+    jw_t w;
+    if (!jw_init_pooled(&w)) return;
+    jw_obj(&w, NULL);
+    jw_str(&w, "dev", s_local_dev);
+    jw_arr(&w, "paths");
+    for (int i = 0; i < n; ++i) {
+        jw_obj(&w, NULL);
+        jw_str(&w,  "path",     p[i].name);
+        jw_uint(&w, "sent",     p[i].sent);
+        jw_uint(&w, "ok",       p[i].ok);
+        jw_uint(&w, "timeout",  p[i].timeout);
+        jw_uint(&w, "no_route", p[i].no_route);
+        jw_uint(&w, "fallback", p[i].fallback);
+        jw_uint(&w, "probes",   p[i].probes);
+        jw_uint(&w, "srtt_ms",  p[i].srtt_ms);
+        jw_uint(&w, "max_ms",   p[i].max_ms);
+        jw_obj_end(&w);
+    }
+    jw_arr_end(&w);
+    jw_obj_end(&w);
+    const char *body = jw_done(&w);
+    if (body) mqtt_link_publish(topic, body, 0, false);
+    jw_release(&w);
+}
+
+// Mesh-tijd (root): per child offset, drift en geschatte fout, in delen zoals de vloot
+#define TIME_PAGE 12
+static void publish_time_stats(void){
+    char topic[96];
+    snprintf(topic, sizeof(topic), MQTT_BASE_PREFIX "/%s/Diag/MeshTime", s_local_dev);
+    mesh_time_info_t ti;
+    mesh_get_time_info(&ti);
+    mesh_time_node_t nodes[TIME_PAGE];
+    int pos = 0, n, page = 0;
+    do {
+        n = mesh_get_time_nodes(&pos, nodes, TIME_PAGE);
+        if (!n && page) break;
+        uint32_t err_max = 0;
+        uint64_t err_sum = 0;
+        for (int i = 0; i < n; ++i) {
+            if (nodes[i].err_us > err_max) err_max = nodes[i].err_us;
+            err_sum += nodes[i].err_us;
+        }
+        jw_t w;
+        if (!jw_init_pooled(&w)) return;
+        jw_obj(&w, NULL);
+        jw_str(&w,  "dev",     s_local_dev);
+        jw_int(&w,  "page",    page++);
+        jw_bool(&w, "wall",    ti.wall);
+        jw_uint(&w, "mesh_ms", mesh_time_now_ms());
+        jw_int(&w,  "nodes",   n);
+        if (n) {
+            jw_uint(&w, "err_max_us", err_max);
+            jw_uint(&w, "err_avg_us", (uint32_t)(err_sum / (uint64_t)n));
+        }
+        jw_arr(&w, "time");
+        for (int i = 0; i < n; ++i) {
+            const mesh_time_node_t *d = &nodes[i];
+            char mac[18];
+            snprintf(mac, sizeof mac, "%02x:%02x:%02x:%02x:%02x:%02x",
+                     d->mac[0], d->mac[1], d->mac[2], d->mac[3], d->mac[4], d->mac[5]);
+            jw_obj(&w, NULL);
+            jw_str(&w,  "dev",       d->dev[0] ? d->dev : mac);
+            jw_int(&w,  "offset_us", d->offset_us);
+            jw_int(&w,  "drift_ppb", d->drift_ppb);
+            jw_uint(&w, "rtt_us",    d->rtt_us);
+            jw_uint(&w, "err_us",    d->err_us);
+            jw_uint(&w, "samples",   d->samples);
+            jw_uint(&w, "rejected",  d->rejected);
+            jw_uint(&w, "age_s",     d->age_ms / 1000);
+            jw_obj_end(&w);
+        }
+        jw_arr_end(&w);
+        jw_obj_end(&w);
+        const char *body = jw_done(&w);
+        if (body) mqtt_link_publish(topic, body, 0, false);
+        jw_release(&w);
+    } while (n == TIME_PAGE);
+}
+
+static void publish_diag_stats(void){
+    if (!s_is_root || !s_mqtt_started) return;
+    publish_parser_stats();
+    publish_router_stats();
+    publish_latency_stats();
+    publish_fleet_stats();
+    publish_txq_stats();
+    publish_rx_stats();
+    publish_path_stats();
+    publish_time_stats();
+}
+
+// Eigen taak met lage prioriteit: mqtt_link_publish blokkeert en de pagina-buffers van de
+// publish_*-functies staan op de stack (tot ~0,9 KB). De timer wekt de taak enkel.
+#ifndef DIAG_TASK_STACK
+#define DIAG_TASK_STACK 4096
+#endif
+#ifndef DIAG_TASK_PRIO
+#define DIAG_TASK_PRIO  2
+#endif
+static TaskHandle_t s_diag_task;
+
+static void diag_task(void *arg){
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // gemiste periodes vallen samen
+        publish_diag_stats();
+    }
+}
+
+static void diag_timer_cb(void *arg){
+    (void)arg;
+    if (s_diag_task) xTaskNotifyGive(s_diag_task);
+}
+
+static void start_parser_stats(void){
+#if PARSER_STATS
+    static esp_timer_handle_t t;
+    if (t) return;
+    if (xTaskCreate(diag_task, "diag", DIAG_TASK_STACK, NULL, DIAG_TASK_PRIO, &s_diag_task) != pdPASS) {
+        ESP_LOGW("DIAG", "geen geheugen voor de diag-taak → geen Diag-publicaties");
+        return;
+    }
+    const esp_timer_create_args_t args = { .callback = &diag_timer_cb, .name = "diag_stats" };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &t));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(t, (uint64_t)PARSER_STATS_PERIOD_S * 1000000ULL));
+#endif
 }
 
 // --------------------------------------------------
 // MQTT lifecycle (auto-root)
 // --------------------------------------------------
 static void on_cmd_set(const char *json, const char *topic); // fwd
+static void on_cmd_set_bin(const uint8_t *data, size_t len, const char *topic); // fwd
 static void on_cfg_set(const char *json, const char *topic); // fwd
 
 static void start_mqtt_if_needed(void){
@@ -107,7 +497,8 @@ static void start_mqtt_if_needed(void){
     strlcpy(m.username,   MQTT_USER,        sizeof m.username);
     strlcpy(m.password,   MQTT_PASS,        sizeof m.password);
     m.is_root = true;
-    mqtt_cbs_t cbs = { .parser_entry=on_cmd_set, .config_set_entry=on_cfg_set, .now_ms=NULL };
+    mqtt_cbs_t cbs = { .parser_entry=on_cmd_set, .parser_bin_entry=on_cmd_set_bin,
+                       .config_set_entry=on_cfg_set, .now_ms=NULL };
     mqtt_link_init(&m, &cbs);
     s_mqtt_started = true;
 }
@@ -146,7 +537,7 @@ static router_status_t exec_relay(const parser_msg_t *m){
         cJSON_AddStringToObject(st, "io", "relay");
         cJSON_AddNumberToObject(st, "io_id", m->io_id);
         cJSON_AddStringToObject(st, "state", on ? "ON" : "OFF");
-        router_emit_event(ML_KIND_RELAY, corr32(m->corr_id), m->topic_hint, st);
+        router_emit_event(ML_KIND_RELAY, m->corr, m->topic_hint, st);
         cJSON_Delete(st);
     }
     return ROUTER_OK;
@@ -176,7 +567,7 @@ static router_status_t exec_pwm(const parser_msg_t *m, int *applied_pct){
         cJSON_AddStringToObject(st, "io", "pwm");
         cJSON_AddNumberToObject(st, "io_id", m->io_id);
         cJSON_AddNumberToObject(st, "brightness_pct", pct);
-        router_emit_event(ML_KIND_PWM, corr32(m->corr_id), m->topic_hint, st);
+        router_emit_event(ML_KIND_PWM, m->corr, m->topic_hint, st);
         cJSON_Delete(st);
     }
     return ROUTER_OK;
@@ -195,7 +586,7 @@ static router_status_t exec_input(const parser_msg_t *m, int *value){
         cJSON_AddStringToObject(st, "io", "input");
         cJSON_AddNumberToObject(st, "io_id", m->io_id);
         cJSON_AddNumberToObject(st, "value", lvl ? 1 : 0);
-        router_emit_event(ML_KIND_INPUT, corr32(m->corr_id), m->topic_hint, st);
+        router_emit_event(ML_KIND_INPUT, m->corr, m->topic_hint, st);
         cJSON_Delete(st);
     }
     return ROUTER_OK;
@@ -210,6 +601,7 @@ static void hook_router_init(const char *local_dev_name){
     };
     router_init(&rcbs);
     router_set_local_dev(local_dev_name);
+    cfg_groups_apply();   // root als lid van zijn eigen groepen
 }
 
 // --------------------------------------------------
@@ -217,10 +609,46 @@ static void hook_router_init(const char *local_dev_name){
 // --------------------------------------------------
 static void on_cmd_set(const char *json, const char *topic) {
     ESP_LOGI("MQ_RX","topic=%s json=%s", topic, json);
+    if (!s_rx_task) s_rx_task = xTaskGetCurrentTaskHandle();
     parser_meta_t meta = { .source=PARSER_SRC_MQTT, .topic_hint=topic };
-    parser_result_t r = parser_parse(json, &meta);
-    if (!r.ok) { publish_parse_error(&r, MQTT_CLIENT_ID); return; }
-    (void)router_handle(&r.msg);
+
+    if (parser_is_batch(json)) {
+        static parser_batch_t s_batch;   // groot → niet op de MQTT-taakstack
+        meta.flags = PARSER_F_DIAG;      // items delen één parse; fouten gaan per item terug
+        if (!parser_parse_batch(json, &meta, &s_batch)) {
+            publish_parse_error(&s_batch.error, s_batch.corr_id, MQTT_CLIENT_ID);
+            return;
+        }
+        if (s_batch.err_count) publish_batch_errors(&s_batch, MQTT_CLIENT_ID);
+        if (s_batch.count)     (void)router_handle_batch(&s_batch);
+        return;
+    }
+
+    static parser_result_t s_res;        // enkel vanuit de MQTT-taak
+    meta.flags = PARSER_F_CACHE;         // HA stuurt steeds dezelfde frames (enkel corr_id verschilt)
+    if (!parser_parse(json, &meta, &s_res)) {
+        meta.flags = PARSER_F_DIAG;      // foutpad: opnieuw mét detail voor de client
+        (void)parser_parse(json, &meta, &s_res);
+        publish_parse_error(&s_res.error, s_res.msg.corr_id, MQTT_CLIENT_ID);
+        return;
+    }
+    lat_rx_mark(LAT_PARSE);
+    (void)router_handle(&s_res.msg);
+}
+
+// binaire variant (Cmd/SetB of msgpack op Cmd/Set): zelfde pad na het decoderen
+static void on_cmd_set_bin(const uint8_t *data, size_t len, const char *topic) {
+    ESP_LOGI("MQ_RX","topic=%s bin=%u bytes", topic, (unsigned)len);
+    parser_meta_t meta = { .source=PARSER_SRC_MQTT, .topic_hint=topic };
+    static parser_result_t s_res;
+    if (!parser_parse_bin(data, len, &meta, &s_res)) {
+        meta.flags = PARSER_F_DIAG;
+        (void)parser_parse_bin(data, len, &meta, &s_res);
+        publish_parse_error(&s_res.error, s_res.msg.corr_id, MQTT_CLIENT_ID);
+        return;
+    }
+    lat_rx_mark(LAT_PARSE);
+    (void)router_handle(&s_res.msg);
 }
 
 // light helper to read target_dev for forwarding
@@ -253,6 +681,19 @@ static void on_cfg_set(const char *json, const char *topic) {
     cfg_mqtt_handle(json, MQTT_CLIENT_ID);
 }
 
+// Mesh/Time (broker → root): unix-tijd als basis van de mesh-tijd; children volgen via de mesh
+static void on_mesh_time(const char *topic, const char *json) {
+    if (!topic || strcmp(topic, MESH_TIME_TOPIC) != 0 || !json) return;
+    cJSON *root = cJSON_Parse(json);
+    if (!root) return;
+    const cJSON *ms = cJSON_GetObjectItemCaseSensitive(root, "unix_ms");
+    const cJSON *s  = cJSON_GetObjectItemCaseSensitive(root, "unix_time");
+    uint64_t unix_ms = cJSON_IsNumber(ms) ? (uint64_t)ms->valuedouble
+                     : cJSON_IsNumber(s)  ? (uint64_t)(s->valuedouble * 1000.0) : 0;
+    cJSON_Delete(root);
+    if (unix_ms) mesh_time_set_wall_ms(unix_ms);   // enkel de root neemt ze over
+}
+
 // --------------------------------------------------
 // Wi-Fi → MQTT boot
 // --------------------------------------------------
@@ -270,7 +711,7 @@ static void on_ip(void){
 static void on_mesh_root(bool is_root){
     s_is_root = is_root;
     if (is_root) start_mqtt_if_needed();
-    else         stop_mqtt_if_running();
+    else         { stop_mqtt_if_running(); cfg_publish_hello_now(); }   // (nieuwe) root leert o.a. onze groepen
 }
 
 
@@ -285,6 +726,8 @@ void app_main(void){
     if (cfg && cfg->dev_name[0]) {
         strlcpy(s_local_dev, cfg->dev_name, sizeof s_local_dev);
     }
+    parser_init();   // alias-hashindex één keer opbouwen
+    start_parser_stats();
 
     // 2) Drivers init met config
     relay_ctrl_init(cfg->relay_gpio, cfg->relay_count,
@@ -314,6 +757,7 @@ void app_main(void){
     // 4) Mesh init (na Wi‑Fi start) – auto-root: altijd als CHILD joinen
     mesh_register_rx(router_handle_mesh_request, router_handle_mesh_event);
     mesh_register_root_cb(on_mesh_root);
+    cfg_groups_apply();   // group-IDs: toegepast zodra de mesh start
 
     mesh_opts_t mo = {
         .role = MESH_ROLE_CHILD,          // hint voor jouw app-logica; driver kiest nog steeds de echte rol
@@ -322,6 +766,7 @@ void app_main(void){
         .default_ttl = 3
     };
     mesh_init(&mo);
+    mqtt_link_subscribe_extra(MESH_TIME_TOPIC, 1, on_mesh_time);   // actief zodra wij root zijn
 }
 
 
@@ -0,0 +1,126 @@
+// test/host_sim/components/esp_timer/esp_timer_host.c
+// esp_timer op de host: vaste tabel, één taak die op de vroegste deadline wacht.
+// Geen pthreads: de POSIX-port van FreeRTOS laat geen FreeRTOS-aanroepen toe
+// vanuit vreemde threads, en de callbacks (router) nemen semaforen.
+#include "esp_timer.h"
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define TIMER_TASK_STACK 4096
+#define TIMER_TASK_PRIO  (configMAX_PRIORITIES - 2)
+
+struct esp_timer {
+    esp_timer_cb_t cb;
+    void          *arg;
+    int64_t        due_us;      // 0 = niet actief
+    uint64_t       period_us;   // 0 = eenmalig
+    bool           used;
+};
+
+static struct esp_timer  s_timers[ESP_TIMER_HOST_MAX];
+static SemaphoreHandle_t s_lock;
+static TaskHandle_t      s_task;
+
+int64_t esp_timer_get_time(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void timer_task(void *arg){
+    (void)arg;
+    for (;;) {
+        int64_t now = esp_timer_get_time(), next = 0;
+        esp_timer_cb_t cb = NULL;
+        void *cb_arg = NULL;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int i = 0; i < ESP_TIMER_HOST_MAX; ++i) {
+            struct esp_timer *t = &s_timers[i];
+            if (!t->used || !t->due_us) continue;
+            if (!cb && t->due_us <= now) {
+                cb = t->cb; cb_arg = t->arg;
+                t->due_us = t->period_us ? now + (int64_t)t->period_us : 0;
+                if (!t->due_us) continue;
+            }
+            if (!next || t->due_us < next) next = t->due_us;
+        }
+        xSemaphoreGive(s_lock);
+        if (cb) { cb(cb_arg); continue; }   // zonder lock: de callback mag timers (her)starten
+        TickType_t wait = portMAX_DELAY;
+        if (next) {
+            int64_t ms = (next - now + 999) / 1000;
+            wait = ms > 0 ? pdMS_TO_TICKS(ms) : 0;
+            if (!wait) wait = 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle){
+    if (!args || !args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock || xTaskCreate(timer_task, "esp_timer", TIMER_TASK_STACK, NULL,
+                                   TIMER_TASK_PRIO, &s_task) != pdPASS) return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_TIMER_HOST_MAX; ++i) {
+        if (s_timers[i].used) continue;
+        s_timers[i] = (struct esp_timer){ .cb = args->callback, .arg = args->arg, .used = true };
+        *out_handle = &s_timers[i];
+        err = ESP_OK;
+        break;
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t us, uint64_t period_us){
+    if (!t || !t->used) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (t->due_us) err = ESP_ERR_INVALID_STATE;   // zoals esp_timer: eerst stoppen
+    else { t->due_us = esp_timer_get_time() + (int64_t)us; t->period_us = period_us; }
+    xSemaphoreGive(s_lock);
+    if (err == ESP_OK) xTaskNotifyGive(s_task);
+    return err;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us){
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period){
+    return timer_arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer){
+    if (!timer || !timer->used) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!timer->due_us) err = ESP_ERR_INVALID_STATE;
+    timer->due_us = 0;
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer){
+    if (!timer || !timer->used) return ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = timer->due_us ? ESP_ERR_INVALID_STATE : ESP_OK;
+    if (err == ESP_OK) memset(timer, 0, sizeof *timer);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer){
+    if (!timer) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool on = timer->due_us != 0;
+    xSemaphoreGive(s_lock);
+    return on;
+}
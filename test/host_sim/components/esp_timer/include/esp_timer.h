@@ -0,0 +1,43 @@
+// test/host_sim/components/esp_timer/include/esp_timer.h
+#pragma once
+// Deelverzameling van esp_timer voor de host (target linux). Callbacks lopen in één
+// FreeRTOS-taak ("esp_timer"), zoals ESP_TIMER_TASK op het toestel; de tijd komt uit
+// CLOCK_MONOTONIC.
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ESP_TIMER_HOST_MAX
+#define ESP_TIMER_HOST_MAX 16
+#endif
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t       callback;
+    void                *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char          *name;
+    bool                 skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool      esp_timer_is_active(esp_timer_handle_t timer);
+int64_t   esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,195 @@
+// test/host_sim/main/host_sim_main.c
+// Host-harness op backend_sim: dit proces is toestel "SIM_<ML_SIM_SELF>"; de andere zijn
+// virtueel (ACK + EVENT) of andere processen. Als root gaan Cmd/Set-payloads door
+// parser_parse() en router_handle() zoals vanuit MQTT; mqtt_pub telt en toont de
+// publicaties i.p.v. een broker. Op het einde één JSON-regel met tellers, lanes,
+// coalescing, vloot en latency (TOTAL). ML_SIM_SELF > 0: enkel child, tot het proces stopt.
+//
+//   HOST_SIM_CMDS      aantal commando's (1000)
+//   HOST_SIM_RATE      commando's per seconde (200)
+//   HOST_SIM_VERBOSE   1 = elke publicatie tonen
+//   + de ML_SIM_*-variabelen van backend_sim (toestellen, hops, verlies, ...)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "router.h"
+#include "parser.h"
+#include "mesh_link.h"
+#include "lat_trace.h"
+#include "json_wr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TAG "host_sim"
+
+#define HOST_SIM_JOIN_MS   5000    // wachten op root + HELLO's van de virtuele toestellen
+#define HOST_SIM_DRAIN_MS  10000   // na het laatste commando: max. wachten op States
+#define HOST_SIM_QUIET_MS  1000    // ... of tot zo lang niets meer gepubliceerd is
+
+static int s_verbose;
+static char s_self[16];
+static atomic_uint s_pubs, s_states, s_failed;
+static atomic_llong s_last_pub_us;
+static volatile bool s_root;
+
+static int env_int(const char *k, int def){ const char *v = getenv(k); return (v && *v) ? atoi(v) : def; }
+
+// --- router-callbacks: geen broker, geen drivers ---
+static void sim_pub(const char *topic, const char *payload, int qos, bool retain){
+    atomic_fetch_add(&s_pubs, 1);
+    atomic_store(&s_last_pub_us, esp_timer_get_time());
+    size_t n = strlen(topic);
+    if (n >= 6 && !strcmp(topic + n - 6, "/State")) {
+        atomic_fetch_add(&s_states, 1);
+        const char *st = strstr(payload, "\"status\":\"");
+        if (st && strncmp(st + 10, "OK\"", 3)) atomic_fetch_add(&s_failed, 1);
+    }
+    if (s_verbose) printf("PUB %s q%d%s %s\n", topic, qos, retain ? " r" : "", payload);
+}
+
+static router_status_t sim_relay(const parser_msg_t *m){ (void)m; return ROUTER_OK; }
+
+static router_status_t sim_pwm(const parser_msg_t *m, int *applied_pct){
+    *applied_pct = m->params.has_brightness_pct ? m->params.brightness_pct : 0;
+    return ROUTER_OK;
+}
+
+static router_status_t sim_input(const parser_msg_t *m, int *value){ (void)m; *value = 0; return ROUTER_OK; }
+
+static void on_root(bool is_root){ s_root = is_root; }
+
+// --- belasting: 2 relay + 1 PWM op 3 (3 ⟂ LAT_SAMPLE_EVERY: beide soorten gesampeld) ---
+static bool send_cmd(unsigned i, int nodes, parser_result_t *res){
+    static const char *const ACT[] = { "ON", "OFF", "TOGGLE" };
+    char json[192];
+    int dev = 1 + (int)(i % (unsigned)(nodes - 1));
+    if (i % 3 == 2)
+        snprintf(json, sizeof json, "{\"target_dev\":\"SIM_%03d\",\"io_kind\":\"pwm\",\"io_id\":%u,"
+                 "\"action\":\"SET\",\"brightness\":%u,\"corr_id\":\"hs-%u\"}", dev, i % 2, i % 101, i);
+    else
+        snprintf(json, sizeof json, "{\"target_dev\":\"SIM_%03d\",\"io_kind\":\"relay\",\"io_id\":%u,"
+                 "\"action\":\"%s\",\"corr_id\":\"hs-%u\"}", dev, i % 4, ACT[(i / 3) % 3], i);
+    parser_meta_t meta = { .source = PARSER_SRC_MQTT };
+    lat_rx_begin();
+    if (!parser_parse(json, &meta, res)) return false;
+    lat_rx_mark(LAT_PARSE);
+    return router_handle(&res->msg) == ROUTER_OK;
+}
+
+static void print_summary(unsigned sent, unsigned busy, int64_t elapsed_us){
+    static char buf[4096];
+    static lat_stats_t lat[LAT_KINDS];
+    static const char *const kind_name[LAT_KINDS] = { "relay", "pwm", "input" };
+    router_lane_stats_t lanes[ROUTER_LANES];
+    router_coalesce_stats_t co;
+    router_dedup_stats_t dd;
+    mesh_fleet_stats_t fs;
+    uint32_t lost;
+    router_lane_stats_get(lanes, false);
+    router_coalesce_stats_get(&co, false);
+    router_dedup_stats_get(&dd, false);
+    mesh_get_fleet_stats(&fs);
+    lat_stats_get(lat, &lost, false);
+
+    jw_t w;
+    jw_init(&w, buf, sizeof buf);
+    jw_obj(&w, NULL);
+    jw_str(&w,  "backend",    mesh_backend_name());
+    jw_uint(&w, "sent",       sent);
+    jw_uint(&w, "busy",       busy);
+    jw_uint(&w, "publishes",  atomic_load(&s_pubs));
+    jw_uint(&w, "states",     atomic_load(&s_states));
+    jw_uint(&w, "failed",     atomic_load(&s_failed));
+    jw_int(&w,  "elapsed_ms", elapsed_us / 1000);
+    jw_obj(&w, "fleet");
+    jw_uint(&w, "nodes",  fs.nodes);
+    jw_uint(&w, "online", fs.online);
+    jw_obj_end(&w);
+    jw_obj(&w, "coalesce");
+    jw_uint(&w, "cmds",      co.cmds);
+    jw_uint(&w, "frames",    co.frames);
+    jw_uint(&w, "collapsed", co.collapsed);
+    jw_obj_end(&w);
+    jw_uint(&w, "dups", dd.dups);
+    jw_arr(&w, "lanes");
+    for (int l = 0; l < ROUTER_LANES; ++l) {
+        jw_obj(&w, NULL);
+        jw_uint(&w, "n",       lanes[l].n);
+        jw_uint(&w, "dropped", lanes[l].dropped);
+        jw_uint(&w, "max_us",  lanes[l].max_us);
+        jw_obj_end(&w);
+    }
+    jw_arr_end(&w);
+    jw_obj(&w, "lat_total");   // steekproef 1 op LAT_SAMPLE_EVERY
+    jw_uint(&w, "lost", lost);
+    for (int k = 0; k < LAT_KINDS; ++k) {
+        const lat_hist_t *h = &lat[k].st[LAT_TOTAL];
+        if (!h->n) continue;
+        jw_obj(&w, kind_name[k]);
+        jw_uint(&w, "n",      h->n);
+        jw_uint(&w, "max_us", h->max_us);
+        jw_arr(&w, "hist");
+        for (int b = 0; b < LAT_BUCKETS; ++b) jw_uint(&w, NULL, h->hist[b]);
+        jw_arr_end(&w);
+        jw_obj_end(&w);
+    }
+    jw_obj_end(&w);
+    jw_obj_end(&w);
+    const char *js = jw_done(&w);
+    printf("%s\n", js ? js : "{\"error\":\"summary te groot\"}");
+    fflush(stdout);
+}
+
+void app_main(void){
+    static parser_result_t s_res;   // groot: niet op de stack
+    int cmds  = env_int("HOST_SIM_CMDS", 1000);
+    int rate  = env_int("HOST_SIM_RATE", 200);
+    int nodes = env_int("ML_SIM_NODES", 50);
+    s_verbose = env_int("HOST_SIM_VERBOSE", 0);
+    int self  = env_int("ML_SIM_SELF", 0);
+    snprintf(s_self, sizeof s_self, "SIM_%03d", self);
+    if (nodes < 2) { ESP_LOGE(TAG, "ML_SIM_NODES >= 2 nodig"); exit(2); }
+
+    parser_init();
+    router_cbs_t cbs = { .mqtt_pub = sim_pub, .exec_relay = sim_relay, .exec_pwm = sim_pwm, .exec_input = sim_input };
+    router_init(&cbs);
+    router_set_local_dev(s_self);
+
+    mesh_register_rx(router_handle_mesh_request, router_handle_mesh_event);
+    mesh_register_root_cb(on_root);
+    mesh_opts_t mo = { .role = MESH_ROLE_CHILD,   // backend_sim kiest de root (laagste levende index)
+                       .local_dev = s_self, .default_timeout_ms = 1000, .default_ttl = 3 };
+    mesh_init(&mo);
+    if (self) { ESP_LOGI(TAG, "%s: enkel child, geen belasting", s_self); return; }
+
+    // root worden en de vloot laten aanmelden
+    mesh_fleet_stats_t fs = {0};
+    for (int t = 0; t < HOST_SIM_JOIN_MS / 50; ++t) {
+        mesh_get_fleet_stats(&fs);
+        if (s_root && fs.online >= nodes) break;
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    if (!s_root) { ESP_LOGE(TAG, "geen root na %d ms", HOST_SIM_JOIN_MS); exit(2); }
+    ESP_LOGI(TAG, "root, %u/%d toestellen online; %d commando's aan %d/s", fs.online, nodes, cmds, rate);
+
+    unsigned sent = 0, busy = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < cmds; ++i) {
+        if (send_cmd((unsigned)i, nodes, &s_res)) sent++;
+        else                                      busy++;
+        int64_t due = t0 + (int64_t)(i + 1) * 1000000 / (rate > 0 ? rate : 1);
+        int64_t ahead = due - esp_timer_get_time();
+        if (ahead >= 1000) vTaskDelay(pdMS_TO_TICKS(ahead / 1000));
+    }
+
+    int64_t end = esp_timer_get_time() + (int64_t)HOST_SIM_DRAIN_MS * 1000;
+    while (esp_timer_get_time() < end &&
+           esp_timer_get_time() - atomic_load(&s_last_pub_us) < (int64_t)HOST_SIM_QUIET_MS * 1000)
+        vTaskDelay(pdMS_TO_TICKS(50));
+
+    print_summary(sent, busy, esp_timer_get_time() - t0);
+    exit(atomic_load(&s_failed) || !atomic_load(&s_states) ? 1 : 0);
+}
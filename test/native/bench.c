@@ -0,0 +1,72 @@
+// test/native/bench.c
+#include "bench.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// --- heap: enkel oproepen uit objecten gelinkt met --wrap (dus niet uit libc zelf) ---
+static bench_alloc_t s_alloc;
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t sz);
+void *__real_realloc(void *p, size_t n);
+void  __real_free(void *p);
+
+void *__wrap_malloc(size_t n)           { s_alloc.n++; s_alloc.bytes += n; return __real_malloc(n); }
+void *__wrap_calloc(size_t n, size_t sz) { s_alloc.n++; s_alloc.bytes += n * sz; return __real_calloc(n, sz); }
+void *__wrap_realloc(void *p, size_t n) { s_alloc.n++; s_alloc.bytes += n; return __real_realloc(p, n); }
+void  __wrap_free(void *p)              { if (p) s_alloc.n_free++; __real_free(p); }
+
+void bench_alloc_reset(void) { memset(&s_alloc, 0, sizeof s_alloc); }
+void bench_alloc_get(bench_alloc_t *out) { *out = s_alloc; }
+
+// --- stack: verven, fn uitvoeren op die stack, onaangeroerde bytes tellen (groeit omlaag) ---
+#define STACK_PAINT 0xA5
+
+static ucontext_t s_main_ctx, s_fn_ctx;
+static void (*s_fn)(void *);
+static void *s_arg;
+
+static void stack_tramp(void) { s_fn(s_arg); }
+
+size_t bench_stack_peak(void (*fn)(void *), void *arg) {
+    static uint8_t stack[BENCH_STACK_SZ] __attribute__((aligned(16)));
+    memset(stack, STACK_PAINT, sizeof stack);
+    s_fn = fn;
+    s_arg = arg;
+    getcontext(&s_fn_ctx);
+    s_fn_ctx.uc_stack.ss_sp = stack;
+    s_fn_ctx.uc_stack.ss_size = sizeof stack;
+    s_fn_ctx.uc_link = &s_main_ctx;
+    makecontext(&s_fn_ctx, stack_tramp, 0);
+    swapcontext(&s_main_ctx, &s_fn_ctx);
+    size_t untouched = 0;
+    while (untouched < sizeof stack && stack[untouched] == STACK_PAINT) untouched++;
+    return sizeof stack - untouched;
+}
+
+// --- uitvoer ---
+void bench_emit(const char *bench, const char *fmt, ...) {
+    char line[512];
+    int n = snprintf(line, sizeof line, "{\"bench\":\"%s\",", bench);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(line + n, sizeof line - (size_t)n, fmt, ap);
+    va_end(ap);
+    printf("%s}\n", line);
+    const char *path = getenv("BENCH_OUT");
+    FILE *f = path && *path ? fopen(path, "a") : NULL;
+    if (f) {
+        fprintf(f, "%s}\n", line);
+        fclose(f);
+    }
+}
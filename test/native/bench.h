@@ -0,0 +1,28 @@
+// test/native/bench.h
+#pragma once
+// Meethulpen voor de host-benchmarks (env:native): klok, heap-tellers via
+// -Wl,--wrap=malloc,... en piek-stack via een geverfde eigen stack.
+// Resultaat: één JSON-regel per meting op stdout ({"bench":...}), en
+// bijgevoegd aan $BENCH_OUT als die gezet is.
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t n;        // malloc/calloc/realloc
+    uint64_t bytes;    // gevraagde bytes
+    uint32_t n_free;
+} bench_alloc_t;
+
+uint64_t bench_now_ns(void);
+
+void bench_alloc_reset(void);
+void bench_alloc_get(bench_alloc_t *out);
+
+// fn(arg) op een geverfde stack van BENCH_STACK_SZ; geeft gebruikte bytes terug
+#ifndef BENCH_STACK_SZ
+#define BENCH_STACK_SZ (64 * 1024)
+#endif
+size_t bench_stack_peak(void (*fn)(void *), void *arg);
+
+// fmt = de velden na "bench", zonder accolades: bench_emit("parser", "\"ns\":%u", ns)
+void bench_emit(const char *bench, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
@@ -0,0 +1,87 @@
+// test/native/corpus.h
+#pragma once
+// Cmd/Set-payloads voor de host-tests en -benchmarks (env:native).
+// Categorie = eerste deel van de naam: relay, pwm, alias, input, err (geldige JSON, foutpad),
+// invalid (geen geldige JSON). Enkel velden die ook de cJSON-referentie (baseline) kent.
+
+typedef struct {
+    const char *name;
+    const char *json;
+} corpus_t;
+
+static const corpus_t CORPUS[] = {
+    // --- minimaal relay ---
+    { "relay_on_min",        "{\"target_dev\":\"ESP32_BINNEN\",\"io_id\":0,\"action\":\"ON\"}" },
+    { "relay_off",           "{\"target_dev\":\"ESP32_BINNEN\",\"io_kind\":\"relay\",\"io_id\":3,\"action\":\"OFF\"}" },
+    { "relay_toggle_corr",   "{\"target_dev\":\"ESP32_KELDER\",\"relay\":2,\"action\":\"toggle\",\"corr_id\":\"ha-8812\"}" },
+    { "relay_bool_true",     "{\"dev\":\"ESP32_SERRE\",\"relay\":1,\"state\":true}" },
+    { "relay_num_state",     "{\"node\":\"ESP32_SERRE\",\"pin\":\"4\",\"relay_state\":0}" },
+    { "relay_duration_s",    "{\"target_dev\":\"ESP32_TUIN\",\"io_id\":1,\"action\":\"ON\",\"duration_s\":90}" },
+    { "relay_minutes",       "{\"target_dev\":\"ESP32_TUIN\",\"io_id\":1,\"action\":\"ON\",\"minutes\":\"15\"}" },
+    { "relay_duration_same", "{\"target_dev\":\"ESP32_TUIN\",\"io_id\":1,\"action\":\"ON\",\"duration_ms\":60000,\"duration\":60}" },
+    { "relay_topic",         "{\"_topic\":\"Devices/ESP32_TUIN/Cmd/Set\",\"target_dev\":\"ESP32_TUIN\",\"io_id\":2,\"action\":\"OFF\"}" },
+    { "relay_ws_bom",        "\xEF\xBB\xBF \n\t{ \"target_dev\" : \"ESP32_BINNEN\" , \"io_id\" : 7 , \"action\" : \"on\" } \r\n" },
+    { "relay_trailing",      "{\"target_dev\":\"ESP32_BINNEN\",\"io_id\":0,\"action\":\"ON\"} garbage" },
+    { "relay_float_id",      "{\"target_dev\":\"ESP32_BINNEN\",\"io_id\":5.9,\"action\":\"ON\"}" },
+    { "relay_exp_id",        "{\"target_dev\":\"ESP32_BINNEN\",\"io_id\":1e1,\"action\":\"ON\"}" },
+    { "relay_dup_key",       "{\"target_dev\":\"A\",\"target_dev\":\"B\",\"io_id\":0,\"io_id\":9,\"action\":\"OFF\"}" },
+
+    // --- PWM: ramp, "NN%", duty ---
+    { "pwm_pct_ramp",        "{\"target_dev\":\"ESP32_WOON\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"brightness\":\"40%\",\"ramp_ms\":500}" },
+    { "pwm_level_fade",      "{\"target_dev\":\"ESP32_WOON\",\"channel\":1,\"action\":\"set\",\"level\":75,\"fade\":1200}" },
+    { "pwm_duty",            "{\"target_dev\":\"ESP32_WOON\",\"io_kind\":\"PWM\",\"io_id\":2,\"action\":\"SET\",\"duty\":128}" },
+    { "pwm_duty_pct",        "{\"target_dev\":\"ESP32_WOON\",\"io_kind\":\"pwm\",\"io_id\":2,\"action\":\"SET\",\"duty\":\"50%\"}" },
+    { "pwm_value_derive",    "{\"target_dev\":\"ESP32_WOON\",\"io_id\":3,\"action\":\"SET\",\"percent\":\" 12 \"}" },
+    { "pwm_transition_eq",   "{\"target_dev\":\"ESP32_WOON\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"brightness\":10,\"ramp\":300,\"transition\":300}" },
+    { "pwm_off",             "{\"target_dev\":\"ESP32_WOON\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"OFF\"}" },
+
+    // --- alias-zwaar: veel synoniemen, onbekende en private sleutels ---
+    { "alias_heavy",         "{\"device\":\"ESP32_ZOLDER\",\"type\":\"pwm\",\"gpio\":6,\"command\":\"set\",\"value\":\"33%\","
+                             "\"transition\":\"250\",\"correlation_id\":\"scene-7\",\"topic_hint\":\"Devices/ESP32_ZOLDER/Cmd/Set\","
+                             "\"_src\":\"ha\",\"extra\":1,\"note\":\"x\"}" },
+    { "alias_order",         "{\"cmd\":\"off\",\"index\":4,\"kind\":\"relay\",\"target\":\"ESP32_ZOLDER\",\"id\":\"abc\"}" },
+    { "alias_device_type",   "{\"target_dev\":\"ESP32_ZOLDER\",\"device_type\":\"Relay\",\"channel\":\"3\",\"action\":\"TOGGLE\"}" },
+    { "alias_nested_skip",   "{\"meta\":{\"a\":[1,2,{\"b\":\"}\"}]},\"target_dev\":\"ESP32_ZOLDER\",\"io_id\":1,\"action\":\"ON\",\"tags\":[\"x\",\"y\"]}" },
+    { "alias_escapes",       "{\"target_dev\":\"ESP32_\\u005A\\/X\",\"io_id\":1,\"action\":\"\\u004fN\",\"corr_id\":\"\\ud83d\\ude00-\\n\"}" },
+
+    // --- input ---
+    { "input_read",          "{\"target_dev\":\"ESP32_GANG\",\"io_kind\":\"input\",\"io_id\":0,\"action\":\"READ\"}" },
+    { "input_read_debounce", "{\"target_dev\":\"ESP32_GANG\",\"io_id\":1,\"action\":\"read\",\"debounce\":\"50\"}" },
+    { "input_report",        "{\"target_dev\":\"ESP32_GANG\",\"io_id\":2,\"action\":\"REPORT\",\"val\":1}" },
+
+    // --- geldige JSON, foutpad ---
+    { "err_no_target",       "{\"io_id\":0,\"action\":\"ON\"}" },
+    { "err_empty_target",    "{\"target_dev\":\"\",\"io_id\":0,\"action\":\"ON\"}" },
+    { "err_target_num",      "{\"target_dev\":12,\"io_id\":0,\"action\":\"ON\"}" },
+    { "err_action",          "{\"target_dev\":\"X\",\"io_id\":0,\"action\":\"DIM\"}" },
+    { "err_action_null",     "{\"target_dev\":\"X\",\"io_id\":0,\"action\":null}" },
+    { "err_iokind",          "{\"target_dev\":\"X\",\"io_kind\":\"servo\",\"io_id\":0,\"action\":\"ON\"}" },
+    { "err_no_iokind",       "{\"target_dev\":\"X\",\"action\":\"ON\"}" },
+    { "err_io_id_range",     "{\"target_dev\":\"X\",\"io_id\":64,\"action\":\"ON\"}" },
+    { "err_io_id_neg",       "{\"target_dev\":\"X\",\"io_id\":-1,\"action\":\"ON\"}" },
+    { "err_io_id_str",       "{\"target_dev\":\"X\",\"io_id\":\"one\",\"action\":\"ON\"}" },
+    { "err_duration_type",   "{\"target_dev\":\"X\",\"io_id\":0,\"action\":\"ON\",\"duration\":\"10s\"}" },
+    { "err_duration_confl",  "{\"target_dev\":\"X\",\"io_id\":0,\"action\":\"ON\",\"duration_ms\":1000,\"duration_s\":2}" },
+    { "err_duration_range",  "{\"target_dev\":\"X\",\"io_id\":0,\"action\":\"ON\",\"duration_s\":86401}" },
+    { "err_bright_range",    "{\"target_dev\":\"X\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"brightness\":101}" },
+    { "err_bright_type",     "{\"target_dev\":\"X\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"level\":\"half\"}" },
+    { "err_duty_range",      "{\"target_dev\":\"X\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"duty\":300}" },
+    { "err_ramp_confl",      "{\"target_dev\":\"X\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"ramp_ms\":100,\"fade\":200}" },
+    { "err_ramp_range",      "{\"target_dev\":\"X\",\"io_kind\":\"pwm\",\"io_id\":0,\"action\":\"SET\",\"ramp\":60001}" },
+    { "err_report_no_val",   "{\"target_dev\":\"X\",\"io_kind\":\"input\",\"io_id\":0,\"action\":\"REPORT\"}" },
+    { "err_debounce_range",  "{\"target_dev\":\"X\",\"io_id\":0,\"action\":\"READ\",\"debounce_ms\":5001}" },
+    { "err_root_string",     "\"ON\"" },
+    { "err_root_number",     "42" },
+
+    // --- ongeldige JSON ---
+    { "invalid_empty",       "" },
+    { "invalid_truncated",   "{\"target_dev\":\"ESP32_BINNEN\",\"io_id\":0,\"act" },
+    { "invalid_comma",       "{\"target_dev\":\"ESP32_BINNEN\",,\"io_id\":0}" },
+    { "invalid_single_q",    "{'target_dev':'ESP32_BINNEN'}" },
+    { "invalid_bad_escape",  "{\"target_dev\":\"A\\qB\",\"io_id\":0,\"action\":\"ON\"}" },
+    { "invalid_lone_surr",   "{\"target_dev\":\"A\\udc00\",\"io_id\":0,\"action\":\"ON\"}" },
+    { "invalid_number",      "{\"target_dev\":\"A\",\"io_id\":-,\"action\":\"ON\"}" },
+    { "invalid_plain_text",  "relay 1 on" },
+};
+
+#define CORPUS_N (sizeof(CORPUS) / sizeof(CORPUS[0]))
@@ -0,0 +1,6 @@
+// test/native/esp_random.h
+#pragma once
+// Host-stub (env:native): deterministisch, zie esp_stubs.c
+#include <stdint.h>
+
+uint32_t esp_random(void);
@@ -0,0 +1,17 @@
+// test/native/esp_stubs.c
+// esp_* stubs voor de host-build: vaste seed → reproduceerbare corr-ids
+#include "esp_random.h"
+#include "esp_timer.h"
+#include <time.h>
+
+uint32_t esp_random(void) {
+    static uint32_t s = 0x2545F491u;   // xorshift32
+    s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+    return s;
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
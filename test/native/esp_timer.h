@@ -0,0 +1,6 @@
+// test/native/esp_timer.h
+#pragma once
+// Host-stub (env:native): CLOCK_MONOTONIC in µs
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,47 @@
+# test/native/native_env.py
+# env:native (host): componenten, esp_*-stubs en cJSON uit ESP-IDF mee bouwen voor de tests.
+# cJSON: $IDF_PATH, anders het framework-espidf-pakket van env:esp32dev (eerst die env bouwen).
+Import("env")
+
+import os
+import sys
+from os.path import isfile, join
+
+proj = env.subst("$PROJECT_DIR")
+native = join(proj, "test", "native")
+
+
+def find_cjson():
+    roots = []
+    if os.environ.get("IDF_PATH"):
+        roots.append(os.environ["IDF_PATH"])
+    roots.append(join(env.subst("$PROJECT_PACKAGES_DIR"), "framework-espidf"))
+    for r in roots:
+        d = join(r, "components", "json", "cJSON")
+        if isfile(join(d, "cJSON.c")):
+            return d
+    sys.stderr.write("native_env.py: cJSON niet gevonden (IDF_PATH of framework-espidf)\n")
+    env.Exit(1)
+
+
+cjson = find_cjson()
+
+env.Append(CPPPATH=[
+    native,
+    cjson,
+    join(proj, "components", "parser", "include"),
+    join(proj, "components", "mesh_link", "include"),
+])
+env.Append(LIBS=["m"])   # mesh_wire.c
+
+# (component, bronnen) die elke test-suite meekrijgt
+SOURCES = [
+    (join(proj, "components", "parser"), ["parser.c"]),
+    (join(proj, "components", "mesh_link"), ["mesh_wire.c"]),
+    (native, ["esp_stubs.c", "bench.c"]),   # bench.c: ook de __wrap_malloc/... voor -Wl,--wrap
+    (cjson, ["cJSON.c"]),
+]
+
+for i, (src_dir, files) in enumerate(SOURCES):
+    env.BuildSources(join("$BUILD_DIR", "native_%d" % i), src_dir,
+                     src_filter=["-<*>"] + ["+<%s>" % f for f in files])
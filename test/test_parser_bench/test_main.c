@@ -0,0 +1,127 @@
+// test/test_parser_bench/test_main.c
+// Benchmark parser_parse()/parser_parse_bin() op het corpus, per categorie:
+// ns/bericht, heap-allocaties en -bytes per bericht, piek-stack.
+// pio test -e native -f test_parser_bench   (BENCH_OUT=bench.jsonl voor een bestand)
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+#include "corpus.h"
+#include "bench.h"
+
+#ifndef BENCH_REPS
+#define BENCH_REPS   2000   // herhalingen over de berichten van een categorie
+#endif
+#define BENCH_ROUNDS 5      // beste ronde telt (minder ruis van de host)
+#define BENCH_WARMUP_MS 300 // host-CPU op kloksnelheid brengen vóór de eerste meting
+
+static const char *const CATS[] = { "relay", "pwm", "alias", "input", "err", "invalid" };
+
+static parser_result_t s_res;   // groot: niet op de stack
+static uint8_t s_bin[CORPUS_N][256];
+static size_t s_bin_len[CORPUS_N];
+
+typedef struct {
+    const char *cat;
+    uint32_t flags;
+    bool bin;
+} run_t;
+
+static bool in_cat(size_t i, const char *cat) {
+    size_t n = strlen(cat);
+    return !strncmp(CORPUS[i].name, cat, n) && CORPUS[i].name[n] == '_';
+}
+
+static bool parse_one(const run_t *r, size_t i) {
+    parser_meta_t meta = { .source = PARSER_SRC_MQTT, .flags = r->flags };
+    if (r->bin) return parser_parse_bin(s_bin[i], s_bin_len[i], &meta, &s_res);
+    return parser_parse(CORPUS[i].json, &meta, &s_res);
+}
+
+static bool usable(const run_t *r, size_t i) {
+    return in_cat(i, r->cat) && (!r->bin || s_bin_len[i]);
+}
+
+// elk bericht van de categorie één keer, voor de stackmeting
+static void parse_cat(void *arg) {
+    const run_t *r = arg;
+    for (size_t i = 0; i < CORPUS_N; ++i)
+        if (usable(r, i)) parse_one(r, i);
+}
+
+static void bench_run(const char *name, const run_t *r) {
+    uint32_t n = 0, n_err = 0;
+    for (size_t i = 0; i < CORPUS_N; ++i)
+        if (usable(r, i)) { n++; n_err += !parse_one(r, i); }
+    if (!n) return;
+
+    uint64_t best = UINT64_MAX;
+    bench_alloc_t a = {0};
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        bench_alloc_reset();
+        uint64_t t0 = bench_now_ns();
+        for (int rep = 0; rep < BENCH_REPS; ++rep)
+            for (size_t i = 0; i < CORPUS_N; ++i)
+                if (usable(r, i)) parse_one(r, i);
+        uint64_t dt = bench_now_ns() - t0;
+        if (dt < best) { best = dt; bench_alloc_get(&a); }
+    }
+    uint64_t msgs = (uint64_t)n * BENCH_REPS;
+    size_t stack = bench_stack_peak(parse_cat, (void *)r);
+
+    bench_emit(name, "\"cat\":\"%s\",\"diag\":%d,\"n\":%u,\"err\":%u,\"reps\":%d,\"ns_per_msg\":%.1f,"
+                     "\"allocs_per_msg\":%.3f,\"alloc_bytes_per_msg\":%.1f,\"peak_stack\":%zu",
+               r->cat, (r->flags & PARSER_F_DIAG) != 0, n, n_err, BENCH_REPS, (double)best / msgs,
+               (double)a.n / msgs, (double)a.bytes / msgs, stack);
+
+    // de parser is heap-vrij; een allocatie hier is een regressie
+    TEST_ASSERT_EQUAL_UINT32(0, a.n);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_bench_json(void) {
+    for (size_t c = 0; c < sizeof CATS / sizeof CATS[0]; ++c) {
+        run_t r = { .cat = CATS[c] };
+        bench_run("parser_json", &r);
+    }
+}
+
+// foutrapportage: zelfde corpus mét PARSER_F_DIAG (detail + unknown_keys)
+static void test_bench_json_diag(void) {
+    for (size_t c = 0; c < sizeof CATS / sizeof CATS[0]; ++c) {
+        run_t r = { .cat = CATS[c], .flags = PARSER_F_DIAG };
+        bench_run("parser_json", &r);
+    }
+}
+
+// binaire payloads: de geldige corpusberichten via parser_encode_bin()
+static void test_bench_bin(void) {
+    for (size_t i = 0; i < CORPUS_N; ++i) {
+        parser_meta_t meta = { .source = PARSER_SRC_MQTT };
+        s_bin_len[i] = parser_parse(CORPUS[i].json, &meta, &s_res)
+                           ? parser_encode_bin(&s_res.msg, s_bin[i], sizeof s_bin[i]) : 0;
+    }
+    for (size_t c = 0; c < sizeof CATS / sizeof CATS[0]; ++c) {
+        run_t r = { .cat = CATS[c], .bin = true };
+        bench_run("parser_bin", &r);
+    }
+}
+
+static void warmup(void) {
+    parser_meta_t meta = { .source = PARSER_SRC_MQTT };
+    uint64_t end = bench_now_ns() + (uint64_t)BENCH_WARMUP_MS * 1000000u;
+    while (bench_now_ns() < end)
+        for (size_t i = 0; i < CORPUS_N; ++i) parser_parse(CORPUS[i].json, &meta, &s_res);
+}
+
+int main(void) {
+    parser_init();
+    warmup();
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_json);
+    RUN_TEST(test_bench_json_diag);
+    RUN_TEST(test_bench_bin);
+    return UNITY_END();
+}
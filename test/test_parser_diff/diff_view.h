@@ -0,0 +1,22 @@
+// test/test_parser_diff/diff_view.h
+#pragma once
+// Vergelijkbare vorm van een parse-resultaat: zelfde velden voor beide implementaties
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    bool ok;
+    int  type, io_kind, io_id, action;
+    int  duration_ms, brightness_pct, ramp_ms, debounce_ms;
+    bool has_duration_ms, has_brightness_pct, has_ramp_ms, has_debounce_ms;
+    bool corr_generated;
+    char target_dev[40];
+    char corr_id[48];
+    char topic[128];
+    char unknown_keys[128];
+    int  err_code;
+    char err_path[64];
+} diff_view_t;
+
+// cJSON-referentie (parser van vóór de streaming tokenizer), zie ref_parser_cjson.c
+void ref_parser_view(const char *json, const char *topic_hint, diff_view_t *out);
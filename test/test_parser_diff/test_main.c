@@ -0,0 +1,151 @@
+// test/test_parser_diff/test_main.c
+// Differentiële test: streaming parser_parse() tegen de cJSON-referentie (ref_parser_cjson.c)
+// op het corpus, alle afgekapte varianten en varianten met één vervangen byte; plus binaire
+// randgevallen (parser_parse_bin).
+// pio test -e native -f test_parser_diff
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+#include "corpus.h"
+#include "diff_view.h"
+
+#define MISMATCH_SHOW 10   // eerste verschillen tonen, daarna enkel tellen
+
+static parser_result_t s_res;   // groot: niet op de stack
+static unsigned s_checked, s_mismatch;
+
+static void cur_view(const char *json, const char *topic_hint, diff_view_t *out) {
+    parser_meta_t meta = { .source = PARSER_SRC_MQTT, .topic_hint = topic_hint, .flags = PARSER_F_DIAG };
+    parser_parse(json, &meta, &s_res);
+    memset(out, 0, sizeof *out);
+    out->ok = s_res.ok;
+    snprintf(out->unknown_keys, sizeof out->unknown_keys, "%s", s_res.unknown_keys);
+    if (!s_res.ok) {
+        out->err_code = s_res.error.code;
+        snprintf(out->err_path, sizeof out->err_path, "%s", s_res.error.path ? s_res.error.path : "");
+        return;
+    }
+    const parser_msg_t *m = &s_res.msg;
+    out->type = m->type; out->io_kind = m->io_kind; out->io_id = m->io_id; out->action = m->action;
+    out->duration_ms = m->params.duration_ms;       out->has_duration_ms = m->params.has_duration_ms;
+    out->brightness_pct = m->params.brightness_pct; out->has_brightness_pct = m->params.has_brightness_pct;
+    out->ramp_ms = m->params.ramp_ms;               out->has_ramp_ms = m->params.has_ramp_ms;
+    out->debounce_ms = m->params.debounce_ms;       out->has_debounce_ms = m->params.has_debounce_ms;
+    out->corr_generated = m->meta.corr_generated;
+    snprintf(out->target_dev, sizeof out->target_dev, "%s", m->target_dev);
+    if (!m->meta.corr_generated) snprintf(out->corr_id, sizeof out->corr_id, "%s", m->corr_id);
+    snprintf(out->topic, sizeof out->topic, "%s", m->topic_hint ? m->topic_hint : "");
+}
+
+static void fmt(const diff_view_t *v, char *out, size_t n) {
+    if (!v->ok) {
+        snprintf(out, n, "ERR code=%d path=%s unk=[%s]", v->err_code, v->err_path, v->unknown_keys);
+        return;
+    }
+    snprintf(out, n, "OK type=%d dev=%s kind=%d id=%d act=%d dur=%d:%d br=%d:%d ramp=%d:%d deb=%d:%d "
+                     "corr=%d:%s topic=%s unk=[%s]",
+             v->type, v->target_dev, v->io_kind, v->io_id, v->action,
+             v->has_duration_ms, v->duration_ms, v->has_brightness_pct, v->brightness_pct,
+             v->has_ramp_ms, v->ramp_ms, v->has_debounce_ms, v->debounce_ms,
+             v->corr_generated, v->corr_id, v->topic, v->unknown_keys);
+}
+
+static void check(const char *name, const char *json, const char *topic_hint) {
+    diff_view_t a, b;
+    char fa[512], fb[512];
+    ref_parser_view(json, topic_hint, &a);
+    cur_view(json, topic_hint, &b);
+    fmt(&a, fa, sizeof fa);
+    fmt(&b, fb, sizeof fb);
+    s_checked++;
+    if (!strcmp(fa, fb)) return;
+    if (s_mismatch++ < MISMATCH_SHOW)
+        printf("MISMATCH %s\n  payload: %s\n  cjson:   %s\n  stream:  %s\n", name, json, fa, fb);
+}
+
+static void finish(void) {
+    char msg[96];
+    snprintf(msg, sizeof msg, "%u payloads, %u verschillen", s_checked, s_mismatch);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(0, s_mismatch);
+}
+
+void setUp(void) { s_checked = 0; s_mismatch = 0; }
+void tearDown(void) {}
+
+static void test_corpus(void) {
+    for (size_t i = 0; i < CORPUS_N; ++i) check(CORPUS[i].name, CORPUS[i].json, NULL);
+    finish();
+}
+
+static void test_topic_hint_from_meta(void) {
+    for (size_t i = 0; i < CORPUS_N; ++i) check(CORPUS[i].name, CORPUS[i].json, "Devices/ESP32_META/Cmd/Set");
+    finish();
+}
+
+// elk prefix: afgebroken MQTT-payloads moeten hetzelfde foutpad geven
+static void test_truncated(void) {
+    static char buf[512];
+    for (size_t i = 0; i < CORPUS_N; ++i) {
+        size_t n = strlen(CORPUS[i].json);
+        for (size_t k = 0; k < n && k < sizeof buf; ++k) {
+            memcpy(buf, CORPUS[i].json, k);
+            buf[k] = '\0';
+            check(CORPUS[i].name, buf, NULL);
+        }
+    }
+    finish();
+}
+
+// één byte vervangen door een structuur-, escape-, cijfer- of stuurteken
+static void test_mutated(void) {
+    static const char SUBST[] = { '"', '{', '}', '[', ']', ',', ':', ' ', '\\', '0', '9', '-', '.', 'e', '%', 'x', '\t', '\x01', '\xC3' };
+    static char buf[512];
+    for (size_t i = 0; i < CORPUS_N; ++i) {
+        size_t n = strlen(CORPUS[i].json);
+        if (n >= sizeof buf) continue;
+        for (size_t k = 0; k < n; ++k) {
+            for (size_t s = 0; s < sizeof SUBST; ++s) {
+                if (CORPUS[i].json[k] == SUBST[s]) continue;
+                memcpy(buf, CORPUS[i].json, n + 1);
+                buf[k] = SUBST[s];
+                check(CORPUS[i].name, buf, NULL);
+            }
+        }
+    }
+    finish();
+}
+
+// binair: onbekende sleutels met een (geneste) container als waarde of als sleutel worden
+// volledig overgeslagen; de velden erna moeten nog gelezen worden
+static void test_bin_unknown_containers(void) {
+    static const uint8_t VAL[] = { 0x84, 0xA1,'t', 0xA2,'D','1',                       // "t":"D1"
+        0xA2,'z','z', 0x93, 0x01, 0x92,0x02,0x03, 0x81,0xA1,'q',0x04,               // "zz":[1,[2,3],{"q":4}]
+        0xA1,'i', 0x02, 0xA1,'a', 0x00 };                                            // "i":2, "a":ON
+    static const uint8_t KEY[] = { 0x84, 0xA1,'t', 0xA2,'D','1',
+        0x81,0xA1,'x',0x01, 0x81,0xA1,'y',0x92,0x01,0x02,                           // {"x":1}:{"y":[1,2]}
+        0xA1,'i', 0x02, 0xA1,'a', 0x00 };
+    const struct { const uint8_t *b; size_t n; const char *unknown; } CASES[] = {
+        { VAL, sizeof VAL, "zz" }, { KEY, sizeof KEY, "#?" },
+    };
+    parser_meta_t meta = { .source = PARSER_SRC_MQTT, .flags = PARSER_F_DIAG };
+    for (size_t i = 0; i < sizeof CASES / sizeof CASES[0]; ++i) {
+        TEST_ASSERT_TRUE(parser_parse_bin(CASES[i].b, CASES[i].n, &meta, &s_res));
+        TEST_ASSERT_EQUAL_STRING("D1", s_res.msg.target_dev);
+        TEST_ASSERT_EQUAL_INT(2, s_res.msg.io_id);
+        TEST_ASSERT_EQUAL_INT(ACT_ON, s_res.msg.action);
+        TEST_ASSERT_EQUAL_STRING(CASES[i].unknown, s_res.unknown_keys);
+    }
+}
+
+int main(void) {
+    parser_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_corpus);
+    RUN_TEST(test_topic_hint_from_meta);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_mutated);
+    RUN_TEST(test_bin_unknown_containers);
+    return UNITY_END();
+}
@@ -0,0 +1,69 @@
+// test/test_wire_bench/json_envelope.c
+#include "json_envelope.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *kind_str(mesh_kind_t k){
+    switch (k){
+        case ML_KIND_RELAY:  return "relay";
+        case ML_KIND_PWM:    return "pwm";
+        case ML_KIND_CONFIG: return "config";
+        case ML_KIND_INPUT:  return "input";
+        default:             return "diag";
+    }
+}
+
+static mesh_kind_t kind_from_str(const char *s){
+    if (!s) return ML_KIND_DIAG;
+    for (int k = ML_KIND_RELAY; k < ML_KIND_DIAG; ++k) if (!strcmp(s, kind_str((mesh_kind_t)k))) return (mesh_kind_t)k;
+    return ML_KIND_DIAG;
+}
+
+char *json_env_encode(mesh_wire_type_t type, const mesh_envelope_t *e){
+    char hex[17];
+    snprintf(hex, sizeof hex, "%016" PRIx64, e->corr_id);
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o,"schema","v1");
+    cJSON_AddStringToObject(o,"type",mesh_wire_type_str(type));
+    cJSON_AddStringToObject(o,"corr_id",hex);
+    cJSON_AddNumberToObject(o,"ts_ms", e->ts_ms);
+    cJSON_AddStringToObject(o,"src_dev", e->src_dev ? e->src_dev : "");
+    if (e->dst_dev) cJSON_AddStringToObject(o,"dst_dev", e->dst_dev);
+    cJSON_AddStringToObject(o,"kind", kind_str(e->kind));
+    if (e->ttl) cJSON_AddNumberToObject(o,"ttl", e->ttl);
+    if (e->hop) cJSON_AddNumberToObject(o,"hop", e->hop);
+    if (e->prio) cJSON_AddNumberToObject(o,"prio", e->prio);
+    if (e->exec_us) cJSON_AddNumberToObject(o,"exec_us", e->exec_us);
+    if (e->origin_set_topic) cJSON_AddStringToObject(o,"origin_set_topic", e->origin_set_topic);
+    if (e->payload) cJSON_AddItemReferenceToObject(o,"payload", e->payload);   // geen kopie
+    char *js = cJSON_PrintUnformatted(o);
+    cJSON_Delete(o);
+    return js;
+}
+
+cJSON *json_env_decode(const char *json, mesh_wire_type_t *type, mesh_envelope_t *e){
+    cJSON *o = cJSON_Parse(json); if (!o) return NULL;
+    *type = mesh_wire_type_from_str(cJSON_GetStringValue(cJSON_GetObjectItem(o,"type")));
+    const cJSON *jcorr = cJSON_GetObjectItem(o,"corr_id");
+    const cJSON *jprio = cJSON_GetObjectItem(o,"prio");
+    const cJSON *jexec = cJSON_GetObjectItem(o,"exec_us");
+    const cJSON *jttl  = cJSON_GetObjectItem(o,"ttl");
+    const cJSON *jhop  = cJSON_GetObjectItem(o,"hop");
+    *e = (mesh_envelope_t){
+        .schema = cJSON_GetStringValue(cJSON_GetObjectItem(o,"schema")),
+        .corr_id = cJSON_IsString(jcorr) ? (corr_id_t)strtoull(jcorr->valuestring, NULL, 16) : 0,
+        .ts_ms = (uint64_t)cJSON_GetNumberValue(cJSON_GetObjectItem(o,"ts_ms")),
+        .src_dev = cJSON_GetStringValue(cJSON_GetObjectItem(o,"src_dev")),
+        .dst_dev = cJSON_GetStringValue(cJSON_GetObjectItem(o,"dst_dev")),
+        .kind = kind_from_str(cJSON_GetStringValue(cJSON_GetObjectItem(o,"kind"))),
+        .prio = cJSON_IsNumber(jprio) ? (mesh_prio_t)jprio->valueint : ML_PRIO_NONE,
+        .ttl = cJSON_IsNumber(jttl) ? (int8_t)jttl->valueint : 0,
+        .hop = cJSON_IsNumber(jhop) ? (uint8_t)jhop->valueint : 0,
+        .origin_set_topic = cJSON_GetStringValue(cJSON_GetObjectItem(o,"origin_set_topic")),
+        .payload = cJSON_GetObjectItem(o,"payload"),
+        .exec_us = cJSON_IsNumber(jexec) ? (uint32_t)jexec->valuedouble : 0
+    };
+    return o;
+}
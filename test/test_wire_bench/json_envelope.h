@@ -0,0 +1,9 @@
+// test/test_wire_bench/json_envelope.h
+#pragma once
+// JSON-envelop zoals backend_espmesh.c (build_json/handle_json): referentie voor de
+// vergelijking met mesh_wire. Zelfde velden, zelfde cJSON-oproepen.
+#include "mesh_wire.h"
+
+char  *json_env_encode(mesh_wire_type_t type, const mesh_envelope_t *e);   // free() door caller
+// e wijst in de teruggegeven boom; cJSON_Delete() door caller. NULL = ongeldig.
+cJSON *json_env_decode(const char *json, mesh_wire_type_t *type, mesh_envelope_t *e);
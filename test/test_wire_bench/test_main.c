@@ -0,0 +1,189 @@
+// test/test_wire_bench/test_main.c
+// Mesh-envelop: binair (mesh_wire) tegen JSON (zoals backend_espmesh build_json/handle_json).
+// Per frame: bytes, µs encode/decode, heap-allocaties; plus round-trip-controle.
+// pio test -e native -f test_wire_bench   (BENCH_OUT=bench.jsonl voor een bestand)
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mesh_wire.h"
+#include "json_envelope.h"
+#include "bench.h"
+
+#ifndef BENCH_REPS
+#define BENCH_REPS   20000
+#endif
+#define BENCH_ROUNDS 5      // beste ronde telt
+
+static mesh_wire_pool_t s_pool;
+static uint8_t          s_buf[1500];
+
+typedef struct {
+    const char      *name;
+    mesh_wire_type_t type;
+    mesh_envelope_t  e;
+} frame_t;
+
+// --- frames zoals router/backends ze versturen ---
+static cJSON *cmd_payload(const char *io, int id, const char *act, const char *k1, int v1, const char *k2, int v2){
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "io", io);
+    cJSON_AddNumberToObject(o, "io_id", id);
+    cJSON_AddStringToObject(o, "action", act);
+    if (k1) {
+        cJSON *p = cJSON_CreateObject();
+        cJSON_AddNumberToObject(p, k1, v1);
+        if (k2) cJSON_AddNumberToObject(p, k2, v2);
+        cJSON_AddItemToObject(o, "params", p);
+    }
+    return o;
+}
+
+static cJSON *cmds_payload(int n){
+    cJSON *items = cJSON_CreateArray();
+    for (int i = 0; i < n; ++i) {
+        char corr[16];
+        snprintf(corr, sizeof corr, "ha-%04d", 8812 + i);
+        cJSON *it = cmd_payload("pwm", i, "SET", "brightness_pct", 10 * (i + 1), "ramp_ms", 250);
+        cJSON_AddNumberToObject(it, "i", i);
+        cJSON_AddStringToObject(it, "corr_id", corr);
+        cJSON_AddItemToArray(items, it);
+    }
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddItemToObject(o, "cmds", items);
+    return o;
+}
+
+static cJSON *state_payload(void){
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "dev", "ESP32_WOON");
+    cJSON_AddStringToObject(o, "io", "pwm");
+    cJSON_AddNumberToObject(o, "io_id", 2);
+    cJSON_AddNumberToObject(o, "brightness_pct", 40);
+    return o;
+}
+
+static cJSON *hello_payload(void){
+    cJSON *h = cJSON_CreateObject();
+    cJSON_AddStringToObject(h, "type", "HELLO");
+    cJSON *d = cJSON_AddObjectToObject(h, "device");
+    cJSON_AddStringToObject(d, "name", "ESP32_WOON");
+    cJSON_AddNumberToObject(h, "relay_count", 4);
+    cJSON_AddNumberToObject(h, "pwm_count",   2);
+    cJSON_AddNumberToObject(h, "input_count", 2);
+    cJSON *m = cJSON_AddObjectToObject(h, "mesh");
+    cJSON_AddNumberToObject(m, "layer", 2);
+    cJSON_AddNumberToObject(m, "rssi",  -52);
+    cJSON *g = cJSON_AddArrayToObject(h, "groups");
+    cJSON_AddItemToArray(g, cJSON_CreateString("woon"));
+    return h;
+}
+
+#define ORIGIN "Devices/ESP32_WOON/Cmd/Set"
+#define CORR   0x9f3c2a1b7d4e5f60ull
+#define TS     1760600000123ull
+
+static frame_t s_frames[6];
+static int     s_frames_n;
+
+static void frames_init(void){
+    frame_t *f = s_frames;
+    *f++ = (frame_t){ "relay_request", MW_REQUEST, { .schema = "v1", .corr_id = CORR, .ts_ms = TS,
+        .src_dev = "ESP32_ROOT", .dst_dev = "ESP32_TUIN", .kind = ML_KIND_RELAY, .prio = ML_PRIO_SWITCH, .ttl = 3,
+        .origin_set_topic = "Devices/ESP32_TUIN/Cmd/Set",
+        .payload = cmd_payload("relay", 1, "ON", "duration_ms", 90000, NULL, 0) } };
+    *f++ = (frame_t){ "pwm_request", MW_REQUEST, { .schema = "v1", .corr_id = CORR, .ts_ms = TS,
+        .src_dev = "ESP32_ROOT", .dst_dev = "ESP32_WOON", .kind = ML_KIND_PWM, .prio = ML_PRIO_SETPOINT, .ttl = 3,
+        .origin_set_topic = ORIGIN, .payload = cmd_payload("pwm", 2, "SET", "brightness_pct", 40, "ramp_ms", 500) } };
+    *f++ = (frame_t){ "cmds4_request", MW_REQUEST, { .schema = "v1", .corr_id = CORR, .ts_ms = TS,
+        .src_dev = "ESP32_ROOT", .dst_dev = "ESP32_WOON", .kind = ML_KIND_PWM, .prio = ML_PRIO_SETPOINT, .ttl = 3,
+        .origin_set_topic = ORIGIN, .payload = cmds_payload(4) } };
+    *f++ = (frame_t){ "response_ack", MW_RESPONSE, { .corr_id = CORR,
+        .src_dev = "ESP32_WOON", .dst_dev = "ESP32_ROOT", .kind = ML_KIND_PWM } };
+    *f++ = (frame_t){ "state_event", MW_EVENT, { .schema = "v1", .corr_id = CORR, .ts_ms = TS,
+        .src_dev = "ESP32_WOON", .dst_dev = "ESP32_ROOT", .kind = ML_KIND_PWM, .ttl = 3, .exec_us = 412,
+        .origin_set_topic = ORIGIN, .payload = state_payload() } };
+    *f++ = (frame_t){ "hello_event", MW_EVENT, { .schema = "v1", .ts_ms = TS,
+        .src_dev = "ESP32_WOON", .dst_dev = "ESP32_ROOT", .kind = ML_KIND_DIAG, .ttl = 3,
+        .payload = hello_payload() } };
+    s_frames_n = (int)(f - s_frames);
+}
+
+// --- metingen ---
+typedef struct { double ns; double allocs; } cost_t;
+
+#define MEASURE(out, body) do {                                          \
+        uint64_t best_ = UINT64_MAX;                                     \
+        bench_alloc_t a_ = {0};                                          \
+        for (int r_ = 0; r_ < BENCH_ROUNDS; ++r_) {                      \
+            bench_alloc_reset();                                         \
+            uint64_t t0_ = bench_now_ns();                               \
+            for (int k_ = 0; k_ < BENCH_REPS; ++k_) { body; }            \
+            uint64_t dt_ = bench_now_ns() - t0_;                         \
+            if (dt_ < best_) { best_ = dt_; bench_alloc_get(&a_); }      \
+        }                                                                \
+        (out).ns = (double)best_ / BENCH_REPS;                           \
+        (out).allocs = (double)a_.n / BENCH_REPS;                        \
+    } while (0)
+
+// decoded envelop opnieuw als JSON → moet gelijk zijn aan het origineel
+static void assert_same(const char *name, mesh_wire_type_t t0, const mesh_envelope_t *e0,
+                        mesh_wire_type_t t1, const mesh_envelope_t *e1){
+    char *a = json_env_encode(t0, e0), *b = json_env_encode(t1, e1);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(a, b, name);
+    free(a);
+    free(b);
+}
+
+static void bench_frame(const frame_t *f){
+    mesh_wire_type_t type;
+    mesh_envelope_t  e;
+
+    // round-trip: binair en JSON geven dezelfde envelop terug
+    size_t bin_n = mesh_wire_encode(s_buf, sizeof s_buf, f->type, &f->e);
+    TEST_ASSERT_TRUE_MESSAGE(bin_n > 0, f->name);
+    TEST_ASSERT_TRUE_MESSAGE(mesh_wire_decode(s_buf, bin_n, &type, &e, &s_pool), f->name);
+    assert_same(f->name, f->type, &f->e, type, &e);
+
+    char *js = json_env_encode(f->type, &f->e);
+    size_t json_n = strlen(js);
+    cJSON *o = json_env_decode(js, &type, &e);
+    TEST_ASSERT_NOT_NULL_MESSAGE(o, f->name);
+    assert_same(f->name, f->type, &f->e, type, &e);
+    cJSON_Delete(o);
+
+    cost_t be, bd, je, jd;
+    MEASURE(be, (void)mesh_wire_encode(s_buf, sizeof s_buf, f->type, &f->e));
+    MEASURE(bd, (void)mesh_wire_decode(s_buf, bin_n, &type, &e, &s_pool));
+    MEASURE(je, free(json_env_encode(f->type, &f->e)));
+    MEASURE(jd, cJSON_Delete(json_env_decode(js, &type, &e)));
+    free(js);
+
+    bench_emit("wire", "\"frame\":\"%s\",\"bin_bytes\":%zu,\"json_bytes\":%zu,"
+                       "\"bin_enc_us\":%.3f,\"bin_dec_us\":%.3f,\"json_enc_us\":%.3f,\"json_dec_us\":%.3f,"
+                       "\"bin_allocs\":%.1f,\"json_enc_allocs\":%.1f,\"json_dec_allocs\":%.1f",
+               f->name, bin_n, json_n, be.ns / 1000, bd.ns / 1000, je.ns / 1000, jd.ns / 1000,
+               be.allocs + bd.allocs, je.allocs, jd.allocs);
+
+    // binair pad is heap-vrij en kleiner dan JSON
+    TEST_ASSERT_TRUE_MESSAGE(be.allocs == 0 && bd.allocs == 0, f->name);
+    TEST_ASSERT_TRUE_MESSAGE(bin_n < json_n, f->name);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_wire_vs_json(void) {
+    for (int i = 0; i < s_frames_n; ++i) bench_frame(&s_frames[i]);
+}
+
+int main(void) {
+    frames_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_wire_vs_json);
+    int rc = UNITY_END();
+    for (int i = 0; i < s_frames_n; ++i) cJSON_Delete(s_frames[i].e.payload);
+    return rc;
+}